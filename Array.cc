@@ -189,22 +189,25 @@ Array::operator=(const Array &rhs)
     return *this;
 }
 
-void Array::transform_to_dap4(D4Group *root, Constructor *container)
+/**
+ * @brief Bind the named dimensions of this Array to shared dimensions.
+ *
+ * Named DAP2 dimensions become DAP4 shared dimensions. If there is just a
+ * size, no D4Dimension is made (in DAP4 you cannot share a dimension unless
+ * it has a name). jhrg 3/18/14
+ *
+ * A named dimension uses the D4Dimension in \e root with the same name. If there
+ * is none, one is added. If there is one but its size is different, a new
+ * D4Dimension named \<dim\>_\<array\> is added. transform_to_dap4() calls
+ * this; DMR::build_using_dds() calls it again when it builds a variable
+ * apart from the root group and then moves it there.
+ *
+ * @param root Look for (and add) the shared dimensions in this group
+ */
+void Array::bind_shared_dimensions(D4Group *root)
 {
-    Array *dest = static_cast<Array*>(ptr_duplicate());
-
-    // If it's already a DAP4 object then we can just return it!
-    if (is_dap4()) {
-        container->add_var_nocopy(dest);
-    }
-
-    // Process the Array's dimensions, making D4 shared dimensions for
-    // D2 dimensions that are named. If there is just a size, don't make
-    // a D4Dimension (In DAP4 you cannot share a dimension unless it has
-    // a name). jhrg 3/18/14
-
     D4Dimensions *root_dims = root->dims();
-    for (Array::Dim_iter dap2_dim = dest->dim_begin(), e = dest->dim_end(); dap2_dim != e; ++dap2_dim) {
+    for (Array::Dim_iter dap2_dim = dim_begin(), e = dim_end(); dap2_dim != e; ++dap2_dim) {
         if (!(*dap2_dim).name.empty()) {
 
             // If a D4Dimension with the name already exists, use it.
@@ -243,6 +246,18 @@ void Array::transform_to_dap4(D4Group *root, Constructor *container)
         }
 
     }
+}
+
+void Array::transform_to_dap4(D4Group *root, Constructor *container)
+{
+    Array *dest = static_cast<Array*>(ptr_duplicate());
+
+    // If it's already a DAP4 object then we can just return it!
+    if (is_dap4()) {
+        container->add_var_nocopy(dest);
+    }
+
+    dest->bind_shared_dimensions(root);
 
     // Copy the D2 attributes to D4 Attributes
     dest->attributes()->transform_to_dap4(get_attr_table());
@@ -1066,9 +1081,9 @@ void Array::print_decl(ostream &out, string space, bool print_semi, bool constra
  */
 void Array::print_xml(FILE *out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer_core(xml, constrained, "Array");
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 }
 
 /**
@@ -1076,9 +1091,9 @@ void Array::print_xml(FILE *out, string space, bool constrained)
  */
 void Array::print_xml(ostream &out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer_core(xml, constrained, "Array");
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 /**
@@ -1086,9 +1101,9 @@ void Array::print_xml(ostream &out, string space, bool constrained)
  */
 void Array::print_as_map_xml(FILE *out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer_core(xml, constrained, "Map");
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 }
 
 /**
@@ -1096,9 +1111,9 @@ void Array::print_as_map_xml(FILE *out, string space, bool constrained)
  */
 void Array::print_as_map_xml(ostream &out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer_core(xml, constrained, "Map");
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 /**
@@ -1106,9 +1121,9 @@ void Array::print_as_map_xml(ostream &out, string space, bool constrained)
  */
 void Array::print_xml_core(FILE *out, string space, bool constrained, string tag)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer_core(xml, constrained, tag);
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 }
 
 /**
@@ -1116,9 +1131,9 @@ void Array::print_xml_core(FILE *out, string space, bool constrained, string tag
  */
 void Array::print_xml_core(ostream &out, string space, bool constrained, string tag)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer_core(xml, constrained, tag);
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 void Array::print_xml_writer(XMLWriter &xml, bool constrained)
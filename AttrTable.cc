@@ -33,6 +33,8 @@
 #include "config.h"
 
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
 #include <sstream>
 
 #include "AttrTable.h"
@@ -54,6 +56,8 @@ using std::cerr;
 using std::string;
 using std::endl;
 using std::vector;
+using std::map;
+using std::make_pair;
 
 namespace libdap {
 
@@ -155,6 +159,55 @@ AttrType String_to_AttrType(const string &s)
         return Attr_unknown;
 }
 
+// Tables with fewer entries than this are searched without an index
+static const unsigned int index_threshold = 16;
+
+/** Map the name of every entry, including aliases, to its position. Private. */
+void AttrTable::m_build_index()
+{
+    DBG(cerr << "Indexing the " << attr_map.size() << " entries of " << d_name << endl);
+
+    d_names.clear();
+    d_containers.clear();
+
+    for (unsigned int i = 0; i < attr_map.size(); ++i) {
+        // insert() keeps the first position when a name is used twice
+        d_names.insert(make_pair(attr_map[i]->name, i));
+        if (attr_map[i]->type == Attr_container)
+            d_containers.insert(make_pair(attr_map[i]->name, i));
+    }
+
+    d_indexed_size = attr_map.size();
+    d_index_valid = true;
+}
+
+/** Rebuild the index after entries were removed, or drop it if the table
+ is now too small to need one. Private. */
+void AttrTable::m_index_changed()
+{
+    if (attr_map.size() >= index_threshold)
+        m_build_index();
+    else
+        d_index_valid = false;
+}
+
+/** Add the last entry to the index. Call this after appending an entry.
+ The index is built when the table grows large enough to need one. Private. */
+void AttrTable::m_index_added()
+{
+    if (!d_index_valid || d_indexed_size + 1 != attr_map.size()) {
+        m_index_changed();
+        return;
+    }
+
+    unsigned int i = attr_map.size() - 1;
+    d_names.insert(make_pair(attr_map[i]->name, i));
+    if (attr_map[i]->type == Attr_container)
+        d_containers.insert(make_pair(attr_map[i]->name, i));
+
+    d_indexed_size = attr_map.size();
+}
+
 /** Clone the given attribute table in <tt>this</tt>.
  Protected. */
 void AttrTable::clone(const AttrTable &at)
@@ -167,6 +220,8 @@ void AttrTable::clone(const AttrTable &at)
     // and potentially dangerous.
     d_parent = 0;
 
+    d_index_valid = false;
+
     Attr_citer i = at.attr_map.begin();
     Attr_citer ie = at.attr_map.end();
     for (; i != ie; ++i) {
@@ -181,18 +236,21 @@ void AttrTable::clone(const AttrTable &at)
             e->attributes->d_parent = this;
         }
     }
+
+    m_index_changed();
 }
 
 /** @name Instance management functions */
 
 //@{
 AttrTable::AttrTable() :
-    DapObj(), d_name(""), d_parent(0), attr_map(), d_is_global_attribute(true)
+    DapObj(), d_name(""), d_parent(0), attr_map(), d_is_global_attribute(true), d_indexed_size(0),
+    d_index_valid(false)
 {
 }
 
 AttrTable::AttrTable(const AttrTable &rhs) :
-    DapObj()
+    DapObj(), d_indexed_size(0), d_index_valid(false)
 {
     clone(rhs);
 }
@@ -204,6 +262,7 @@ void AttrTable::delete_attr_table()
         delete *i;
     }
     attr_map.clear();
+    d_index_valid = false;
 }
 
 AttrTable::~AttrTable()
@@ -336,6 +395,7 @@ unsigned int AttrTable::append_attr(const string &name, const string &type, cons
         e->attr->push_back(value);
 
         attr_map.push_back(e);
+        m_index_added();
 
         return e->attr->size(); // return the length of the attr vector
     }
@@ -392,6 +452,7 @@ unsigned int AttrTable::append_attr(const string &name, const string &type, vect
         e->attr = new vector<string> (*values);
 
         attr_map.push_back(e);
+        m_index_added();
 
         return e->attr->size(); // return the length of the attr vector
     }
@@ -445,7 +506,7 @@ AttrTable::append_container(AttrTable *at, const string &name)
     string lname = remove_space_encoding(name);
 #endif
 
-    if (simple_find(name) != attr_end())
+    if (simple_find(lname) != attr_end())
         throw Error("There already exists a container called '" + name + "' in this attribute table (" + at->get_name() + "). (1)");
 
     DBG(cerr << "Setting appended attribute container name to: " << lname << endl);
@@ -458,6 +519,7 @@ AttrTable::append_container(AttrTable *at, const string &name)
     e->attributes = at;
 
     attr_map.push_back(e);
+    m_index_added();
 
     at->d_parent = this;
 
@@ -540,6 +602,11 @@ AttrTable::recurrsive_find(const string &target, Attr_iter *location)
  @return An Attr_iter which references \c target. */
 AttrTable::Attr_iter AttrTable::simple_find(const string &target)
 {
+    if (m_use_index()) {
+        map<string, unsigned int>::iterator p = d_names.find(target);
+        return (p == d_names.end()) ? attr_map.end() : attr_map.begin() + p->second;
+    }
+
     Attr_iter i;
     for (i = attr_map.begin(); i != attr_map.end(); ++i) {
         if (target == (*i)->name) {
@@ -585,6 +652,11 @@ AttrTable::simple_find_container(const string &target)
     if (get_name() == target)
         return this;
 
+    if (m_use_index()) {
+        map<string, unsigned int>::iterator p = d_containers.find(target);
+        return (p == d_containers.end()) ? 0 : attr_map[p->second]->attributes;
+    }
+
     for (Attr_iter i = attr_map.begin(); i != attr_map.end(); ++i) {
         if (is_container(i) && target == (*i)->name) {
             return (*i)->attributes;
@@ -656,6 +728,37 @@ AttrTable::get_attr_vector(const string &name)
     return (p != attr_map.end()) ? get_attr_vector(p) : 0;
 }
 
+/** Get the values of a numeric attribute, converted to double. Each value
+ is converted from its text with one call to strtod(), so code that uses
+ numeric attributes such as scale_factor or valid_range doesn't have to
+ do its own parsing.
+
+ @param name The name of the attribute.
+ @param values Value-result parameter; the values are appended.
+ @return False if there is no attribute called <tt>name</tt> or it is not
+ one of the numeric types (Byte through Float64).
+ @exception Error if one of the values is not a number.
+ @brief Get the values of a numeric attribute. */
+bool AttrTable::get_attr_values(const string &name, vector<double> &values)
+{
+    Attr_iter p = simple_find(name);
+    if (p == attr_map.end() || (*p)->type < Attr_byte || (*p)->type > Attr_float64)
+        return false;
+
+    vector<string> &text = *(*p)->attr;
+    values.reserve(values.size() + text.size());
+    for (vector<string>::iterator i = text.begin(), e = text.end(); i != e; ++i) {
+        char *end = 0;
+        errno = 0;
+        double value = strtod(i->c_str(), &end);
+        if (errno == ERANGE || end == i->c_str() || *end != '\0')
+            throw Error(malformed_expr, "The value '" + *i + "' of the attribute '" + name + "' is not a number.");
+        values.push_back(value);
+    }
+
+    return true;
+}
+
 /** Delete the attribute named <tt>name</tt>. If <tt>i</tt> is given, and
  the attribute has a vector value, delete the <tt>i</tt>$^th$
  element of the vector.
@@ -685,6 +788,7 @@ void AttrTable::del_attr(const string &name, int i)
         if (i == -1) { // Delete the whole attribute
             entry *e = *iter;
             attr_map.erase(iter);
+            m_index_changed();
             delete e;
             e = 0;
         }
@@ -799,7 +903,9 @@ AttrTable::Attr_iter AttrTable::del_attr_table(Attr_iter iter)
 
     delete e;
 
-    return attr_map.erase(iter);
+    Attr_iter next = attr_map.erase(iter);
+    m_index_changed();
+    return next;
 }
 
 /** Get the type name of an attribute referenced by \e iter.
@@ -925,6 +1031,7 @@ void AttrTable::add_container_alias(const string &name, AttrTable *src)
     e->attributes = src;
 
     attr_map.push_back(e);
+    m_index_added();
 }
 
 /** Assume \e source names an attribute value in some container. Add an alias
@@ -991,6 +1098,7 @@ void AttrTable::add_value_alias(AttrTable *das, const string &name, const string
         e->attr = (*iter)->attr;
 
     attr_map.push_back(e);
+    m_index_added();
 }
 
 // Deprecated
@@ -1041,6 +1149,7 @@ void AttrTable::erase()
     }
 
     attr_map.erase(attr_map.begin(), attr_map.end());
+    m_index_changed();
 
     d_name = "";
 }
@@ -1312,9 +1421,9 @@ void AttrTable::print(ostream &out, string pad, bool dereference)
  @deprecated */
 void AttrTable::print_xml(FILE *out, string pad, bool /*constrained*/)
 {
-    XMLWriter xml(pad);
+    XMLWriter xml(out, pad);
     print_xml_writer(xml);
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 
 #if OLD_XML_MOETHODS
     ostringstream oss;
@@ -1377,9 +1486,9 @@ void AttrTable::print_xml(FILE *out, string pad, bool /*constrained*/)
  */
 void AttrTable::print_xml(ostream &out, string pad, bool /*constrained*/)
 {
-    XMLWriter xml(pad);
+    XMLWriter xml(out, pad);
     print_xml_writer(xml);
-    out << xml.get_doc();
+    xml.end_doc();
 
 #if 0
     for (Attr_iter i = attr_begin(); i != attr_end(); ++i) {
@@ -35,6 +35,7 @@
 #define _attrtable_h 1
 
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -244,8 +245,24 @@ private:
     // bound to a container and not any of the container's children.
     bool d_is_global_attribute;
 
+    // Lookups by name in tables with many entries use an index that maps
+    // each name (aliases included) to the position of the first entry with
+    // that name. The methods that add or remove entries keep the index
+    // current, so the lookups only read it and a table (e.g., one that is
+    // part of a shared DDS) can be searched by several threads at once.
+    // Don't change an entry's name once it's in the table.
+    std::map<string, unsigned int> d_names;
+    std::map<string, unsigned int> d_containers;
+    unsigned int d_indexed_size;
+    bool d_index_valid;
+
     void delete_attr_table();
 
+    void m_build_index();
+    void m_index_added();
+    void m_index_changed();
+    bool m_use_index() const { return d_index_valid && d_indexed_size == attr_map.size(); }
+
     friend class AttrTableTest;
 
 protected:
@@ -302,6 +319,7 @@ public:
     virtual unsigned int get_attr_num(const string &name);
     virtual string get_attr(const string &name, unsigned int i = 0);
     virtual vector<string> *get_attr_vector(const string &name);
+    virtual bool get_attr_values(const string &name, vector<double> &values);
     virtual void del_attr(const string &name, int i = -1);
 
     virtual Attr_iter attr_begin();
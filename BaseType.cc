@@ -339,12 +339,18 @@ BaseType::FQN() const
         return get_parent()->FQN() + "." + name();
 }
 
-/** @brief Sets the name of the class instance. */
+/** @brief Sets the name of the class instance.
+
+    If this variable is part of a Constructor, the Constructor's index of
+    its variables' names is updated. */
 void
 BaseType::set_name(const string &n)
 {
     string name = n;
     d_name = www2id(name); // www2id writes into its param.
+
+    if (d_parent && d_parent->is_constructor_type())
+        static_cast<Constructor*>(d_parent)->m_var_index_changed();
 }
 
 /** @brief Returns the name of the dataset used to create this instance
@@ -1104,9 +1110,9 @@ BaseType::print_val(FILE *out, string space, bool print_decl_p)
 void
 BaseType::print_xml(FILE *out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer(xml, constrained);
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 }
 
 /** Write the XML representation of this variable. This method is used to
@@ -1119,9 +1125,9 @@ BaseType::print_xml(FILE *out, string space, bool constrained)
 void
 BaseType::print_xml(ostream &out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer(xml, constrained);
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 /** Write the XML representation of this variable. This method is used to
@@ -55,6 +55,7 @@
 #include "Type.h"
 
 #include "DapObj.h"
+#include "InternedString.h"
 
 using namespace std;
 
@@ -117,9 +118,9 @@ class D4Attributes;
 class BaseType : public DapObj
 {
 private:
-    string d_name;  // name of the instance
+    InternedString d_name;  // name of the instance
     Type d_type;   // instance's type
-    string d_dataset; // name of the dataset used to create this BaseType
+    InternedString d_dataset; // name of the dataset used to create this BaseType
 
     bool d_is_read;  // true if the value has been read
     bool d_is_send;  // Is the variable in the projection?
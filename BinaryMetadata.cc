@@ -0,0 +1,818 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <climits>
+#include <cstring>
+#include <sstream>
+
+#include "BaseType.h"
+#include "Array.h"
+#include "Constructor.h"
+#include "Grid.h"
+#include "D4Enum.h"
+#include "D4EnumDefs.h"
+#include "D4Dimensions.h"
+#include "D4Maps.h"
+#include "D4Group.h"
+#include "D4Attributes.h"
+#include "D4BaseTypeFactory.h"
+#include "AttrTable.h"
+#include "DDS.h"
+#include "DMR.h"
+
+#include "BinaryMetadata.h"
+
+#include "Error.h"
+#include "InternalErr.h"
+
+// #define DODS_DEBUG
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+// The first bytes of every document
+static const char binary_metadata_magic[] = { 'D', 'A', 'P', 'B' };
+
+// Change this when the layout changes; readers reject other versions
+static const unsigned int binary_metadata_version = 2;
+
+// The kinds of object a document can hold
+static const unsigned int binary_metadata_dmr = 1;
+static const unsigned int binary_metadata_dds = 2;
+
+// Read all of a stream into a string so it can be decoded from memory
+static string
+read_document(istream &in)
+{
+    ostringstream oss;
+    oss << in.rdbuf();
+    return oss.str();
+}
+
+void
+BinaryMetadataWriter::m_put_uint(string &buf, unsigned long long v)
+{
+    while (v >= 0x80) {
+        buf += static_cast<char>((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    buf += static_cast<char>(v);
+}
+
+// Signed values are 'zig-zag' encoded so small negative numbers stay short
+void
+BinaryMetadataWriter::m_put_int(long long v)
+{
+    unsigned long long u = static_cast<unsigned long long>(v) << 1;
+    m_put_uint(v < 0 ? ~u : u);
+}
+
+void
+BinaryMetadataWriter::m_put_string(const string &s)
+{
+    map<string, unsigned long>::iterator i = d_strings.find(s);
+    if (i == d_strings.end()) {
+        i = d_strings.insert(make_pair(s, d_string_table.size())).first;
+        d_string_table.push_back(&i->first);
+    }
+
+    m_put_uint(i->second);
+}
+
+// The attributes are only read, using the const methods, so the attributes
+// of a frozen DMR are written without copying them (see D4Attributes::freeze()).
+void
+BinaryMetadataWriter::m_put_attributes(const D4Attributes *attrs)
+{
+    if (!attrs || attrs->empty()) {
+        m_put_uint(0);
+        return;
+    }
+
+    m_put_uint(attrs->attribute_cend() - attrs->attribute_cbegin());
+    for (D4Attributes::D4AttributesCIter i = attrs->attribute_cbegin(), e = attrs->attribute_cend(); i != e; ++i) {
+        const D4Attribute *attr = *i;
+        m_put_string(attr->name());
+        m_put_uint(attr->type());
+
+        if (attr->type() == attr_container_c) {
+            m_put_attributes(attr->attributes());
+        }
+        else {
+            m_put_uint(attr->num_values());
+            for (unsigned int v = 0; v < attr->num_values(); ++v)
+                m_put_string(attr->value(v));
+        }
+    }
+}
+
+void
+BinaryMetadataWriter::m_put_attributes(AttrTable &at)
+{
+    m_put_uint(at.get_size());
+    for (AttrTable::Attr_iter i = at.attr_begin(), e = at.attr_end(); i != e; ++i) {
+        m_put_string(at.get_name(i));
+        m_put_uint(at.get_attr_type(i));
+
+        if (at.get_attr_type(i) == Attr_container) {
+            m_put_attributes(*at.get_attr_table(i));
+        }
+        else {
+            vector<string> *values = at.get_attr_vector(i);
+            m_put_uint(values->size());
+            for (vector<string>::iterator v = values->begin(), ve = values->end(); v != ve; ++v)
+                m_put_string(*v);
+        }
+    }
+}
+
+void
+BinaryMetadataWriter::m_put_d4_var(BaseType *btp)
+{
+    m_put_uint(btp->type());
+    m_put_string(btp->name());
+
+    switch (btp->type()) {
+    case dods_enum_c: {
+        D4EnumDef *enum_def = static_cast<D4Enum*>(btp)->enumeration();
+        if (!enum_def)
+            throw InternalErr(__FILE__, __LINE__, "The Enumeration '" + btp->name() + "' has no definition.");
+
+        // Use the same path D4Enum::print_dap4() writes
+        string path = enum_def->name();
+        if (enum_def->parent())
+            path = static_cast<D4Group*>(enum_def->parent()->parent())->FQN() + path;
+        m_put_string(path);
+        break;
+    }
+
+    case dods_array_c: {
+        Array *a = static_cast<Array*>(btp);
+        m_put_d4_var(a->prototype());
+
+        m_put_uint(a->dimensions());
+        for (Array::Dim_iter d = a->dim_begin(), de = a->dim_end(); d != de; ++d) {
+            if (d->dim) {
+                m_put_uint(1);
+                m_put_string(d->dim->fully_qualified_name());
+            }
+            else {
+                m_put_uint(0);
+                m_put_uint(d->size);
+                m_put_string(d->name);
+            }
+        }
+
+        m_put_uint(a->maps()->size());
+        for (D4Maps::D4MapsIter m = a->maps()->map_begin(), me = a->maps()->map_end(); m != me; ++m)
+            m_put_string((*m)->name());
+        break;
+    }
+
+    case dods_structure_c:
+    case dods_sequence_c: {
+        Constructor *c = static_cast<Constructor*>(btp);
+        m_put_uint(c->var_end() - c->var_begin());
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i)
+            m_put_d4_var(*i);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    m_put_attributes(btp->attributes());
+}
+
+void
+BinaryMetadataWriter::m_put_d4_group(D4Group *grp)
+{
+    m_put_attributes(grp->attributes());
+
+    D4Dimensions *dims = grp->dims();
+    m_put_uint(dims->dim_end() - dims->dim_begin());
+    for (D4Dimensions::D4DimensionsIter d = dims->dim_begin(), de = dims->dim_end(); d != de; ++d) {
+        m_put_string((*d)->name());
+        m_put_uint((*d)->size());
+    }
+
+    D4EnumDefs *enum_defs = grp->enum_defs();
+    m_put_uint(enum_defs->enum_end() - enum_defs->enum_begin());
+    for (D4EnumDefs::D4EnumDefIter e = enum_defs->enum_begin(), ee = enum_defs->enum_end(); e != ee; ++e) {
+        D4EnumDef *enum_def = *e;
+        m_put_string(enum_def->name());
+        m_put_uint(enum_def->type());
+        m_put_uint(enum_def->value_end() - enum_def->value_begin());
+        for (D4EnumDef::D4EnumValueIter v = enum_def->value_begin(), ve = enum_def->value_end(); v != ve; ++v) {
+            m_put_string(enum_def->label(v));
+            m_put_int(enum_def->value(v));
+        }
+    }
+
+    m_put_uint(grp->grp_end() - grp->grp_begin());
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g) {
+        m_put_string((*g)->name());
+        m_put_d4_group(*g);
+    }
+}
+
+// The variables are written after all of the groups so that a variable can
+// use a Dimension or Enumeration from any group.
+void
+BinaryMetadataWriter::m_put_d4_vars(D4Group *grp)
+{
+    m_put_uint(grp->var_end() - grp->var_begin());
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i)
+        m_put_d4_var(*i);
+
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        m_put_d4_vars(*g);
+}
+
+void
+BinaryMetadataWriter::m_put_var(BaseType *btp)
+{
+    m_put_uint(btp->type());
+    m_put_string(btp->name());
+
+    switch (btp->type()) {
+    case dods_array_c: {
+        Array *a = static_cast<Array*>(btp);
+        m_put_var(a->prototype());
+
+        m_put_uint(a->dimensions());
+        for (Array::Dim_iter d = a->dim_begin(), de = a->dim_end(); d != de; ++d) {
+            m_put_uint(d->size);
+            m_put_string(d->name);
+        }
+        break;
+    }
+
+    // A Grid's Array is its first variable and its Maps follow
+    case dods_structure_c:
+    case dods_sequence_c:
+    case dods_grid_c: {
+        Constructor *c = static_cast<Constructor*>(btp);
+        m_put_uint(c->var_end() - c->var_begin());
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i)
+            m_put_var(*i);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    m_put_attributes(btp->get_attr_table());
+}
+
+// Write the header and string table, then the body, and reset the writer
+void
+BinaryMetadataWriter::m_finish(ostream &out, unsigned int kind)
+{
+    string header(binary_metadata_magic, sizeof(binary_metadata_magic));
+    m_put_uint(header, binary_metadata_version);
+    m_put_uint(header, kind);
+
+    m_put_uint(header, d_string_table.size());
+    for (vector<const string*>::iterator i = d_string_table.begin(), e = d_string_table.end(); i != e; ++i) {
+        m_put_uint(header, (*i)->size());
+        header.append(**i);
+    }
+
+    out.write(header.data(), header.size());
+    out.write(d_body.data(), d_body.size());
+
+    d_strings.clear();
+    d_string_table.clear();
+    d_body.clear();
+
+    if (!out)
+        throw InternalErr(__FILE__, __LINE__, "Could not write the binary metadata.");
+}
+
+/** Write the DMR.
+    @param dmr Write this DMR
+    @param out Write to this stream */
+void
+BinaryMetadataWriter::print(DMR &dmr, ostream &out)
+{
+    DBG(cerr << "BinaryMetadataWriter::print(DMR) - " << dmr.name() << endl);
+
+    m_put_string(dmr.name());
+    m_put_string(dmr.filename());
+    m_put_string(dmr.dap_version());
+    m_put_string(dmr.dmr_version());
+    m_put_string(dmr.request_xml_base());
+    m_put_string(dmr.get_namespace());
+
+    m_put_d4_group(dmr.root());
+    m_put_d4_vars(dmr.root());
+
+    m_finish(out, binary_metadata_dmr);
+}
+
+/** Write the DDS, including the attributes of its variables and its global
+    attributes. To include the attributes from a DAS, merge them into the
+    DDS using DDS::transfer_attributes() first.
+    @param dds Write this DDS
+    @param out Write to this stream */
+void
+BinaryMetadataWriter::print(DDS &dds, ostream &out)
+{
+    DBG(cerr << "BinaryMetadataWriter::print(DDS) - " << dds.get_dataset_name() << endl);
+
+    m_put_string(dds.get_dataset_name());
+    m_put_string(dds.filename());
+    m_put_string(dds.get_dap_version());
+    m_put_string(dds.get_request_xml_base());
+    m_put_attributes(dds.get_attr_table());
+
+    m_put_uint(dds.var_end() - dds.var_begin());
+    for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i)
+        m_put_var(*i);
+
+    m_finish(out, binary_metadata_dds);
+}
+
+unsigned long long
+BinaryMetadataReader::m_get_uint()
+{
+    unsigned long long v = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (d_pos == d_end)
+            throw Error("The binary metadata document is truncated.");
+
+        unsigned char byte = static_cast<unsigned char>(*d_pos++);
+        v |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return v;
+    }
+
+    throw Error("The binary metadata document is malformed: a number is too long.");
+}
+
+long long
+BinaryMetadataReader::m_get_int()
+{
+    unsigned long long u = m_get_uint();
+    return static_cast<long long>((u & 1) ? ~(u >> 1) : (u >> 1));
+}
+
+const string &
+BinaryMetadataReader::m_get_string()
+{
+    unsigned long long i = m_get_uint();
+    if (i >= d_strings.size())
+        throw Error("The binary metadata document is malformed: a string reference is out of range.");
+
+    return d_strings[i];
+}
+
+// Read a count and check that it's plausible - every item takes at least one
+// byte - so a corrupt document can't make us loop or allocate wildly.
+static unsigned long long
+check_count(unsigned long long count, const char *pos, const char *end)
+{
+    if (count > static_cast<unsigned long long>(end - pos))
+        throw Error("The binary metadata document is malformed: a count is larger than the document.");
+
+    return count;
+}
+
+// Read the size of an Array dimension; Array holds it in an int.
+static int
+check_dim_size(unsigned long long size)
+{
+    if (size > static_cast<unsigned long long>(INT_MAX))
+        throw Error("The binary metadata document is malformed: a dimension size is out of range.");
+
+    return static_cast<int>(size);
+}
+
+void
+BinaryMetadataReader::m_get_attributes(D4Attributes *attrs)
+{
+    unsigned long long n = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < n; ++i) {
+        const string &name = m_get_string();
+        unsigned long long type = m_get_uint();
+        if (type > attr_otherxml_c)
+            throw Error("The binary metadata document is malformed: bad type for the attribute '" + name + "'.");
+
+        D4Attribute *attr = new D4Attribute(name, static_cast<D4AttributeType>(type));
+        attrs->add_attribute_nocopy(attr);
+
+        if (type == attr_container_c) {
+            m_get_attributes(attr->attributes());
+        }
+        else {
+            unsigned long long num_values = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long v = 0; v < num_values; ++v)
+                attr->add_value(m_get_string());
+        }
+    }
+}
+
+void
+BinaryMetadataReader::m_get_attributes(AttrTable &at)
+{
+    unsigned long long n = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < n; ++i) {
+        const string &name = m_get_string();
+        unsigned long long type = m_get_uint();
+        if (type > Attr_other_xml)
+            throw Error("The binary metadata document is malformed: bad type for the attribute '" + name + "'.");
+
+        if (type == Attr_container) {
+            m_get_attributes(*at.append_container(name));
+        }
+        else {
+            unsigned long long num_values = check_count(m_get_uint(), d_pos, d_end);
+            vector<string> values;
+            values.reserve(num_values);
+            for (unsigned long long v = 0; v < num_values; ++v)
+                values.push_back(m_get_string());
+
+            at.append_attr(name, AttrType_to_String(static_cast<AttrType>(type)), &values);
+        }
+    }
+}
+
+// Read a variable declared in the group 'grp'. Names of Dimensions,
+// Enumerations and Maps are resolved the way D4ParserSax2 does.
+BaseType *
+BinaryMetadataReader::m_get_d4_var(D4Group *grp)
+{
+    unsigned long long type = m_get_uint();
+    if (type == dods_null_c || type >= dods_group_c)
+        throw Error("The binary metadata document is malformed: bad type for a variable.");
+
+    const string &name = m_get_string();
+    BaseType *btp = d_dmr->factory()->NewVariable(static_cast<Type>(type), name);
+    if (!btp)
+        throw InternalErr(__FILE__, __LINE__, "Could not instantiate the variable '" + name + "'.");
+
+    try {
+        btp->set_is_dap4(true);
+
+        switch (type) {
+        case dods_enum_c: {
+            const string &path = m_get_string();
+            D4EnumDef *enum_def = (path[0] == '/') ? d_dmr->root()->find_enum_def(path) : grp->find_enum_def(path);
+            if (!enum_def)
+                throw Error("Could not find the Enumeration definition '" + path + "'.");
+
+            static_cast<D4Enum*>(btp)->set_enumeration(enum_def);
+            break;
+        }
+
+        case dods_array_c: {
+            Array *a = static_cast<Array*>(btp);
+            a->add_var_nocopy(m_get_d4_var(grp));
+
+            unsigned long long num_dims = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long i = 0; i < num_dims; ++i) {
+                if (m_get_uint()) {
+                    const string &path = m_get_string();
+                    D4Dimension *dim = (path[0] == '/') ? d_dmr->root()->find_dim(path) : grp->find_dim(path);
+                    if (!dim)
+                        throw Error("The dimension '" + path + "' was not found while reading the variable '"
+                            + name + "'.");
+
+                    a->append_dim(dim);
+                }
+                else {
+                    int size = check_dim_size(m_get_uint());
+                    a->append_dim(size, m_get_string());
+                }
+            }
+
+            // A Map can name an Array that comes later in the document
+            unsigned long long num_maps = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long i = 0; i < num_maps; ++i) {
+                D4Map *map = new D4Map(m_get_string(), 0);
+                a->maps()->add_map(map);
+                d_maps.push_back(pending_map(map, a, grp));
+            }
+            break;
+        }
+
+        case dods_structure_c:
+        case dods_sequence_c: {
+            Constructor *c = static_cast<Constructor*>(btp);
+            unsigned long long n = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long i = 0; i < n; ++i)
+                c->add_var_nocopy(m_get_d4_var(grp));
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        m_get_attributes(btp->attributes());
+    }
+    catch (...) {
+        delete btp;
+        throw;
+    }
+
+    return btp;
+}
+
+void
+BinaryMetadataReader::m_get_d4_group(D4Group *grp)
+{
+    m_get_attributes(grp->attributes());
+
+    unsigned long long num_dims = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < num_dims; ++i) {
+        const string &name = m_get_string();
+        grp->dims()->add_dim_nocopy(new D4Dimension(name, m_get_uint()));
+    }
+
+    unsigned long long num_enums = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < num_enums; ++i) {
+        const string &name = m_get_string();
+        unsigned long long type = m_get_uint();
+        if (type >= dods_group_c)
+            throw Error("The binary metadata document is malformed: bad type for the Enumeration '" + name + "'.");
+
+        D4EnumDef *enum_def = new D4EnumDef(name, static_cast<Type>(type));
+        grp->enum_defs()->add_enum_nocopy(enum_def);
+
+        unsigned long long num_values = check_count(m_get_uint(), d_pos, d_end);
+        for (unsigned long long v = 0; v < num_values; ++v) {
+            const string &label = m_get_string();
+            enum_def->add_value(label, m_get_int());
+        }
+    }
+
+    unsigned long long num_groups = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < num_groups; ++i) {
+        const string &name = m_get_string();
+        D4Group *child = static_cast<D4Group*>(d_dmr->factory()->NewVariable(dods_group_c, name));
+        if (!child)
+            throw InternalErr(__FILE__, __LINE__, "Could not instantiate the Group '" + name + "'.");
+
+        child->set_is_dap4(true);
+        // Link the group first so paths that start at the root resolve
+        grp->add_group_nocopy(child);
+        m_get_d4_group(child);
+    }
+}
+
+void
+BinaryMetadataReader::m_get_d4_vars(D4Group *grp)
+{
+    unsigned long long num_vars = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < num_vars; ++i)
+        grp->add_var_nocopy(m_get_d4_var(grp));
+
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        m_get_d4_vars(*g);
+}
+
+// Link the Maps to their Arrays once all of the variables have been read
+void
+BinaryMetadataReader::m_resolve_maps()
+{
+    for (vector<pending_map>::iterator i = d_maps.begin(), e = d_maps.end(); i != e; ++i) {
+        const string &name = i->map->name();
+        Array *map_source = (name[0] == '/') ? d_dmr->root()->find_map_source(name)
+            : i->group->find_map_source(name);
+        if (!map_source)
+            throw Error("The Map '" + name + "' was not found while reading the variable '" + i->array->name() + "'.");
+
+        i->map->set_array(map_source);
+    }
+
+    d_maps.clear();
+}
+
+BaseType *
+BinaryMetadataReader::m_get_var()
+{
+    unsigned long long type = m_get_uint();
+    if (type == dods_null_c || type > dods_grid_c)
+        throw Error("The binary metadata document is malformed: bad type for a variable.");
+
+    const string &name = m_get_string();
+    BaseType *btp = d_dds->get_factory()->NewVariable(static_cast<Type>(type), name);
+    if (!btp)
+        throw InternalErr(__FILE__, __LINE__, "Could not instantiate the variable '" + name + "'.");
+
+    try {
+        switch (type) {
+        case dods_array_c: {
+            Array *a = static_cast<Array*>(btp);
+            a->add_var_nocopy(m_get_var());
+
+            unsigned long long num_dims = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long i = 0; i < num_dims; ++i) {
+                int size = check_dim_size(m_get_uint());
+                a->append_dim(size, m_get_string());
+            }
+            break;
+        }
+
+        case dods_structure_c:
+        case dods_sequence_c: {
+            Constructor *c = static_cast<Constructor*>(btp);
+            unsigned long long n = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long i = 0; i < n; ++i)
+                c->add_var_nocopy(m_get_var());
+            break;
+        }
+
+        case dods_grid_c: {
+            Grid *g = static_cast<Grid*>(btp);
+            unsigned long long n = check_count(m_get_uint(), d_pos, d_end);
+            for (unsigned long long i = 0; i < n; ++i) {
+                BaseType *part = m_get_var();
+                if (part->type() != dods_array_c) {
+                    delete part;
+                    throw Error("The binary metadata document is malformed: the Grid '" + name
+                        + "' holds a variable that is not an Array.");
+                }
+
+                if (i == 0)
+                    g->set_array(static_cast<Array*>(part));
+                else
+                    g->add_map(static_cast<Array*>(part), false);
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        m_get_attributes(btp->get_attr_table());
+    }
+    catch (...) {
+        delete btp;
+        throw;
+    }
+
+    return btp;
+}
+
+// Check the header and read the string table
+void
+BinaryMetadataReader::m_start(const char *buffer, unsigned long size, unsigned int kind)
+{
+    d_strings.clear();
+    d_maps.clear();
+    d_pos = buffer;
+    d_end = buffer + size;
+
+    if (size < sizeof(binary_metadata_magic)
+        || memcmp(buffer, binary_metadata_magic, sizeof(binary_metadata_magic)) != 0)
+        throw Error("The document does not hold binary metadata.");
+
+    d_pos += sizeof(binary_metadata_magic);
+
+    unsigned long long version = m_get_uint();
+    if (version != binary_metadata_version) {
+        ostringstream oss;
+        oss << "Expected version " << binary_metadata_version << " of the binary metadata format but found version "
+            << version << ".";
+        throw Error(oss.str());
+    }
+
+    if (m_get_uint() != kind)
+        throw Error(string("The binary metadata document does not hold a ")
+            + (kind == binary_metadata_dmr ? "DMR." : "DDS."));
+
+    unsigned long long num_strings = check_count(m_get_uint(), d_pos, d_end);
+    d_strings.reserve(num_strings);
+    for (unsigned long long i = 0; i < num_strings; ++i) {
+        unsigned long long length = m_get_uint();
+        if (length > static_cast<unsigned long long>(d_end - d_pos))
+            throw Error("The binary metadata document is truncated.");
+
+        d_strings.push_back(string(d_pos, length));
+        d_pos += length;
+    }
+}
+
+/** Build a DMR from a binary metadata document.
+    @param buffer The document
+    @param size The number of bytes in the document
+    @param dmr Add the variables to this DMR; it must have a factory and
+    should be empty. */
+void
+BinaryMetadataReader::intern(const char *buffer, unsigned long size, DMR *dmr)
+{
+    if (!dmr || !dmr->factory())
+        throw InternalErr(__FILE__, __LINE__, "A DMR with a factory is needed to read binary metadata.");
+
+    m_start(buffer, size, binary_metadata_dmr);
+    d_dmr = dmr;
+
+    dmr->set_name(m_get_string());
+    dmr->set_filename(m_get_string());
+    dmr->set_dap_version(m_get_string());
+    dmr->set_dmr_version(m_get_string());
+    dmr->set_request_xml_base(m_get_string());
+    dmr->set_namespace(m_get_string());
+
+    m_get_d4_group(dmr->root());
+    m_get_d4_vars(dmr->root());
+
+    if (d_pos != d_end)
+        throw Error("The binary metadata document has extra data at its end.");
+
+    m_resolve_maps();
+
+    d_dmr = 0;
+    d_strings.clear();
+}
+
+/** Build a DMR from a binary metadata document read from a stream.
+    @param in Read the document from this stream
+    @param dmr Add the variables to this DMR */
+void
+BinaryMetadataReader::intern(istream &in, DMR *dmr)
+{
+    string document = read_document(in);
+    intern(document.data(), document.size(), dmr);
+}
+
+/** Build a DDS from a binary metadata document.
+    @param buffer The document
+    @param size The number of bytes in the document
+    @param dds Add the variables to this DDS; it must have a factory and
+    should be empty. */
+void
+BinaryMetadataReader::intern(const char *buffer, unsigned long size, DDS *dds)
+{
+    if (!dds || !dds->get_factory())
+        throw InternalErr(__FILE__, __LINE__, "A DDS with a factory is needed to read binary metadata.");
+
+    m_start(buffer, size, binary_metadata_dds);
+    d_dds = dds;
+
+    dds->set_dataset_name(m_get_string());
+    dds->filename(m_get_string());
+
+    const string &version = m_get_string();
+    try {
+        dds->set_dap_version(version);
+    }
+    catch (InternalErr &e) {
+        throw Error("The binary metadata document is malformed: bad DAP version '" + version + "'.");
+    }
+
+    dds->set_request_xml_base(m_get_string());
+    m_get_attributes(dds->get_attr_table());
+
+    unsigned long long num_vars = check_count(m_get_uint(), d_pos, d_end);
+    for (unsigned long long i = 0; i < num_vars; ++i)
+        dds->add_var_nocopy(m_get_var());
+
+    if (d_pos != d_end)
+        throw Error("The binary metadata document has extra data at its end.");
+
+    d_dds = 0;
+    d_strings.clear();
+}
+
+/** Build a DDS from a binary metadata document read from a stream.
+    @param in Read the document from this stream
+    @param dds Add the variables to this DDS */
+void
+BinaryMetadataReader::intern(istream &in, DDS *dds)
+{
+    string document = read_document(in);
+    intern(document.data(), document.size(), dds);
+}
+
+} // namespace libdap
@@ -0,0 +1,149 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _binary_metadata_h
+#define _binary_metadata_h 1
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace libdap
+{
+
+class Array;
+class AttrTable;
+class BaseType;
+class Constructor;
+class D4Attributes;
+class D4Group;
+class D4Map;
+class DDS;
+class DMR;
+
+/** @brief Write a DMR or a DDS (with its attributes) in a compact binary form.
+
+    The binary form is meant for metadata caches kept by servers: a cached
+    DMR or DDS can be rebuilt with BinaryMetadataReader without the cost of
+    parsing XML (or a DDS and DAS). It is not a transmission format; it is
+    only guaranteed to be read by the version of libdap that wrote it.
+
+    The document starts with the characters 'DAPB', the format version and
+    the kind of object (DMR or DDS). Every name, label and attribute value is
+    stored once in a table of strings that follows, and the object itself
+    refers to those strings by number. Numbers are written as
+    variable-length unsigned integers, seven bits per byte, so the format
+    does not depend on the byte order of the host. The variables are written
+    in the order they are declared. The groups of a DMR, with their
+    Dimensions and Enumerations, come before all of the variables, so a
+    variable can use a Dimension defined in any group.
+
+    @note Aliases in a DDS's attribute tables are written as copies of the
+    attributes they name.
+    @see BinaryMetadataReader */
+class BinaryMetadataWriter
+{
+private:
+    std::map<std::string, unsigned long> d_strings;
+    std::vector<const std::string*> d_string_table;
+    std::string d_body;
+
+    void m_put_uint(std::string &buf, unsigned long long v);
+    void m_put_uint(unsigned long long v) { m_put_uint(d_body, v); }
+    void m_put_int(long long v);
+    void m_put_string(const std::string &s);
+
+    void m_put_attributes(const D4Attributes *attrs);
+    void m_put_attributes(AttrTable &at);
+    void m_put_d4_var(BaseType *btp);
+    void m_put_d4_group(D4Group *grp);
+    void m_put_d4_vars(D4Group *grp);
+    void m_put_var(BaseType *btp);
+
+    void m_finish(std::ostream &out, unsigned int kind);
+
+public:
+    BinaryMetadataWriter() { }
+    virtual ~BinaryMetadataWriter() { }
+
+    void print(DMR &dmr, std::ostream &out);
+    void print(DDS &dds, std::ostream &out);
+};
+
+/** @brief Build a DMR or a DDS from the output of BinaryMetadataWriter.
+
+    The whole document is read at once and decoded from memory; the
+    variables are made using the factory of the DMR or DDS, as the XML and
+    DDS parsers do. A document that was not written by BinaryMetadataWriter,
+    is truncated or holds the wrong kind of object is an Error.
+
+    @see BinaryMetadataWriter */
+class BinaryMetadataReader
+{
+private:
+    const char *d_pos;
+    const char *d_end;
+    std::vector<std::string> d_strings;
+
+    DMR *d_dmr;
+    DDS *d_dds;
+
+    // Maps are linked to their Arrays after all the variables are read
+    struct pending_map {
+        D4Map *map;
+        Array *array;
+        D4Group *group;
+
+        pending_map(D4Map *m, Array *a, D4Group *g) : map(m), array(a), group(g) { }
+    };
+    std::vector<pending_map> d_maps;
+
+    unsigned long long m_get_uint();
+    long long m_get_int();
+    const std::string &m_get_string();
+
+    void m_get_attributes(D4Attributes *attrs);
+    void m_get_attributes(AttrTable &at);
+    BaseType *m_get_d4_var(D4Group *grp);
+    void m_get_d4_group(D4Group *grp);
+    void m_get_d4_vars(D4Group *grp);
+    void m_resolve_maps();
+    BaseType *m_get_var();
+
+    void m_start(const char *buffer, unsigned long size, unsigned int kind);
+
+public:
+    BinaryMetadataReader() : d_pos(0), d_end(0), d_dmr(0), d_dds(0) { }
+    virtual ~BinaryMetadataReader() { }
+
+    void intern(const char *buffer, unsigned long size, DMR *dmr);
+    void intern(std::istream &in, DMR *dmr);
+
+    void intern(const char *buffer, unsigned long size, DDS *dds);
+    void intern(std::istream &in, DDS *dds);
+};
+
+} // namespace libdap
+
+#endif // _binary_metadata_h
@@ -0,0 +1,117 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <time.h>
+
+#include "CancelToken.h"
+#include "Error.h"
+
+namespace libdap {
+
+/** Make a token that has no deadline and has not been cancelled. */
+CancelToken::CancelToken() : d_cancelled(0)
+{
+    d_deadline.tv_sec = 0;
+    d_deadline.tv_nsec = 0;
+}
+
+/** Set the deadline to be \c milliseconds from now. A value of zero (or
+    less) means there is no deadline.
+    @param milliseconds The time the work has, starting now. */
+void
+CancelToken::set_timeout(long milliseconds)
+{
+    if (milliseconds <= 0) {
+        d_deadline.tv_sec = 0;
+        d_deadline.tv_nsec = 0;
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &d_deadline);
+    d_deadline.tv_sec += milliseconds / 1000;
+    d_deadline.tv_nsec += (milliseconds % 1000) * 1000000;
+    if (d_deadline.tv_nsec >= 1000000000) {
+        d_deadline.tv_sec += 1;
+        d_deadline.tv_nsec -= 1000000000;
+    }
+}
+
+/** @return True if there is a deadline and it has passed. */
+bool
+CancelToken::expired() const
+{
+    if (!has_deadline())
+        return false;
+
+    return time_left() == 0;
+}
+
+/** @return The milliseconds until the deadline, zero if it has passed or
+    -1 if there is no deadline. */
+long
+CancelToken::time_left() const
+{
+    if (!has_deadline())
+        return -1;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long sec = d_deadline.tv_sec - now.tv_sec;
+    long nsec = d_deadline.tv_nsec - now.tv_nsec;
+    if (nsec < 0) {
+        sec -= 1;
+        nsec += 1000000000;
+    }
+    if (sec < 0 || (sec == 0 && nsec == 0))
+        return 0;
+
+    // Round up; zero means the deadline has passed
+    return sec * 1000 + (nsec + 999999) / 1000000;
+}
+
+/** Stop the work using this token the next time it checks the token. This
+    may be called from any thread. */
+void
+CancelToken::cancel()
+{
+    __sync_lock_test_and_set(&d_cancelled, 1);
+}
+
+/** Throw Error if cancel() has been called or the deadline has passed.
+    Code that builds a response calls this between the pieces of the
+    response.
+    @exception Error Thrown if the work should stop. */
+void
+CancelToken::check() const
+{
+    if (cancel_called())
+        throw Error("The request was cancelled.");
+
+    if (expired())
+        throw Error("The request did not finish before its deadline.");
+}
+
+} // namespace libdap
@@ -0,0 +1,84 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _cancel_token_h
+#define _cancel_token_h 1
+
+#include <time.h>
+
+namespace libdap
+{
+
+/** @brief Stop building a response once its deadline passes or it is
+    cancelled.
+
+    DODSFilter and DDS::timeout_on() limit the time spent on a response
+    with alarm() and SignalHandler. Both are global to the process, so
+    they cannot be used by a server that answers requests in threads.
+    A CancelToken is the threaded alternative: it belongs to one request
+    and holds that request's deadline, and any thread may call cancel()
+    to stop the request early.
+
+    The cancellation is cooperative. Give the token to the Marshaller
+    used to send the response (Marshaller::set_cancel_token()); the
+    marshallers check it before each vector is written, Vector checks it
+    before each element of an array of strings or of constructors, and
+    Sequence and D4Sequence check it before each row. Once the deadline
+    has passed, or cancel() has been called, check() throws Error and
+    serialization stops. A DAP4 server should then call
+    chunked_ostream::write_err_chunk() with the error's message so the
+    client sees an error instead of a truncated response.
+
+    The deadline is a time of the CLOCK_MONOTONIC clock, so setting the
+    system's clock does not move it.
+
+    Set the deadline before the token is used by other threads; cancel()
+    and the checks may be called from any thread at any time. */
+class CancelToken
+{
+private:
+    struct timespec d_deadline; // CLOCK_MONOTONIC; zero if there is no deadline
+    volatile int d_cancelled;   // Set by cancel()
+
+public:
+    CancelToken();
+
+    void set_timeout(long milliseconds);
+    void set_deadline(const struct timespec &deadline) { d_deadline = deadline; }
+    struct timespec get_deadline() const { return d_deadline; }
+    bool has_deadline() const { return d_deadline.tv_sec != 0 || d_deadline.tv_nsec != 0; }
+    bool expired() const;
+    long time_left() const;
+
+    void cancel();
+    bool cancel_called() const { return d_cancelled != 0; }
+
+    /// True if cancel() was called or the deadline has passed
+    bool cancelled() const { return cancel_called() || expired(); }
+
+    void check() const;
+};
+
+} // namespace libdap
+
+#endif // _cancel_token_h
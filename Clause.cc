@@ -245,4 +245,22 @@ Clause::value(DDS &dds, BaseType **value)
     }
 }
 
+/** Add the variables used by this clause, including those used by the
+    arguments of any functions it calls, to \e vars. Evaluating two
+    clauses that use none of the same variables does not read or change
+    the same variables.
+
+    @param vars Value-result parameter */
+void
+Clause::variables(std::vector<BaseType*> &vars) const
+{
+    if (_arg1)
+        _arg1->variables(vars);
+
+    if (_args) {
+        for (rvalue_list_citer i = _args->begin(), e = _args->end(); i != e; ++i)
+            (*i)->variables(vars);
+    }
+}
+
 } // namespace libdap
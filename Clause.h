@@ -107,6 +107,8 @@ private:
     Clause(const Clause &);
     Clause &operator=(const Clause &);
 
+    friend class SelectionProgram;
+
 public:
     Clause(const int oper, rvalue *a1, rvalue_list *rv);
     Clause(bool_func func, rvalue_list *rv);
@@ -124,6 +126,8 @@ public:
     bool value(DDS &dds);
 
     bool value(DDS &dds, BaseType **value);
+
+    void variables(std::vector<BaseType*> &vars) const;
 };
 
 } // namespace libdap
@@ -0,0 +1,190 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _constraint_cache_h
+#define _constraint_cache_h 1
+
+#include <pthread.h>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include "InternalErr.h"
+
+namespace libdap
+{
+
+/** @brief A cache of parsed constraint expressions.
+
+    Servers see the same few constraint expressions over and over. The
+    constraint evaluators can keep the parts of a parse that do not depend
+    on the dataset in one of these, keyed on the text of the expression,
+    and use them the next time the expression is seen instead of parsing
+    it again. D4ConstraintEvaluator keeps the operations its parser builds
+    (see D4ConstraintEvaluator::Parse_cache). The DAP2 grammar binds a CE
+    to the DDS as it is parsed, so ConstraintEvaluator has nothing of the
+    kind to keep.
+
+    The cache holds at most a fixed number of expressions; when it is full
+    the one used least recently is removed. The cache is MT-safe, so one
+    cache can be shared by the evaluators of many threads. It does not
+    belong to the evaluators that use it.
+
+    @param T The parsed form of an expression; it must be copyable. */
+template<class T>
+class ConstraintCache
+{
+private:
+    struct entry {
+        T value;
+        std::list<const std::string*>::iterator lru;
+    };
+
+    typedef std::map<std::string, entry> entry_map;
+
+    class cache_lock {
+    private:
+        pthread_mutex_t &d_mutex;
+
+    public:
+        cache_lock(pthread_mutex_t &mutex) : d_mutex(mutex) { pthread_mutex_lock(&d_mutex); }
+        ~cache_lock() { pthread_mutex_unlock(&d_mutex); }
+    };
+
+    entry_map d_entries;
+    std::list<const std::string*> d_lru;    // Most recently used first
+
+    unsigned long d_max_entries;
+
+    unsigned long d_hits;
+    unsigned long d_misses;
+
+    pthread_mutex_t d_mutex;
+
+    ConstraintCache(const ConstraintCache &);
+    ConstraintCache &operator=(const ConstraintCache &);
+
+public:
+    /** @brief Make an empty cache
+        @param max_entries The cache holds at most this many expressions. */
+    ConstraintCache(unsigned long max_entries) : d_entries(), d_lru(), d_max_entries(max_entries), d_hits(0), d_misses(0)
+    {
+        if (pthread_mutex_init(&d_mutex, 0) != 0)
+            throw InternalErr(__FILE__, __LINE__, "Could not initialize the constraint cache mutex.");
+    }
+
+    virtual ~ConstraintCache()
+    {
+        pthread_mutex_destroy(&d_mutex);
+    }
+
+    /** @brief Look for the parsed form of an expression.
+        @param expr The constraint expression
+        @param value The parsed form, if found
+        @return True if the expression was found */
+    virtual bool get(const std::string &expr, T &value)
+    {
+        cache_lock lock(d_mutex);
+
+        typename entry_map::iterator i = d_entries.find(expr);
+        if (i == d_entries.end()) {
+            ++d_misses;
+            return false;
+        }
+
+        d_lru.splice(d_lru.begin(), d_lru, i->second.lru);
+        value = i->second.value;
+        ++d_hits;
+        return true;
+    }
+
+    /** @brief Add the parsed form of an expression.
+
+        This replaces any value the expression already has. If the cache
+        is full, the expression used least recently is removed.
+
+        @param expr The constraint expression
+        @param value Its parsed form */
+    virtual void put(const std::string &expr, const T &value)
+    {
+        cache_lock lock(d_mutex);
+
+        if (d_max_entries == 0)
+            return;
+
+        typename entry_map::iterator i = d_entries.find(expr);
+        if (i != d_entries.end()) {
+            i->second.value = value;
+            d_lru.splice(d_lru.begin(), d_lru, i->second.lru);
+            return;
+        }
+
+        while (d_entries.size() >= d_max_entries) {
+            d_entries.erase(*d_lru.back());
+            d_lru.pop_back();
+        }
+
+        i = d_entries.insert(std::make_pair(expr, entry())).first;
+        i->second.value = value;
+        d_lru.push_front(&i->first);
+        i->second.lru = d_lru.begin();
+    }
+
+    /// Remove all of the expressions
+    virtual void clear()
+    {
+        cache_lock lock(d_mutex);
+
+        d_lru.clear();
+        d_entries.clear();
+    }
+
+    /// The most expressions the cache holds
+    unsigned long max_entries() const { return d_max_entries; }
+
+    /// The number of expressions in the cache
+    unsigned long entries()
+    {
+        cache_lock lock(d_mutex);
+        return d_entries.size();
+    }
+
+    /// The number of times get() found an expression
+    unsigned long hits()
+    {
+        cache_lock lock(d_mutex);
+        return d_hits;
+    }
+
+    /// The number of times get() did not find an expression
+    unsigned long misses()
+    {
+        cache_lock lock(d_mutex);
+        return d_misses;
+    }
+};
+
+} // namespace libdap
+
+#endif // _constraint_cache_h
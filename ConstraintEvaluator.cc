@@ -24,30 +24,35 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 //#define DODS_DEBUG
 
 #include "ServerFunctionsList.h"
 #include "ConstraintEvaluator.h"
 #include "Clause.h"
+#include "SelectionProgram.h"
 #include "DataDDS.h"
+#include "ParallelLoop.h"
+#include "FunctionResultCache.h"
 
 #include "ce_parser.h"
 #include "debug.h"
 #include "parser.h"
 #include "expr.h"
-
-struct yy_buffer_state;
+#include "util.h"
 
 int ce_exprparse(libdap::ce_parser_arg *arg);
 
-// Glue routines declared in expr.lex
-void ce_expr_switch_to_buffer(void *new_buffer);
-void ce_expr_delete_buffer(void * buffer);
-void *ce_expr_string(const char *yy_str);
+// Glue routines declared in ce_expr.lex
+void *ce_expr_scanner(const char *str);
+void ce_expr_delete_scanner(void *scanner);
 
 namespace libdap {
 
-ConstraintEvaluator::ConstraintEvaluator()
+ConstraintEvaluator::ConstraintEvaluator() :
+    d_selection(0), d_function_threads(1), d_function_cache(0), d_cache_last_modified(0),
+    d_cancel_token(0)
 {
     // Functions are now held in BES modules. jhrg 1/30/13
 
@@ -61,6 +66,8 @@ ConstraintEvaluator::ConstraintEvaluator()
 
 ConstraintEvaluator::~ConstraintEvaluator()
 {
+    delete d_selection;
+
     // delete all the constants created by the parser for CE evaluation
     for (Constants_iter j = constants.begin(); j != constants.end(); j++) {
         BaseType *btp = *j;
@@ -115,6 +122,9 @@ void ConstraintEvaluator::append_clause(int op, rvalue *arg1, rvalue_list *arg2)
     Clause *clause = new Clause(op, arg1, arg2);
 
     expr.push_back(clause);
+
+    delete d_selection;
+    d_selection = 0;
 }
 
 /** @brief Add a clause to a constraint expression.
@@ -131,6 +141,9 @@ void ConstraintEvaluator::append_clause(bool_func func, rvalue_list *args)
     Clause *clause = new Clause(func, args);
 
     expr.push_back(clause);
+
+    delete d_selection;
+    d_selection = 0;
 }
 
 /** @brief Add a clause to a constraint expression.
@@ -147,6 +160,9 @@ void ConstraintEvaluator::append_clause(btp_func func, rvalue_list *args)
     Clause *clause = new Clause(func, args);
 
     expr.push_back(clause);
+
+    delete d_selection;
+    d_selection = 0;
 }
 
 /** The Constraint Evaluator maintains a list of BaseType pointers for all the
@@ -237,6 +253,118 @@ bool ConstraintEvaluator::function_clauses()
     return true;
 }
 
+namespace {
+
+// Evaluate the clauses of each group in order. The groups share no
+// variables, so different groups can be evaluated at the same time.
+class eval_clause_groups: public ParallelLoop::Body {
+    const vector<Clause*> &d_clauses;
+    const vector<vector<unsigned long> > &d_groups;
+    DDS &d_dds;
+    vector<BaseType*> &d_results;
+
+public:
+    eval_clause_groups(const vector<Clause*> &clauses, const vector<vector<unsigned long> > &groups, DDS &dds,
+        vector<BaseType*> &results) :
+        d_clauses(clauses), d_groups(groups), d_dds(dds), d_results(results) { }
+
+    void run(unsigned long g)
+    {
+        for (vector<unsigned long>::const_iterator i = d_groups[g].begin(), e = d_groups[g].end(); i != e; ++i) {
+            BaseType *result = 0;
+            if (d_clauses[*i]->value(d_dds, &result))
+                d_results[*i] = result;
+        }
+    }
+};
+
+void delete_results(vector<BaseType*> &results)
+{
+    for (vector<BaseType*>::iterator i = results.begin(), e = results.end(); i != e; ++i) {
+        delete *i;
+        *i = 0;
+    }
+}
+
+} // anonymous namespace
+
+// Evaluate the function clauses and add their values to fdds, in the order
+// of the clauses in the CE. With more than one thread, clauses that use
+// none of the same variables are evaluated at the same time.
+static void
+eval_clauses(vector<Clause*> &expr, DDS &dds, unsigned int threads, DDS &fdds)
+{
+    if (threads <= 1 || expr.size() < 2) {
+        for (unsigned int i = 0; i < expr.size(); ++i) {
+            Clause *cp = expr[i];
+            BaseType *result;
+            if (cp->value(dds, &result)) {
+                // This is correct: The function must allocate the memory for the result
+                // variable. 11/30/12 jhrg
+                fdds.add_var_nocopy(result);
+            }
+            else {
+                throw Error(internal_error, "A function was called but failed to return a value.");
+            }
+        }
+
+        return;
+    }
+
+    vector<vector<BaseType*> > uses(expr.size());
+    for (unsigned int i = 0; i < expr.size(); ++i)
+        expr[i]->variables(uses[i]);
+
+    vector<vector<unsigned long> > groups;
+    independent_groups(uses, groups);
+
+    vector<BaseType*> results(expr.size(), static_cast<BaseType*>(0));
+    try {
+        eval_clause_groups body(expr, groups, dds, results);
+        ParallelLoop(body, groups.size()).run(threads);
+    }
+    catch (...) {
+        delete_results(results);
+        throw;
+    }
+
+    if (find(results.begin(), results.end(), static_cast<BaseType*>(0)) != results.end()) {
+        delete_results(results);
+        throw Error(internal_error, "A function was called but failed to return a value.");
+    }
+
+    for (vector<BaseType*>::iterator i = results.begin(), e = results.end(); i != e; ++i)
+        fdds.add_var_nocopy(*i);
+}
+
+// Evaluate the function clauses, or read their values from the function
+// result cache. The cache is used only when it can be given a key and the
+// result can be read back.
+void
+ConstraintEvaluator::eval_cached_function_clauses(DDS &dds, DDS &fdds)
+{
+    if (!d_function_cache || d_expression.empty() || !fdds.get_factory()) {
+        eval_clauses(expr, dds, d_function_threads, fdds);
+        return;
+    }
+
+    string key = FunctionResultCache::make_key(d_cache_dataset, d_cache_last_modified, d_expression);
+    if (d_function_cache->get(key, fdds, d_cancel_token)) {
+        DBG(cerr << "Found the function result for: " << key << endl);
+        return;
+    }
+
+    try {
+        eval_clauses(expr, dds, d_function_threads, fdds);
+    }
+    catch (...) {
+        d_function_cache->abandon(key);
+        throw;
+    }
+
+    d_function_cache->put(key, fdds);
+}
+
 /** @brief Evaluate a function-valued constraint expression that contains
  several function calls.
 
@@ -259,18 +387,12 @@ ConstraintEvaluator::eval_function_clauses(DDS &dds)
         throw InternalErr(__FILE__, __LINE__, "The constraint expression is empty.");
 
     DDS *fdds = new DDS(dds.get_factory(), "function_result_" + dds.get_dataset_name());
-    for (unsigned int i = 0; i < expr.size(); ++i) {
-        Clause *cp = expr[i];
-        BaseType *result;
-        if (cp->value(dds, &result)) {
-            // This is correct: The function must allocate the memory for the result
-            // variable. 11/30/12 jhrg
-            fdds->add_var_nocopy(result);
-        }
-        else {
-            delete fdds;
-            throw Error(internal_error, "A function was called but failed to return a value.");
-        }
+    try {
+        eval_cached_function_clauses(dds, *fdds);
+    }
+    catch (...) {
+        delete fdds;
+        throw;
     }
 
     return fdds;
@@ -289,17 +411,12 @@ ConstraintEvaluator::eval_function_clauses(DataDDS &dds)
 
     DataDDS *fdds = new DataDDS(dds.get_factory(), "function_result_" + dds.get_dataset_name(), dds.get_version(),
             dds.get_protocol());
-
-    for (unsigned int i = 0; i < expr.size(); ++i) {
-        Clause *cp = expr[i];
-        BaseType *result;
-        if (cp->value(dds, &result)) {
-            fdds->add_var_nocopy(result);
-        }
-        else {
-            delete fdds;
-            throw Error(internal_error, "A function was called but failed to return a value.");
-        }
+    try {
+        eval_cached_function_clauses(dds, *fdds);
+    }
+    catch (...) {
+        delete fdds;
+        throw;
     }
 
     return fdds;
@@ -338,16 +455,13 @@ bool ConstraintEvaluator::eval_selection(DDS &dds, const string &)
     // A CE is made up of zero or more clauses, each of which has a boolean
     // value. The value of the CE is the logical AND of the clause
     // values. See ConstraintEvaluator::clause::value(...) for information on logical ORs in
-    // CEs.
-    bool result = true;
-    for (Clause_iter i = expr.begin(); i != expr.end() && result; i++) {
-        // A selection expression *must* contain only boolean clauses!
-        if (!((*i)->boolean_clause()))
-            throw InternalErr(__FILE__, __LINE__, "A selection expression must contain only boolean clauses.");
-        result = result && (*i)->value(dds);
-    }
+    // CEs. This is called once per row of a Sequence, so the clauses are
+    // compiled the first time through and the compiled form is used after
+    // that. The program is discarded when a clause is added.
+    if (!d_selection)
+        d_selection = new SelectionProgram(expr, constants);
 
-    return result;
+    return d_selection->eval(dds);
 }
 
 /** @brief Parse the constraint expression given the current DDS.
@@ -359,23 +473,30 @@ bool ConstraintEvaluator::eval_selection(DDS &dds, const string &)
  @param constraint A string containing the constraint expression.
  @param dds The DDS that provides the environment within which the
  constraint is evaluated.
+ @note The parser is reentrant; evaluators used by different threads can
+ parse constraints at the same time.
  @exception Throws Error if the constraint does not parse. */
 void ConstraintEvaluator::parse_constraint(const string &constraint, DDS &dds)
 {
-    void *buffer = ce_expr_string(constraint.c_str());
-
-    ce_expr_switch_to_buffer(buffer);
+    // Each call adds clauses, so the key of a cached function result uses
+    // all of the text parsed.
+    if (!d_expression.empty())
+        d_expression += "&";
+    d_expression += constraint;
 
     ce_parser_arg arg(this, &dds);
 
+    void *scanner = ce_expr_scanner(constraint.c_str());
+    arg.set_scanner(scanner);
+
     // For all errors, exprparse will throw Error.
     try {
     	ce_exprparse(&arg);
-    	ce_expr_delete_buffer(buffer);
+    	ce_expr_delete_scanner(scanner);
     }
     catch (...) {
-    	// Make sure to remove the buffer when there's an error
-    	ce_expr_delete_buffer(buffer);
+    	// Make sure to remove the scanner when there's an error
+    	ce_expr_delete_scanner(scanner);
     	throw;
     }
 }
@@ -25,6 +25,9 @@
 #ifndef constraint_evaluator_h
 #define constraint_evaluator_h
 
+#include <ctime>
+
+#include <string>
 #include <vector>
 
 #include "expr.h"
@@ -37,6 +40,9 @@ class DDS;
 class DataDDS;
 struct Clause;
 class ServerFunctionsList;
+class SelectionProgram;
+class FunctionResultCache;
+class CancelToken;
 
 /** @brief Evaluate a constraint expression */
 class ConstraintEvaluator
@@ -49,6 +55,19 @@ private:
     ServerFunctionsList *d_functions_list;  // Known external functions from
                                             // modules
 
+    SelectionProgram *d_selection;  // The clauses, compiled by eval_selection()
+
+    unsigned int d_function_threads;    // Used by eval_function_clauses()
+
+    std::string d_expression;           // The text given to parse_constraint()
+
+    FunctionResultCache *d_function_cache;  // Weak pointer; see set_function_cache()
+    std::string d_cache_dataset;
+    time_t d_cache_last_modified;
+    const CancelToken *d_cancel_token;      // Weak pointer; see set_cancel_token()
+
+    void eval_cached_function_clauses(DDS &dds, DDS &fdds);
+
     // The default versions of these methods will break this class. Because
     // Clause does not support deep copies, that class will need to be modified
     // before these can be properly implemented. jhrg 4/3/06
@@ -86,6 +105,43 @@ public:
     DDS *eval_function_clauses(DDS &dds);
     DataDDS *eval_function_clauses(DataDDS &dds);
 
+    /** Get/set the number of threads used by eval_function_clauses(). The
+        default is one, which evaluates the function calls in order in the
+        calling thread. With more than one, calls that use none of the same
+        variables are evaluated at the same time; the results are in the
+        same order either way. Only use more than one thread when the
+        functions and the read() methods of the variables are MT-safe.
+        @see ServerFunction */
+    //@{
+    unsigned int function_threads() const { return d_function_threads; }
+    void set_function_threads(unsigned int threads) { d_function_threads = threads; }
+    //@}
+
+    /** Get/set the cache used by eval_function_clauses(). The cache is not
+        deleted by the evaluator and may be shared by many of them. The
+        results are cached using the dataset, the time it was last
+        modified and the text given to parse_constraint(), so set those
+        for each request. Use null (the default) to turn caching off.
+        @see FunctionResultCache */
+    //@{
+    FunctionResultCache *function_cache() const { return d_function_cache; }
+    void set_function_cache(FunctionResultCache *cache, const std::string &dataset, time_t last_modified)
+    {
+        d_function_cache = cache;
+        d_cache_dataset = dataset;
+        d_cache_last_modified = last_modified;
+    }
+    //@}
+
+    /** Get/set the token of the request being evaluated. When another
+        thread is evaluating the same functions, eval_function_clauses()
+        waits for its result only until this token is cancelled. Use null
+        (the default) to wait without a limit. */
+    //@{
+    const CancelToken *cancel_token() const { return d_cancel_token; }
+    void set_cancel_token(const CancelToken *token) { d_cancel_token = token; }
+    //@}
+
     Clause_iter clause_begin();
     Clause_iter clause_end();
     bool clause_value(Clause_iter &i, DDS &dds);
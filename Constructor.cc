@@ -76,6 +76,7 @@ Constructor::m_duplicate(const Constructor &c)
 	// Clear out any spurious vars in Constructor::d_vars
 	// Moved from Grid::m_duplicate. jhrg 4/3/13
 	d_vars.clear(); // [mjohnson 10 Sep 2009]
+	d_var_index.clear();
 
 	Vars_citer i = c.d_vars.begin();
 	while (i != c.d_vars.end()) {
@@ -84,6 +85,8 @@ Constructor::m_duplicate(const Constructor &c)
 		d_vars.push_back(btp);
 	}
 
+	d_var_index.changed(d_vars);
+
 	DBG(cerr << "Exiting Constructor::m_duplicate for " << c.name() << endl);
 }
 
@@ -293,24 +296,52 @@ Constructor::var(const string &n, btp_stack &s)
 BaseType *
 Constructor::m_leaf_match(const string &name, btp_stack *s)
 {
-    for (Vars_iter i = d_vars.begin(); i != d_vars.end(); i++) {
-        if ((*i)->name() == name) {
-            if (s) {
-                DBG(cerr << "Pushing " << this->name() << endl);
-                s->push(static_cast<BaseType *>(this));
-            }
-            return *i;
-        }
-        if ((*i)->is_constructor_type()) {
-            BaseType *btp = (*i)->var(name, false, s);
-            if (btp) {
+    if (!d_var_index.indexed(d_vars)) {
+        for (Vars_iter i = d_vars.begin(); i != d_vars.end(); i++) {
+            if ((*i)->name() == name) {
                 if (s) {
                     DBG(cerr << "Pushing " << this->name() << endl);
                     s->push(static_cast<BaseType *>(this));
                 }
-                return btp;
+                return *i;
+            }
+            if ((*i)->is_constructor_type()) {
+                BaseType *btp = (*i)->var(name, false, s);
+                if (btp) {
+                    if (s) {
+                        DBG(cerr << "Pushing " << this->name() << endl);
+                        s->push(static_cast<BaseType *>(this));
+                    }
+                    return btp;
+                }
             }
         }
+
+        return 0;
+    }
+
+    VarIndex::Vars::size_type pos = d_var_index.find(d_vars, name);
+
+    // Only a constructor that comes before the first variable named 'name'
+    // can hold a match that is found first.
+    const vector<VarIndex::Vars::size_type> &ctors = d_var_index.constructors();
+    for (vector<VarIndex::Vars::size_type>::const_iterator i = ctors.begin(); i != ctors.end() && *i < pos; ++i) {
+        BaseType *btp = d_vars[*i]->var(name, false, s);
+        if (btp) {
+            if (s) {
+                DBG(cerr << "Pushing " << this->name() << endl);
+                s->push(static_cast<BaseType *>(this));
+            }
+            return btp;
+        }
+    }
+
+    if (pos < d_vars.size()) {
+        if (s) {
+            DBG(cerr << "Pushing " << this->name() << endl);
+            s->push(static_cast<BaseType *>(this));
+        }
+        return d_vars[pos];
     }
 
     return 0;
@@ -321,13 +352,12 @@ BaseType *
 Constructor::m_exact_match(const string &name, btp_stack *s)
 {
     // Look for name at the top level first.
-    for (Vars_iter i = d_vars.begin(); i != d_vars.end(); i++) {
-        if ((*i)->name() == name) {
-            if (s)
-                s->push(static_cast<BaseType *>(this));
+    VarIndex::Vars::size_type pos = d_var_index.find(d_vars, name);
+    if (pos < d_vars.size()) {
+        if (s)
+            s->push(static_cast<BaseType *>(this));
 
-            return *i;
-        }
+        return d_vars[pos];
     }
 
     // If it was not found using the simple search, look for a dot and
@@ -422,6 +452,7 @@ Constructor::add_var(BaseType *bt, Part)
     BaseType *btp = bt->ptr_duplicate();
     btp->set_parent(this);
     d_vars.push_back(btp);
+    d_var_index.added(d_vars);
 }
 
 /** Adds an element to a Constructor.
@@ -439,6 +470,7 @@ Constructor::add_var_nocopy(BaseType *bt, Part)
 #endif
     bt->set_parent(this);
     d_vars.push_back(bt);
+    d_var_index.added(d_vars);
 }
 
 /** Remove an element from a Constructor.
@@ -452,6 +484,7 @@ Constructor::del_var(const string &n)
         if ((*i)->name() == n) {
             BaseType *bt = *i ;
             d_vars.erase(i) ;
+            d_var_index.changed(d_vars);
             delete bt ; bt = 0;
             return;
         }
@@ -464,6 +497,7 @@ Constructor::del_var(Vars_iter i)
     if (*i != 0) {
         BaseType *bt = *i;
         d_vars.erase(i);
+        d_var_index.changed(d_vars);
         delete bt;
     }
 }
@@ -683,9 +717,9 @@ Constructor::print_val(ostream &out, string space, bool print_decl_p)
 void
 Constructor::print_xml(FILE *out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer(xml, constrained);
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 }
 
 /**
@@ -694,9 +728,9 @@ Constructor::print_xml(FILE *out, string space, bool constrained)
 void
 Constructor::print_xml(ostream &out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer(xml, constrained);
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 class PrintFieldXMLWriter : public unary_function<BaseType *, void>
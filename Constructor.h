@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "BaseType.h"
+#include "VarIndex.h"
 
 class Crc32;
 
@@ -45,9 +46,19 @@ class Constructor: public BaseType
 private:
     Constructor();  // No default ctor.
 
+    VarIndex d_var_index;
+
+    // BaseType::set_name() uses m_var_index_changed()
+    friend class BaseType;
+
 protected:
     std::vector<BaseType *> d_vars;
 
+    /** Subclasses that add, remove or replace elements of d_vars without
+        using add_var() or del_var() should call this. Until they do,
+        lookups search d_vars instead of using the index. */
+    void m_var_index_changed() { d_var_index.changed(d_vars); }
+
     void m_duplicate(const Constructor &s);
     BaseType *m_leaf_match(const string &name, btp_stack *s = 0);
     BaseType *m_exact_match(const string &name, btp_stack *s = 0);
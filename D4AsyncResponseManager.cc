@@ -0,0 +1,630 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+
+#include <fstream>
+#include <algorithm>
+
+//#define DODS_DEBUG
+
+#include "DMR.h"
+#include "D4Group.h"
+#include "XMLWriter.h"
+#include "D4StreamMarshaller.h"
+#include "chunked_stream.h"
+#include "chunked_ostream.h"
+#include "D4ConstraintEvaluator.h"
+#include "D4AsyncUtil.h"
+#include "D4AsyncResponseManager.h"
+
+#include "Error.h"
+#include "InternalErr.h"
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+static const string CRLF = "\r\n";
+
+namespace {
+
+/**
+ * Lock a pthread mutex for the life of a scope.
+ */
+class mutex_lock {
+    pthread_mutex_t &d_m;
+
+    mutex_lock(const mutex_lock &);
+    mutex_lock &operator=(const mutex_lock &);
+
+public:
+    mutex_lock(pthread_mutex_t &m) : d_m(m)
+    {
+        int status = pthread_mutex_lock(&d_m);
+        if (status != 0)
+            throw InternalErr(__FILE__, __LINE__, string("Could not lock mutex: ") + strerror(status));
+    }
+
+    ~mutex_lock()
+    {
+        pthread_mutex_unlock(&d_m);
+    }
+};
+
+} // anonymous namespace
+
+/**
+ * Build the manager and start its worker threads.
+ *
+ * @param spool_dir Directory where the finished responses are stored. It
+ * must exist and be writable.
+ * @param num_workers Number of worker threads; at least one is started.
+ * @param expected_delay The value (in seconds) to report in the
+ * AsynchronousResponse 'accepted' document.
+ * @param response_lifetime Number of seconds a finished response is kept in
+ * the spool. After that the job's status is async_gone; after another
+ * response_lifetime seconds the job is forgotten.
+ */
+D4AsyncResponseManager::D4AsyncResponseManager(const string &spool_dir, unsigned int num_workers,
+    long expected_delay, long response_lifetime) :
+    d_spool_dir(spool_dir), d_expected_delay(expected_delay), d_response_lifetime(response_lifetime),
+    d_timeout(0), d_shutdown(false)
+{
+    struct stat buf;
+    if (stat(d_spool_dir.c_str(), &buf) != 0 || !S_ISDIR(buf.st_mode))
+        throw Error("The asynchronous response spool directory '" + d_spool_dir + "' does not exist.");
+
+    if (pthread_mutex_init(&d_mutex, 0) != 0)
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the asynchronous response mutex.");
+    if (pthread_cond_init(&d_queue_cond, 0) != 0)
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the asynchronous response condition variable.");
+
+    num_workers = max(num_workers, 1U);
+    for (unsigned int i = 0; i < num_workers; ++i) {
+        pthread_t thread;
+        int status = pthread_create(&thread, 0, worker, this);
+        if (status != 0) {
+            // The destructor will not run; stop the workers already started.
+            m_stop_workers();
+            pthread_cond_destroy(&d_queue_cond);
+            pthread_mutex_destroy(&d_mutex);
+            throw InternalErr(__FILE__, __LINE__, string("Could not start asynchronous response worker: ") + strerror(status));
+        }
+        d_workers.push_back(thread);
+    }
+}
+
+/**
+ * Stop the workers, wait for any response being built to finish and remove
+ * all of the spool files this instance made. Jobs that were never started
+ * are discarded.
+ */
+D4AsyncResponseManager::~D4AsyncResponseManager()
+{
+    m_stop_workers();
+
+    for (map<string, job*>::iterator i = d_jobs.begin(), e = d_jobs.end(); i != e; ++i) {
+        delete i->second->d_dmr;
+        if (i->second->d_status == async_complete || i->second->d_status == async_failed)
+            (void) remove(i->second->d_spool_file.c_str());
+        delete i->second;
+    }
+
+    pthread_cond_destroy(&d_queue_cond);
+    pthread_mutex_destroy(&d_mutex);
+}
+
+// Tell the workers to quit and wait for them. Call without the lock held.
+void D4AsyncResponseManager::m_stop_workers()
+{
+    pthread_mutex_lock(&d_mutex);
+    d_shutdown = true;
+    pthread_cond_broadcast(&d_queue_cond);
+    pthread_mutex_unlock(&d_mutex);
+
+    for (vector<pthread_t>::iterator i = d_workers.begin(), e = d_workers.end(); i != e; ++i)
+        pthread_join(*i, 0);
+    d_workers.clear();
+}
+
+/**
+ * Make a new job id from 128 random bits. The id is also the name of the
+ * job's spool file, so it uses only letters, digits and '_'.
+ */
+string D4AsyncResponseManager::m_make_id()
+{
+    unsigned char bytes[16];
+
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0)
+        throw InternalErr(__FILE__, __LINE__, string("Could not open /dev/urandom: ") + strerror(errno));
+
+    size_t got = 0;
+    while (got < sizeof(bytes)) {
+        ssize_t n = read(fd, bytes + got, sizeof(bytes) - got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            close(fd);
+            throw InternalErr(__FILE__, __LINE__, "Could not read /dev/urandom.");
+        }
+        got += n;
+    }
+    close(fd);
+
+    static const char hex[] = "0123456789abcdef";
+    string id = "dap4_async_";
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        id += hex[bytes[i] >> 4];
+        id += hex[bytes[i] & 0x0f];
+    }
+
+    return id;
+}
+
+/**
+ * Queue a DAP4 data response for background processing.
+ *
+ * @param dmr The DMR for the dataset. The manager takes ownership of this
+ * object and deletes it once the response has been built.
+ * @param ce The DAP4 constraint expression. If empty, every variable is sent.
+ * @return The id used to refer to this response in other methods.
+ */
+string D4AsyncResponseManager::submit(DMR *dmr, const string &ce)
+{
+    if (!dmr)
+        throw InternalErr(__FILE__, __LINE__, "Null DMR passed to the asynchronous response manager.");
+
+    string id = m_make_id();
+
+    mutex_lock lock(d_mutex);
+
+    if (d_shutdown)
+        throw InternalErr(__FILE__, __LINE__, "The asynchronous response manager is shutting down.");
+
+    // 128 random bits will not repeat, but a duplicate would orphan a job.
+    if (d_jobs.find(id) != d_jobs.end())
+        throw InternalErr(__FILE__, __LINE__, "Duplicate asynchronous response id.");
+
+    job *j = new job(id, dmr, ce, d_spool_dir + "/" + id + ".dap");
+    d_jobs[id] = j;
+    d_queue.push_back(j);
+
+    pthread_cond_signal(&d_queue_cond);
+
+    DBG(cerr << "D4AsyncResponseManager::submit() - queued " << id << endl);
+
+    return id;
+}
+
+/**
+ * Run the constraint and write the DAP4 data response for one job into
+ * its spool file. Called by a worker thread without the lock held; the job
+ * is not visible to other workers while this runs.
+ *
+ * If the job's token is cancelled while the data are written, the data
+ * still buffered are replaced by an error chunk and Error is thrown.
+ */
+void D4AsyncResponseManager::m_build_response(job *j)
+{
+    j->d_token.check();
+
+    DMR &dmr = *j->d_dmr;
+
+    bool constrained = !j->d_ce.empty();
+    if (constrained) {
+        D4ConstraintEvaluator eval(&dmr);
+        if (!eval.parse(j->d_ce))
+            throw Error(malformed_expr, "Constraint Expression (" + j->d_ce + ") failed to parse.");
+    }
+    else {
+        dmr.root()->set_send_p(true);
+    }
+
+    ofstream out(j->d_spool_file.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out)
+        throw InternalErr(__FILE__, __LINE__, "Could not open the spool file: " + j->d_spool_file);
+
+    XMLWriter xml;
+    dmr.print_dap4(xml, constrained);
+
+    // See D4ResponseBuilder::send_dap(); the DMR and its CRLF must fit in the
+    // first chunk.
+    chunked_ostream cos(out, max((unsigned int) CHUNK_SIZE, xml.get_doc_size() + 2));
+    cos << xml.get_doc() << CRLF << flush;
+
+    try {
+        // The marshaller must be gone (and so must its writer thread) before
+        // the error chunk is written.
+        D4StreamMarshaller m(cos);
+        m.set_cancel_token(&j->d_token);
+        dmr.root()->serialize(m, dmr, constrained);
+    }
+    catch (Error &e) {
+        cos.write_err_chunk(e.get_error_message());
+        throw;
+    }
+
+    cos.flush();
+    out.flush();
+    if (!out)
+        throw InternalErr(__FILE__, __LINE__, "Could not write the spool file: " + j->d_spool_file);
+}
+
+/**
+ * The worker thread. Pull jobs off the queue until the manager shuts down.
+ * @param arg The D4AsyncResponseManager instance
+ */
+void *D4AsyncResponseManager::worker(void *arg)
+{
+    D4AsyncResponseManager &manager = *static_cast<D4AsyncResponseManager*>(arg);
+
+    while (true) {
+        job *j = 0;
+
+        pthread_mutex_lock(&manager.d_mutex);
+        while (manager.d_queue.empty() && !manager.d_shutdown)
+            pthread_cond_wait(&manager.d_queue_cond, &manager.d_mutex);
+
+        if (manager.d_shutdown) {
+            pthread_mutex_unlock(&manager.d_mutex);
+            return 0;
+        }
+
+        j = manager.d_queue.front();
+        manager.d_queue.pop_front();
+        j->d_status = async_pending;
+        j->d_token.set_timeout(manager.d_timeout);
+        pthread_mutex_unlock(&manager.d_mutex);
+
+        D4AsyncStatus status = async_complete;
+        string error = "";
+        try {
+            manager.m_build_response(j);
+        }
+        catch (Error &e) {
+            status = async_failed;
+            error = e.get_error_message();
+        }
+        catch (std::exception &e) {
+            status = async_failed;
+            error = e.what();
+        }
+        catch (...) {
+            status = async_failed;
+            error = "Unknown exception while building the asynchronous response.";
+        }
+
+        struct stat buf;
+        unsigned long long size = (stat(j->d_spool_file.c_str(), &buf) == 0) ? buf.st_size : 0;
+
+        pthread_mutex_lock(&manager.d_mutex);
+        delete j->d_dmr;
+        j->d_dmr = 0;
+        j->d_status = status;
+        j->d_error = error;
+        j->d_size = size;
+        j->d_finished = time(0);
+        manager.d_finished_jobs.push_back(j);
+        pthread_mutex_unlock(&manager.d_mutex);
+
+        DBG(cerr << "D4AsyncResponseManager::worker() - finished " << j->d_id << ", status: " << status << endl);
+    }
+
+    return 0;
+}
+
+// Call with the lock held.
+D4AsyncResponseManager::job *D4AsyncResponseManager::m_find_job(const string &id) const
+{
+    map<string, job*>::const_iterator i = d_jobs.find(id);
+    return (i == d_jobs.end()) ? 0 : i->second;
+}
+
+// Call with the lock held. The finished and gone jobs are each kept in the
+// order they reached that state, so only the jobs that expire are visited.
+void D4AsyncResponseManager::m_purge_expired()
+{
+    time_t now = time(0);
+
+    while (!d_finished_jobs.empty() && now - d_finished_jobs.front()->d_finished > d_response_lifetime) {
+        job *j = d_finished_jobs.front();
+        d_finished_jobs.pop_front();
+
+        (void) remove(j->d_spool_file.c_str());
+        j->d_status = async_gone;
+        j->d_size = 0;
+        j->d_error = "";
+        j->d_gone = now;
+        d_gone_jobs.push_back(j);
+    }
+
+    long grace = max(d_response_lifetime, 0L);
+    while (!d_gone_jobs.empty() && now - d_gone_jobs.front()->d_gone > grace) {
+        job *j = d_gone_jobs.front();
+        d_gone_jobs.pop_front();
+
+        d_jobs.erase(j->d_id);
+        delete j;
+    }
+}
+
+/**
+ * Remove the spool files of all responses older than the response lifetime.
+ * Those jobs are reported as gone for another response lifetime; then
+ * they are forgotten and reported as unknown.
+ */
+void D4AsyncResponseManager::purge_expired()
+{
+    mutex_lock lock(d_mutex);
+    m_purge_expired();
+}
+
+/**
+ * @param id The job id returned by submit()
+ * @return The state of that job.
+ */
+D4AsyncStatus D4AsyncResponseManager::status(const string &id)
+{
+    mutex_lock lock(d_mutex);
+    m_purge_expired();
+
+    job *j = m_find_job(id);
+    return j ? j->d_status : async_unknown;
+}
+
+/**
+ * @param id The job id returned by submit()
+ * @return The error message for a failed job; the empty string otherwise.
+ */
+string D4AsyncResponseManager::error_message(const string &id)
+{
+    mutex_lock lock(d_mutex);
+
+    job *j = m_find_job(id);
+    return j ? j->d_error : "";
+}
+
+/**
+ * @param id The job id returned by submit()
+ * @return The number of bytes in the spooled response; zero if the job is
+ * not complete.
+ */
+unsigned long long D4AsyncResponseManager::response_size(const string &id)
+{
+    mutex_lock lock(d_mutex);
+
+    job *j = m_find_job(id);
+    return (j && j->d_status == async_complete) ? j->d_size : 0;
+}
+
+/**
+ * Stop building a response. A job still in the queue fails as soon as a
+ * worker takes it; a job being built stops the next time it checks its
+ * token (see CancelToken). Either way the job's status becomes
+ * async_failed.
+ *
+ * @param id The job id returned by submit()
+ * @return True if the job was queued or being built, false otherwise.
+ */
+bool D4AsyncResponseManager::cancel(const string &id)
+{
+    mutex_lock lock(d_mutex);
+
+    job *j = m_find_job(id);
+    if (!j || (j->d_status != async_accepted && j->d_status != async_pending))
+        return false;
+
+    j->d_token.cancel();
+    return true;
+}
+
+/**
+ * @return The time, in milliseconds, a worker may spend on a job.
+ */
+long D4AsyncResponseManager::timeout()
+{
+    mutex_lock lock(d_mutex);
+    return d_timeout;
+}
+
+/**
+ * @param milliseconds The time a worker may spend on a job; zero (or less)
+ * for no limit.
+ */
+void D4AsyncResponseManager::set_timeout(long milliseconds)
+{
+    mutex_lock lock(d_mutex);
+    d_timeout = milliseconds;
+}
+
+/**
+ * Write the DAP4 AsynchronousResponse document that describes the current
+ * state of a job. A job still in the queue is 'accepted', one being built
+ * is 'pending', one that failed is 'rejected' and one that expired, or was
+ * never submitted, is 'gone'.
+ *
+ * @param xml Write to this XMLWriter
+ * @param id The job id returned by submit()
+ * @param async_resource_url The URL the client should use to get the response.
+ * Used only in the 'accepted' document.
+ * @param stylesheet_ref If not null, include a reference to this stylesheet.
+ * @return False if the response is complete, in which case nothing is
+ * written and the caller should use send_response(); true otherwise.
+ */
+bool D4AsyncResponseManager::write_status(XMLWriter &xml, const string &id, const string &async_resource_url,
+    string *stylesheet_ref)
+{
+    D4AsyncStatus s;
+    string error;
+    {
+        mutex_lock lock(d_mutex);
+        m_purge_expired();
+
+        job *j = m_find_job(id);
+        s = j ? j->d_status : async_unknown;
+        error = j ? j->d_error : "";
+    }
+
+    D4AsyncUtil util;
+    switch (s) {
+    case async_complete:
+        return false;
+
+    case async_accepted:
+        util.writeD4AsyncAccepted(xml, d_expected_delay, d_response_lifetime, async_resource_url, stylesheet_ref);
+        break;
+
+    case async_pending:
+        util.writeD4AsyncPending(xml, stylesheet_ref);
+        break;
+
+    case async_failed:
+        util.writeD4AsyncResponseRejected(xml, OTHER, error, stylesheet_ref);
+        break;
+
+    case async_gone:
+    case async_unknown:
+        util.writeD4AsyncResponseGone(xml, stylesheet_ref);
+        break;
+
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Unknown asynchronous response state.");
+    }
+
+    return true;
+}
+
+/**
+ * Send a finished response to a file descriptor. Where sendfile(2) is
+ * available the bytes are copied by the kernel without passing through
+ * user space.
+ *
+ * @param id The job id returned by submit()
+ * @param fd Write to this file descriptor
+ * @exception Error if the response is not complete.
+ */
+void D4AsyncResponseManager::send_response(const string &id, int fd)
+{
+    int in;
+    unsigned long long size;
+    {
+        mutex_lock lock(d_mutex);
+        m_purge_expired();
+
+        job *j = m_find_job(id);
+        if (!j || j->d_status != async_complete)
+            throw Error("The asynchronous response '" + id + "' is not available.");
+
+        // Open while locked so a purge cannot remove the file first; once
+        // open, removing the file does not affect this descriptor.
+        in = open(j->d_spool_file.c_str(), O_RDONLY);
+        if (in < 0)
+            throw InternalErr(__FILE__, __LINE__, "Could not open the spool file: " + j->d_spool_file);
+        size = j->d_size;
+    }
+
+    unsigned long long sent = 0;
+#ifdef HAVE_SYS_SENDFILE_H
+    while (sent < size) {
+        ssize_t n = sendfile(fd, in, 0, size - sent);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+#endif
+
+    // Either there's no sendfile() or it refused this pair of descriptors
+    // (e.g., fd is not a socket on some systems); copy what remains.
+    char buf[CHUNK_SIZE * 16];
+    while (sent < size) {
+        ssize_t n = read(in, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        ssize_t written = 0;
+        while (written < n) {
+            ssize_t w = write(fd, buf + written, n - written);
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w < 0) {
+                close(in);
+                throw InternalErr(__FILE__, __LINE__, string("Could not write the asynchronous response: ") + strerror(errno));
+            }
+            written += w;
+        }
+        sent += n;
+    }
+
+    close(in);
+
+    if (sent != size)
+        throw InternalErr(__FILE__, __LINE__, "Could not send the whole asynchronous response.");
+}
+
+/**
+ * Send a finished response to an output stream.
+ *
+ * @param id The job id returned by submit()
+ * @param out Write to this stream
+ * @exception Error if the response is not complete.
+ */
+void D4AsyncResponseManager::send_response(const string &id, ostream &out)
+{
+    ifstream in;
+    {
+        mutex_lock lock(d_mutex);
+        m_purge_expired();
+
+        job *j = m_find_job(id);
+        if (!j || j->d_status != async_complete)
+            throw Error("The asynchronous response '" + id + "' is not available.");
+
+        in.open(j->d_spool_file.c_str(), ios::in | ios::binary);
+        if (!in)
+            throw InternalErr(__FILE__, __LINE__, "Could not open the spool file: " + j->d_spool_file);
+    }
+
+    out << in.rdbuf();
+    out.flush();
+}
+
+} /* namespace libdap */
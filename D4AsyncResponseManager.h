@@ -0,0 +1,165 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef D4ASYNCRESPONSEMANAGER_H_
+#define D4ASYNCRESPONSEMANAGER_H_
+
+#include <pthread.h>
+#include <ctime>
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <ostream>
+
+#include "XMLWriter.h"
+#include "CancelToken.h"
+
+namespace libdap {
+
+class DMR;
+
+/// The states an asynchronous DAP4 response moves through.
+enum D4AsyncStatus {
+    async_unknown,  ///< No job with that id (or it was gone for longer than the response lifetime)
+    async_accepted, ///< Queued; no worker has started it yet
+    async_pending,  ///< A worker is serializing the response
+    async_complete, ///< The response is in the spool, ready to send
+    async_failed,   ///< Building the response threw an exception
+    async_gone      ///< The response lifetime expired and the spool file was removed
+};
+
+/**
+ * Build DAP4 data responses in the background. A caller hands the manager
+ * a DMR (and, optionally, a DAP4 constraint expression); one of a fixed pool
+ * of worker threads evaluates the CE, runs D4Group::serialize() and writes
+ * the complete on-the-wire response (DMR, CRLF, chunked data) into a
+ * spool file. The id returned by submit() can then be used to write the
+ * AsynchronousResponse documents (see D4AsyncUtil) that match the real
+ * state of the job and, once the job is complete, to send the response
+ * from the spool.
+ *
+ * The manager takes ownership of the DMR passed to submit(). Each DMR is
+ * read by exactly one worker, so the handler's read() methods are not
+ * called concurrently for the same DMR; they may be called concurrently
+ * for different DMRs.
+ *
+ * Each job has a CancelToken. If set_timeout() has been called, a job that
+ * runs longer than the timeout is stopped; cancel() stops a job at once.
+ * A job stopped while its data are being written ends with a DAP4 error
+ * chunk, and its status is async_failed.
+ *
+ * Job ids are random, so one client cannot guess the id of another
+ * client's response. A finished response is kept for the response
+ * lifetime; then its spool file is removed and its status is async_gone.
+ * After another response lifetime the job is forgotten altogether and its
+ * status is async_unknown.
+ */
+class D4AsyncResponseManager {
+private:
+    struct job {
+        std::string d_id;
+        DMR *d_dmr;
+        std::string d_ce;
+        D4AsyncStatus d_status;
+        std::string d_error;
+        std::string d_spool_file;
+        unsigned long long d_size;
+        time_t d_submitted;
+        time_t d_finished;
+        time_t d_gone;
+        CancelToken d_token;
+
+        job(const std::string &id, DMR *dmr, const std::string &ce, const std::string &spool) :
+            d_id(id), d_dmr(dmr), d_ce(ce), d_status(async_accepted), d_error(""), d_spool_file(spool),
+            d_size(0), d_submitted(time(0)), d_finished(0), d_gone(0)
+        {
+        }
+    };
+
+    std::string d_spool_dir;
+    long d_expected_delay;      // seconds, reported in the Accepted document
+    long d_response_lifetime;   // seconds a finished response stays in the spool
+    long d_timeout;             // milliseconds a worker may spend on a job; 0 for no limit
+
+    std::map<std::string, job*> d_jobs;
+    std::deque<job*> d_queue;
+    std::deque<job*> d_finished_jobs;   // Complete or failed, in the order they finished
+    std::deque<job*> d_gone_jobs;       // Gone, in the order they expired
+    std::vector<pthread_t> d_workers;
+    bool d_shutdown;
+
+    mutable pthread_mutex_t d_mutex;
+    pthread_cond_t d_queue_cond;
+
+    void m_build_response(job *j);
+    job *m_find_job(const std::string &id) const;
+    void m_purge_expired();
+    void m_stop_workers();
+
+    static std::string m_make_id();
+    static void *worker(void *arg);
+
+    D4AsyncResponseManager();
+    D4AsyncResponseManager(const D4AsyncResponseManager &);
+    D4AsyncResponseManager &operator=(const D4AsyncResponseManager &);
+
+public:
+    D4AsyncResponseManager(const std::string &spool_dir, unsigned int num_workers = 2,
+        long expected_delay = 60, long response_lifetime = 3600);
+    virtual ~D4AsyncResponseManager();
+
+    virtual std::string submit(DMR *dmr, const std::string &ce = "");
+
+    virtual D4AsyncStatus status(const std::string &id);
+    virtual std::string error_message(const std::string &id);
+    virtual unsigned long long response_size(const std::string &id);
+
+    virtual bool cancel(const std::string &id);
+
+    virtual bool write_status(XMLWriter &xml, const std::string &id, const std::string &async_resource_url,
+        std::string *stylesheet_ref = 0);
+
+    virtual void send_response(const std::string &id, int fd);
+    virtual void send_response(const std::string &id, std::ostream &out);
+
+    virtual void purge_expired();
+
+    long expected_delay() const { return d_expected_delay; }
+    long response_lifetime() const { return d_response_lifetime; }
+    std::string spool_dir() const { return d_spool_dir; }
+
+    /** Get/set the time, in milliseconds, a worker may spend building a
+        response. The time starts when a worker takes the job from the
+        queue. Zero (the default) means there is no limit. Changing the
+        timeout does not change the jobs already started. */
+    //@{
+    long timeout();
+    void set_timeout(long milliseconds);
+    //@}
+};
+
+} /* namespace libdap */
+
+#endif /* D4ASYNCRESPONSEMANAGER_H_ */
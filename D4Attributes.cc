@@ -24,11 +24,21 @@
 
 #include "config.h"
 
+#include <pthread.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
 //#define DODS_DEBUG
 
 #include "D4Attributes.h"
 #include "D4AttributeType.h"
 #include "InternalErr.h"
+#include "Error.h"
+#include "dods-datatypes.h"
 
 #include "AttrTable.h"
 
@@ -153,13 +163,18 @@ D4Attribute::m_duplicate(const D4Attribute &src)
     d_name = src.d_name;
     d_type = src.d_type;
     d_values = src.d_values;
+    d_buf = src.d_buf;
+    d_text_valid = src.d_text_valid;
+    d_binary_valid = src.d_binary_valid;
     if (src.d_attributes)
         d_attributes = new D4Attributes(*src.d_attributes);
     else
         d_attributes = 0;
+
+    if (d_owner) d_owner->m_index_changed();
 }
 
-D4Attribute::D4Attribute(const D4Attribute &src)
+D4Attribute::D4Attribute(const D4Attribute &src) : d_owner(0)
 {
     m_duplicate(src);
 }
@@ -177,6 +192,15 @@ D4Attribute::operator=(const D4Attribute &rhs)
     return *this;
 }
 
+void
+D4Attribute::set_name(const string &name)
+{
+    d_name = name;
+
+    // The attributes that hold this one must rebuild their index
+    if (d_owner) d_owner->m_index_changed();
+}
+
 D4Attributes *
 D4Attribute::attributes()
 {
@@ -184,6 +208,283 @@ D4Attribute::attributes()
     return d_attributes;
 }
 
+// The C++ type that holds the binary values of each numeric attribute type
+static D4AttributeType attr_type(dods_byte *) { return attr_byte_c; }
+static D4AttributeType attr_type(dods_int8 *) { return attr_int8_c; }
+static D4AttributeType attr_type(dods_int16 *) { return attr_int16_c; }
+static D4AttributeType attr_type(dods_uint16 *) { return attr_uint16_c; }
+static D4AttributeType attr_type(dods_int32 *) { return attr_int32_c; }
+static D4AttributeType attr_type(dods_uint32 *) { return attr_uint32_c; }
+static D4AttributeType attr_type(dods_int64 *) { return attr_int64_c; }
+static D4AttributeType attr_type(dods_uint64 *) { return attr_uint64_c; }
+static D4AttributeType attr_type(dods_float32 *) { return attr_float32_c; }
+static D4AttributeType attr_type(dods_float64 *) { return attr_float64_c; }
+
+// Byte and UInt8 attributes are both held as dods_byte
+static bool same_type(D4AttributeType a, D4AttributeType b)
+{
+    if (a == attr_uint8_c) a = attr_byte_c;
+    if (b == attr_uint8_c) b = attr_byte_c;
+    return a == b;
+}
+
+// Read one value of type T from its text; throw Error if it is not a T.
+template <typename T>
+static T parse_value(const string &text, const string &name)
+{
+    const char *str = text.c_str();
+    char *end = 0;
+    errno = 0;
+    T value = 0;
+    bool ok;
+
+    if (numeric_limits<T>::is_integer) {
+        if (numeric_limits<T>::is_signed) {
+            long long v = strtoll(str, &end, 0);
+            ok = v >= numeric_limits<T>::min() && v <= numeric_limits<T>::max();
+            value = static_cast<T>(v);
+        }
+        else {
+            unsigned long long v = strtoull(str, &end, 0);
+            ok = !strchr(str, '-') && v <= numeric_limits<T>::max();
+            value = static_cast<T>(v);
+        }
+    }
+    else {
+        // NaN and the infinities are allowed; other values must fit in T
+        double v = strtod(str, &end);
+        ok = v != v || v == numeric_limits<double>::infinity() || v == -numeric_limits<double>::infinity()
+            || (v <= numeric_limits<T>::max() && v >= -numeric_limits<T>::max());
+        value = static_cast<T>(v);
+    }
+
+    if (!ok || errno == ERANGE || end == str || *end != '\0')
+        throw Error(malformed_expr, "The value '" + text + "' of the attribute '" + name + "' is not a "
+            + D4AttributeTypeToString(attr_type((T*)0)) + ".");
+
+    return value;
+}
+
+template <typename T>
+static void parse_values(const vector<string> &text, vector<char> &buf, const string &name)
+{
+    buf.resize(text.size() * sizeof(T));
+    for (vector<string>::size_type i = 0; i < text.size(); ++i) {
+        T value = parse_value<T>(text[i], name);
+        memcpy(&buf[i * sizeof(T)], &value, sizeof(T));
+    }
+}
+
+// Write value i of the array in buf; floating point values get enough
+// digits that the text reads back as the same value.
+template <typename T>
+static string format_value(const vector<char> &buf, unsigned int i)
+{
+    T value;
+    memcpy(&value, &buf[i * sizeof(T)], sizeof(T));
+
+    ostringstream oss;
+    if (numeric_limits<T>::is_integer) {
+        // Print one-byte values as numbers, not characters
+        if (sizeof(T) == 1)
+            oss << static_cast<int>(value);
+        else
+            oss << value;
+    }
+    else {
+        oss.precision(sizeof(T) == sizeof(dods_float32) ? 9 : 17);
+        oss << value;
+    }
+    return oss.str();
+}
+
+/// The size of one binary value, or zero if d_type is not numeric
+unsigned int
+D4Attribute::m_width() const
+{
+    switch (d_type) {
+    case attr_byte_c:
+    case attr_uint8_c:
+    case attr_int8_c: return 1;
+    case attr_int16_c:
+    case attr_uint16_c: return 2;
+    case attr_int32_c:
+    case attr_uint32_c:
+    case attr_float32_c: return 4;
+    case attr_int64_c:
+    case attr_uint64_c:
+    case attr_float64_c: return 8;
+    default: return 0;
+    }
+}
+
+/// Format the binary value i
+string
+D4Attribute::m_format(unsigned int i) const
+{
+    switch (d_type) {
+    case attr_byte_c:
+    case attr_uint8_c: return format_value<dods_byte>(d_buf, i);
+    case attr_int8_c: return format_value<dods_int8>(d_buf, i);
+    case attr_int16_c: return format_value<dods_int16>(d_buf, i);
+    case attr_uint16_c: return format_value<dods_uint16>(d_buf, i);
+    case attr_int32_c: return format_value<dods_int32>(d_buf, i);
+    case attr_uint32_c: return format_value<dods_uint32>(d_buf, i);
+    case attr_int64_c: return format_value<dods_int64>(d_buf, i);
+    case attr_uint64_c: return format_value<dods_uint64>(d_buf, i);
+    case attr_float32_c: return format_value<dods_float32>(d_buf, i);
+    case attr_float64_c: return format_value<dods_float64>(d_buf, i);
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Binary values for a non-numeric attribute.");
+    }
+}
+
+/// Make the text the only form of the values, so they can be modified
+void
+D4Attribute::m_text()
+{
+    if (!d_text_valid) {
+        unsigned int n = num_values();
+        d_values.clear();
+        d_values.reserve(n);
+        for (unsigned int i = 0; i < n; ++i)
+            d_values.push_back(m_format(i));
+        d_text_valid = true;
+    }
+
+    d_buf.clear();
+    d_binary_valid = false;
+}
+
+/// Make sure the binary form of the values is valid
+void
+D4Attribute::m_binary()
+{
+    if (d_binary_valid)
+        return;
+
+    switch (d_type) {
+    case attr_byte_c:
+    case attr_uint8_c: parse_values<dods_byte>(d_values, d_buf, name()); break;
+    case attr_int8_c: parse_values<dods_int8>(d_values, d_buf, name()); break;
+    case attr_int16_c: parse_values<dods_int16>(d_values, d_buf, name()); break;
+    case attr_uint16_c: parse_values<dods_uint16>(d_values, d_buf, name()); break;
+    case attr_int32_c: parse_values<dods_int32>(d_values, d_buf, name()); break;
+    case attr_uint32_c: parse_values<dods_uint32>(d_values, d_buf, name()); break;
+    case attr_int64_c: parse_values<dods_int64>(d_values, d_buf, name()); break;
+    case attr_uint64_c: parse_values<dods_uint64>(d_values, d_buf, name()); break;
+    case attr_float32_c: parse_values<dods_float32>(d_values, d_buf, name()); break;
+    case attr_float64_c: parse_values<dods_float64>(d_values, d_buf, name()); break;
+    default:
+        throw InternalErr(__FILE__, __LINE__, "The attribute '" + name() + "' is not numeric.");
+    }
+
+    d_binary_valid = true;
+}
+
+/** @brief Set the type of the attribute.
+    Values held in binary form are converted to text first. */
+void
+D4Attribute::set_type(D4AttributeType type)
+{
+    if (type != d_type && d_binary_valid)
+        m_text();
+    d_type = type;
+}
+
+void
+D4Attribute::add_value_vector(const vector<string> &values)
+{
+    d_values = values;
+    d_text_valid = true;
+    d_buf.clear();
+    d_binary_valid = false;
+}
+
+unsigned int
+D4Attribute::num_values() const
+{
+    return d_text_valid ? d_values.size() : d_buf.size() / m_width();
+}
+
+/** @brief Get value i as text.
+    Values held in binary form are formatted when they are read. */
+string
+D4Attribute::value(unsigned int i) const
+{
+    return d_text_valid ? d_values[i] : m_format(i);
+}
+
+/** @brief Set the values of a numeric attribute from their binary form.
+
+    The values are kept in their binary form and formatted as text only if
+    they are read as text or printed, so attributes made by a server from
+    binary data (e.g., scale_factor or the bounds of a coordinate) are
+    never parsed. The attribute's type is set to match T; a UInt8 attribute
+    keeps its type when given dods_byte values.
+
+    @param values The values, one of the dods_* numeric types. */
+template <typename T>
+void
+D4Attribute::set_values(const vector<T> &values)
+{
+    D4AttributeType type = attr_type((T*)0);
+    if (!same_type(d_type, type))
+        d_type = type;
+
+    d_values.clear();
+    d_text_valid = false;
+    d_buf.resize(values.size() * sizeof(T));
+    if (!values.empty())
+        memcpy(&d_buf[0], &values[0], d_buf.size());
+    d_binary_valid = true;
+}
+
+/** @brief Get the values of a numeric attribute in their binary form.
+
+    Values held as text, for example those read by a parser, are converted
+    the first time this is called and kept, so later calls cost nothing.
+    The returned array has num_values() elements and is valid until the
+    values are next modified.
+
+    @return A pointer to the values, or null if there are none.
+    @exception InternalErr if T is not the C++ type for the attribute's
+    type, e.g., dods_float64 for a Float64 attribute.
+    @exception Error if a value is not a valid T. */
+template <typename T>
+const T *
+D4Attribute::values()
+{
+    if (!same_type(d_type, attr_type((T*)0)))
+        throw InternalErr(__FILE__, __LINE__, "The attribute '" + name() + "' is a " + D4AttributeTypeToString(d_type)
+            + ", not a " + D4AttributeTypeToString(attr_type((T*)0)) + ".");
+
+    m_binary();
+    return d_buf.empty() ? 0 : reinterpret_cast<const T*>(&d_buf[0]);
+}
+
+template void D4Attribute::set_values(const vector<dods_byte> &);
+template void D4Attribute::set_values(const vector<dods_int8> &);
+template void D4Attribute::set_values(const vector<dods_int16> &);
+template void D4Attribute::set_values(const vector<dods_uint16> &);
+template void D4Attribute::set_values(const vector<dods_int32> &);
+template void D4Attribute::set_values(const vector<dods_uint32> &);
+template void D4Attribute::set_values(const vector<dods_int64> &);
+template void D4Attribute::set_values(const vector<dods_uint64> &);
+template void D4Attribute::set_values(const vector<dods_float32> &);
+template void D4Attribute::set_values(const vector<dods_float64> &);
+
+template const dods_byte *D4Attribute::values();
+template const dods_int8 *D4Attribute::values();
+template const dods_int16 *D4Attribute::values();
+template const dods_uint16 *D4Attribute::values();
+template const dods_int32 *D4Attribute::values();
+template const dods_uint32 *D4Attribute::values();
+template const dods_int64 *D4Attribute::values();
+template const dods_uint64 *D4Attribute::values();
+template const dods_float32 *D4Attribute::values();
+template const dods_float64 *D4Attribute::values();
+
 /** @brief copy attributes from DAP2 to DAP4
  *
  * Given a DAP2 AttrTable, copy all of its attributes into
@@ -320,8 +621,10 @@ AttrType get_dap2_AttrType(D4AttributeType d4_type) {
  */
 void D4Attributes::transform_attrs_to_dap2(AttrTable *d2_attr_table)
 {
-    // for every attribute in d4_attrs, copy it to d2_attr_table.
-    for (D4Attributes::D4AttributesIter i = attribute_begin(), e = attribute_end(); i != e; ++i) {
+    // for every attribute in d4_attrs, copy it to d2_attr_table. This
+    // only reads the attributes, so it uses them even if they're shared.
+    const vector<D4Attribute*> &attrs = m_attrs();
+    for (D4Attributes::D4AttributesCIter i = attrs.begin(), e = attrs.end(); i != e; ++i) {
         string name = (*i)->name();
         D4AttributeType d4_attr_type = (*i)->type();
         AttrType d2_attr_type = get_dap2_AttrType(d4_attr_type);
@@ -332,13 +635,14 @@ void D4Attributes::transform_attrs_to_dap2(AttrTable *d2_attr_table)
             AttrTable *child_attr_table = new AttrTable();
             child_attr_table->set_name(name);
 
-            (*i)->attributes()->transform_attrs_to_dap2(child_attr_table);
+            if ((*i)->d_attributes)
+                (*i)->d_attributes->transform_attrs_to_dap2(child_attr_table);
             d2_attr_table->append_container(child_attr_table, name);
             break;
         }
         default: {
-            for (D4Attribute::D4AttributeIter vi = (*i)->value_begin(), ve = (*i)->value_end(); vi != ve; vi++) {
-                d2_attr_table->append_attr(name, d2_attr_type_name, *vi);
+            for (unsigned int v = 0, n = (*i)->num_values(); v < n; ++v) {
+                d2_attr_table->append_attr(name, d2_attr_type_name, (*i)->value(v));
             }
 
             break;
@@ -416,27 +720,261 @@ AttrTable *D4Attributes::get_AttrTable(const string name)
 }
 #endif
 
-D4Attribute *
-D4Attributes::find_depth_first(const string &name, D4AttributesIter i)
+/** The attributes of a frozen D4Attributes object and its copies. The
+ * attributes are never modified once they are here; an object that needs
+ * to change them makes its own copy first. The reference count is the only
+ * thing that changes, so copies can be made and destroyed by different
+ * threads.
+ */
+struct D4Attributes::shared_attributes {
+    vector<D4Attribute*> d_attrs;
+
+    // The index of d_attrs, built by freeze(); see D4Attributes
+    std::map<string, unsigned int> d_names;
+    std::map<string, unsigned int> d_containers;
+    vector<unsigned int> d_container_positions;
+    bool d_indexed;
+
+    unsigned int d_refs;
+    pthread_mutex_t d_mutex;
+
+    shared_attributes() : d_indexed(false), d_refs(1)
+    {
+        if (pthread_mutex_init(&d_mutex, 0) != 0)
+            throw InternalErr(__FILE__, __LINE__, "Could not initialize a mutex for shared attributes.");
+    }
+
+    ~shared_attributes()
+    {
+        for (D4AttributesIter i = d_attrs.begin(), e = d_attrs.end(); i != e; ++i)
+            delete *i;
+        pthread_mutex_destroy(&d_mutex);
+    }
+
+    void acquire()
+    {
+        pthread_mutex_lock(&d_mutex);
+        ++d_refs;
+        pthread_mutex_unlock(&d_mutex);
+    }
+
+    // Returns true when the last reference is released
+    bool release()
+    {
+        pthread_mutex_lock(&d_mutex);
+        bool last = (--d_refs == 0);
+        pthread_mutex_unlock(&d_mutex);
+        return last;
+    }
+};
+
+void
+D4Attributes::m_clear()
 {
-    if (i == attribute_end())
-        return 0;
-    else if ((*i)->name() == name)
-        return *i;
-    else if ((*i)->type() == attr_container_c)
-        return find_depth_first(name, (*i)->attributes()->attribute_begin());
+    if (d_shared) {
+        if (d_shared->release()) delete d_shared;
+        d_shared = 0;
+    }
+
+    for (D4AttributesIter i = d_attrs.begin(), e = d_attrs.end(); i != e; ++i)
+        delete *i;
+    d_attrs.clear();
+
+    d_index_valid = false;
+}
+
+void
+D4Attributes::m_duplicate(const D4Attributes &src)
+{
+    m_clear();
+
+    if (src.d_shared) {
+        // Share the frozen attributes until one of the copies changes them
+        d_shared = src.d_shared;
+        d_shared->acquire();
+    }
+    else {
+        D4AttributesCIter i = src.d_attrs.begin();
+        while (i != src.d_attrs.end()) {
+            add_attribute_nocopy(new D4Attribute(**i++));    // deep copy
+        }
+    }
+}
+
+/** The attributes, whether or not they are shared. */
+const vector<D4Attribute*> &
+D4Attributes::m_attrs() const
+{
+    return d_shared ? d_shared->d_attrs : d_attrs;
+}
+
+/** Make a private copy of shared attributes. Call this before doing
+ * anything that might modify the attributes, including returning a
+ * pointer to one of them.
+ */
+void
+D4Attributes::m_unshare()
+{
+    if (!d_shared) return;
+
+    shared_attributes *shared = d_shared;
+    d_shared = 0;
+
+    try {
+        // Containers in the copies share their (frozen) attributes in turn
+        for (D4AttributesCIter i = shared->d_attrs.begin(), e = shared->d_attrs.end(); i != e; ++i)
+            add_attribute_nocopy(new D4Attribute(**i));
+    }
+    catch (...) {
+        if (shared->release()) delete shared;
+        throw;
+    }
+
+    if (shared->release()) delete shared;
+}
+
+/** @brief Share these attributes with copies of this object.
+ *
+ * Once frozen, copying a D4Attributes object (and so a BaseType, D4Group or
+ * DMR that holds one) does not copy the attributes; the copy shares them
+ * until it or this object calls a method that could modify them, which
+ * includes the non-const find(), get(), attribute_begin() and
+ * attribute_end() since they return pointers that can be used to modify
+ * the attributes. The const versions of find() and get() and
+ * attribute_cbegin()/attribute_cend() read the shared attributes. Use this
+ * for metadata that is built once and copied for every request. Containers
+ * are frozen, too.
+ *
+ * @note Pointers to D4Attribute objects obtained before calling freeze()
+ * must not be used to modify the attributes afterwards.
+ */
+void
+D4Attributes::freeze()
+{
+    if (d_shared) return;
+
+    for (D4AttributesIter i = d_attrs.begin(), e = d_attrs.end(); i != e; ++i) {
+        if ((*i)->d_attributes) (*i)->d_attributes->freeze();
+        (*i)->d_owner = 0;
+    }
+
+    // The shared attributes keep the index, so the const lookups do not
+    // have to build one.
+    bool indexed = m_use_index();
+
+    d_shared = new shared_attributes;
+    d_shared->d_attrs.swap(d_attrs);
+
+    if (indexed) {
+        d_shared->d_names.swap(d_names);
+        d_shared->d_containers.swap(d_containers);
+        d_shared->d_container_positions.swap(d_container_positions);
+        d_shared->d_indexed = true;
+    }
+
+    d_names.clear();
+    d_containers.clear();
+    d_container_positions.clear();
+    d_index_valid = false;
+}
+
+// Sets of attributes smaller than this are searched without an index
+static const unsigned int index_threshold = 16;
+
+/** Rebuild the index after an attribute was renamed or replaced, or drop
+ * it if there are too few attributes to need one. */
+void
+D4Attributes::m_index_changed()
+{
+    if (d_attrs.size() >= index_threshold)
+        m_build_index();
     else
-        return find_depth_first(name, ++i);
+        d_index_valid = false;
 }
 
+void
+D4Attributes::m_build_index()
+{
+    d_names.clear();
+    d_containers.clear();
+    d_container_positions.clear();
+
+    for (unsigned int i = 0; i < d_attrs.size(); ++i) {
+        // insert() keeps the first position when a name is used twice
+        d_names.insert(make_pair(d_attrs[i]->name(), i));
+        if (d_attrs[i]->type() == attr_container_c) {
+            d_containers.insert(make_pair(d_attrs[i]->name(), i));
+            d_container_positions.push_back(i);
+        }
+    }
+
+    d_indexed_size = d_attrs.size();
+    d_index_valid = true;
+}
+
+/** Add the last attribute to the index. The index is built when there
+ * are enough attributes to need one. */
+void
+D4Attributes::m_index_added()
+{
+    if (!d_index_valid || d_indexed_size + 1 != d_attrs.size()) {
+        m_index_changed();
+        return;
+    }
+
+    unsigned int i = d_attrs.size() - 1;
+    d_names.insert(make_pair(d_attrs[i]->name(), i));
+    if (d_attrs[i]->type() == attr_container_c) {
+        d_containers.insert(make_pair(d_attrs[i]->name(), i));
+        d_container_positions.push_back(i);
+    }
+
+    d_indexed_size = d_attrs.size();
+}
+
+/** Find the first attribute called \e name, searching these attributes
+ * and, depth first, the containers they hold.
+ *
+ * The attribute returned may be modified, so frozen attributes are copied
+ * first. To look up an attribute only to read it, use the const version.
+ * @param name The name of the attribute
+ * @return The attribute or null if it is not found
+ */
 D4Attribute *
 D4Attributes::find(const string &name)
 {
-    return find_depth_first(name, attribute_begin());
+    m_unshare();
+
+    if (!m_use_index()) {
+        for (D4AttributesIter i = d_attrs.begin(), e = d_attrs.end(); i != e; ++i) {
+            if ((*i)->name() == name)
+                return *i;
+            if ((*i)->type() == attr_container_c) {
+                D4Attribute *a = (*i)->attributes()->find(name);
+                if (a) return a;
+            }
+        }
+
+        return 0;
+    }
+
+    map<string, unsigned int>::iterator p = d_names.find(name);
+    unsigned int pos = (p == d_names.end()) ? d_attrs.size() : p->second;
+
+    // Only a container that comes before the first attribute called 'name'
+    // can hold a match that is found first.
+    for (vector<unsigned int>::iterator i = d_container_positions.begin(), e = d_container_positions.end();
+            i != e && *i < pos; ++i) {
+        D4Attribute *a = d_attrs[*i]->attributes()->find(name);
+        if (a) return a;
+    }
+
+    return (pos < d_attrs.size()) ? d_attrs[pos] : 0;
 }
 
 /** Return a pointer to the D4Attribute object that has the given FQN.
  * @note A FQN for an attribute is a series of names separated by dots.
+ * @note Frozen attributes are copied first; see find().
  */
 D4Attribute *
 D4Attributes::get(const string &fqn)
@@ -453,8 +991,15 @@ D4Attributes::get(const string &fqn)
 
     DBG(cerr << "part: '" << part << "'; rest: '" << rest << "'" << endl);
 
+    m_unshare();
+
     if (!part.empty()) {
         if (!rest.empty()) {
+            if (m_use_index()) {
+                map<string, unsigned int>::iterator p = d_containers.find(part);
+                return (p == d_containers.end()) ? 0 : d_attrs[p->second]->attributes()->get(rest);
+            }
+
             D4AttributesIter i = attribute_begin();
             while (i != attribute_end()) {
                 if ((*i)->name() == part && (*i)->type() == attr_container_c)
@@ -463,6 +1008,11 @@ D4Attributes::get(const string &fqn)
             }
         }
         else {
+            if (m_use_index()) {
+                map<string, unsigned int>::iterator p = d_names.find(part);
+                return (p == d_names.end()) ? 0 : d_attrs[p->second];
+            }
+
             D4AttributesIter i = attribute_begin();
             while (i != attribute_end()) {
                 if ((*i)->name() == part)
@@ -475,6 +1025,99 @@ D4Attributes::get(const string &fqn)
     return 0;
 }
 
+/** Find the first attribute called \e name, as find() does, without copying
+ * frozen attributes.
+ * @param name The name of the attribute
+ * @return The attribute or null if it is not found
+ */
+const D4Attribute *
+D4Attributes::find(const string &name) const
+{
+    const vector<D4Attribute*> &attrs = m_attrs();
+
+    const map<string, unsigned int> *names = 0;
+    const vector<unsigned int> *positions = 0;
+    if (d_shared) {
+        if (d_shared->d_indexed) {
+            names = &d_shared->d_names;
+            positions = &d_shared->d_container_positions;
+        }
+    }
+    else if (m_use_index()) {
+        names = &d_names;
+        positions = &d_container_positions;
+    }
+
+    if (!names) {
+        for (D4AttributesCIter i = attrs.begin(), e = attrs.end(); i != e; ++i) {
+            if ((*i)->name() == name)
+                return *i;
+            if ((*i)->type() == attr_container_c && (*i)->d_attributes) {
+                const D4Attribute *a = static_cast<const D4Attributes*>((*i)->d_attributes)->find(name);
+                if (a) return a;
+            }
+        }
+
+        return 0;
+    }
+
+    map<string, unsigned int>::const_iterator p = names->find(name);
+    unsigned int pos = (p == names->end()) ? attrs.size() : p->second;
+
+    for (vector<unsigned int>::const_iterator i = positions->begin(), e = positions->end(); i != e && *i < pos; ++i) {
+        if (!attrs[*i]->d_attributes) continue;
+        const D4Attribute *a = static_cast<const D4Attributes*>(attrs[*i]->d_attributes)->find(name);
+        if (a) return a;
+    }
+
+    return (pos < attrs.size()) ? attrs[pos] : 0;
+}
+
+/** Return the attribute with the given FQN, as get() does, without copying
+ * frozen attributes.
+ * @param fqn The names of the containers and the attribute, separated by dots
+ * @return The attribute or null if it is not found
+ */
+const D4Attribute *
+D4Attributes::get(const string &fqn) const
+{
+    size_t pos = fqn.find('.');
+    string part = fqn.substr(0, pos);
+    string rest = (pos != string::npos) ? fqn.substr(pos + 1) : "";
+
+    if (part.empty())
+        return 0;
+
+    const vector<D4Attribute*> &attrs = m_attrs();
+
+    const map<string, unsigned int> *index = 0;
+    if (d_shared) {
+        if (d_shared->d_indexed)
+            index = rest.empty() ? &d_shared->d_names : &d_shared->d_containers;
+    }
+    else if (m_use_index()) {
+        index = rest.empty() ? &d_names : &d_containers;
+    }
+
+    const D4Attribute *attr = 0;
+    if (index) {
+        map<string, unsigned int>::const_iterator p = index->find(part);
+        if (p != index->end())
+            attr = attrs[p->second];
+    }
+    else {
+        for (D4AttributesCIter i = attrs.begin(), e = attrs.end(); i != e && !attr; ++i) {
+            if ((*i)->name() == part && (rest.empty() || (*i)->type() == attr_container_c))
+                attr = *i;
+        }
+    }
+
+    if (!attr || rest.empty())
+        return attr;
+
+    return attr->d_attributes ? static_cast<const D4Attributes*>(attr->d_attributes)->get(rest) : 0;
+}
+
 void
 D4Attribute::print_dap4(XMLWriter &xml) const
 {
@@ -501,12 +1144,12 @@ D4Attribute::print_dap4(XMLWriter &xml) const
 
     default: {
         // Assume only valid types make it into instances
-        D4AttributeCIter i = d_values.begin();//value_begin();
-        while (i != d_values.end()) {
+        // Values held in binary form are formatted here
+        for (unsigned int i = 0, n = num_values(); i < n; ++i) {
             if (xmlTextWriterStartElement(xml.get_writer(), (const xmlChar*) "Value") < 0)
                 throw InternalErr(__FILE__, __LINE__, "Could not write value element");
 
-            if (xmlTextWriterWriteString(xml.get_writer(), (const xmlChar*) (*i++).c_str()) < 0)
+            if (xmlTextWriterWriteString(xml.get_writer(), (const xmlChar*) value(i).c_str()) < 0)
                 throw InternalErr(__FILE__, __LINE__, "Could not write attribute value");
 
             if (xmlTextWriterEndElement(xml.get_writer()) < 0)
@@ -550,8 +1193,9 @@ D4Attributes::print_dap4(XMLWriter &xml) const
     if (empty())
         return;
 
-    D4AttributesCIter i = d_attrs.begin();
-    while (i != d_attrs.end()) {
+    const vector<D4Attribute*> &attrs = m_attrs();
+    D4AttributesCIter i = attrs.begin();
+    while (i != attrs.end()) {
         (*i++)->print_dap4(xml);
     }
 }
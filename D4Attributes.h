@@ -26,10 +26,12 @@
 #ifndef _d4attributes_h
 #define _d4attributes_h 1
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "DapObj.h"
+#include "InternedString.h"
 #include "D4AttributeType.h"
 #include "XMLWriter.h"
 
@@ -42,7 +44,7 @@ class AttrTable;
 class D4Attributes;
 
 class D4Attribute : public DapObj {
-    string d_name;
+    InternedString d_name;
     D4AttributeType d_type;    // Attributes are limited to the simple types
 
     // If d_type is attr_container_c is true, use d_attributes to read
@@ -54,37 +56,61 @@ class D4Attribute : public DapObj {
     // XML, otherwise, the strings hold attributes of type d_type.
     vector<string> d_values;
 
+    // Numeric values can also be held in binary form, as an array of the C++
+    // type that matches d_type (see set_values() and values()). At least one
+    // of d_values and d_buf holds the values; the flags record which.
+    vector<char> d_buf;
+    bool d_text_valid;
+    bool d_binary_valid;
+
+    // The D4Attributes object that holds this attribute, if any. Used to
+    // invalidate its index when the attribute is renamed.
+    D4Attributes *d_owner;
+
     // perform a deep copy
     void m_duplicate(const D4Attribute &src);
 
+    unsigned int m_width() const;
+    string m_format(unsigned int i) const;
+    void m_text();
+    void m_binary();
+
+    friend class D4Attributes;
+
 public:
     typedef vector<string>::iterator D4AttributeIter;
     typedef vector<string>::const_iterator D4AttributeCIter;
 
-    D4Attribute() : d_name(""), d_type(attr_null_c), d_attributes(0) {}
+    D4Attribute() : d_name(""), d_type(attr_null_c), d_attributes(0), d_text_valid(true), d_binary_valid(false),
+        d_owner(0) {}
     D4Attribute(const string &name, D4AttributeType type)
-        : d_name(name), d_type(type), d_attributes(0) {}
+        : d_name(name), d_type(type), d_attributes(0), d_text_valid(true), d_binary_valid(false), d_owner(0) {}
 
     D4Attribute(const D4Attribute &src);
     ~D4Attribute();
     D4Attribute &operator=(const D4Attribute &rhs);
 
     string name() const { return d_name; }
-    void set_name(const string &name) { d_name = name; }
+    void set_name(const string &name);
 
     D4AttributeType type() const { return d_type; }
-    void set_type(D4AttributeType type) { d_type = type; }
+    void set_type(D4AttributeType type);
+
+    void add_value(const string &value) { m_text(); d_values.push_back(value); }
+    void add_value_vector(const vector<string> &values);
 
-    void add_value(const string &value) { d_values.push_back(value); }
-    void add_value_vector(const vector<string> &values) { d_values = values; }
+    D4AttributeIter value_begin() { m_text(); return d_values.begin(); }
+    D4AttributeIter value_end() { m_text(); return d_values.end(); }
 
-    D4AttributeIter value_begin() { return d_values.begin(); }
-    D4AttributeIter value_end() { return d_values.end(); }
+    unsigned int num_values() const;
+    string value(unsigned int i) const;
 
-    unsigned int num_values() const { return d_values.size(); }
-    string value(unsigned int i) const { return d_values[i]; }
+    template <typename T> void set_values(const vector<T> &values);
+    template <typename T> const T *values();
 
     D4Attributes *attributes();
+    /// The contained attributes, or null if there are none; does not allocate
+    const D4Attributes *attributes() const { return d_attributes; }
 
     void print_dap4(XMLWriter &xml) const;
 
@@ -99,27 +125,44 @@ public:
 private:
     vector<D4Attribute*> d_attrs;
 
-    void m_duplicate(const D4Attributes &src) {
-        D4AttributesCIter i = src.d_attrs.begin();
-        while (i != src.d_attrs.end()) {
-            d_attrs.push_back(new D4Attribute(**i++));    // deep copy
-        }
-    }
-
-    D4Attribute *find_depth_first(const string &name, D4AttributesIter i);
+    // After freeze(), the attributes are held in a reference-counted block
+    // shared by this object and all of its copies; d_attrs is empty. The
+    // first method that can modify the attributes gives the object its own
+    // copy (see m_unshare()), so a copy costs one pointer until then.
+    struct shared_attributes;
+    shared_attributes *d_shared;
+
+    // Lookups in large sets of attributes use an index of the names; see
+    // AttrTable. d_names and d_containers map a name to the position of the
+    // first attribute or container with that name. The methods that change
+    // the attributes keep the index current; lookups only read it.
+    std::map<string, unsigned int> d_names;
+    std::map<string, unsigned int> d_containers;
+    vector<unsigned int> d_container_positions;
+    unsigned int d_indexed_size;
+    bool d_index_valid;
+
+    void m_duplicate(const D4Attributes &src);
+    void m_clear();
+    void m_unshare();
+    const vector<D4Attribute*> &m_attrs() const;
+
+    bool m_use_index() const { return d_index_valid && d_indexed_size == d_attrs.size(); }
+    void m_build_index();
+    void m_index_added();
+    void m_index_changed();
+
+    friend class D4Attribute;
 
 public:
 
-    D4Attributes() {}
-    D4Attributes(const D4Attributes &rhs) {
+    D4Attributes() : d_shared(0), d_indexed_size(0), d_index_valid(false) {}
+    D4Attributes(const D4Attributes &rhs) : d_shared(0), d_indexed_size(0), d_index_valid(false) {
         m_duplicate(rhs);
     }
 
     virtual ~D4Attributes() {
-        D4AttributesIter i = d_attrs.begin();
-        while(i != d_attrs.end()) {
-            delete *i++;
-        }
+        m_clear();
     }
 
     D4Attributes &operator=(const D4Attributes &rhs) {
@@ -137,30 +180,53 @@ public:
     static void load_AttrTable(AttrTable *d2_attr_table, D4Attributes *d4_attrs);
 #endif
 
-    bool empty() const { return d_attrs.empty(); }
+    bool empty() const { return m_attrs().empty(); }
 
     void add_attribute(D4Attribute *attr) {
-        d_attrs.push_back(new D4Attribute(*attr));
+        add_attribute_nocopy(new D4Attribute(*attr));
     }
 
     void add_attribute_nocopy(D4Attribute *attr) {
+        m_unshare();
         d_attrs.push_back(attr);
+        attr->d_owner = this;
+        m_index_added();
     }
 
-    /// Get an iterator to the start of the enumerations
-    D4AttributesIter attribute_begin() { return d_attrs.begin(); }
-
-    /// Get an iterator to the end of the enumerations
-    D4AttributesIter attribute_end() { return d_attrs.end(); }
-
+    /** Iterators that can be used to modify the attributes. If they are
+        frozen, this object first gets its own copy of the attributes at
+        this level (containers in the copy still share theirs); to read
+        them, use attribute_cbegin() and attribute_cend(). */
+    //@{
+    D4AttributesIter attribute_begin() { m_unshare(); return d_attrs.begin(); }
+    D4AttributesIter attribute_end() { m_unshare(); return d_attrs.end(); }
+    //@}
+
+    /** Iterators for reading the attributes. Unlike attribute_begin() and
+        attribute_end(), these do not copy frozen attributes. */
+    //@{
+    D4AttributesCIter attribute_cbegin() const { return m_attrs().begin(); }
+    D4AttributesCIter attribute_cend() const { return m_attrs().end(); }
+    //@}
+
+    // These copy frozen attributes, like attribute_begin(), since the
+    // attribute they return can be modified
     D4Attribute *find(const string &name);
     D4Attribute *get(const string &fqn);
 
+    // These read frozen attributes without copying them
+    const D4Attribute *find(const string &name) const;
+    const D4Attribute *get(const string &fqn) const;
+
     // D4Attribute *find_container(const string &name);
     // D4Attribute *get_container(const string &fqn);
 
     // Might add erase()
 
+    void freeze();
+    /// Are the attributes shared with copies of this object?
+    bool frozen() const { return d_shared != 0; }
+
     void print_dap4(XMLWriter &xml) const;
 
     virtual void dump(ostream &strm) const;
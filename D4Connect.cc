@@ -146,18 +146,19 @@ void D4Connect::process_data(DMR &data, Response &rs)
             int chunk_size = cis.read_next_chunk();
             if (chunk_size < 0)
                 throw Error("Found an unexpected end of input (EOF) while reading a DAP4 data response. (1)");
+            // The chunk holds the DMR and the CRLF pair that ends it
+            if (chunk_size < 2)
+                throw Error("The DMR chunk of a DAP4 data response is too short. (1)");
 
-            // get chunk
-            char chunk[chunk_size];
-            cis.read(chunk, chunk_size);
-            // parse char * with given size
+            // parse the DMR directly from the chunked stream
             D4ParserSax2 parser;
             // permissive mode allows references to Maps that are not in the response.
             // Use this mode when parsing a data response (but not the DMR). jhrg 4/13/16
             parser.set_strict(false);
 
-            // '-2' to discard the CRLF pair
-            parser.intern(chunk, chunk_size - 2, &data);
+            // '-2' to leave the CRLF pair; then discard it
+            parser.intern(cis, chunk_size - 2, &data);
+            cis.ignore(2);
         }
         catch (Error &e) {
             cerr << "Exception: " << e.get_error_message() << endl;
@@ -380,16 +381,17 @@ void D4Connect::request_dap4_data(DMR &dmr, const string expr)
             int chunk_size = cis.read_next_chunk();
             if (chunk_size < 0)
                 throw Error("Found an unexpected end of input (EOF) while reading a DAP4 data response. (2)");
+            // The chunk holds the DMR and the CRLF pair that ends it
+            if (chunk_size < 2)
+                throw Error("The DMR chunk of a DAP4 data response is too short. (2)");
 
-            // get chunk
-            char chunk[chunk_size];
-            cis.read(chunk, chunk_size);
-            // parse char * with given size
+            // parse the DMR directly from the chunked stream
             D4ParserSax2 parser;
             // permissive mode allows references to Maps that are not in the response.
             parser.set_strict(false);
-            // '-2' to discard the CRLF pair
-            parser.intern(chunk, chunk_size - 2, &dmr, false /*debug*/);
+            // '-2' to leave the CRLF pair; then discard it
+            parser.intern(cis, chunk_size - 2, &dmr, false /*debug*/);
+            cis.ignore(2);
 
             // Read data and store in the DMR
             D4StreamUnMarshaller um(cis, cis.twiddle_bytes());
@@ -104,19 +104,73 @@ D4Dimension::print_dap4(XMLWriter &xml) const
 		throw InternalErr(__FILE__, __LINE__, "Could not end Dimension element");
 }
 
-// Note that in order for this to work the second argument must not be a reference.
-// jhrg 8/20/13
-static bool
-dim_name_eq(D4Dimension *d, const string name)
+/**
+ * @brief Set the name of the dimension.
+ * If the dimension belongs to a D4Dimensions object, that object's index of
+ * names is invalidated.
+ * @param name The new name
+ */
+void
+D4Dimension::set_name(const string &name)
+{
+	d_name = name;
+	if (d_parent)
+		d_parent->invalidate_index();
+}
+
+void
+D4Dimensions::m_build_index()
 {
-	return d->name() == name;
+	d_names.clear();
+
+	// insert() keeps the first dimension when a name is used twice
+	for (D4DimensionsIter i = d_dims.begin(), e = d_dims.end(); i != e; ++i)
+		d_names.insert(make_pair((*i)->name(), *i));
+
+	d_indexed = d_dims.size();
+	d_index_valid = true;
 }
 
+void
+D4Dimensions::add_dim_nocopy(D4Dimension *dim)
+{
+	dim->set_parent(this);
+	d_dims.push_back(dim);
+
+	// If the index is current, add the new dimension to it; otherwise leave
+	// it to be rebuilt when it's used
+	if (d_index_valid && d_indexed + 1 == d_dims.size()) {
+		d_names.insert(make_pair(dim->name(), dim));
+		d_indexed = d_dims.size();
+	}
+	else {
+		d_index_valid = false;
+	}
+}
+
+/**
+ * @brief Find the first dimension with the given name.
+ * The lookup uses an index of the names that is built when first needed,
+ * so code that adds many dimensions and looks up each one (e.g., building
+ * a DMR from a DDS) is not quadratic in the number of dimensions.
+ * @param name The name of the dimension
+ * @return A pointer to the dimension or null if there is no dimension with
+ * that name.
+ */
 D4Dimension *
 D4Dimensions::find_dim(const string &name)
 {
-	D4DimensionsIter d = find_if(d_dims.begin(), d_dims.end(), bind2nd(ptr_fun(dim_name_eq), name));
-	return (d != d_dims.end()) ? *d: 0;
+	if (!d_index_valid || d_indexed != d_dims.size())
+		m_build_index();
+
+	map<string, D4Dimension*>::iterator i = d_names.find(name);
+	if (i != d_names.end() && i->second->name() != name) {
+		// A dimension was replaced without telling the index
+		m_build_index();
+		i = d_names.find(name);
+	}
+
+	return (i != d_names.end()) ? i->second : 0;
 }
 
 void
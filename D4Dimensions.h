@@ -25,6 +25,7 @@
 #ifndef D4DIMENSIONS_H_
 #define D4DIMENSIONS_H_
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -56,7 +57,7 @@ public:
             d_constrained(false), d_c_start(0), d_c_stride(0), d_c_stop(0), d_used_by_projected_var(false) {}
 
     string name() const {return d_name;}
-    void set_name(const string &name) { d_name = name; }
+    void set_name(const string &name);
     string fully_qualified_name() const;
 
     unsigned long long size() const { return d_size; }
@@ -103,6 +104,14 @@ class D4Dimensions {
 
     D4Group *d_parent;		// the group that holds this set of D4Dimensions; weak pointer, don't delete
 
+    // Index of the dimension names used by find_dim(). It's built when first
+    // needed and holds the first dimension with a given name.
+    map<string, D4Dimension*> d_names;
+    vector<D4Dimension*>::size_type d_indexed;
+    bool d_index_valid;
+
+    void m_build_index();
+
 protected:
     // Note Code in Array depends on the order of these 'new' dimensions
     // matching the 'old' dimensions they are derived from. See
@@ -115,6 +124,7 @@ protected:
         }
 
         d_parent = rhs.d_parent;
+        d_index_valid = false;
     }
 
 public:
@@ -122,9 +132,9 @@ public:
     typedef vector<D4Dimension*>::iterator D4DimensionsIter;
     typedef vector<D4Dimension*>::const_iterator D4DimensionsCIter;
 
-    D4Dimensions() : d_parent(0) {}
-    D4Dimensions(D4Group *g) : d_parent(g) {}
-    D4Dimensions(const D4Dimensions &rhs) : d_parent(0) { m_duplicate(rhs); }
+    D4Dimensions() : d_parent(0), d_indexed(0), d_index_valid(false) {}
+    D4Dimensions(D4Group *g) : d_parent(g), d_indexed(0), d_index_valid(false) {}
+    D4Dimensions(const D4Dimensions &rhs) : d_parent(0), d_indexed(0), d_index_valid(false) { m_duplicate(rhs); }
 
     virtual ~D4Dimensions() {
         D4DimensionsIter i = d_dims.begin();
@@ -157,7 +167,7 @@ public:
     /** Append a new dimension.
      * @param dim Pointer to the D4Dimension object to add; copies the pointer
      */
-    void add_dim_nocopy(D4Dimension *dim) { dim->set_parent(this); d_dims.push_back(dim); }
+    void add_dim_nocopy(D4Dimension *dim);
 
     /// Get an iterator to the start of the dimensions
     D4DimensionsIter dim_begin() { return d_dims.begin(); }
@@ -185,8 +195,12 @@ public:
     void insert_dim_nocopy(D4Dimension *dim, D4DimensionsIter i) {
     	dim->set_parent(this);
         d_dims.insert(i, dim);
+        d_index_valid = false;
     }
 
+    /// The index used by find_dim() must be rebuilt before it is used again
+    void invalidate_index() { d_index_valid = false; }
+
     void print_dap4(XMLWriter &xml, bool constrained = false) const;
 };
 
@@ -34,9 +34,26 @@
 
 #include "config.h"
 
+#include <algorithm>
+
+#include "Byte.h"
+#include "Int8.h"
+#include "Int16.h"
+#include "UInt16.h"
+#include "Int32.h"
+#include "UInt32.h"
+#include "Int64.h"
+#include "UInt64.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Str.h"
+
 #include "D4RValue.h"
 #include "D4FilterClause.h"
 
+#include "Operators.h"
+#include "InternalErr.h"
+
 using namespace std;
 
 namespace libdap {
@@ -64,7 +81,8 @@ D4FilterClauseList::~D4FilterClauseList()
  *
  * Evaluate the list of clauses and return false when/if one is found to be false.
  * This evaluates the clauses in the order they are stored and stops evaluation a
- * the first false clause.
+ * the first false clause. Clauses the handler has marked as enforced are not
+ * evaluated.
  *
  * @param dmr Use this DMR when evaluating clauses - for clauses that contain functions,
  * not currently in the DAP4 specification.
@@ -74,7 +92,7 @@ bool
 D4FilterClauseList::value(DMR &dmr)
 {
     for (D4FilterClauseList::iter i = d_clauses.begin(), e = d_clauses.end(); i != e; ++i) {
-        if ((*i)->value(dmr) == false)
+        if (!(*i)->enforced() && (*i)->value(dmr) == false)
             return false;
     }
 
@@ -95,15 +113,148 @@ bool
 D4FilterClauseList::value()
 {
     for (D4FilterClauseList::iter i = d_clauses.begin(), e = d_clauses.end(); i != e; ++i) {
-        if ((*i)->value() == false)
+        if (!(*i)->enforced() && (*i)->value() == false)
             return false;
     }
 
     return true;
 }
 
+/**
+ * @brief Can the clauses be evaluated for a block of rows?
+ *
+ * The block version of value() can evaluate a clause only when each of
+ * its operands is a constant or one of the variables in \c columns.
+ * Clauses already enforced by the handler are not evaluated, so they are
+ * not checked.
+ *
+ * @param columns The variables the row elements will hold values for
+ * @return True if value(rows, columns, selection) can be used
+ */
+bool
+D4FilterClauseList::can_evaluate_block(const vector<BaseType*> &columns) const
+{
+    for (D4FilterClauseList::citer i = d_clauses.begin(), e = d_clauses.end(); i != e; ++i) {
+        if ((*i)->enforced())
+            continue;
+
+        D4RValue *args[] = { (*i)->d_arg1, (*i)->d_arg2 };
+        for (int a = 0; a < 2; ++a) {
+            if (!args[a])
+                return false;
+            if (args[a]->get_kind() == D4RValue::constant)
+                continue;
+            if (args[a]->get_kind() != D4RValue::basetype
+                || find(columns.begin(), columns.end(), args[a]->d_variable) == columns.end())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Evaluate the list of clauses for a block of rows
+ *
+ * Each row is a vector of BaseType objects that hold the values of the
+ * variables in \c columns, in the same order; this is how D4Sequence stores
+ * its values. The variables referenced by the clauses must be in
+ * \c columns. On return, \c selection has one element per row and the
+ * elements for the rows that satisfy all of the clauses are non-zero.
+ *
+ * Each clause is evaluated for the whole block before the next one is
+ * evaluated. Rows rejected by one clause are not read by the later clauses
+ * and evaluation stops as soon as no rows are left.
+ *
+ * @param rows The block of rows
+ * @param columns The variables the row elements hold values for
+ * @param selection Value-result parameter; one entry per row
+ * @return The number of rows that satisfy the clauses
+ */
+unsigned long
+D4FilterClauseList::value(const vector<vector<BaseType*>*> &rows, const vector<BaseType*> &columns,
+    vector<unsigned char> &selection)
+{
+    selection.assign(rows.size(), 1);
+
+    unsigned long count = rows.size();
+    for (D4FilterClauseList::iter i = d_clauses.begin(), e = d_clauses.end(); i != e && count > 0; ++i) {
+        if ((*i)->enforced())
+            continue;
+        (*i)->value(rows, columns, selection);
+        count = std::count(selection.begin(), selection.end(), 1);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Get the range of values the clauses allow for a variable
+ *
+ * Intersect the clauses that compare \c var with a constant using one of
+ * the operators <, <=, >, >= or ==. Clauses using != or ~= and clauses
+ * that compare two variables do not limit the range; a handler that wants
+ * to apply those must look at the clauses themselves. The range is built
+ * from all of the clauses, including those already marked as enforced.
+ *
+ * @param var The variable, one of the fields of the D4Sequence
+ * @param range Value-result parameter
+ * @return True if at least one clause limits the values of \c var
+ */
+bool
+D4FilterClauseList::get_range(BaseType *var, D4FilterRange &range) const
+{
+    range = D4FilterRange();
+    range.d_variable = var;
+
+    bool found = false;
+    for (D4FilterClauseList::citer i = d_clauses.begin(), e = d_clauses.end(); i != e; ++i) {
+        BaseType *constant = (*i)->get_constant();
+        if (!var || (*i)->get_variable() != var || !constant)
+            continue;
+
+        D4FilterClause::ops op = (*i)->get_variable_op();
+        bool lower = (op == D4FilterClause::greater || op == D4FilterClause::greater_equal || op == D4FilterClause::equal);
+        bool upper = (op == D4FilterClause::less || op == D4FilterClause::less_equal || op == D4FilterClause::equal);
+        bool inclusive = (op != D4FilterClause::greater && op != D4FilterClause::less);
+
+        if (lower) {
+            if (!range.d_lower || constant->d4_ops(range.d_lower, D4FilterClause::greater)) {
+                range.d_lower = constant;
+                range.d_lower_inclusive = inclusive;
+            }
+            else if (!inclusive && constant->d4_ops(range.d_lower, D4FilterClause::equal)) {
+                range.d_lower_inclusive = false;
+            }
+        }
+
+        if (upper) {
+            if (!range.d_upper || constant->d4_ops(range.d_upper, D4FilterClause::less)) {
+                range.d_upper = constant;
+                range.d_upper_inclusive = inclusive;
+            }
+            else if (!inclusive && constant->d4_ops(range.d_upper, D4FilterClause::equal)) {
+                range.d_upper_inclusive = false;
+            }
+        }
+
+        found = found || lower || upper;
+    }
+
+    if (range.d_lower && range.d_upper) {
+        if (range.d_lower->d4_ops(range.d_upper, D4FilterClause::greater))
+            range.d_empty = true;
+        else if (range.d_lower->d4_ops(range.d_upper, D4FilterClause::equal)
+            && !(range.d_lower_inclusive && range.d_upper_inclusive))
+            range.d_empty = true;
+    }
+
+    return found;
+}
+
 void D4FilterClause::m_duplicate(const D4FilterClause &rhs) {
     d_op = rhs.d_op;
+    d_enforced = rhs.d_enforced;
 
     d_arg1 = new D4RValue(*rhs.d_arg1);
     d_arg2 = new D4RValue(*rhs.d_arg2);
@@ -209,4 +360,357 @@ bool D4FilterClause::cmp(ops op, BaseType *arg1, BaseType *arg2)
     return arg1->d4_ops(arg2, op);
 }
 
+// The remainder of this file implements the block version of value().
+// The values of a column are copied into a vector and compared in one loop
+// per operator so that the comparison is not hidden behind a switch or a
+// virtual call. Only the type combinations produced by the CE parser (a
+// column compared to an Int64, UInt64 or Float64 constant or to a value
+// of its own type) and string constants use these loops; everything else
+// is evaluated a row at a time with d4_ops().
+
+namespace {
+
+// An operand of a clause evaluated over a block of rows: a column of the
+// rows or a constant.
+struct block_operand {
+    BaseType *d_btp;    // the constant or the column's variable
+    int d_column;       // -1 for a constant
+
+    block_operand() : d_btp(0), d_column(-1) { }
+
+    bool constant() const { return d_column == -1; }
+    BaseType *value(const vector<BaseType*> &row) const { return constant() ? d_btp : row[d_column]; }
+};
+
+struct op_less { template<typename T1, typename T2> static bool cmp(T1 a, T2 b) { return a < b; } };
+struct op_greater { template<typename T1, typename T2> static bool cmp(T1 a, T2 b) { return a > b; } };
+struct op_less_equal { template<typename T1, typename T2> static bool cmp(T1 a, T2 b) { return a <= b; } };
+struct op_greater_equal { template<typename T1, typename T2> static bool cmp(T1 a, T2 b) { return a >= b; } };
+struct op_equal { template<typename T1, typename T2> static bool cmp(T1 a, T2 b) { return a == b; } };
+struct op_not_equal { template<typename T1, typename T2> static bool cmp(T1 a, T2 b) { return a != b; } };
+
+// Swap the operands of a relational operator: 'a op b' is 'b swap_op(op) a'
+int swap_op(int op)
+{
+    switch (op) {
+    case D4FilterClause::less: return D4FilterClause::greater;
+    case D4FilterClause::greater: return D4FilterClause::less;
+    case D4FilterClause::less_equal: return D4FilterClause::greater_equal;
+    case D4FilterClause::greater_equal: return D4FilterClause::less_equal;
+    default: return op;
+    }
+}
+
+// Copy the values of a column into 'values'. Rows that have already been
+// rejected are not read.
+template<class B, typename T>
+void gather(const vector<vector<BaseType*>*> &rows, int column, const vector<unsigned char> &selection,
+    vector<T> &values)
+{
+    values.resize(rows.size());
+    for (typename vector<T>::size_type i = 0, e = rows.size(); i < e; ++i)
+        values[i] = selection[i] ? static_cast<T>(static_cast<B*>((*rows[i])[column])->B::value()) : T();
+}
+
+template<class Op, typename T1, typename T2>
+void select_const(const vector<T1> &lhs, T2 rhs, vector<unsigned char> &selection)
+{
+    const T1 *l = &lhs[0];
+    unsigned char *s = &selection[0];
+    for (typename vector<T1>::size_type i = 0, e = lhs.size(); i < e; ++i)
+        s[i] &= Op::cmp(l[i], rhs);
+}
+
+template<class Op, typename T1, typename T2>
+void select_column(const vector<T1> &lhs, const vector<T2> &rhs, vector<unsigned char> &selection)
+{
+    const T1 *l = &lhs[0];
+    const T2 *r = &rhs[0];
+    unsigned char *s = &selection[0];
+    for (typename vector<T1>::size_type i = 0, e = lhs.size(); i < e; ++i)
+        s[i] &= Op::cmp(l[i], r[i]);
+}
+
+// Apply the operator to a column and a constant or to two columns
+template<class Op, typename T1, typename T2>
+void select_op(const vector<T1> &lhs, const vector<T2> &rhs, bool rhs_constant, vector<unsigned char> &selection)
+{
+    if (rhs_constant)
+        select_const<Op>(lhs, rhs[0], selection);
+    else
+        select_column<Op>(lhs, rhs, selection);
+}
+
+template<typename T1, typename T2>
+void select(int op, const vector<T1> &lhs, const vector<T2> &rhs, bool rhs_constant, vector<unsigned char> &selection)
+{
+    switch (op) {
+    case D4FilterClause::less: select_op<op_less>(lhs, rhs, rhs_constant, selection); break;
+    case D4FilterClause::greater: select_op<op_greater>(lhs, rhs, rhs_constant, selection); break;
+    case D4FilterClause::less_equal: select_op<op_less_equal>(lhs, rhs, rhs_constant, selection); break;
+    case D4FilterClause::greater_equal: select_op<op_greater_equal>(lhs, rhs, rhs_constant, selection); break;
+    case D4FilterClause::equal: select_op<op_equal>(lhs, rhs, rhs_constant, selection); break;
+    case D4FilterClause::not_equal: select_op<op_not_equal>(lhs, rhs, rhs_constant, selection); break;
+    case D4FilterClause::match:
+        throw Error(malformed_expr, "Regular expressions are supported for strings only.");
+    default:
+        throw Error(malformed_expr, "Unrecognized operator.");
+    }
+}
+
+// Get the values of the right operand as T2 (a single value if it's a
+// constant) and compare them to the left column.
+template<class B2, typename T1, typename T2>
+void select_rhs(int op, const vector<T1> &lhs, const block_operand &rhs, const vector<vector<BaseType*>*> &rows,
+    vector<unsigned char> &selection)
+{
+    vector<T2> values;
+    if (rhs.constant())
+        values.push_back(static_cast<T2>(static_cast<B2*>(rhs.d_btp)->value()));
+    else
+        gather<B2, T2>(rows, rhs.d_column, selection, values);
+
+    select(op, lhs, values, rhs.constant(), selection);
+}
+
+// The left operand is a column of type B1. Return false if the type of
+// the right operand is not one handled here.
+template<class B1, typename T1>
+bool select_lhs(int op, const block_operand &lhs, const block_operand &rhs, const vector<vector<BaseType*>*> &rows,
+    vector<unsigned char> &selection)
+{
+    Type lhs_type = lhs.d_btp->type();
+    Type rhs_type = rhs.d_btp->type();
+
+    vector<T1> values;
+
+    // Float32 and Float64 values are compared as floats; see Float64::d4_ops()
+    if (lhs_type == dods_float32_c && rhs_type == dods_float64_c) {
+        gather<B1, T1>(rows, lhs.d_column, selection, values);
+        select_rhs<Float64, T1, dods_float32>(op, values, rhs, rows, selection);
+        return true;
+    }
+
+    if (rhs_type == lhs_type) {
+        gather<B1, T1>(rows, lhs.d_column, selection, values);
+        select_rhs<B1, T1, T1>(op, values, rhs, rows, selection);
+        return true;
+    }
+
+    switch (rhs_type) {
+    case dods_int64_c:
+        gather<B1, T1>(rows, lhs.d_column, selection, values);
+        select_rhs<Int64, T1, dods_int64>(op, values, rhs, rows, selection);
+        return true;
+    case dods_uint64_c:
+        gather<B1, T1>(rows, lhs.d_column, selection, values);
+        select_rhs<UInt64, T1, dods_uint64>(op, values, rhs, rows, selection);
+        return true;
+    case dods_float64_c:
+        gather<B1, T1>(rows, lhs.d_column, selection, values);
+        select_rhs<Float64, T1, dods_float64>(op, values, rhs, rows, selection);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A string column compared to a string constant. The pattern of a regular
+// expression is compiled once for the block.
+bool select_str(int op, const block_operand &lhs, const block_operand &rhs, const vector<vector<BaseType*>*> &rows,
+    vector<unsigned char> &selection)
+{
+    Type rhs_type = rhs.d_btp->type();
+    if (!rhs.constant() || (rhs_type != dods_str_c && rhs_type != dods_url_c))
+        return false;
+
+    const string &pattern = static_cast<Str*>(rhs.d_btp)->value();
+
+    if (op == D4FilterClause::match) {
+        Regex r(pattern.c_str());
+        for (vector<unsigned char>::size_type i = 0, e = rows.size(); i < e; ++i) {
+            if (selection[i]) {
+                string s = static_cast<Str*>((*rows[i])[lhs.d_column])->Str::value();
+                selection[i] = r.match(s.c_str(), s.length()) > 0;
+            }
+        }
+    }
+    else {
+        for (vector<unsigned char>::size_type i = 0, e = rows.size(); i < e; ++i) {
+            if (selection[i])
+                selection[i] = StrCmp<string, string>(op,
+                    static_cast<Str*>((*rows[i])[lhs.d_column])->Str::value(), pattern);
+        }
+    }
+
+    return true;
+}
+
+// Evaluate a clause with a column as the left operand using the typed
+// loops. Return false if the operand types are not handled.
+bool select_block(int op, const block_operand &lhs, const block_operand &rhs, const vector<vector<BaseType*>*> &rows,
+    vector<unsigned char> &selection)
+{
+    switch (lhs.d_btp->type()) {
+    case dods_byte_c: return select_lhs<Byte, dods_byte>(op, lhs, rhs, rows, selection);
+    case dods_int8_c: return select_lhs<Int8, dods_int8>(op, lhs, rhs, rows, selection);
+    case dods_int16_c: return select_lhs<Int16, dods_int16>(op, lhs, rhs, rows, selection);
+    case dods_uint16_c: return select_lhs<UInt16, dods_uint16>(op, lhs, rhs, rows, selection);
+    case dods_int32_c: return select_lhs<Int32, dods_int32>(op, lhs, rhs, rows, selection);
+    case dods_uint32_c: return select_lhs<UInt32, dods_uint32>(op, lhs, rhs, rows, selection);
+    case dods_int64_c: return select_lhs<Int64, dods_int64>(op, lhs, rhs, rows, selection);
+    case dods_uint64_c: return select_lhs<UInt64, dods_uint64>(op, lhs, rhs, rows, selection);
+    case dods_float32_c: return select_lhs<Float32, dods_float32>(op, lhs, rhs, rows, selection);
+    case dods_float64_c: return select_lhs<Float64, dods_float64>(op, lhs, rhs, rows, selection);
+    case dods_str_c:
+    case dods_url_c: return select_str(op, lhs, rhs, rows, selection);
+    default: return false;
+    }
+}
+
+// Find the column for a variable; 'btp' is the rvalue's variable or constant.
+// D4RValue::value() is not used because it calls read() for variables.
+block_operand make_block_operand(D4RValue::value_kind kind, BaseType *btp, const vector<BaseType*> &columns)
+{
+    block_operand operand;
+
+    switch (kind) {
+    case D4RValue::basetype: {
+        vector<BaseType*>::const_iterator i = find(columns.begin(), columns.end(), btp);
+        if (i == columns.end())
+            throw InternalErr(__FILE__, __LINE__, "While evaluating a constraint filter clause: A filter variable is not part of the rows.");
+        operand.d_btp = *i;
+        operand.d_column = i - columns.begin();
+        break;
+    }
+
+    case D4RValue::constant:
+        operand.d_btp = btp;
+        break;
+
+    case D4RValue::function:
+        throw Error(malformed_expr, "An expression that included a function call was used in a place where that won't work.");
+
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Unknown rvalue type.");
+    }
+
+    return operand;
+}
+
+} // namespace
+
+/**
+ * @brief Evaluate this clause for a block of rows.
+ *
+ * Rows whose entry in \c selection is zero are skipped; for the others
+ * the entry is set to zero if the clause is false.
+ *
+ * @param rows The block of rows
+ * @param columns The variables the row elements hold values for
+ * @param selection One entry per row
+ * @see D4FilterClauseList::value(const vector<vector<BaseType*>*> &, const vector<BaseType*> &, vector<unsigned char> &)
+ */
+void D4FilterClause::value(const vector<vector<BaseType*>*> &rows, const vector<BaseType*> &columns,
+    vector<unsigned char> &selection)
+{
+    switch (d_op) {
+    case null:
+        throw InternalErr(__FILE__, __LINE__, "While evaluating a constraint filter clause: Found a null operator");
+
+    case less:
+    case greater:
+    case less_equal:
+    case greater_equal:
+    case equal:
+    case not_equal:
+    case match:
+        break;
+
+    case ND:
+    case map:
+        throw InternalErr(__FILE__, __LINE__, "While evaluating a constraint filter clause: Filter operator not implemented");
+
+    default:
+        throw InternalErr(__FILE__, __LINE__, "While evaluating a constraint filter clause: Unrecognized operator");
+    }
+
+    if (selection.size() != rows.size())
+        throw InternalErr(__FILE__, __LINE__, "While evaluating a constraint filter clause: The selection does not match the rows.");
+
+    if (rows.empty())
+        return;
+
+    block_operand lhs = make_block_operand(d_arg1->get_kind(),
+        d_arg1->get_kind() == D4RValue::constant ? d_arg1->d_constant : d_arg1->d_variable, columns);
+    block_operand rhs = make_block_operand(d_arg2->get_kind(),
+        d_arg2->get_kind() == D4RValue::constant ? d_arg2->d_constant : d_arg2->d_variable, columns);
+
+    // Two constants; the value is the same for every row
+    if (lhs.constant() && rhs.constant()) {
+        if (!cmp(d_op, lhs.d_btp, rhs.d_btp))
+            fill(selection.begin(), selection.end(), 0);
+        return;
+    }
+
+    // UInt16 and UInt32 have no d4_ops(); leave those (and the other cases
+    // the typed loops do not handle) for the row-at-a-time code so the
+    // result is the same as value().
+    Type lhs_type = lhs.d_btp->type();
+    if (lhs_type != dods_uint16_c && lhs_type != dods_uint32_c) {
+        if (!lhs.constant() && select_block(d_op, lhs, rhs, rows, selection))
+            return;
+        if (lhs.constant() && d_op != match && select_block(swap_op(d_op), rhs, lhs, rows, selection))
+            return;
+    }
+
+    for (vector<unsigned char>::size_type i = 0, e = rows.size(); i < e; ++i) {
+        if (selection[i])
+            selection[i] = cmp(d_op, lhs.value(*rows[i]), rhs.value(*rows[i]));
+    }
+}
+
+/**
+ * @brief The variable this clause filters on
+ * @return The D4Sequence field used by the clause or null if neither
+ * operand is a variable. If both are, the left operand is returned.
+ */
+BaseType *D4FilterClause::get_variable() const
+{
+    if (d_arg1->get_kind() == D4RValue::basetype)
+        return d_arg1->d_variable;
+    else if (d_arg2->get_kind() == D4RValue::basetype)
+        return d_arg2->d_variable;
+    else
+        return 0;
+}
+
+/**
+ * @brief The constant this clause compares the variable with
+ * @return The constant or null if neither operand is a constant.
+ */
+BaseType *D4FilterClause::get_constant() const
+{
+    if (d_arg2->get_kind() == D4RValue::constant)
+        return d_arg2->d_constant;
+    else if (d_arg1->get_kind() == D4RValue::constant)
+        return d_arg1->d_constant;
+    else
+        return 0;
+}
+
+/**
+ * @brief The operator with the variable as the left operand
+ * The parser accepts both 'x < 3' and '3 > x'; for both this returns
+ * 'less' so that the clause can be read as 'variable op constant'.
+ * @return The operator
+ */
+D4FilterClause::ops D4FilterClause::get_variable_op() const
+{
+    if (d_arg1->get_kind() != D4RValue::basetype && d_arg2->get_kind() == D4RValue::basetype)
+        return static_cast<ops>(swap_op(d_op));
+    else
+        return d_op;
+}
+
 } // namespace libdap
@@ -34,9 +34,32 @@
 namespace libdap
 {
 
+class BaseType;
 class D4Rvalue;
 class D4FilterClause;
 
+/**
+ * @brief The range of values a filter allows for one variable
+ *
+ * Built by D4FilterClauseList::get_range() by intersecting the clauses
+ * that compare the variable with a constant using <, <=, >, >= or ==. The
+ * bounds are the (typed) constants of those clauses, so a handler can
+ * compare them to its own index without any loss of precision. A null
+ * bound means there is no limit on that side.
+ */
+struct D4FilterRange
+{
+    BaseType *d_variable;       ///< The variable; a field of a D4Sequence
+    BaseType *d_lower;          ///< The lower bound or null; a weak pointer
+    bool d_lower_inclusive;
+    BaseType *d_upper;          ///< The upper bound or null; a weak pointer
+    bool d_upper_inclusive;
+    bool d_empty;               ///< True if no value can satisfy the clauses
+
+    D4FilterRange() : d_variable(0), d_lower(0), d_lower_inclusive(false), d_upper(0), d_upper_inclusive(false),
+        d_empty(false) { }
+};
+
 /**
  * @brief List of DAP4 Filter Clauses
  *
@@ -81,10 +104,18 @@ public:
 
     unsigned int size() const { return d_clauses.size(); }
 
+    // Predicate pushdown; these are used by handlers before they read data
+    bool get_range(BaseType *var, D4FilterRange &range) const;
+
     // get the clause value; this version supports functional clauses
     bool value(DMR &dmr);
 
     bool value();
+
+    // Evaluate the clauses for a block of rows (e.g., a D4Sequence's values)
+    bool can_evaluate_block(const std::vector<BaseType*> &columns) const;
+    unsigned long value(const std::vector<std::vector<BaseType*>*> &rows, const std::vector<BaseType*> &columns,
+        std::vector<unsigned char> &selection);
 };
 
 /**
@@ -104,10 +135,18 @@ public:
  * Sequences fields. The method 'value()' is effectively the evaluator for
  * the clause and nominally reads values from the rvalue objects.
  *
- * @note Potential optimization: Because Sequences might have an optimized
- * representation as a STL vector of some built in types, there could be a
- * value() method that takes a value and compares it to the clause's constant
- * value using the supplied op.
+ * A handler that can apply a filter while it reads (e.g., using an index)
+ * can inspect the clauses bound to a D4Sequence using get_variable(),
+ * get_constant() and get_variable_op() (or the ranges built by
+ * D4FilterClauseList::get_range()) and then call set_enforced() for the
+ * clauses it has fully applied. D4FilterClauseList does not evaluate those
+ * clauses again.
+ *
+ * When the values of a Sequence are already held in memory, the version of
+ * value() that takes a block of rows evaluates the clause for all of them at
+ * once. The values of each column are copied into a vector of their C++
+ * type and compared to the constant (or to another column) in a single
+ * loop, which the compiler can vectorize.
  *
  * @note The 'ND' and 'map' ops are 'still just an idea' parts.
  */
@@ -137,7 +176,10 @@ private:
 
     D4RValue *d_arg1, *d_arg2;
 
-    D4FilterClause() : d_op(null), d_arg1(0), d_arg2(0) { }
+    /** True if the handler has applied this clause to the data it returns */
+    bool d_enforced;
+
+    D4FilterClause() : d_op(null), d_arg1(0), d_arg2(0), d_enforced(false) { }
 
     void m_duplicate(const D4FilterClause &rhs);
 
@@ -167,7 +209,7 @@ public:
      * @param arg2 The right-hand operand
      */
     D4FilterClause(const ops op, D4RValue *arg1, D4RValue *arg2) :
-    	d_op(op), d_arg1(arg1), d_arg2(arg2) {
+    	d_op(op), d_arg1(arg1), d_arg2(arg2), d_enforced(false) {
     	assert(op != null && "null operator");
     	assert(arg1 && "null arg1");
     	assert(arg2 && "null arg2");
@@ -191,10 +233,35 @@ public:
     	delete d_arg2;
     }
 
+    /// The operator, as written in the constraint
+    ops get_op() const { return d_op; }
+
+    BaseType *get_variable() const;
+    BaseType *get_constant() const;
+    ops get_variable_op() const;
+
+    /**
+     * @brief Has the handler applied this clause?
+     * @return True if the clause will not be evaluated by D4FilterClauseList
+     */
+    bool enforced() const { return d_enforced; }
+
+    /**
+     * @brief Record that the data returned by the handler satisfy this clause
+     *
+     * A handler that reads only values that satisfy this clause calls this
+     * so that the clause is not evaluated again for each row.
+     * @param state True if the clause is enforced by the handler
+     */
+    void set_enforced(bool state = true) { d_enforced = state; }
+
     // get the clause value; this version supports functional clauses
     bool value(DMR &dmr);
 
     bool value();
+
+    void value(const std::vector<std::vector<BaseType*>*> &rows, const std::vector<BaseType*> &columns,
+        std::vector<unsigned char> &selection);
 };
 
 } // namespace libdap
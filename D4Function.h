@@ -38,6 +38,10 @@ class DMR;
 // I think this would be better as a 'function that takes...' instead of a 'pointer
 // to a function that takes...' but I used this to make the code fit more closely to
 // the pattern established by the DAP2 CE functions. jhrg 3/10/14
+//
+// D4FunctionEvaluator::eval() copies the value the function returns into the
+// result DMR unless the function's ServerFunction says that the value is a new
+// BaseType; see ServerFunction::setResultIsNew().
 
 typedef BaseType* (*D4Function)(D4RValueList *, DMR &);
 
@@ -31,6 +31,7 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <set>
 
 #include <stdint.h>
 
@@ -44,6 +45,8 @@
 #include "D4Dimensions.h"
 #include "D4Group.h"
 #include "D4Enum.h"
+#include "D4Maps.h"
+#include "ParallelLoop.h"
 
 #include "D4StreamMarshaller.h"
 #include "D4StreamUnMarshaller.h"
@@ -532,6 +535,7 @@ D4Group::serialize(D4StreamMarshaller &m, DMR &dmr, /*ConstraintEvaluator &eval,
 	for (Vars_iter i = d_vars.begin(); i != d_vars.end(); i++) {
 		// Only send the stuff in the current subset.
 		if ((*i)->send_p()) {
+			m.check_cancel();
 			m.reset_checksum();
 
 	        DBG(cerr << "Serializing variable " << (*i)->type_name() << " " << (*i)->name() << endl);
@@ -652,6 +656,8 @@ D4Group::transform_to_dap2(AttrTable *parent_attr_table)
  *
  * @todo Fix the comment.
  *
+ * This uses one thread; see transform_to_dap2(AttrTable*, unsigned int).
+ *
  * @param parent_attr_table The AttrTable pointer parent_attr_table is used by Groups, which disappear
  * from the DAP2 representation. Their children are returned in the the BaseType vector
  * their attributes are added to parent_attr_table;
@@ -661,6 +667,83 @@ D4Group::transform_to_dap2(AttrTable *parent_attr_table)
  */
 vector<BaseType *> *
 D4Group::transform_to_dap2(AttrTable *parent_attr_table)
+{
+    return transform_to_dap2(parent_attr_table, 1);
+}
+
+namespace {
+
+// Transform each variable and save the result in the same position of
+// the results
+class transform_vars: public ParallelLoop::Body {
+    const vector<BaseType *> &d_vars;
+    AttrTable *d_attrs;
+    vector<vector<BaseType *> *> &d_results;
+
+public:
+    transform_vars(const vector<BaseType *> &vars, AttrTable *attrs, vector<vector<BaseType *> *> &results) :
+        d_vars(vars), d_attrs(attrs), d_results(results) { }
+
+    void run(unsigned long i)
+    {
+        d_results[i] = d_vars[i]->transform_to_dap2(d_attrs);
+    }
+};
+
+} // anonymous namespace
+
+// Make the D4Attributes and D4Maps objects that transform_to_dap2() makes
+// when they are first used, so that variables sharing Map arrays can be
+// transformed by several threads.
+static void
+prepare_for_dap2(BaseType *btp, set<BaseType *> &visited)
+{
+    if (!visited.insert(btp).second)
+        return;
+
+    btp->attributes();
+
+    if (btp->type() == dods_array_c) {
+        D4Maps *maps = static_cast<Array*>(btp)->maps();
+        for (D4Maps::D4MapsIter i = maps->map_begin(), e = maps->map_end(); i != e; ++i)
+            if ((*i)->array())
+                prepare_for_dap2(const_cast<Array*>((*i)->array()), visited);
+    }
+    else if (btp->is_constructor_type()) {
+        Constructor *c = static_cast<Constructor*>(btp);
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i)
+            prepare_for_dap2(*i, visited);
+    }
+}
+
+static void
+delete_results(vector<vector<BaseType *> *> &results)
+{
+    for (vector<vector<BaseType *> *>::iterator i = results.begin(), e = results.end(); i != e; ++i) {
+        if (*i) {
+            for (vector<BaseType *>::iterator vi = (*i)->begin(), ve = (*i)->end(); vi != ve; ++vi)
+                delete *vi;
+            delete *i;
+            *i = 0;
+        }
+    }
+}
+
+/** @brief Transform the D4Group's variables to DAP2 variables using several threads
+
+    This is the same as transform_to_dap2(AttrTable*) but the variables of
+    each group are transformed by \e threads threads. The variables are
+    returned in the same order and with the same attributes as when one
+    thread is used. The variables' transform_to_dap2() methods must be
+    MT-safe; those in libdap are.
+
+    @param parent_attr_table Add the Group attributes to this AttrTable
+    @param threads Use this many threads; one transforms the variables in
+    order in the calling thread.
+    @return The new DAP2 variables.
+    @see DMR::set_transform_threads() */
+vector<BaseType *> *
+D4Group::transform_to_dap2(AttrTable *parent_attr_table, unsigned int threads)
 {
     DBG( cerr << __func__ << "() - BEGIN ("<< name() << ")" << endl);
 
@@ -698,13 +781,30 @@ D4Group::transform_to_dap2(AttrTable *parent_attr_table)
 
     // Now we process the child variables of this group
 
+    vector<BaseType *> vars(var_begin(), var_end());
+    vector<vector<BaseType *> *> var_results(vars.size(), static_cast<vector<BaseType *> *>(0));
+    try {
+        if (threads > 1) {
+            set<BaseType *> visited;
+            for (vector<BaseType *>::iterator i = vars.begin(), e = vars.end(); i != e; ++i)
+                prepare_for_dap2(*i, visited);
+        }
+
+        transform_vars body(vars, group_attrs, var_results);
+        ParallelLoop(body, vars.size()).run(threads);
+    }
+    catch (...) {
+        delete_results(var_results);
+        throw;
+    }
+
     vector<BaseType *> dropped_vars;
-    for (D4Group::Vars_citer i = var_begin(), e = var_end(); i != e; ++i) {
+    for (vector<BaseType *>::size_type i = 0; i < vars.size(); ++i) {
 
-        DBG( cerr << __func__ << "() - Processing member variable '" << (*i)->name() <<
+        DBG( cerr << __func__ << "() - Processing member variable '" << vars[i]->name() <<
             "' root: " << (is_root?"true":"false") << endl);
 
-        vector<BaseType *> *new_vars = (*i)->transform_to_dap2(group_attrs);
+        vector<BaseType *> *new_vars = var_results[i];
         if (new_vars) {  // Might be un-mappable
             // It's not so game on..
             for (vector<BaseType*>::iterator vi = new_vars->begin(), ve = new_vars->end(); vi != ve; vi++) {
@@ -715,17 +815,17 @@ D4Group::transform_to_dap2(AttrTable *parent_attr_table)
 #if 0
                 (*vi) = NULL;
 #endif
-                DBG( cerr << __func__ << "() - Added member variable '" << (*i)->name() << "' " <<
+                DBG( cerr << __func__ << "() - Added member variable '" << vars[i]->name() << "' " <<
                     "to results vector. root: "<< (is_root?"true":"false") << endl);
             }
 
             delete new_vars;
         }
         else {
-            DBG( cerr << __func__ << "() - Dropping member variable " << (*i)->name() <<
+            DBG( cerr << __func__ << "() - Dropping member variable " << vars[i]->name() <<
                 " root: " << (is_root?"true":"false") << endl);
             // Got back a NULL, so we are dropping this var.
-            dropped_vars.push_back(*i);
+            dropped_vars.push_back(vars[i]);
         }
     }
 
@@ -739,7 +839,8 @@ D4Group::transform_to_dap2(AttrTable *parent_attr_table)
 
     // Get all the child groups.
     for (D4Group::groupsIter gi = grp_begin(), ge = grp_end(); gi != ge; ++gi) {
-        vector<BaseType *> *d2_vars = (*gi)->transform_to_dap2(group_attrs);
+        vector<BaseType *> *d2_vars = (threads > 1) ? (*gi)->transform_to_dap2(group_attrs, threads)
+            : (*gi)->transform_to_dap2(group_attrs);
         if (d2_vars) {
             for (vector<BaseType *>::iterator i = d2_vars->begin(), e = d2_vars->end(); i != e; ++i) {
                 results->push_back(*i);
@@ -1267,12 +1267,14 @@ void D4ParserSax2::cleanup_parse()
 /**
  * Read the DMR from a stream.
  *
+ * The stream is read in blocks of D4_PARSE_BUFF_SIZE bytes and each block
+ * is passed to the parser, so the whole document is never held in memory
+ * and the number of parser calls does not depend on how the document is
+ * broken into lines.
+ *
  * @param f The input stream
  * @param dest_dmr Value-result parameter. Pass a pointer to a DMR in and
  * the information in the DMR will be added to it.
- * @param boundary If not empty, use this as the boundary tag in a MPM document
- * that marks the end of the part hat holds the DMR. Stop reading when the
- * boundary is found.
  * @param debug If true, ouput helpful debugging messages, False by default.
  *
  * @exception Error Thrown if the XML document could not be read or parsed.
@@ -1280,9 +1282,30 @@ void D4ParserSax2::cleanup_parse()
  */
 void D4ParserSax2::intern(istream &f, DMR *dest_dmr, bool debug)
 {
-    d_debug = debug;
+    intern(f, -1, dest_dmr, debug);
+}
 
-    // Code example from libxml2 docs re: read from a stream.
+/**
+ * Read a DMR of a known size from a stream.
+ *
+ * Read exactly \c size bytes of the stream; the rest of the stream is
+ * left unread. Use this to parse the DMR at the start of a DAP4 data
+ * response directly from a chunked_istream, without first copying the
+ * DMR's chunk into a buffer.
+ *
+ * @param f The input stream
+ * @param size The number of bytes in the DMR. If less than zero, read to
+ * the end of the stream.
+ * @param dest_dmr Value-result parameter. Pass a pointer to a DMR in and
+ * the information in the DMR will be added to it.
+ * @param debug If true, ouput helpful debugging messages, False by default.
+ *
+ * @exception Error Thrown if the XML document could not be read or parsed.
+ * @exception InternalErr Thrown if an internal error is found.
+ */
+void D4ParserSax2::intern(istream &f, streamsize size, DMR *dest_dmr, bool debug)
+{
+    d_debug = debug;
 
     if (!f.good())
         throw Error("Input stream not open or read error");
@@ -1290,75 +1313,51 @@ void D4ParserSax2::intern(istream &f, DMR *dest_dmr, bool debug)
         throw InternalErr(__FILE__, __LINE__, "DMR object is null");
 
     d_dmr = dest_dmr; // dump values here
-#if 0
-    int line_num = 1;
-    string line;
 
-    // Get the <xml ... ?> line
-    getline(f, line);
-    if (line.length() == 0) throw Error("No input found while parsing the DMR.");
-
-    if (debug) cerr << "line: (" << line_num << "): " << endl << line << endl << endl;
-
-    d_context = xmlCreatePushParserCtxt(&d_dmr_sax_parser, this, line.c_str(), line.length(), "stream");
-    d_context->validate = true;
-    push_state(parser_start);
-
-    // Get the first line of stuff
-    getline(f, line);
-    ++line_num;
-
-    if (debug) cerr << "line: (" << line_num << "): " << endl << line << endl << endl;
-
-    while (!f.eof() && (get_state() != parser_end)) {
-        xmlParseChunk(d_context, line.c_str(), line.length(), 0);
+    vector<char> buffer(D4_PARSE_BUFF_SIZE);
+    streamsize remaining = size;
+    long chunk_count = 0;
 
-        // Get the next line
-        getline(f, line);
-        ++line_num;
+    // Read the next block, but not past the end of the DMR
+    streamsize block = (remaining < 0 || remaining > D4_PARSE_BUFF_SIZE) ? D4_PARSE_BUFF_SIZE : remaining;
+    f.read(&buffer[0], block);
+    streamsize chunk_size = f.gcount();
+    if (chunk_size == 0) throw Error("No input found while parsing the DMR.");
 
-        if (debug) cerr << "line: (" << line_num << "): " << endl << line << endl << endl;
+    if (debug) {
+        cerr << "chunk: (" << chunk_count++ << "): " << endl;
+        cerr.write(&buffer[0], chunk_size) << endl << endl;
     }
-    // This call ends the parse.
-    xmlParseChunk(d_context, line.c_str(), 0, 1/*terminate*/);
 
-#else
-    int line_num = 1;
-    string line;
-
-    // Get the XML prolog line (looks like: <?xml ... ?> )
-    getline(f, line);
-    if (line.length() == 0) throw Error("No input found while parsing the DMR.");
-
-    if (debug) cerr << "line: (" << line_num << "): " << endl << line << endl << endl;
-
-    d_context = xmlCreatePushParserCtxt(&d_dmr_sax_parser, this, line.c_str(), line.length(), "stream");
-    d_context->validate = true;
+    // libxml2 uses the start of the document to determine its encoding, so
+    // pass the first block when making the parser.
     push_state(parser_start);
+    d_context = xmlCreatePushParserCtxt(&d_dmr_sax_parser, this, &buffer[0], chunk_size, "stream");
+    d_context->validate = true;
 
-    // Get the first chunk of the stuff
-    long chunk_count = 0;
-    long chunk_size = 0;
+    if (remaining > 0) remaining -= chunk_size;
 
-    f.read(d_parse_buffer, D4_PARSE_BUFF_SIZE);
-    chunk_size=f.gcount();
-    d_parse_buffer[chunk_size]=0; // null terminate the string. We can do it this way because the buffer is +1 bigger than D4_PARSE_BUFF_SIZE
-    if (debug) cerr << "chunk: (" << chunk_count++ << "): " << endl << d_parse_buffer << endl << endl;
+    while (f.good() && remaining != 0 && get_state() != parser_end) {
+        block = (remaining < 0 || remaining > D4_PARSE_BUFF_SIZE) ? D4_PARSE_BUFF_SIZE : remaining;
+        f.read(&buffer[0], block);
+        chunk_size = f.gcount();
+        if (chunk_size == 0) break;
 
-    while(!f.eof()  && (get_state() != parser_end)){
+        if (debug) {
+            cerr << "chunk: (" << chunk_count++ << "): " << endl;
+            cerr.write(&buffer[0], chunk_size) << endl << endl;
+        }
 
-        xmlParseChunk(d_context, d_parse_buffer, chunk_size, 0);
+        xmlParseChunk(d_context, &buffer[0], chunk_size, 0);
 
-        // There is more to read. Get the next chunk
-        f.read(d_parse_buffer, D4_PARSE_BUFF_SIZE);
-        chunk_size=f.gcount();
-        d_parse_buffer[chunk_size]=0; // null terminate the string. We can do it this way because the buffer is +1 bigger than D4_PARSE_BUFF_SIZE
-        if (debug) cerr << "chunk: (" << chunk_count++ << "): " << endl << d_parse_buffer << endl << endl;
+        if (remaining > 0) remaining -= chunk_size;
     }
 
     // This call ends the parse.
-    xmlParseChunk(d_context, d_parse_buffer, chunk_size, 1/*terminate*/);
-#endif
+    xmlParseChunk(d_context, &buffer[0], 0, 1/*terminate*/);
+
+    // Leave the stream at the end of the DMR even if the parser stopped early
+    if (remaining > 0) f.ignore(remaining);
 
     // This checks that the state on the parser stack is parser_end and throws
     // an exception if it's not (i.e., the loop exited with gcount() == 0).
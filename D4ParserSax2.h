@@ -34,11 +34,13 @@
 #include <iostream>
 #include <map>
 #include <stack>
+#include <vector>
 
 #include <libxml/parserInternals.h>
 
 #define CRLF "\r\n"
-#define D4_PARSE_BUFF_SIZE 1048576
+// intern(istream&) reads and parses the DMR in blocks of this many bytes
+#define D4_PARSE_BUFF_SIZE 65536
 
 namespace libdap
 {
@@ -117,8 +119,6 @@ private:
 
         parser_end
     };
-    char d_parse_buffer[D4_PARSE_BUFF_SIZE+1]; // Buff size plus one byte for NULL termination.
-
     xmlSAXHandler d_dmr_sax_parser;
 
     // The results of the parse operation are stored in these fields.
@@ -283,6 +283,7 @@ public:
     }
 
     void intern(istream &f, DMR *dest_dmr, bool debug = false);
+    void intern(istream &f, std::streamsize size, DMR *dest_dmr, bool debug = false);
     // Deprecated - this does not read from a file, it parses text in the string 'document'
     void intern(const string &document, DMR *dest_dmr, bool debug = false);
     void intern(const char *buffer, int size, DMR *dest_dmr, bool debug = false);
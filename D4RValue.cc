@@ -76,6 +76,7 @@ D4RValue::m_duplicate(const D4RValue &src)
     d_variable = src.d_variable;    // weak pointers
 
     d_func = src.d_func;
+    d_result_is_new = src.d_result_is_new;
     d_args = (src.d_args != 0) ? new D4RValueList(*src.d_args) : 0; // deep copy these
 
     d_constant = (src.d_constant != 0) ? src.d_constant->ptr_duplicate() : 0;
@@ -101,28 +102,28 @@ build_constant_array(vector<T> &values, DAP_TYPE &dt)
     return array;
 }
 
-D4RValue::D4RValue(unsigned long long ull) : d_variable(0), d_func(0), d_args(0), d_constant(0), d_value_kind(constant)
+D4RValue::D4RValue(unsigned long long ull) : d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	UInt64 *ui = new UInt64("constant");
 	ui->set_value(ull);
 	d_constant = ui;
 }
 
-D4RValue::D4RValue(long long ll) : d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+D4RValue::D4RValue(long long ll) : d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Int64 *i = new Int64("constant");
 	i->set_value(ll);
 	d_constant = i;
 }
 
-D4RValue::D4RValue(double r) : d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+D4RValue::D4RValue(double r) : d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Float64 *f = new Float64("constant");
 	f->set_value(r);
 	d_constant = f;
 }
 
-D4RValue::D4RValue(std::string cpps) : d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+D4RValue::D4RValue(std::string cpps) : d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Str *s = new Str("constant");
 	s->set_value(remove_quotes(cpps));
@@ -130,70 +131,70 @@ D4RValue::D4RValue(std::string cpps) : d_variable(0), d_func(0), d_args(0),  d_c
 }
 
 D4RValue::D4RValue(std::vector<dods_byte> &byte_args)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Byte b("");
 	d_constant = build_constant_array(byte_args, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_int8> &byte_int8)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Int8 b("");
 	d_constant = build_constant_array(byte_int8, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_uint16> &byte_uint16)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	UInt16 b("");
 	d_constant = build_constant_array(byte_uint16, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_int16> &byte_int16)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Int16 b("");
 	d_constant = build_constant_array(byte_int16, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_uint32> &byte_uint32)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	UInt32 b("");
 	d_constant = build_constant_array(byte_uint32, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_int32> &byte_int32)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Int32 b("");
 	d_constant = build_constant_array(byte_int32, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_uint64> &byte_uint64)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	UInt64 b("");
 	d_constant = build_constant_array(byte_uint64, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_int64> &byte_int64)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Int64 b("");
 	d_constant = build_constant_array(byte_int64, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_float32> &byte_float32)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Float32 b("");
 	d_constant = build_constant_array(byte_float32, b);
 }
 
 D4RValue::D4RValue(std::vector<dods_float64> &byte_float64)
-	: d_variable(0), d_func(0), d_args(0),  d_constant(0), d_value_kind(constant)
+	: d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(constant)
 {
 	Float64 b("");
 	d_constant = build_constant_array(byte_float64, b);
@@ -316,5 +317,25 @@ D4RValue::value()
     }
 }
 
+/**
+ * @brief Add the dataset variables this RValue uses to a vector
+ *
+ * For a function, these are the variables used by its arguments. Constants
+ * are not dataset variables and are not added.
+ *
+ * @param vars Value-result parameter
+ */
+void
+D4RValue::variables(std::vector<BaseType*> &vars) const
+{
+    if (d_variable)
+        vars.push_back(d_variable);
+
+    if (d_args) {
+        for (D4RValueList::iter i = d_args->begin(), e = d_args->end(); i != e; ++i)
+            (*i)->variables(vars);
+    }
+}
+
 } // namespace libdap
 
@@ -97,6 +97,7 @@ private:
 
     D4Function d_func;  	// (weak) pointer to a function returning BaseType *
     D4RValueList *d_args;  	// pointer to arguments to the function; delete
+    bool d_result_is_new;   // d_func returns a new BaseType; see result_is_new()
 
     BaseType *d_constant;	// pointer; delete.
 
@@ -106,12 +107,15 @@ private:
     void m_duplicate(const D4RValue &src);
 
     friend class D4RValueList;
+    friend class D4FilterClause;
+    friend class D4FilterClauseList;
 
 public:
-    D4RValue() : d_variable(0), d_func(0), d_args(0), d_constant(0), d_value_kind(unknown) { }
+    D4RValue() : d_variable(0), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(unknown) { }
     D4RValue(const D4RValue &src) { m_duplicate(src); }
-    D4RValue(BaseType *btp)  : d_variable(btp), d_func(0), d_args(0), d_constant(0), d_value_kind(basetype) { }
-    D4RValue(D4Function f, D4RValueList *args)  : d_variable(0), d_func(f), d_args(args), d_constant(0), d_value_kind(function) { }
+    D4RValue(BaseType *btp)  : d_variable(btp), d_func(0), d_args(0), d_result_is_new(false), d_constant(0), d_value_kind(basetype) { }
+    D4RValue(D4Function f, D4RValueList *args, bool result_is_new = false)
+        : d_variable(0), d_func(f), d_args(args), d_result_is_new(result_is_new), d_constant(0), d_value_kind(function) { }
 
     D4RValue(unsigned long long ui);
     D4RValue(long long i);
@@ -149,12 +153,24 @@ public:
      */
     value_kind get_kind() const { return d_value_kind; }
 
+    /**
+     * @brief Does the function return a new BaseType that the caller owns?
+     *
+     * True only for a function whose ServerFunction says so; see
+     * ServerFunction::setResultIsNew(). Otherwise the value of a function
+     * may be one of its arguments, a variable of the dataset or something
+     * the function keeps, so it must be copied and not deleted.
+     */
+    bool result_is_new() const { return d_result_is_new; }
+
     // This is the call that will be used to return the value of a function.
     // jhrg 3/10/14
     virtual BaseType *value(DMR &dmr);
     // And this optimizes value() for filters, where functions are not supported.
     virtual BaseType *value();
 
+    void variables(std::vector<BaseType*> &vars) const;
+
 };
 
 } // namespace libdap
@@ -34,6 +34,7 @@
 
 #include "D4StreamMarshaller.h"
 #include "D4StreamUnMarshaller.h"
+#include "CancelToken.h"
 
 #include "D4RValue.h"
 #include "D4FilterClause.h"     // also contains D4FilterClauseList
@@ -102,11 +103,10 @@ is_end_of_sequence(unsigned char marker)
 void D4Sequence::m_duplicate(const D4Sequence &s)
 {
     d_length = s.d_length;
-#if INDEX_SUBSETTING
     d_starting_row_number = s.d_starting_row_number;
     d_ending_row_number = s.d_ending_row_number;
     d_row_stride = s.d_row_stride;
-#endif
+    d_row_number_constraint_enforced = s.d_row_number_constraint_enforced;
     // Deep copy for the values
     for (D4SeqValues::const_iterator i = s.d_values.begin(), e = s.d_values.end(); i != e; ++i) {
         D4SeqRow &row = **i;
@@ -134,7 +134,8 @@ void D4Sequence::m_duplicate(const D4Sequence &s)
 
  @brief The Sequence constructor. */
 D4Sequence::D4Sequence(const string &n) :
-        Constructor(n, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_length(0)
+        Constructor(n, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_length(0),
+        d_starting_row_number(-1), d_row_stride(1), d_ending_row_number(-1), d_row_number_constraint_enforced(false)
 {
 }
 
@@ -149,7 +150,8 @@ D4Sequence::D4Sequence(const string &n) :
 
  @brief The Sequence server-side constructor. */
 D4Sequence::D4Sequence(const string &n, const string &d) :
-        Constructor(n, d, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_length(0)
+        Constructor(n, d, dods_sequence_c, true /* is dap4 */), d_clauses(0), d_copy_clauses(true), d_length(0),
+        d_starting_row_number(-1), d_row_stride(1), d_ending_row_number(-1), d_row_number_constraint_enforced(false)
 {
 }
 
@@ -299,19 +301,58 @@ void D4Sequence::intern_data()
  * before being written. That is a consequence of using a length prefix
  * instead of a series of sentinel values.
  *
+ * If a row-number constraint has been set, only the rows in that constraint
+ * are stored and reading stops after the ending row. A handler can use
+ * get_starting_row_number(), get_row_stride() and get_ending_row_number()
+ * in read() to seek instead; it should then call
+ * set_row_number_constraint_enforced(). Without that, read() is called for
+ * every row up to the ending row, including those the constraint skips.
+ *
+ * When the filter clauses reference only the variables being sent (and
+ * there is no child sequence or row-number constraint to apply), the rows
+ * are read a block at a time and each block is filtered with
+ * D4FilterClauseList::value(rows, columns, selection). Otherwise the
+ * clauses are evaluated as each row is read.
+ *
  * @param filter True if the/a file expression bound to this sequence
  * should be evaluated.
+ * @param token If not null, check this before each row is read and stop
+ * (by throwing Error) once it has been cancelled.
  * @see set_value()
  */
-void D4Sequence::read_sequence_values(bool filter)
+void D4Sequence::read_sequence_values(bool filter, const CancelToken *token)
 {
     DBG(cerr << __PRETTY_FUNCTION__ << " BEGIN" << endl);
 
     if (read_p()) return;
 
+    vector<BaseType*> columns;
+    if (filter && m_filter_by_block(columns)) {
+        m_read_values_by_block(columns, token);
+        set_length(d_values.size());
+        return;
+    }
+
+    // If there's a row-number constraint, 'row_number' is the number of the
+    // next row that satisfies the filter. Rows before the start or between
+    // strides are still read by read(), both to evaluate the filter and to
+    // move the data source to the next row, but they are not copied and
+    // their child sequences are not read. The loop stops once the ending row
+    // has been stored.
+    const bool row_numbers = d_starting_row_number != -1 && !d_row_number_constraint_enforced;
+    int64_t row_number = 0;
+
     // Read the data values, then serialize. NB: read_next_instance sets d_length
     // evaluates the filter expression
-    while (read_next_instance(filter)) {
+    while (!(row_numbers && d_ending_row_number != -1 && row_number > d_ending_row_number) && read_next_instance(filter)) {
+        if (token) token->check();
+
+        if (row_numbers) {
+            bool skip = row_number < d_starting_row_number || (row_number - d_starting_row_number) % d_row_stride != 0;
+            ++row_number;
+            if (skip) continue;
+        }
+
         DBG(cerr << "read_sequence_values() - Adding row" << endl);
         D4SeqRow* row = new D4SeqRow;
         for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; i++) {
@@ -320,7 +361,7 @@ void D4Sequence::read_sequence_values(bool filter)
                 if ((*i)->type() == dods_sequence_c) {
                     DBG(cerr << "Reading child sequence values for " << (*i)->name() << endl);
                     D4Sequence *d4s = static_cast<D4Sequence*>(*i);
-                    d4s->read_sequence_values(filter);
+                    d4s->read_sequence_values(filter, token);
                     d4s->d_copy_clauses = false;
                     row->push_back(d4s->ptr_duplicate());
                     d4s->d_copy_clauses = true;  // Must be sure to not break the object in general
@@ -347,6 +388,152 @@ void D4Sequence::read_sequence_values(bool filter)
     DBGN(cerr << __PRETTY_FUNCTION__ << " END added " << d_values.size() << endl);
 }
 
+// The rows in one block of the block filter; this bounds the memory used
+// by the rows that are not selected and by the temporary column vectors.
+static const D4SeqValues::size_type filter_block_size = 4096;
+
+/**
+ * Can read_sequence_values() filter this sequence a block of rows at a
+ * time? It can if there are filter clauses, they reference only the
+ * variables that are sent, none of those is a child sequence (whose
+ * values would be read for every row, including those the filter
+ * rejects) and there is no row-number constraint to apply as the rows are
+ * read.
+ *
+ * @param columns Value-result parameter; the variables that are sent.
+ * @return True if the rows can be filtered by block.
+ */
+bool D4Sequence::m_filter_by_block(vector<BaseType*> &columns) const
+{
+    if (!d_clauses || d_clauses->size() == 0)
+        return false;
+
+    if (d_starting_row_number != -1 && !d_row_number_constraint_enforced)
+        return false;
+
+    columns.clear();
+    for (Vars_citer i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+        if ((*i)->send_p()) {
+            if ((*i)->type() == dods_sequence_c)
+                return false;
+            columns.push_back(*i);
+        }
+    }
+
+    return d_clauses->can_evaluate_block(columns);
+}
+
+/**
+ * Read the rows without evaluating the filter, a block at a time, and
+ * filter each block using D4FilterClauseList::value(rows, columns,
+ * selection). The result is the same as evaluating the clauses as each
+ * row is read, but each clause is applied to the whole block in one loop.
+ */
+void D4Sequence::m_read_values_by_block(const vector<BaseType*> &columns, const CancelToken *token)
+{
+    D4SeqValues block;
+    block.reserve(filter_block_size);
+    vector<unsigned char> selection;
+
+    try {
+        bool more = true;
+        while (more) {
+            while (block.size() < filter_block_size && (more = read_next_instance(false))) {
+                if (token) token->check();
+
+                block.push_back(new D4SeqRow);
+                for (vector<BaseType*>::const_iterator i = columns.begin(), e = columns.end(); i != e; ++i) {
+                    block.back()->push_back((*i)->ptr_duplicate());
+                    block.back()->back()->set_read_p(true);
+                }
+            }
+
+            m_filter_block(block, columns, selection);
+        }
+    }
+    catch (...) {
+        for_each(block.begin(), block.end(), delete_rows);
+        throw;
+    }
+}
+
+// Move the rows of 'block' that satisfy the filter to d_values and delete
+// the others. If the evaluation throws, 'block' is unchanged. The rows were
+// read with read_next_instance(false), which counted all of them in
+// d_length; take the rejected rows back out.
+void D4Sequence::m_filter_block(D4SeqValues &block, const vector<BaseType*> &columns,
+    vector<unsigned char> &selection)
+{
+    d_clauses->value(block, columns, selection);
+
+    d_values.reserve(d_values.size() + block.size());
+    for (D4SeqValues::size_type i = 0, size = block.size(); i < size; ++i) {
+        if (selection[i]) {
+            d_values.push_back(block[i]);
+        }
+        else {
+            delete_rows(block[i]);
+            --d_length;
+        }
+    }
+
+    block.clear();
+}
+
+/**
+ * @brief Apply the filter to values already held by the D4Sequence
+ *
+ * read_sequence_values() evaluates the filter clauses as the rows are
+ * read. A specialization of that method that loads many rows at once (or
+ * that uses set_value()) can call this method to filter the loaded values
+ * instead. The clauses are evaluated a block of rows at a
+ * time; the rows that do not satisfy them are deleted and the length is
+ * set to the number of rows that remain.
+ *
+ * The rows must hold values for the variables with send_p() set, in the
+ * order they appear in the D4Sequence, which is how read_sequence_values()
+ * builds them, and the filter may only reference those variables.
+ *
+ * @see D4FilterClauseList::value(const vector<vector<BaseType*>*> &, const vector<BaseType*> &, vector<unsigned char> &)
+ */
+void D4Sequence::filter_sequence_values()
+{
+    if (!d_clauses || d_clauses->size() == 0) return;
+
+    // The columns of the rows; see read_sequence_values()
+    vector<BaseType*> columns;
+    for (Vars_iter i = d_vars.begin(), e = d_vars.end(); i != e; ++i) {
+        if ((*i)->send_p()) columns.push_back(*i);
+    }
+
+    // Evaluate the clauses for every block before deleting any rows so that
+    // d_values is intact if the evaluation throws.
+    const D4SeqValues::size_type block_size = filter_block_size;
+
+    vector<unsigned char> keep;
+    keep.reserve(d_values.size());
+
+    D4SeqValues block;
+    vector<unsigned char> selection;
+    for (D4SeqValues::size_type start = 0, size = d_values.size(); start < size; start += block_size) {
+        block.assign(d_values.begin() + start, d_values.begin() + min(start + block_size, size));
+        d_clauses->value(block, columns, selection);
+        keep.insert(keep.end(), selection.begin(), selection.end());
+    }
+
+    D4SeqValues values;
+    for (D4SeqValues::size_type i = 0, size = d_values.size(); i < size; ++i) {
+        if (keep[i])
+            values.push_back(d_values[i]);
+        else
+            delete_rows(d_values[i]);
+    }
+
+    d_values.swap(values);
+
+    set_length(d_values.size());
+}
+
 /**
  * @brief Serialize the values of a D4Sequence
  * This method assumes that the underlying data store cannot/does not return a count
@@ -372,7 +559,7 @@ void D4Sequence::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter)
 
     // Read the data values, then serialize. NB: read_next_instance sets d_length
     // evaluates the filter expression
-    read_sequence_values(filter);
+    read_sequence_values(filter, m.cancel_token());
 
     // write D4Sequecne::length(); don't include the length in the checksum
     m.put_count(d_length);
@@ -380,6 +567,7 @@ void D4Sequence::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter)
     // By this point the d_values object holds all and only the values to be sent;
     // use the serialize methods to send them (but no need to test send_p).
     for (D4SeqValues::iterator i = d_values.begin(), e = d_values.end(); i != e; ++i) {
+        m.check_cancel();
         for (D4SeqRow::iterator j = (*i)->begin(), f = (*i)->end(); j != f; ++j) {
            (*j)->serialize(m, dmr, /*eval,*/false);
         }
@@ -421,25 +609,28 @@ D4FilterClauseList & D4Sequence::clauses()
 }
 
 
-#if INDEX_SUBSETTING
 /** Set the start, stop and stride for a row-number type constraint.
- This should be used only when the sequence is constrained using the
- bracket notation (which supplies start, stride and stop information).
- If omitted, the stride defaults to 1.
+ The row numbers count the rows that satisfy the filter clauses, if any.
+ read_sequence_values() stops reading once the ending row has been found
+ and does not store the rows skipped by the stride.
 
  @param start The starting row number. The first row is row zero.
- @param stop The ending row number. The 20th row is row 19.
+ @param stop The ending row number. The 20th row is row 19. Use -1 to read
+ to the end of the sequence.
  @param stride The stride. A stride of two skips every other row. */
-virtual void set_row_number_constraint(int start, int stop, int stride)
+void D4Sequence::set_row_number_constraint(int start, int stop, int stride)
 {
-    if (stop < start)
-    throw Error(malformed_expr, "Starting row number must precede the ending row number.");
+    if (start < 0)
+        throw Error(malformed_expr, "The starting row number must not be negative.");
+    if (stop != -1 && stop < start)
+        throw Error(malformed_expr, "Starting row number must precede the ending row number.");
+    if (stride < 1)
+        throw Error(malformed_expr, "The row stride must be greater than zero.");
 
     d_starting_row_number = start;
     d_row_stride = stride;
     d_ending_row_number = stop;
 }
-#endif
 
 /** @brief Get a whole row from the sequence.
  @param row Get row number <i>row</i> from the sequence.
@@ -577,11 +768,9 @@ void D4Sequence::dump(ostream &strm) const
     strm << DapIndent::LMarg << "bracket notation information:" << endl;
 
     DapIndent::Indent();
-#if INDEX_SUBSETTING
     strm << DapIndent::LMarg << "starting row #: " << d_starting_row_number << endl;
     strm << DapIndent::LMarg << "row stride: " << d_row_stride << endl;
     strm << DapIndent::LMarg << "ending row #: " << d_ending_row_number << endl;
-#endif
     DapIndent::UnIndent();
 
     DapIndent::UnIndent();
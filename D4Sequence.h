@@ -27,16 +27,13 @@
 
 #include "Constructor.h"
 
-// DAP2 Sequence supported subsetting using the array notation. This might
-// be introduced into DAP4 later on.
-#define INDEX_SUBSETTING 0
-
 class Crc32;
 
 namespace libdap
 {
 class BaseType;
 class D4FilterClauseList;
+class CancelToken;
 
 /** The type BaseTypeRow is used to store single rows of values in an
     instance of D4Sequence. Values are stored in instances of BaseType. */
@@ -153,17 +150,30 @@ protected:
 
     int64_t d_length;	// How many elements are in the sequence; -1 if not currently known
 
-#if INDEX_SUBSETTING
+    // The row-number constraint; -1 for start and end if not constrained.
+    // The row numbers count the rows that satisfy the filter.
     int d_starting_row_number;
     int d_row_stride;
     int d_ending_row_number;
-#endif
+
+    // True if the handler's read() returns only the rows in the row-number
+    // constraint (e.g., because it seeks to them).
+    bool d_row_number_constraint_enforced;
 
     void m_duplicate(const D4Sequence &s);
 
+    bool m_filter_by_block(std::vector<BaseType*> &columns) const;
+    void m_read_values_by_block(const std::vector<BaseType*> &columns, const CancelToken *token);
+    void m_filter_block(D4SeqValues &block, const std::vector<BaseType*> &columns,
+        std::vector<unsigned char> &selection);
+
     // Specialize this if you have a data source that requires read()
     // recursively call itself for child sequences.
-    void read_sequence_values(bool filter);
+    void read_sequence_values(bool filter, const CancelToken *token = 0);
+
+    // Use this to apply the filter to values loaded a block at a time
+    // (e.g., by a specialization of read_sequence_values()).
+    void filter_sequence_values();
 
     friend class D4SequenceTest;
 
@@ -217,7 +227,6 @@ public:
 
     D4FilterClauseList &clauses();
 
-#if INDEX_SUBSETTING
     /** Return the starting row number if the sequence was constrained using
         row numbers (instead of, or in addition to, a relational constraint).
         If a relational constraint was also given, the row number corresponds
@@ -257,7 +266,18 @@ public:
     virtual int get_ending_row_number() const { return d_ending_row_number; }
 
     virtual void set_row_number_constraint(int start, int stop, int stride = 1);
-#endif
+
+    /** @brief Does the handler apply the row-number constraint?
+        @return True if read() returns only the rows in the constraint */
+    virtual bool row_number_constraint_enforced() const { return d_row_number_constraint_enforced; }
+
+    /** A handler that uses the row-number constraint to seek (so that read()
+        returns only the rows that are part of the constraint) calls this so
+        read_sequence_values() does not apply the constraint a second time.
+
+        @brief Record that read() applies the row-number constraint.
+        @param state True if the handler applies the constraint */
+    virtual void set_row_number_constraint_enforced(bool state = true) { d_row_number_constraint_enforced = state; }
 
     /**
      * @brief Set the internal value.
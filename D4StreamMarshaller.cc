@@ -515,6 +515,8 @@ void D4StreamMarshaller::put_url(const string &val)
 
 void D4StreamMarshaller::put_opaque_dap4(const char *val, int64_t len)
 {
+    check_cancel();
+
     assert(val);
     assert(len >= 0);
 
@@ -545,6 +547,8 @@ void D4StreamMarshaller::put_opaque_dap4(const char *val, int64_t len)
  */
 void D4StreamMarshaller::put_vector(char *val, int64_t num_bytes)
 {
+    check_cancel();
+
     assert(val);
     assert(num_bytes >= 0);
 
@@ -567,6 +571,8 @@ void D4StreamMarshaller::put_vector(char *val, int64_t num_bytes)
 
 void D4StreamMarshaller::put_vector(char *val, int64_t num_elem, int elem_size)
 {
+	check_cancel();
+
 	assert(val);
 	assert(num_elem >= 0);
 	assert(elem_size > 0);
@@ -624,6 +630,8 @@ void D4StreamMarshaller::put_vector(char *val, int64_t num_elem, int elem_size)
  */
 void D4StreamMarshaller::put_vector_float32(char *val, int64_t num_elem)
 {
+	check_cancel();
+
 #if !USE_XDR_FOR_IEEE754_ENCODING
 
 	assert(std::numeric_limits<float>::is_iec559);
@@ -698,6 +706,8 @@ void D4StreamMarshaller::put_vector_float32(char *val, int64_t num_elem)
  */
 void D4StreamMarshaller::put_vector_float64(char *val, int64_t num_elem)
 {
+	check_cancel();
+
 #if !USE_XDR_FOR_IEEE754_ENCODING
 
 	assert(std::numeric_limits<double>::is_iec559);
@@ -0,0 +1,438 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+//#define DODS_DEBUG
+
+#include "DAP2RequestHandler.h"
+
+#include "BaseTypeFactory.h"
+#include "ConstraintEvaluator.h"
+#include "DAS.h"
+#include "DDS.h"
+#include "XDRStreamMarshaller.h"
+#include "mime_util.h"
+
+#include "Error.h"
+#include "InternalErr.h"
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+/** Make a request for a response from a dataset. The request is not
+    conditional, has no deadline and its response includes the MIME
+    headers.
+    @param response Which response to send
+    @param dataset The dataset, as known to DAP2RequestHandler::build_dds()
+    @param ce The DAP2 constraint expression */
+DAP2Request::DAP2Request(DODSFilter::Response response, const string &dataset, const string &ce) :
+    d_response(response), d_dataset(dataset), d_ce(ce), d_version(""), d_if_modified_since(-1),
+    d_with_mime_headers(true)
+{
+}
+
+/** Make a handler.
+    @param factory Make the variables of the templates with this factory.
+    It is not deleted by the handler.
+    @param max_templates Keep the templates of at most this many datasets. */
+DAP2RequestHandler::DAP2RequestHandler(BaseTypeFactory *factory, unsigned long max_templates) :
+    d_factory(factory), d_templates(), d_max_templates(max_templates), d_use_count(0), d_template_hits(0),
+    d_template_misses(0), d_function_cache(0)
+{
+    if (pthread_mutex_init(&d_mutex, 0) != 0)
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the request handler mutex.");
+}
+
+/** The handler must not be deleted while requests are using it. */
+DAP2RequestHandler::~DAP2RequestHandler()
+{
+    for (template_map::iterator i = d_templates.begin(), e = d_templates.end(); i != e; ++i) {
+        delete i->second->dds;
+        delete i->second->das;
+        delete i->second;
+    }
+
+    pthread_mutex_destroy(&d_mutex);
+}
+
+/** Get the time a dataset was last modified. The templates of a dataset
+    are built again when this changes. This version treats the dataset as
+    a file name and uses the time the file was last modified; servers
+    whose datasets are not files should override it, since for those it
+    returns the current time and the templates are never used again.
+
+    @param dataset The dataset of a request
+    @return The time \c dataset was last modified */
+time_t
+DAP2RequestHandler::last_modified(const string &dataset)
+{
+    return last_modified_time(dataset);
+}
+
+// Remove a template from the table. If a request is still using it, it is
+// deleted when that request releases it. Call with the lock held.
+void
+DAP2RequestHandler::m_remove_template(template_map::iterator i)
+{
+    dataset_template *t = i->second;
+    d_templates.erase(i);
+
+    if (t->refs == 0) {
+        delete t->dds;
+        delete t->das;
+        delete t;
+    }
+    else {
+        t->stale = true;
+    }
+}
+
+// Remove the templates used least recently until there are no more than
+// d_max_templates. Call with the lock held.
+void
+DAP2RequestHandler::m_evict()
+{
+    while (d_templates.size() > d_max_templates) {
+        template_map::iterator oldest = d_templates.begin();
+        for (template_map::iterator i = d_templates.begin(), e = d_templates.end(); i != e; ++i) {
+            if (i->second->last_used < oldest->second->last_used)
+                oldest = i;
+        }
+
+        DBG(cerr << "Removing the template for " << oldest->first << endl);
+        m_remove_template(oldest);
+    }
+}
+
+/** Get the template for a dataset, building it if it is not in the table or
+    was built for an older version of the dataset. The template is built
+    without holding the lock, so requests for other datasets are not held
+    up; if two requests build the same template, the first one added is
+    kept. Release the template using m_release_template(). */
+DAP2RequestHandler::dataset_template *
+DAP2RequestHandler::m_get_template(const string &dataset, time_t last_modified)
+{
+    {
+        handler_lock lock(d_mutex);
+
+        template_map::iterator i = d_templates.find(dataset);
+        if (i != d_templates.end() && i->second->last_modified == last_modified) {
+            ++d_template_hits;
+            i->second->last_used = ++d_use_count;
+            ++i->second->refs;
+            return i->second;
+        }
+
+        ++d_template_misses;
+    }
+
+    DBG(cerr << "Building the template for " << dataset << endl);
+
+    auto_ptr<DDS> dds(new DDS(d_factory));
+    auto_ptr<DAS> das(new DAS);
+    build_dds(dataset, *dds);
+    build_das(dataset, *das);
+    dds->transfer_attributes(das.get());
+
+    handler_lock lock(d_mutex);
+
+    template_map::iterator i = d_templates.find(dataset);
+    if (i != d_templates.end()) {
+        if (i->second->last_modified == last_modified) {
+            i->second->last_used = ++d_use_count;
+            ++i->second->refs;
+            return i->second;
+        }
+
+        m_remove_template(i);
+    }
+
+    dataset_template *t = new dataset_template;
+    t->dds = dds.release();
+    t->das = das.release();
+    t->last_modified = last_modified;
+    t->last_used = ++d_use_count;
+    t->refs = 1;
+    d_templates.insert(make_pair(dataset, t));
+
+    m_evict();
+
+    return t;
+}
+
+void
+DAP2RequestHandler::m_release_template(dataset_template *t)
+{
+    handler_lock lock(d_mutex);
+
+    if (--t->refs == 0 && t->stale) {
+        delete t->dds;
+        delete t->das;
+        delete t;
+    }
+}
+
+void
+DAP2RequestHandler::m_check_deadline(const DAP2Request &request) const
+{
+    if (request.cancel_token().cancel_called())
+        throw Error("The request for " + request.get_dataset() + " was cancelled.");
+
+    if (request.expired())
+        throw Error("The request for " + request.get_dataset() + " did not finish before its deadline.");
+}
+
+void
+DAP2RequestHandler::m_set_evaluator(const DAP2Request &request, time_t last_modified, ConstraintEvaluator &eval)
+{
+    eval.set_function_cache(d_function_cache, request.get_dataset(), last_modified);
+    eval.set_cancel_token(&request.cancel_token());
+}
+
+void
+DAP2RequestHandler::m_send_das(const DAP2Request &request, dataset_template &t, ostream &out)
+{
+    if (request.get_with_mime_headers())
+        set_mime_text(out, dods_das, request.get_version(), x_plain, t.last_modified);
+
+    // Printing does not change the template, so all of the requests use it
+    t.das->print(out);
+
+    out << flush;
+}
+
+void
+DAP2RequestHandler::m_send_dds(const DAP2Request &request, dataset_template &t, ostream &out)
+{
+    DDS dds(*t.dds);
+
+    ConstraintEvaluator eval;
+    m_set_evaluator(request, t.last_modified, eval);
+
+    bool constrained = !request.get_ce().empty();
+    if (constrained)
+        eval.parse_constraint(request.get_ce(), dds);
+
+    if (eval.functional_expression())
+        throw Error("Function calls can only be used with data requests. To see the structure of the underlying data source, reissue the URL without the function.");
+
+    m_check_deadline(request);
+
+    if (request.get_with_mime_headers())
+        set_mime_text(out, dods_dds, request.get_version(), x_plain, t.last_modified);
+
+    if (constrained)
+        dds.print_constrained(out);
+    else
+        dds.print(out);
+
+    out << flush;
+}
+
+void
+DAP2RequestHandler::m_send_ddx(const DAP2Request &request, dataset_template &t, ostream &out)
+{
+    DDS dds(*t.dds);
+
+    ConstraintEvaluator eval;
+    m_set_evaluator(request, t.last_modified, eval);
+
+    bool constrained = !request.get_ce().empty();
+    if (constrained)
+        eval.parse_constraint(request.get_ce(), dds);
+
+    if (eval.functional_expression())
+        throw Error("Function calls can only be used with data requests. To see the structure of the underlying data source, reissue the URL without the function.");
+
+    m_check_deadline(request);
+
+    if (request.get_with_mime_headers())
+        set_mime_text(out, dods_ddx, request.get_version(), x_plain, t.last_modified);
+
+    dds.print_xml_writer(out, constrained, "");
+
+    out << flush;
+}
+
+// Send the constrained DDS and the values of its variables. The deadline is
+// checked before each variable is read and, by the marshaller, while the
+// values of arrays and sequences are sent.
+void
+DAP2RequestHandler::m_send_values(const DAP2Request &request, DDS &dds, ConstraintEvaluator &eval, ostream &out,
+    bool ce_eval)
+{
+    dds.print_constrained(out);
+    out << "Data:\n";
+    out << flush;
+
+    XDRStreamMarshaller m(out);
+    m.set_cancel_token(&request.cancel_token());
+
+    for (DDS::Vars_iter i = dds.var_begin(); i != dds.var_end(); i++) {
+        if ((*i)->send_p()) {
+            m_check_deadline(request);
+            DBG(cerr << "Sending " << (*i)->name() << endl);
+            (*i)->serialize(eval, dds, m, ce_eval);
+        }
+    }
+}
+
+void
+DAP2RequestHandler::m_send_data(const DAP2Request &request, dataset_template &t, ostream &out)
+{
+    DDS dds(*t.dds);
+
+    ConstraintEvaluator eval;
+    m_set_evaluator(request, t.last_modified, eval);
+
+    eval.parse_constraint(request.get_ce(), dds);   // Throws Error if the ce doesn't parse.
+
+    dds.tag_nested_sequences(); // Tag Sequences as Parent or Leaf node.
+
+    m_check_deadline(request);
+
+    if (eval.function_clauses()) {
+        auto_ptr<DDS> fdds(eval.eval_function_clauses(dds));
+        m_check_deadline(request);
+
+        if (request.get_with_mime_headers())
+            set_mime_binary(out, dods_data, request.get_version(), x_plain, t.last_modified);
+
+        m_send_values(request, *fdds, eval, out, false);
+    }
+    else {
+        if (request.get_with_mime_headers())
+            set_mime_binary(out, dods_data, request.get_version(), x_plain, t.last_modified);
+
+        m_send_values(request, dds, eval, out, true);
+    }
+
+    out << flush;
+}
+
+/** Write the response to a request. This may be called by many threads at
+    once.
+
+    If the request is conditional and the dataset has not changed since
+    the request's If-Modified-Since time, a Not Modified response is sent
+    instead. If the deadline of the request passes, or the request is
+    cancelled, while the response is built, Error is thrown; the part of
+    the response already written is left in \c out.
+
+    @param request The request
+    @param out Write the response here
+    @exception Error Thrown if the constraint does not parse, if the
+    response is not one the handler sends or if the request is stopped. */
+void
+DAP2RequestHandler::handle(const DAP2Request &request, ostream &out)
+{
+    m_check_deadline(request);
+
+    switch (request.get_response()) {
+    case DODSFilter::DAS_Response:
+    case DODSFilter::DDS_Response:
+    case DODSFilter::DataDDS_Response:
+    case DODSFilter::DDX_Response:
+        break;
+    default:
+        throw Error(not_implemented, "The request handler only sends the DAS, DDS, DDX and data responses.");
+    }
+
+    time_t lmt = last_modified(request.get_dataset());
+
+    if (request.is_conditional() && lmt <= request.get_if_modified_since() && request.get_with_mime_headers()) {
+        set_mime_not_modified(out);
+        return;
+    }
+
+    dataset_template *t = m_get_template(request.get_dataset(), lmt);
+
+    try {
+        switch (request.get_response()) {
+        case DODSFilter::DAS_Response:
+            m_send_das(request, *t, out);
+            break;
+        case DODSFilter::DDS_Response:
+            m_send_dds(request, *t, out);
+            break;
+        case DODSFilter::DDX_Response:
+            m_send_ddx(request, *t, out);
+            break;
+        default:
+            m_send_data(request, *t, out);
+            break;
+        }
+    }
+    catch (...) {
+        m_release_template(t);
+        throw;
+    }
+
+    m_release_template(t);
+}
+
+/** Remove all of the templates. Those in use by requests are deleted when
+    the requests finish. */
+void
+DAP2RequestHandler::clear_templates()
+{
+    handler_lock lock(d_mutex);
+
+    while (!d_templates.empty())
+        m_remove_template(d_templates.begin());
+}
+
+/// The number of datasets with templates
+unsigned long
+DAP2RequestHandler::templates()
+{
+    handler_lock lock(d_mutex);
+    return d_templates.size();
+}
+
+/// The number of requests that used a template built by another request
+unsigned long
+DAP2RequestHandler::template_hits()
+{
+    handler_lock lock(d_mutex);
+    return d_template_hits;
+}
+
+/// The number of requests that built a template
+unsigned long
+DAP2RequestHandler::template_misses()
+{
+    handler_lock lock(d_mutex);
+    return d_template_misses;
+}
+
+} // namespace libdap
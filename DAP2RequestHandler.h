@@ -0,0 +1,237 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dap2_request_handler_h
+#define _dap2_request_handler_h 1
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <ctime>
+
+#include <map>
+#include <ostream>
+#include <string>
+
+#ifndef _dodsfilter_h
+#include "DODSFilter.h"
+#endif
+
+#ifndef _cancel_token_h
+#include "CancelToken.h"
+#endif
+
+namespace libdap
+{
+
+class BaseTypeFactory;
+class DAS;
+class DDS;
+class FunctionResultCache;
+
+/** @brief A request for a DAP2 response.
+
+    This holds what DODSFilter reads from its command line: the response,
+    the dataset, the constraint expression, the server version and the time
+    of a conditional request. It also holds the CancelToken of the request;
+    DAP2RequestHandler stops working on a request once its deadline has
+    passed or cancel() has been called. */
+class DAP2Request
+{
+private:
+    DODSFilter::Response d_response;
+    std::string d_dataset;
+    std::string d_ce;
+    std::string d_version;          // Server version for the MIME headers
+    time_t d_if_modified_since;     // -1 if the request is not conditional
+    bool d_with_mime_headers;
+    CancelToken d_token;
+
+public:
+    DAP2Request(DODSFilter::Response response, const std::string &dataset, const std::string &ce = "");
+
+    DODSFilter::Response get_response() const { return d_response; }
+    void set_response(DODSFilter::Response response) { d_response = response; }
+
+    std::string get_dataset() const { return d_dataset; }
+    void set_dataset(const std::string &dataset) { d_dataset = dataset; }
+
+    std::string get_ce() const { return d_ce; }
+    void set_ce(const std::string &ce) { d_ce = ce; }
+
+    std::string get_version() const { return d_version; }
+    void set_version(const std::string &version) { d_version = version; }
+
+    /** Get/set the If-Modified-Since time of a conditional request. Use -1
+        (the default) for a request that is not conditional. */
+    //@{
+    time_t get_if_modified_since() const { return d_if_modified_since; }
+    void set_if_modified_since(time_t t) { d_if_modified_since = t; }
+    bool is_conditional() const { return d_if_modified_since != -1; }
+    //@}
+
+    bool get_with_mime_headers() const { return d_with_mime_headers; }
+    void set_with_mime_headers(bool with_headers) { d_with_mime_headers = with_headers; }
+
+    /** The deadline of the request. A timeout of zero (or less) means the
+        request has no deadline. The deadline is a CLOCK_MONOTONIC time.
+        @see CancelToken */
+    //@{
+    void set_timeout(long milliseconds) { d_token.set_timeout(milliseconds); }
+    void set_deadline(const struct timespec &deadline) { d_token.set_deadline(deadline); }
+    struct timespec get_deadline() const { return d_token.get_deadline(); }
+    bool has_deadline() const { return d_token.has_deadline(); }
+    bool expired() const { return d_token.expired(); }
+    //@}
+
+    /** Stop the request the next time the handler checks it. This may be
+        called from any thread while the request is being handled. */
+    void cancel() { d_token.cancel(); }
+
+    const CancelToken &cancel_token() const { return d_token; }
+};
+
+/** @brief Answer DAP2 requests in the threads of a server.
+
+    DODSFilter answers one request per process: it reads the request from
+    argv and uses alarm() to limit the time spent on it. This class
+    answers the same requests (the DAS, DDS, DataDDS and DDX responses),
+    but one instance is made when the server starts and handle() is called
+    by many threads at once, each with its own DAP2Request.
+
+    Instead of alarm() and SignalHandler, each request has a CancelToken
+    (see DAP2Request::set_timeout() and DAP2Request::cancel()). The
+    handler checks it between the steps of a response and the marshaller
+    checks it while the values are sent, before each array and each
+    sequence row; Error is thrown once the deadline has passed or the
+    request has been cancelled.
+
+    The DDS and DAS of each dataset are built once and kept as templates;
+    a request works on a copy of the DDS, so requests for the same dataset
+    do not share variables. A template is built again when last_modified()
+    returns a new time for its dataset. When there are more datasets than
+    the handler keeps, the template used least recently is removed. The
+    cache of server-function results given to the handler (see
+    set_function_cache()) is used by all of the requests.
+
+    Servers subclass the handler and define build_dds() and build_das().
+    Those, and the read() methods of the variables they make, are called
+    by many threads at once and must be MT-safe.
+
+    @see DODSFilter */
+class DAP2RequestHandler
+{
+private:
+    struct dataset_template {
+        DDS *dds;
+        DAS *das;
+        time_t last_modified;
+        unsigned long last_used;
+        unsigned int refs;      // The requests using this template
+        bool stale;             // Removed from the table; delete when refs is zero
+
+        dataset_template() : dds(0), das(0), last_modified(0), last_used(0), refs(0), stale(false) { }
+    };
+
+    typedef std::map<std::string, dataset_template*> template_map;
+
+    class handler_lock {
+    private:
+        pthread_mutex_t &d_mutex;
+
+    public:
+        handler_lock(pthread_mutex_t &mutex) : d_mutex(mutex) { pthread_mutex_lock(&d_mutex); }
+        ~handler_lock() { pthread_mutex_unlock(&d_mutex); }
+    };
+
+    BaseTypeFactory *d_factory;     // Weak pointer; used for the templates
+
+    template_map d_templates;
+    unsigned long d_max_templates;
+    unsigned long d_use_count;
+
+    unsigned long d_template_hits;
+    unsigned long d_template_misses;
+
+    FunctionResultCache *d_function_cache;  // Weak pointer
+
+    pthread_mutex_t d_mutex;
+
+    dataset_template *m_get_template(const std::string &dataset, time_t last_modified);
+    void m_release_template(dataset_template *t);
+    void m_remove_template(template_map::iterator i);
+    void m_evict();
+
+    void m_check_deadline(const DAP2Request &request) const;
+
+    void m_send_das(const DAP2Request &request, dataset_template &t, std::ostream &out);
+    void m_send_dds(const DAP2Request &request, dataset_template &t, std::ostream &out);
+    void m_send_ddx(const DAP2Request &request, dataset_template &t, std::ostream &out);
+    void m_send_data(const DAP2Request &request, dataset_template &t, std::ostream &out);
+    void m_send_values(const DAP2Request &request, DDS &dds, ConstraintEvaluator &eval, std::ostream &out,
+        bool ce_eval);
+
+    void m_set_evaluator(const DAP2Request &request, time_t last_modified, ConstraintEvaluator &eval);
+
+    DAP2RequestHandler();
+    DAP2RequestHandler(const DAP2RequestHandler &);
+    DAP2RequestHandler &operator=(const DAP2RequestHandler &);
+
+protected:
+    /** Load the variables and the name of a dataset into \c dds. Called
+        once for each template, from any thread. */
+    virtual void build_dds(const std::string &dataset, DDS &dds) = 0;
+
+    /** Load the attributes of a dataset into \c das. Called once for each
+        template, from any thread. */
+    virtual void build_das(const std::string &dataset, DAS &das) = 0;
+
+    virtual time_t last_modified(const std::string &dataset);
+
+public:
+    DAP2RequestHandler(BaseTypeFactory *factory, unsigned long max_templates = 100);
+    virtual ~DAP2RequestHandler();
+
+    virtual void handle(const DAP2Request &request, std::ostream &out);
+
+    /** Get/set the cache of server-function results used by the requests.
+        The cache is not deleted by the handler. Use null (the default) to
+        evaluate the functions for every request.
+        @see ConstraintEvaluator::set_function_cache() */
+    //@{
+    FunctionResultCache *function_cache() const { return d_function_cache; }
+    void set_function_cache(FunctionResultCache *cache) { d_function_cache = cache; }
+    //@}
+
+    virtual void clear_templates();
+
+    /// The most datasets the handler keeps templates for
+    unsigned long max_templates() const { return d_max_templates; }
+
+    unsigned long templates();
+    unsigned long template_hits();
+    unsigned long template_misses();
+};
+
+} // namespace libdap
+
+#endif // _dap2_request_handler_h
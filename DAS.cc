@@ -51,6 +51,7 @@
 
 #include "DAS.h"
 #include "AttrTable.h"
+#include "DASParser.h"
 #include "Error.h"
 #include "InternalErr.h"
 #include "parser.h"
@@ -61,14 +62,9 @@
 using std::cerr;
 using std::endl;
 
-// Glue routines declared in das.lex
-extern void das_switch_to_buffer(void *new_buffer);
-extern void das_delete_buffer(void * buffer);
-extern void *das_buffer(FILE *fp);
-
 //extern void dasrestart(FILE *yyin);
 //extern int dasparse(void *arg); // defined in das.tab.c
-extern int dasparse(libdap::parser_arg *arg); // defined in das.tab.c
+extern int das_parse(FILE *in, libdap::parser_arg *arg); // defined in das.tab.c
 
 namespace libdap {
 
@@ -82,6 +78,7 @@ void DAS::duplicate(const DAS &src)
 
     d_container_name = src.d_container_name;
     d_attrs = src.d_attrs;
+    d_fast_parser = src.d_fast_parser;
 }
 
 DAS &DAS::operator=(const DAS &rhs)
@@ -286,7 +283,11 @@ DAS::parse(int fd)
 
     Read attributes from in (which defaults to stdin). If
     dasrestart() fails, return false, otherwise return the status
-    of dasparse().
+    of dasparse(). If set_fast_parser(true) has been called, use
+    DASParser instead.
+
+    The parser is reentrant, so different DAS objects can be parsed by
+    different threads at the same time.
 */
 void
 DAS::parse(FILE *in)
@@ -295,15 +296,16 @@ DAS::parse(FILE *in)
         throw InternalErr(__FILE__, __LINE__, "Null input stream.");
     }
 
-    void *buffer = das_buffer(in);
-    das_switch_to_buffer(buffer);
+    if (d_fast_parser) {
+        DASParser parser;
+        parser.intern(in, this);
+        return;
+    }
 
     parser_arg arg(this);
 
     //bool status = dasparse((void *) & arg) == 0;
-    bool status = dasparse(&arg) == 0;
-
-    das_delete_buffer(buffer);
+    bool status = das_parse(in, &arg) == 0;
 
     //  STATUS is the result of the parser function; if a recoverable error
     //  was found it will be true but arg.status() will be false.
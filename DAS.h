@@ -133,10 +133,12 @@ private:
     // variables are its children.
     AttrTable d_attrs ;
 
+    bool d_fast_parser;     // Use DASParser in parse()
+
     void duplicate(const DAS &src);
 
 public:
-    DAS() : DapObj(), d_container( 0 ) { }
+    DAS() : DapObj(), d_container( 0 ), d_fast_parser(false) { }
     DAS(const DAS &das) { duplicate(das); }
 
     virtual ~DAS() { }
@@ -183,6 +185,14 @@ public:
 
     virtual AttrTable *add_table(const string &name, AttrTable *at);
 
+    /** Use the hand-written DASParser instead of the bison parser in
+        parse(). It builds the same DAS and is much faster for large
+        documents.
+        @param state True to use DASParser */
+    void set_fast_parser(bool state) { d_fast_parser = state; }
+    /// Does parse() use DASParser?
+    bool get_fast_parser() const { return d_fast_parser; }
+
     /** Read a DAS by parsing the specified file*/
     virtual void parse(string fname);
     virtual void parse(int fd);
@@ -0,0 +1,469 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "DAS.h"
+#include "AttrTable.h"
+#include "DASParser.h"
+
+#include "Error.h"
+#include "InternalErr.h"
+#include "parser.h"
+#include "escaping.h"
+#include "util.h"
+
+// #define DODS_DEBUG
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+// These are the messages used by das.yy
+static const char *ATTR_TUPLE_MSG =
+"Expected an attribute type (Byte, Int16, UInt16, Int32, UInt32, Float32,\n\
+Float64, String or Url) followed by a name and value.";
+static const char *NO_DAS_MSG =
+"The attribute object returned from the dataset was null\n\
+Check that the URL is correct.";
+
+// Read FILE input in blocks this big
+static const int das_read_size = 65536;
+
+typedef int checker(const char *);
+
+// The characters allowed in a DAS word; see das.lex. A word may not
+// start with '#'.
+static inline bool
+is_word_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.'
+        || c == '-' || c == '+' || c == '/' || c == '%' || c == ':' || c == '\\' || c == '(' || c == ')' || c == '*'
+        || c == '#';
+}
+
+static string
+a_or_an(const string &subject)
+{
+    string first_char(1, subject[0]);
+    string::size_type pos = first_char.find_first_of("aeiouAEIOUyY");
+
+    if (pos == string::npos)
+        return "a";
+    else
+        return "an";
+}
+
+/** Read the next token. This follows the rules in das.lex: white space and
+    comments are skipped, quoted strings (with their quotes) are words and
+    characters that can't start a token are ignored. */
+void
+DASParser::m_next()
+{
+    // The keywords, spelled the ways das.lex accepts them
+    static const struct {
+        const char *word;
+        token tok;
+    } keywords[] = {
+        { "attributes", t_attr }, { "Attributes", t_attr }, { "ATTRIBUTES", t_attr },
+        { "ALIAS", t_alias }, { "Alias", t_alias }, { "alias", t_alias },
+        { "BYTE", t_byte }, { "Byte", t_byte }, { "byte", t_byte },
+        { "INT16", t_int16 }, { "Int16", t_int16 }, { "int16", t_int16 },
+        { "UINT16", t_uint16 }, { "UInt16", t_uint16 }, { "Uint16", t_uint16 }, { "uint16", t_uint16 },
+        { "INT32", t_int32 }, { "Int32", t_int32 }, { "int32", t_int32 },
+        { "UINT32", t_uint32 }, { "UInt32", t_uint32 }, { "Uint32", t_uint32 }, { "uint32", t_uint32 },
+        { "FLOAT32", t_float32 }, { "Float32", t_float32 }, { "float32", t_float32 },
+        { "FLOAT64", t_float64 }, { "Float64", t_float64 }, { "float64", t_float64 },
+        { "STRING", t_string }, { "String", t_string }, { "string", t_string },
+        { "URL", t_url }, { "Url", t_url }, { "url", t_url },
+        { "OTHERXML", t_xml }, { "OtherXML", t_xml }, { "OtherXml", t_xml }, { "otherxml", t_xml },
+        { 0, t_eof }
+    };
+
+    while (d_pos < d_end) {
+        switch (*d_pos) {
+        case ' ':
+        case '\t':
+        case '\r':
+            ++d_pos;
+            continue;
+
+        case '\n':
+            ++d_line;
+            ++d_pos;
+            continue;
+
+        case '#':
+            while (d_pos < d_end && *d_pos != '\n')
+                ++d_pos;
+            continue;
+
+        case '{':
+            d_tok = t_lbrace;
+            break;
+        case '}':
+            d_tok = t_rbrace;
+            break;
+        case ';':
+            d_tok = t_semicolon;
+            break;
+        case ',':
+            d_tok = t_comma;
+            break;
+
+        case '"': {
+            int start_line = d_line;
+            d_text = d_pos++;
+            while (d_pos < d_end && *d_pos != '"') {
+                if (*d_pos == '\\' && d_pos + 1 < d_end)
+                    ++d_pos;    // skip the escaped character
+                if (*d_pos == '\n')
+                    ++d_line;
+                ++d_pos;
+            }
+
+            if (d_pos == d_end) {
+                ostringstream msg;
+                msg << "Error scanning DAS object text: Unterminated quote (starts on line " << start_line << ")\n";
+                throw Error(msg.str());
+            }
+
+            ++d_pos;
+            d_len = d_pos - d_text;
+            d_tok = t_word;
+            return;
+        }
+
+        default:
+            if (!is_word_char(*d_pos)) {
+                ++d_pos;        // das.lex ignores these
+                continue;
+            }
+
+            d_text = d_pos;
+            while (d_pos < d_end && is_word_char(*d_pos))
+                ++d_pos;
+            d_len = d_pos - d_text;
+
+            d_tok = t_word;
+            for (int i = 0; keywords[i].word; ++i) {
+                if (strlen(keywords[i].word) == d_len && strncmp(keywords[i].word, d_text, d_len) == 0) {
+                    d_tok = keywords[i].tok;
+                    break;
+                }
+            }
+            return;
+        }
+
+        // A one-character token
+        d_text = d_pos++;
+        d_len = 1;
+        return;
+    }
+
+    d_tok = t_eof;
+    d_text = d_pos;
+    d_len = 0;
+}
+
+// Throw an Error that looks like the ones from the bison parser. If
+// context is true, include the current token.
+void
+DASParser::m_error(const string &msg, bool context) const
+{
+    parse_error(msg, d_line, context ? m_text().c_str() : 0);
+}
+
+/** Add the values in d_values to the current table and clear d_values. */
+void
+DASParser::m_add_values(const string &name, const string &type)
+{
+    if (d_values.empty())
+        return;
+
+    try {
+        d_tables.back()->append_attr(name, type, &d_values);
+    }
+    catch (Error &e) {
+        // re-throw with line number
+        parse_error(e.get_error_message().c_str(), d_line);
+    }
+
+    d_values.clear();
+}
+
+// See add_bad_attribute() in das.yy
+void
+DASParser::m_add_bad_attribute(const string &type, const string &name, const string &value)
+{
+    AttrTable *attr = d_tables.back();
+    if (attr->get_name().find("_dods_errors") != string::npos) {
+        attr->append_attr(name, type, value);
+    }
+    else {
+        string error_cont_name = attr->get_name() + "_dods_errors";
+        AttrTable *error_cont = attr->get_attr_table(error_cont_name);
+        if (!error_cont)
+            error_cont = attr->append_container(error_cont_name);
+
+        error_cont->append_attr(name, type, value);
+
+        string msg = "`" + value + "' is not " + a_or_an(type) + " " + type + " value.";
+        error_cont->append_attr(name + "_explanation", "String", msg);
+    }
+}
+
+/** Parse '<type> <name> <value>, ... ;'. The current token is the type. */
+void
+DASParser::m_attr_tuple(const string &type)
+{
+    checker *chk = 0;
+    switch (d_tok) {
+    case t_byte: chk = &check_byte; break;
+    case t_int16: chk = &check_int16; break;
+    case t_uint16: chk = &check_uint16; break;
+    case t_int32: chk = &check_int32; break;
+    case t_uint32: chk = &check_uint32; break;
+    case t_float32: chk = &check_float32; break;
+    case t_float64: chk = &check_float64; break;
+    case t_url: chk = &check_url; break;
+    default: break;
+    }
+    bool is_string = d_tok == t_string;
+    bool is_xml = d_tok == t_xml;
+
+    // The name may be a word or any of the keywords
+    m_next();
+    if (d_tok == t_eof || d_tok >= t_lbrace)
+        m_error(ATTR_TUPLE_MSG, true);
+
+    string name = m_text();
+
+    d_values.clear();
+    string value;
+    do {
+        m_next();
+        if (d_tok != t_word)
+            m_error(ATTR_TUPLE_MSG, true);
+
+        if (is_string) {
+            // Strip the quotes, as remove_quotes() does
+            if (d_len > 1 && d_text[0] == '"' && d_text[d_len - 1] == '"')
+                value.assign(d_text + 1, d_len - 2);
+            else
+                value.assign(d_text, d_len);
+        }
+        else if (is_xml) {
+            // XML must be quoted in the DAS but the quotes are an artifact
+            // of the DAS syntax so they are not part of the value.
+            value = unescape_double_quotes(m_text());
+            if (is_quoted(value))
+                value = remove_quotes(value);
+        }
+        else {
+            value.assign(d_text, d_len);
+        }
+
+        if (chk && !(*chk)(value.c_str())) {
+            // Keep the order of the good and bad values the same as das.yy
+            m_add_values(name, type);
+            m_add_bad_attribute(type, name, value);
+        }
+        else {
+            d_values.push_back(value);
+        }
+
+        m_next();
+    } while (d_tok == t_comma);
+
+    if (d_tok != t_semicolon)
+        m_error(ATTR_TUPLE_MSG, true);
+
+    m_add_values(name, type);
+    m_next();
+}
+
+/** Parse 'Alias <name> <source>;'. The current token is the keyword. */
+void
+DASParser::m_alias()
+{
+    m_next();
+    if (d_tok != t_word)
+        m_error(ATTR_TUPLE_MSG, true);
+    string name = m_text();
+
+    m_next();
+    if (d_tok != t_word)
+        m_error(ATTR_TUPLE_MSG, true);
+    string src = m_text();
+
+    DBG(cerr << "Adding an alias: " << name << ": " << src << endl);
+
+    AttrTable *das = d_das->get_top_level_attributes();
+    AttrTable *table = das->get_attr_table(src);
+    try {
+        if (table)
+            d_tables.back()->add_container_alias(name, table);
+        else
+            d_tables.back()->add_value_alias(das, name, src);
+    }
+    catch (Error &e) {
+        parse_error(e.get_error_message().c_str(), d_line);
+    }
+
+    m_next();
+    if (d_tok != t_semicolon)
+        m_error(ATTR_TUPLE_MSG, true);
+    m_next();
+}
+
+/** Parse the contents of a container, up to its closing brace. */
+void
+DASParser::m_attributes()
+{
+    while (d_tok != t_rbrace) {
+        switch (d_tok) {
+        case t_alias:
+            m_alias();
+            break;
+
+        case t_byte: m_attr_tuple("Byte"); break;
+        case t_int16: m_attr_tuple("Int16"); break;
+        case t_uint16: m_attr_tuple("UInt16"); break;
+        case t_int32: m_attr_tuple("Int32"); break;
+        case t_uint32: m_attr_tuple("UInt32"); break;
+        case t_float32: m_attr_tuple("Float32"); break;
+        case t_float64: m_attr_tuple("Float64"); break;
+        case t_string: m_attr_tuple("String"); break;
+        case t_url: m_attr_tuple("Url"); break;
+        case t_xml: m_attr_tuple("OtherXML"); break;
+
+        case t_word: {
+            string name = m_text();
+            m_next();
+            if (d_tok != t_lbrace)
+                m_error(ATTR_TUPLE_MSG, true);
+
+            AttrTable *at = d_tables.back()->get_attr_table(name);
+            if (!at) {
+                try {
+                    at = d_tables.back()->append_container(name);
+                }
+                catch (Error &e) {
+                    // re-throw with line number info
+                    parse_error(e.get_error_message().c_str(), d_line);
+                }
+            }
+
+            d_tables.push_back(at);
+            m_next();
+            m_attributes();
+            d_tables.pop_back();
+            m_next();
+            break;
+        }
+
+        default:
+            m_error(ATTR_TUPLE_MSG, true);
+        }
+    }
+}
+
+void
+DASParser::m_parse(DAS *das)
+{
+    if (!das)
+        throw InternalErr(__FILE__, __LINE__, "Null DAS object.");
+
+    d_das = das;
+    d_line = 1;
+    d_tables.clear();
+
+    m_next();
+    if (d_tok == t_eof)
+        m_error(NO_DAS_MSG);
+
+    while (d_tok != t_eof) {
+        if (d_tok != t_attr)
+            m_error(NO_DAS_MSG);
+        m_next();
+        if (d_tok != t_lbrace)
+            m_error(NO_DAS_MSG);
+        m_next();
+
+        d_tables.push_back(das->get_top_level_attributes());
+        m_attributes();
+        d_tables.pop_back();
+
+        m_next();
+    }
+}
+
+/** Parse a DAS held in memory.
+    @param buffer The DAS document
+    @param size The number of bytes in \e buffer
+    @param das Add the attributes to this DAS */
+void
+DASParser::intern(const char *buffer, unsigned long size, DAS *das)
+{
+    d_pos = buffer;
+    d_end = buffer + size;
+
+    m_parse(das);
+}
+
+/** Parse a DAS held in a string.
+    @param document The DAS document
+    @param das Add the attributes to this DAS */
+void
+DASParser::intern(const string &document, DAS *das)
+{
+    intern(document.data(), document.size(), das);
+}
+
+/** Read a DAS from \e in and parse it. The whole of \e in is read.
+    @param in Read from this FILE
+    @param das Add the attributes to this DAS */
+void
+DASParser::intern(FILE *in, DAS *das)
+{
+    if (!in)
+        throw InternalErr(__FILE__, __LINE__, "Null input stream.");
+
+    vector<char> document;
+    size_t size = 0;
+    size_t n;
+    do {
+        document.resize(size + das_read_size);
+        n = fread(&document[size], 1, das_read_size, in);
+        size += n;
+    } while (n > 0);
+
+    intern(size ? &document[0] : "", size, das);
+}
+
+} // namespace libdap
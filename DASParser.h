@@ -0,0 +1,98 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _das_parser_h
+#define _das_parser_h 1
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace libdap
+{
+
+class AttrTable;
+class DAS;
+
+/** @brief A hand-written parser for the DAP2 DAS.
+
+    This accepts the same documents as the bison parser in das.yy and builds
+    the same DAS, including the <tt>*_dods_errors</tt> containers for
+    attribute values that don't match their type. It reads the whole
+    document into memory and scans it in place, so words are not copied
+    until they become names or values, and the values of an attribute are
+    added to its AttrTable all at once instead of one at a time. Use it for
+    very large DAS documents.
+
+    DAS::parse() uses this parser when DAS::set_fast_parser(true) has been
+    called.
+
+    @see DDSParser */
+class DASParser
+{
+private:
+    enum token {
+        t_eof, t_word, t_attr, t_alias, t_byte, t_int16, t_uint16, t_int32, t_uint32,
+        t_float32, t_float64, t_string, t_url, t_xml, t_lbrace, t_rbrace, t_semicolon, t_comma
+    };
+
+    const char *d_pos;
+    const char *d_end;
+    int d_line;
+
+    // The current token; for words, d_text/d_len point into the document
+    token d_tok;
+    const char *d_text;
+    std::string::size_type d_len;
+
+    DAS *d_das;
+    std::vector<AttrTable *> d_tables;
+
+    // Values of the attribute being read that have passed their type check
+    std::vector<std::string> d_values;
+
+    void m_next();
+    std::string m_text() const { return std::string(d_text, d_len); }
+    void m_error(const std::string &msg, bool context = false) const;
+
+    void m_attributes();
+    void m_attr_tuple(const std::string &type);
+    void m_alias();
+
+    void m_add_values(const std::string &name, const std::string &type);
+    void m_add_bad_attribute(const std::string &type, const std::string &name, const std::string &value);
+
+    void m_parse(DAS *das);
+
+public:
+    DASParser() : d_pos(0), d_end(0), d_line(1), d_tok(t_eof), d_text(0), d_len(0), d_das(0) { }
+    virtual ~DASParser() { }
+
+    void intern(const char *buffer, unsigned long size, DAS *das);
+    void intern(const std::string &document, DAS *das);
+    void intern(FILE *in, DAS *das);
+};
+
+} // namespace libdap
+
+#endif // _das_parser_h
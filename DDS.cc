@@ -86,6 +86,8 @@
 #include "Sequence.h"
 #include "Grid.h"
 
+#include "DDSParser.h"
+
 #include "escaping.h"
 
 /**
@@ -117,12 +119,8 @@ const string TOP_LEVEL_ATTRS_CONTAINER_NAME = "DAP4_GLOBAL";
 
 using namespace std;
 
-int ddsparse(libdap::parser_arg *arg);
-
-// Glue for the DDS parser defined in dds.lex
-void dds_switch_to_buffer(void *new_buffer);
-void dds_delete_buffer(void * buffer);
-void *dds_buffer(FILE *fp);
+// The DDS parser; defined in dds.yy
+int dds_parse(FILE *in, libdap::parser_arg *arg);
 
 namespace libdap {
 
@@ -173,6 +171,11 @@ DDS::duplicate(const DDS &dds)
 
     d_attr = dds.d_attr;
 
+    d_use_name_index = dds.d_use_name_index;
+    m_index_changed();
+
+    d_fast_parser = dds.d_fast_parser;
+
     DDS &dds_tmp = const_cast<DDS &>(dds);
 
     // copy the things pointed to by the list, not just the pointers
@@ -204,7 +207,8 @@ DDS::duplicate(const DDS &dds)
 DDS::DDS(BaseTypeFactory *factory, const string &name)
         : d_factory(factory), d_name(name), d_container_name(""), d_container(0),
           d_request_xml_base(""),
-          d_timeout(0), /*d_keywords(),*/ d_max_response_size(0)
+          d_timeout(0), /*d_keywords(),*/ d_max_response_size(0), d_use_name_index(false),
+          d_fast_parser(false)
 {
     DBG(cerr << "Building a DDS for the default version (2.0)" << endl);
 
@@ -231,7 +235,8 @@ DDS::DDS(BaseTypeFactory *factory, const string &name)
 DDS::DDS(BaseTypeFactory *factory, const string &name, const string &version)
         : d_factory(factory), d_name(name), d_container_name(""), d_container(0),
           d_request_xml_base(""),
-          d_timeout(0), /*d_keywords(),*/ d_max_response_size(0)
+          d_timeout(0), /*d_keywords(),*/ d_max_response_size(0), d_use_name_index(false),
+          d_fast_parser(false)
 {
     DBG(cerr << "Building a DDS for version: " << version << endl);
 
@@ -604,6 +609,7 @@ void DDS::add_var(BaseType *bt) {
     }
     else {
         vars.push_back(btp);
+        m_index_added();
     }
 }
 
@@ -622,6 +628,7 @@ DDS::add_var_nocopy(BaseType *bt)
     }
     else {
         vars.push_back(bt);
+        m_index_added();
     }
 }
 
@@ -645,6 +652,7 @@ DDS::del_var(const string &n)
         if ((*i)->name() == n) {
             BaseType *bt = *i ;
             vars.erase(i) ;
+            m_index_changed();
             delete bt ; bt = 0;
             return;
         }
@@ -661,6 +669,7 @@ DDS::del_var(Vars_iter i)
     if (i != vars.end()) {
         BaseType *bt = *i ;
         vars.erase(i) ;
+        m_index_changed();
         delete bt ; bt = 0;
     }
 }
@@ -679,6 +688,7 @@ DDS::del_var(Vars_iter i1, Vars_iter i2)
         delete bt ; bt = 0;
     }
     vars.erase(i1, i2) ;
+    m_index_changed();
 }
 
 /** Search for for variable <i>n</i> as above but record all
@@ -731,6 +741,23 @@ DDS::leaf_match(const string &n, BaseType::btp_stack *s)
 {
     DBG(cerr << "DDS::leaf_match: Looking for " << n << endl);
 
+    if (d_use_name_index && d_var_index.indexed(vars)) {
+        VarIndex::Vars::size_type pos = d_var_index.find(vars, n);
+
+        // Only a constructor that comes before the first top-level variable
+        // named 'n' can hold a match that is found first.
+        const vector<VarIndex::Vars::size_type> &ctors = d_var_index.constructors();
+        for (vector<VarIndex::Vars::size_type>::const_iterator i = ctors.begin(); i != ctors.end() && *i < pos; ++i) {
+            BaseType *found = vars[*i]->var(n, false, s);
+            if (found) {
+                DBG(cerr << "Found " << n << " in: " << vars[*i]->name() << endl);
+                return found;
+            }
+        }
+
+        return (pos < vars.size()) ? vars[pos] : 0;
+    }
+
     for (Vars_iter i = vars.begin(); i != vars.end(); i++) {
         BaseType *btp = *i;
         DBG(cerr << "DDS::leaf_match: Looking for " << n << " in: " << btp->name() << endl);
@@ -765,13 +792,20 @@ DDS::leaf_match(const string &n, BaseType::btp_stack *s)
 BaseType *
 DDS::exact_match(const string &name, BaseType::btp_stack *s)
 {
-    for (Vars_iter i = vars.begin(); i != vars.end(); i++) {
-        BaseType *btp = *i;
-        DBG2(cerr << "Looking for " << d_name << " in: " << btp << endl);
-        // Look for the d_name in the current ctor type or the top level
-        if (btp->name() == name) {
-            DBG2(cerr << "Found " << d_name << " in: " << btp << endl);
-            return btp;
+    if (d_use_name_index) {
+        VarIndex::Vars::size_type pos = d_var_index.find(vars, name);
+        if (pos < vars.size())
+            return vars[pos];
+    }
+    else {
+        for (Vars_iter i = vars.begin(); i != vars.end(); i++) {
+            BaseType *btp = *i;
+            DBG2(cerr << "Looking for " << d_name << " in: " << btp << endl);
+            // Look for the d_name in the current ctor type or the top level
+            if (btp->name() == name) {
+                DBG2(cerr << "Found " << d_name << " in: " << btp << endl);
+                return btp;
+            }
         }
     }
 
@@ -849,6 +883,7 @@ DDS::insert_var(Vars_iter i, BaseType *ptr)
         throw InternalErr(__FILE__, __LINE__, "Attempt to add a DAP4 type to a DAP2 DDS.");
 #endif
     vars.insert(i, ptr->ptr_duplicate());
+    m_index_changed();
 }
 
 /** Insert the BaseType before the position given.
@@ -866,6 +901,7 @@ DDS::insert_var_nocopy(Vars_iter i, BaseType *ptr)
         throw InternalErr(__FILE__, __LINE__, "Attempt to add a DAP4 type to a DAP2 DDS.");
 #endif
     vars.insert(i, ptr);
+    m_index_changed();
 }
 
 /** @brief Returns the number of variables in the DDS. */
@@ -990,6 +1026,9 @@ DDS::parse(int fd)
     Read the persistent representation of a DDS from the FILE *in, parse it
     and create a matching binary object.
     @param in Read the persistent DDS from this FILE*.
+    If set_fast_parser(true) has been called, use DDSParser instead of the
+    bison parser. The bison parser is reentrant, so different DDS objects
+    can be parsed by different threads at the same time.
     @exception InternalErr Thrown if \c in is null
     @exception Error Thrown if the parse fails. */
 void
@@ -999,14 +1038,15 @@ DDS::parse(FILE *in)
         throw InternalErr(__FILE__, __LINE__, "Null input stream.");
     }
 
-    void *buffer = dds_buffer(in);
-    dds_switch_to_buffer(buffer);
+    if (d_fast_parser) {
+        DDSParser parser;
+        parser.intern(in, this);
+        return;
+    }
 
     parser_arg arg(this);
 
-    bool status = ddsparse(&arg) == 0;
-
-    dds_delete_buffer(buffer);
+    bool status = dds_parse(in, &arg) == 0;
 
     DBG2(cout << "Status from parser: " << status << endl);
 
@@ -1432,7 +1472,7 @@ public:
 void
 DDS::print_xml_writer(ostream &out, bool constrained, const string &blob)
 {
-    XMLWriter xml("    ");
+    XMLWriter xml(out, "    ");
 
     // this is the old version of this method. It produced different output for
     // different version of DAP. We stopped using version numbers and use different
@@ -1629,7 +1669,7 @@ DDS::print_xml_writer(ostream &out, bool constrained, const string &blob)
 #error Must define DAP2_DDX or DAP3_2_DDX
 #endif
 
-    out << xml.get_doc();// << ends;// << endl;
+    xml.end_doc();
 }
 
 /**
@@ -1651,7 +1691,7 @@ DDS::print_dmr(ostream &out, bool constrained)
     if (get_dap_major() < 4)
         throw InternalErr(__FILE__, __LINE__, "Tried to print a DMR with DAP major version less than 4");
 
-    XMLWriter xml("    ");
+    XMLWriter xml(out, "    ");
 
     // DAP4 wraps a dataset in a top-level Group element.
     if (xmlTextWriterStartElement(xml.get_writer(), (const xmlChar*) "Group") < 0)
@@ -1698,7 +1738,7 @@ DDS::print_dmr(ostream &out, bool constrained)
     if (xmlTextWriterEndElement(xml.get_writer()) < 0)
         throw InternalErr(__FILE__, __LINE__, "Could not end the top-level Group element");
 
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 // Used by DDS::send() when returning data from a function call.
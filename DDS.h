@@ -58,6 +58,8 @@
 #include "DAS.h"
 #endif
 
+#include "VarIndex.h"
+
 #ifndef A_DapObj_h
 #include "DapObj.h"
 #endif
@@ -210,6 +212,15 @@ private:
 
     long d_max_response_size;   // In bytes...
 
+    bool d_use_name_index;      // Use d_var_index in var()
+    VarIndex d_var_index;       // Names of the top-level variables
+
+    // Keep d_var_index current when it's used
+    void m_index_added() { if (d_use_name_index) d_var_index.added(vars); }
+    void m_index_changed() { if (d_use_name_index) d_var_index.changed(vars); }
+
+    bool d_fast_parser;         // Use DDSParser in parse()
+
     friend class DDSTest;
 
 protected:
@@ -347,8 +358,24 @@ public:
     /// Removes a range of variables from the DDS.
     void del_var(Vars_iter i1, Vars_iter i2);
 
+    /** Use an index of the top-level variables' names in var(). This
+        makes lookups in a DDS with many variables much faster. The index
+        is updated by the add, insert and delete methods and variables
+        inside constructors always keep their own index current, but the
+        DDS is not told when a top-level variable is renamed; call
+        set_name_index(true) again after renaming one.
+        @param state True to use the index, false to search the variables */
+    void set_name_index(bool state) {
+        d_use_name_index = state;
+        if (state) d_var_index.changed(vars); else d_var_index.clear();
+    }
+    /// Is var() using an index of the top-level variables' names?
+    bool get_name_index() const { return d_use_name_index; }
+
     /** @name DDS_timeout
-     *  Old deprecated DDS timeout code
+     *  Old deprecated DDS timeout code. These use alarm(), which is global
+     *  to the process; a server that answers requests in threads should
+     *  give each request a CancelToken instead.
      *  @deprecated
      */
     ///@{
@@ -358,6 +385,14 @@ public:
     int get_timeout();
     ///@}
 
+    /** Use the hand-written DDSParser instead of the bison parser in
+        parse(). It builds the same variables and is much faster for
+        large documents.
+        @param state True to use DDSParser */
+    void set_fast_parser(bool state) { d_fast_parser = state; }
+    /// Does parse() use DDSParser?
+    bool get_fast_parser() const { return d_fast_parser; }
+
     // These parse the DAP2 curly-brace document and make a C++ object.
     void parse(string fname);
     void parse(int fd);
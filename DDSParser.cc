@@ -0,0 +1,457 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include "Byte.h"
+#include "Int16.h"
+#include "UInt16.h"
+#include "Int32.h"
+#include "UInt32.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Str.h"
+#include "Url.h"
+#include "Array.h"
+#include "Structure.h"
+#include "Sequence.h"
+#include "Grid.h"
+#include "BaseTypeFactory.h"
+#include "DDS.h"
+#include "DDSParser.h"
+
+#include "Error.h"
+#include "InternalErr.h"
+#include "parser.h"
+#include "util.h"
+
+// #define DODS_DEBUG
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+// These are the messages used by dds.yy
+static const char *NO_DDS_MSG =
+"The descriptor object returned from the dataset was null.\n\
+Check that the URL is correct.";
+
+static const char *BAD_DECLARATION =
+"In the dataset descriptor object: Expected a variable declaration\n\
+(e.g., Int32 i;). Make sure that the variable name is not the name\n\
+of a datatype and that the Array: and Maps: sections of a Grid are\n\
+labeled properly.";
+
+static const char *BAD_SUBSCRIPT =
+"In the dataset descriptor object:\n\
+Expected an array subscript.\n";
+
+static const char *BAD_NAME =
+"Error parsing the dataset name.\n\
+The name may be missing or may contain an illegal character.\n";
+
+// Read FILE input in blocks this big
+static const int dds_read_size = 65536;
+
+// The characters allowed in a DDS word; see dds.lex. A word may not
+// start with '#'.
+static inline bool
+is_word_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.'
+        || c == '-' || c == '+' || c == '/' || c == '%' || c == '\\' || c == '*' || c == '#';
+}
+
+/** Read the next token. This follows the rules in dds.lex: white space and
+    comments are skipped, a line that is just 'Data:' ends the document
+    and characters that can't start a token are ignored. */
+void
+DDSParser::m_next()
+{
+    // The keywords, spelled the ways dds.lex accepts them
+    static const struct {
+        const char *word;
+        token tok;
+    } keywords[] = {
+        { "DATASET", t_dataset }, { "Dataset", t_dataset }, { "dataset", t_dataset },
+        { "LIST", t_list }, { "List", t_list }, { "list", t_list },
+        { "SEQUENCE", t_sequence }, { "Sequence", t_sequence }, { "sequence", t_sequence },
+        { "STRUCTURE", t_structure }, { "Structure", t_structure }, { "structure", t_structure },
+        { "GRID", t_grid }, { "Grid", t_grid }, { "grid", t_grid },
+        { "BYTE", t_byte }, { "Byte", t_byte }, { "byte", t_byte },
+        { "INT16", t_int16 }, { "Int16", t_int16 }, { "int16", t_int16 },
+        { "UINT16", t_uint16 }, { "UInt16", t_uint16 }, { "uint16", t_uint16 },
+        { "INT32", t_int32 }, { "Int32", t_int32 }, { "int32", t_int32 },
+        { "UINT32", t_uint32 }, { "UInt32", t_uint32 }, { "uint32", t_uint32 },
+        { "FLOAT32", t_float32 }, { "Float32", t_float32 }, { "float32", t_float32 },
+        { "FLOAT64", t_float64 }, { "Float64", t_float64 }, { "float64", t_float64 },
+        { "STRING", t_string }, { "String", t_string }, { "string", t_string },
+        { "URL", t_url }, { "Url", t_url }, { "url", t_url },
+        { 0, t_eof }
+    };
+
+    while (d_pos < d_end) {
+        switch (*d_pos) {
+        case ' ':
+        case '\t':
+        case '\r':
+            ++d_pos;
+            continue;
+
+        case '\n':
+            ++d_line;
+            ++d_pos;
+            continue;
+
+        case '#':
+            while (d_pos < d_end && *d_pos != '\n')
+                ++d_pos;
+            continue;
+
+        case '{':
+            d_tok = t_lbrace;
+            break;
+        case '}':
+            d_tok = t_rbrace;
+            break;
+        case '[':
+            d_tok = t_lbracket;
+            break;
+        case ']':
+            d_tok = t_rbracket;
+            break;
+        case ':':
+            d_tok = t_colon;
+            break;
+        case ';':
+            d_tok = t_semicolon;
+            break;
+        case '=':
+            d_tok = t_equal;
+            break;
+
+        default:
+            if (!is_word_char(*d_pos)) {
+                ++d_pos;        // dds.lex ignores these
+                continue;
+            }
+
+            // 'Data:' on a line by itself separates the DDS from the data
+            if (d_end - d_pos >= 6 && strncmp(d_pos, "Data:", 5) == 0
+                && (d_pos[5] == '\n' || (d_pos[5] == '\r' && d_end - d_pos >= 7 && d_pos[6] == '\n'))) {
+                d_pos = d_end;
+                continue;
+            }
+
+            d_text = d_pos;
+            while (d_pos < d_end && is_word_char(*d_pos))
+                ++d_pos;
+            d_len = d_pos - d_text;
+
+            d_tok = t_word;
+            for (int i = 0; keywords[i].word; ++i) {
+                if (strlen(keywords[i].word) == d_len && strncmp(keywords[i].word, d_text, d_len) == 0) {
+                    d_tok = keywords[i].tok;
+                    break;
+                }
+            }
+            return;
+        }
+
+        // A one-character token
+        d_text = d_pos++;
+        d_len = 1;
+        return;
+    }
+
+    d_tok = t_eof;
+    d_text = d_pos;
+    d_len = 0;
+}
+
+// Throw an Error that looks like the ones from the bison parser. If
+// context is true, include the current token.
+void
+DDSParser::m_error(const string &msg, bool context) const
+{
+    parse_error(msg, d_line, context ? m_text().c_str() : 0);
+}
+
+// See invalid_declaration() in dds.yy
+void
+DDSParser::m_check(BaseType *btp, const string &type)
+{
+    string smsg;
+    if (!btp->check_semantics(smsg)) {
+        ostringstream msg;
+        msg << "In the dataset descriptor object: `" << type << " " << btp->name() << "'" << endl
+            << "is not a valid declaration." << endl << smsg;
+        m_error(msg.str());
+    }
+}
+
+/** Parse a variable's name and its array dimensions, if any. If there
+    are dimensions, *btp is replaced by an Array that holds it. */
+void
+DDSParser::m_var(BaseType **btp)
+{
+    // The name may be a word or any of the keywords but 'Dataset'
+    if (d_tok != t_word && (d_tok < t_list || d_tok > t_url))
+        m_error(BAD_DECLARATION, true);
+
+    (*btp)->set_name(m_text());
+    m_next();
+
+    while (d_tok == t_lbracket) {
+        m_next();
+        if (d_tok != t_word)
+            m_error(BAD_SUBSCRIPT, true);
+
+        // Either '[size]' or '[name = size]'
+        string dim_name;
+        string size = m_text();
+        m_next();
+        if (d_tok == t_equal) {
+            dim_name = size;
+            m_next();
+            if (d_tok != t_word)
+                m_error(BAD_SUBSCRIPT, true);
+            size = m_text();
+            m_next();
+        }
+        else if (d_tok != t_rbracket) {
+            m_error(BAD_SUBSCRIPT, true);
+        }
+
+        if (!check_int32(size.c_str()))
+            parse_error(BAD_SUBSCRIPT, d_line, size.c_str());
+        if (d_tok != t_rbracket)
+            m_error(BAD_SUBSCRIPT, true);
+        m_next();
+
+        if ((*btp)->type() == dods_array_c) {
+            static_cast<Array*>(*btp)->append_dim(atoi(size.c_str()), dim_name);
+        }
+        else {
+            Array *a = d_dds->get_factory()->NewArray();
+            a->add_var_nocopy(*btp);
+            *btp = a;
+            a->append_dim(atoi(size.c_str()), dim_name);
+        }
+    }
+}
+
+/** Parse one declaration and return the new variable. */
+BaseType *
+DDSParser::m_declaration()
+{
+    BaseTypeFactory *factory = d_dds->get_factory();
+    string type = m_text();
+    BaseType *btp = 0;
+
+    try {
+        switch (d_tok) {
+        case t_byte: btp = factory->NewByte(); break;
+        case t_int16: btp = factory->NewInt16(); break;
+        case t_uint16: btp = factory->NewUInt16(); break;
+        case t_int32: btp = factory->NewInt32(); break;
+        case t_uint32: btp = factory->NewUInt32(); break;
+        case t_float32: btp = factory->NewFloat32(); break;
+        case t_float64: btp = factory->NewFloat64(); break;
+        case t_string: btp = factory->NewStr(); break;
+        case t_url: btp = factory->NewUrl(); break;
+
+        case t_structure:
+        case t_sequence: {
+            Constructor *ctor;
+            if (d_tok == t_structure)
+                ctor = factory->NewStructure();
+            else
+                ctor = factory->NewSequence();
+            btp = ctor;
+
+            m_next();
+            if (d_tok != t_lbrace)
+                m_error(BAD_DECLARATION, true);
+            m_next();
+
+            while (d_tok != t_rbrace)
+                ctor->add_var_nocopy(m_declaration());
+            break;
+        }
+
+        case t_grid: {
+            Grid *grid = factory->NewGrid();
+            btp = grid;
+
+            m_next();
+            if (d_tok != t_lbrace)
+                m_error(BAD_DECLARATION, true);
+            m_next();
+            if (d_tok != t_word || !is_keyword(m_text(), "array"))
+                m_error(BAD_DECLARATION, true);
+            m_next();
+            if (d_tok != t_colon)
+                m_error(BAD_DECLARATION, true);
+            m_next();
+
+            BaseType *part = m_declaration();
+            try {
+                grid->add_var_nocopy(part, libdap::array);
+            }
+            catch (...) {
+                delete part;
+                throw;
+            }
+
+            if (d_tok != t_word || !is_keyword(m_text(), "maps"))
+                m_error(BAD_DECLARATION, true);
+            m_next();
+            if (d_tok != t_colon)
+                m_error(BAD_DECLARATION, true);
+            m_next();
+
+            while (d_tok != t_rbrace) {
+                part = m_declaration();
+                try {
+                    grid->add_var_nocopy(part, maps);
+                }
+                catch (...) {
+                    delete part;
+                    throw;
+                }
+            }
+            break;
+        }
+
+        default:
+            m_error(BAD_DECLARATION, true);
+        }
+
+        // Move past the type or the constructor's closing brace
+        m_next();
+
+        m_var(&btp);
+        if (d_tok != t_semicolon)
+            m_error(BAD_DECLARATION, true);
+
+        m_check(btp, type);
+        m_next();
+    }
+    catch (...) {
+        delete btp;
+        throw;
+    }
+
+    return btp;
+}
+
+void
+DDSParser::m_parse(DDS *dds)
+{
+    if (!dds)
+        throw InternalErr(__FILE__, __LINE__, "Null DDS object.");
+    if (!dds->get_factory())
+        throw InternalErr(__FILE__, __LINE__, "The DDS has no BaseTypeFactory.");
+
+    d_dds = dds;
+    d_line = 1;
+
+    m_next();
+    if (d_tok == t_eof)
+        m_error(NO_DDS_MSG);
+
+    while (d_tok != t_eof) {
+        if (d_tok != t_dataset)
+            m_error(NO_DDS_MSG, true);
+        m_next();
+        if (d_tok != t_lbrace)
+            m_error(NO_DDS_MSG, true);
+        m_next();
+
+        while (d_tok != t_rbrace)
+            dds->add_var_nocopy(m_declaration());
+        m_next();
+
+        // The name may be any word or keyword
+        if (d_tok == t_eof || d_tok >= t_lbrace)
+            m_error(BAD_NAME, true);
+        dds->set_dataset_name(m_text());
+
+        m_next();
+        if (d_tok != t_semicolon)
+            m_error(NO_DDS_MSG, true);
+        m_next();
+    }
+}
+
+/** Parse a DDS held in memory.
+    @param buffer The DDS document
+    @param size The number of bytes in \e buffer
+    @param dds Add the variables to this DDS */
+void
+DDSParser::intern(const char *buffer, unsigned long size, DDS *dds)
+{
+    d_pos = buffer;
+    d_end = buffer + size;
+
+    m_parse(dds);
+}
+
+/** Parse a DDS held in a string.
+    @param document The DDS document
+    @param dds Add the variables to this DDS */
+void
+DDSParser::intern(const string &document, DDS *dds)
+{
+    intern(document.data(), document.size(), dds);
+}
+
+/** Read a DDS from \e in and parse it. The whole of \e in is read.
+    @param in Read from this FILE
+    @param dds Add the variables to this DDS */
+void
+DDSParser::intern(FILE *in, DDS *dds)
+{
+    if (!in)
+        throw InternalErr(__FILE__, __LINE__, "Null input stream.");
+
+    vector<char> document;
+    size_t size = 0;
+    size_t n;
+    do {
+        document.resize(size + dds_read_size);
+        n = fread(&document[size], 1, dds_read_size, in);
+        size += n;
+    } while (n > 0);
+
+    intern(size ? &document[0] : "", size, dds);
+}
+
+} // namespace libdap
@@ -0,0 +1,89 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _dds_parser_h
+#define _dds_parser_h 1
+
+#include <cstdio>
+#include <string>
+
+namespace libdap
+{
+
+class BaseType;
+class DDS;
+
+/** @brief A hand-written parser for the DAP2 DDS.
+
+    This accepts the same documents as the bison parser in dds.yy and builds
+    the same variables. The document is read into memory and scanned in
+    place, and each variable is made once and added to its parent without
+    being copied. As with dds.lex, a line that is just 'Data:' ends the
+    DDS.
+
+    DDS::parse() uses this parser when DDS::set_fast_parser(true) has been
+    called.
+
+    @see DASParser */
+class DDSParser
+{
+private:
+    enum token {
+        t_eof, t_word, t_dataset, t_list, t_sequence, t_structure, t_grid, t_byte, t_int16, t_uint16,
+        t_int32, t_uint32, t_float32, t_float64, t_string, t_url,
+        t_lbrace, t_rbrace, t_lbracket, t_rbracket, t_colon, t_semicolon, t_equal
+    };
+
+    const char *d_pos;
+    const char *d_end;
+    int d_line;
+
+    // The current token; d_text/d_len point into the document
+    token d_tok;
+    const char *d_text;
+    std::string::size_type d_len;
+
+    DDS *d_dds;
+
+    void m_next();
+    std::string m_text() const { return std::string(d_text, d_len); }
+    void m_error(const std::string &msg, bool context = false) const;
+
+    BaseType *m_declaration();
+    void m_var(BaseType **btp);
+    void m_check(BaseType *btp, const std::string &type);
+
+    void m_parse(DDS *dds);
+
+public:
+    DDSParser() : d_pos(0), d_end(0), d_line(1), d_tok(t_eof), d_text(0), d_len(0), d_dds(0) { }
+    virtual ~DDSParser() { }
+
+    void intern(const char *buffer, unsigned long size, DDS *dds);
+    void intern(const std::string &document, DDS *dds);
+    void intern(FILE *in, DDS *dds);
+};
+
+} // namespace libdap
+
+#endif // _dds_parser_h
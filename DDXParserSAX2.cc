@@ -30,6 +30,7 @@
 
 #include <cstring>
 #include <cstdarg>
+#include <vector>
 
 #include "BaseType.h"
 #include "Byte.h"
@@ -54,6 +55,10 @@
 
 namespace libdap {
 
+// When there's no MIME boundary to find, intern_stream() reads the DDX in
+// blocks of this many bytes
+static const int ddx_parse_buff_size = 65536;
+
 #if defined(DODS_DEBUG) || defined(DODS_DEUG2)
 static const char *states[] =
     {
@@ -1095,20 +1100,33 @@ void DDXParser::intern_stream(istream &in, DDS *dest_dds, string &cid, const str
         context->userData = this;
         context->validate = true;
 
-        in.getline(chars, size);	// chars has size+1 elements
-        res = in.gcount();
-        chars[res-1] = '\n';		// libxml needs the newline; w/o it the parse will fail
-        chars[res] = '\0';
-        while (res > 0 && !is_boundary(chars, boundary)) {
-        	DBG(cerr << "line (" << res << "): " << chars << endl);
-        	xmlParseChunk(ctxt, chars, res, 0);
-
-        	in.getline(chars, size);	// chars has size+1 elements
-        	res = in.gcount();
-        	if (res > 0) {
-        		chars[res-1] = '\n';
-        		chars[res] = '\0';
-        	}
+        if (boundary.empty()) {
+            // Without a boundary to look for, the rest of the stream is the
+            // DDX, so read it in blocks instead of lines.
+            vector<char> buffer(ddx_parse_buff_size);
+            while (in.good()) {
+                in.read(&buffer[0], ddx_parse_buff_size);
+                res = in.gcount();
+                DBG(cerr << "block (" << res << ")" << endl);
+                if (res > 0) xmlParseChunk(ctxt, &buffer[0], res, 0);
+            }
+        }
+        else {
+            in.getline(chars, size);	// chars has size+1 elements
+            res = in.gcount();
+            chars[res-1] = '\n';		// libxml needs the newline; w/o it the parse will fail
+            chars[res] = '\0';
+            while (res > 0 && !is_boundary(chars, boundary)) {
+                DBG(cerr << "line (" << res << "): " << chars << endl);
+                xmlParseChunk(ctxt, chars, res, 0);
+
+                in.getline(chars, size);	// chars has size+1 elements
+                res = in.gcount();
+                if (res > 0) {
+                    chars[res-1] = '\n';
+                    chars[res] = '\0';
+                }
+            }
         }
 
         // This call ends the parse: The fourth argument of xmlParseChunk is
@@ -1166,9 +1184,19 @@ void DDXParser::intern_stream(FILE *in, DDS *dest_dds, string &cid, const string
         context->validate = true;
 
 
-        while ((fgets(chars, size, in) != 0) && !is_boundary(chars, boundary)) {
-            DBG(cerr << "line (" << strlen(chars) << "): " << chars << endl);
-            xmlParseChunk(ctxt, chars, strlen(chars), 0);
+        if (boundary.empty()) {
+            // See intern_stream(istream &, ...)
+            vector<char> buffer(ddx_parse_buff_size);
+            while ((res = fread(&buffer[0], 1, ddx_parse_buff_size, in)) > 0) {
+                DBG(cerr << "block (" << res << ")" << endl);
+                xmlParseChunk(ctxt, &buffer[0], res, 0);
+            }
+        }
+        else {
+            while ((fgets(chars, size, in) != 0) && !is_boundary(chars, boundary)) {
+                DBG(cerr << "line (" << strlen(chars) << "): " << chars << endl);
+                xmlParseChunk(ctxt, chars, strlen(chars), 0);
+            }
         }
         // This call ends the parse: The fourth argument of xmlParseChunk is
         // the bool 'terminate.'
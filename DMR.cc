@@ -35,6 +35,7 @@
 
 #include <cassert>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -49,6 +50,7 @@
 #include "XMLWriter.h"
 #include "D4BaseTypeFactory.h"
 #include "D4Attributes.h"
+#include "ParallelLoop.h"
 
 #include "DDS.h"	// Included so DMRs can be built using a DDS for 'legacy' handlers
 
@@ -96,6 +98,8 @@ DMR::m_duplicate(const DMR &dmr)
 
     d_max_response_size = dmr.d_max_response_size;
 
+    d_transform_threads = dmr.d_transform_threads;
+
     // Deep copy, using ptr_duplicate()
     // d_root can only be a D4Group, so the thing returned by ptr_duplicate() must be a D4Group.
     d_root = static_cast<D4Group*>(dmr.d_root->ptr_duplicate());
@@ -121,7 +125,7 @@ DMR::DMR(D4BaseTypeFactory *factory, const string &name)
         : d_factory(factory), d_name(name), d_filename(""),
           d_dap_major(4), d_dap_minor(0),
           d_dmr_version("1.0"), d_request_xml_base(""),
-          d_namespace(c_dap40_namespace), d_max_response_size(0), d_root(0)
+          d_namespace(c_dap40_namespace), d_max_response_size(0), d_transform_threads(1), d_root(0)
 {
     // sets d_dap_version string and the two integer fields too
     set_dap_version("4.0");
@@ -151,7 +155,7 @@ DMR::DMR(D4BaseTypeFactory *factory, DDS &dds)
         : d_factory(factory), d_name(dds.get_dataset_name()),
           d_filename(dds.filename()), d_dap_major(4), d_dap_minor(0),
           d_dmr_version("1.0"), d_request_xml_base(""),
-          d_namespace(c_dap40_namespace), d_max_response_size(0), d_root(0)
+          d_namespace(c_dap40_namespace), d_max_response_size(0), d_transform_threads(1), d_root(0)
 {
     // sets d_dap_version string and the two integer fields too
     set_dap_version("4.0");
@@ -182,7 +186,7 @@ DMR::DMR(D4BaseTypeFactory *factory, DDS &dds)
 DMR::DMR()
         : d_factory(0), d_name(""), d_filename(""), d_dap_major(4), d_dap_minor(0),
           d_dap_version("4.0"), d_dmr_version("1.0"), d_request_xml_base(""),
-          d_namespace(c_dap40_namespace), d_max_response_size(0), d_root(0)
+          d_namespace(c_dap40_namespace), d_max_response_size(0), d_transform_threads(1), d_root(0)
 {
     // sets d_dap_version string and the two integer fields too
     set_dap_version("4.0");
@@ -215,13 +219,100 @@ DMR::operator=(const DMR &rhs)
     return *this;
 }
 
+// Can this DAP2 variable be transformed apart from the root group? A Grid
+// looks for its Map arrays in the root group and a DAP4 variable is copied
+// as-is, so those (and constructors that hold them) are not.
+static bool
+independent_transform(BaseType *btp)
+{
+    if (btp->is_dap4() || btp->type() == dods_grid_c)
+        return false;
+
+    if (btp->is_constructor_type()) {
+        Constructor *c = static_cast<Constructor*>(btp);
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i)
+            if (!independent_transform(*i))
+                return false;
+    }
+
+    return true;
+}
+
+namespace {
+
+// A group used by build_using_dds() to transform one DAP2 variable apart
+// from the root group.
+class transform_group: public D4Group {
+public:
+    transform_group() : D4Group("/") { }
+
+    // Take the variables out of this group; the caller must delete them
+    void release(vector<BaseType*> &vars)
+    {
+        vars.swap(d_vars);
+        m_var_index_changed();
+    }
+};
+
+// Transform each variable that doesn't need the root group in a group of
+// its own, using that group as both the root and the container
+class transform_vars: public ParallelLoop::Body {
+    const vector<BaseType*> &d_vars;
+    vector<transform_group*> &d_groups;
+
+public:
+    transform_vars(const vector<BaseType*> &vars, vector<transform_group*> &groups) :
+        d_vars(vars), d_groups(groups) { }
+
+    void run(unsigned long i)
+    {
+        if (independent_transform(d_vars[i])) {
+            d_groups[i] = new transform_group;
+            d_vars[i]->transform_to_dap4(d_groups[i], d_groups[i]);
+        }
+    }
+};
+
+} // anonymous namespace
+
+// Bind the Arrays in btp, and in its children if it's a constructor, to the
+// shared dimensions of root. The Arrays are visited in the order
+// transform_to_dap4() made them, so the dimensions added to root are the
+// same as if they had been transformed in root in the first place.
+static void
+bind_shared_dimensions(BaseType *btp, D4Group *root)
+{
+    if (btp->type() == dods_array_c) {
+        static_cast<Array*>(btp)->bind_shared_dimensions(root);
+    }
+    else if (btp->is_constructor_type()) {
+        Constructor *c = static_cast<Constructor*>(btp);
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i)
+            bind_shared_dimensions(*i, root);
+    }
+}
+
+static inline void
+delete_group(transform_group *g)
+{
+    delete g;
+}
+
 /**
  * If we have a DDS that includes Attributes, use it to build the DMR. This
  * will copy all of the variables in the DDS into the DMR using BaseType::transform_to_dap4(),
  * so the actual types added can be controlled by code that specializes
  * the various type classes.
  *
+ * When more than one transform thread has been set, the top-level
+ * variables that don't need the root group (all but Grids and DAP4
+ * variables) are transformed at the same time, each in a group of its
+ * own, and then moved to the root group in the order of the DDS. Their
+ * shared dimensions are made when they are moved, so the DMR is the same
+ * as the one built using one thread.
+ *
  * @param dds Read variables and Attributes from this DDS
+ * @see set_transform_threads()
  */
 void DMR::build_using_dds(DDS &dds)
 {
@@ -229,27 +320,55 @@ void DMR::build_using_dds(DDS &dds)
     set_filename(dds.filename());
 
     D4Group *root_grp = root();
-    for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i) {
-        BaseType *d4_var = root()->var((*i)->name());
-        // Don't add duplicate variables. We have to make this check
-        // because some of the child variables may add arrays
-        // to the root object. For example, this happens in
-        // Grid with the Map Arrays - ndp - 05/08/17
-        if(!d4_var){
-            // no variable of this name is in the root group at this point. Add it.
-            DBG(cerr << __func__ << "() - Transforming top level variable: " <<
-                " (" << (*i)->type_name() << ":'" << (*i)->name() << "':"<<(void *)(*i) <<
-                ") (root:"<< root_grp << ")"<< endl; );
-            (*i)->transform_to_dap4(root_grp, root_grp);
-            DBG(cerr << __func__ << "() - top level variable: '" <<
-                (*i)->name() << "' (type:" << (*i)->type_name() << ") Transformed"<< endl; );
+
+    vector<BaseType*> dap2_vars(dds.var_begin(), dds.var_end());
+    vector<transform_group*> groups(dap2_vars.size(), static_cast<transform_group*>(0));
+
+    try {
+        if (d_transform_threads > 1) {
+            transform_vars body(dap2_vars, groups);
+            ParallelLoop(body, dap2_vars.size()).run(d_transform_threads);
         }
-        else {
-            DBG(cerr << __func__ << "() - Skipping variable: " <<
-                d4_var->type_name() << " " << d4_var->name() << " because a variable with" <<
-                " this name already exists in the root group." << endl; );
+
+        for (vector<BaseType*>::size_type i = 0; i < dap2_vars.size(); ++i) {
+            BaseType *dap2_var = dap2_vars[i];
+            BaseType *d4_var = root_grp->var(dap2_var->name());
+            // Don't add duplicate variables. We have to make this check
+            // because some of the child variables may add arrays
+            // to the root object. For example, this happens in
+            // Grid with the Map Arrays - ndp - 05/08/17
+            if (d4_var) {
+                DBG(cerr << __func__ << "() - Skipping variable: " <<
+                    d4_var->type_name() << " " << d4_var->name() << " because a variable with" <<
+                    " this name already exists in the root group." << endl; );
+            }
+            else if (groups[i]) {
+                // Already transformed; move it to the root group
+                vector<BaseType*> new_vars;
+                groups[i]->release(new_vars);
+                for (vector<BaseType*>::size_type j = 0; j < new_vars.size(); ++j) {
+                    bind_shared_dimensions(new_vars[j], root_grp);
+                    root_grp->add_var_nocopy(new_vars[j]);
+                    new_vars[j] = 0;
+                }
+            }
+            else {
+                // no variable of this name is in the root group at this point. Add it.
+                DBG(cerr << __func__ << "() - Transforming top level variable: " <<
+                    " (" << dap2_var->type_name() << ":'" << dap2_var->name() << "':"<<(void *)dap2_var <<
+                    ") (root:"<< root_grp << ")"<< endl; );
+                dap2_var->transform_to_dap4(root_grp, root_grp);
+                DBG(cerr << __func__ << "() - top level variable: '" <<
+                    dap2_var->name() << "' (type:" << dap2_var->type_name() << ") Transformed"<< endl; );
+            }
         }
     }
+    catch (...) {
+        for_each(groups.begin(), groups.end(), delete_group);
+        throw;
+    }
+
+    for_each(groups.begin(), groups.end(), delete_group);
 
     // Now copy the global attributes
     root()->attributes()->transform_to_dap4(dds.get_attr_table());
@@ -363,9 +482,14 @@ DDS *DMR::getDDS(DMR &dmr)
  * That is, if the HDF5 handler built the DMR, then the resulting DDS will hold
  * instances of H5Int32, etc.
  *
+ * When more than one transform thread has been set, the variables of each
+ * group are transformed at the same time; the DDS is the same as the one
+ * built using one thread.
+ *
  * @note The caller is responsible for deleting the resulting DDS object.
  *
  * @return A pointer to the newly allocated DDS.
+ * @see set_transform_threads()
  */
 DDS *
 DMR::getDDS()
@@ -384,7 +508,9 @@ DMR::getDDS()
 
     // Now copy the global attributes
     // TODO Make this a unique_ptr<> and let the compiler delete it. jhrg 6/17/19
-    vector<BaseType *> *top_vars = root()->transform_to_dap2(&(dds->get_attr_table())/*, true*/);
+    vector<BaseType *> *top_vars = (d_transform_threads > 1)
+        ? root()->transform_to_dap2(&(dds->get_attr_table()), d_transform_threads)
+        : root()->transform_to_dap2(&(dds->get_attr_table())/*, true*/);
     for (vector<BaseType *>::iterator i = top_vars->begin(), e = top_vars->end(); i != e; i++) {
         dds->add_var_nocopy(*i);
     }
@@ -410,6 +536,52 @@ DMR::root()
 	return d_root;
 }
 
+// Freeze the attributes of btp and, if it's a constructor, of its children
+static void
+freeze_attributes(BaseType *btp)
+{
+    btp->attributes()->freeze();
+
+    if (btp->is_constructor_type()) {
+        Constructor *c = static_cast<Constructor*>(btp);
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i)
+            freeze_attributes(*i);
+    }
+
+    if (btp->type() == dods_group_c) {
+        D4Group *g = static_cast<D4Group*>(btp);
+        for (D4Group::groupsIter i = g->grp_begin(), e = g->grp_end(); i != e; ++i)
+            freeze_attributes(*i);
+    }
+}
+
+/**
+ * @brief Share the attributes of this DMR with its copies.
+ *
+ * Freeze the attributes of every variable and group so that copies of this
+ * DMR share them instead of copying them; see D4Attributes::freeze(). A
+ * copy gets its own attributes only for the variables whose attributes it
+ * modifies or gets using the non-const D4Attributes methods. Printing or
+ * writing a copy, transforming it to DAP2 and the const lookups do not copy
+ * the attributes.
+ *
+ * @note This shares only the attributes. Copying the DMR still makes a deep
+ * copy of every group, dimension, enumeration and variable, since each
+ * variable holds its own per-request state (send_p, read_p, values and
+ * constraints), so making a copy is still O(size of the dataset). DAP2
+ * copies made with DDS::duplicate() share nothing.
+ *
+ * The DMR must not be modified once it's in use; make copies of it in as
+ * many threads as needed and work with those. Keep it until its copies are
+ * deleted: the maps of a copied Array still refer to the map arrays of the
+ * DMR it was copied from (see D4Maps).
+ */
+void
+DMR::freeze()
+{
+    freeze_attributes(root());
+}
+
 /**
  * Given the DAP protocol version, parse that string and set the DMR fields.
  *
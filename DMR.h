@@ -79,6 +79,9 @@ private:
     /// The maximum response size (in Kilo bytes)
     long d_max_response_size;
 
+    /// Threads used by build_using_dds() and getDDS()
+    unsigned int d_transform_threads;
+
     /// The root group; holds dimensions, enums, variables, groups, ...
     D4Group *d_root;
 
@@ -165,12 +168,25 @@ public:
     /// Get the estimated response size, in kilo bytes
     long request_size(bool constrained);
 
+    /** Get/set the number of threads used to transform the top-level
+        variables in build_using_dds() and getDDS(). The default is one,
+        which transforms them in order in the calling thread. The result
+        is the same regardless of the number of threads, but more than one
+        should only be used when the variables' transform_to_dap4() and
+        transform_to_dap2() methods are MT-safe; those in libdap are. */
+    //@{
+    unsigned int transform_threads() const { return d_transform_threads; }
+    void set_transform_threads(unsigned int threads) { d_transform_threads = threads; }
+    //@}
+
     /** Return the root group of this Dataset. If no root group has been
      * set, use the D4BaseType factory to make it.
      * @return The root group of the dataset.
      */
     D4Group *root();
 
+    void freeze();
+
     // TODO Remove this static method? If we have a DMR, why not use the
     // getDDS() method below? jhrg 2.28.18
     //static DDS *getDDS(DMR &dmr);
@@ -622,7 +622,10 @@ DODSFilter::get_timeout() const
     know that when an exception is thrown during a deserialize operation, it
     should scan ahead in the input stream for an Error object. Add this, or a
     sensible variant once libdap++ supports reliable error delivery. Dumb
-    clients will never get the Error object... */
+    clients will never get the Error object...
+
+    @note The alarm is global to the process. Servers that answer requests
+    in threads should use a CancelToken (see DAP2RequestHandler). */
 
 void
 DODSFilter::establish_timeout(FILE *stream) const
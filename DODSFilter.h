@@ -72,6 +72,9 @@ namespace libdap
     @todo We need to rethink the ancillary file/directory stuff. I don't
     think it's ever been used...
 
+    Servers that answer requests in threads instead of processes can use
+    DAP2RequestHandler.
+
     @brief Common functions for DODS server filter programs.
     @author jhrg 8/26/97 */
 
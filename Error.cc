@@ -44,13 +44,8 @@
 
 using namespace std;
 
-// Glue routines declared in Error.lex
-extern void Error_switch_to_buffer(void *new_buffer);
-extern void Error_delete_buffer(void * buffer);
-extern void *Error_buffer(FILE *fp);
-
 //extern void Errorrestart(FILE *yyin); // defined in Error.tab.c
-extern int Errorparse(libdap::parser_arg *arg);
+extern int Error_parse(FILE *in, libdap::parser_arg *arg);
 
 namespace libdap {
 
@@ -160,18 +155,13 @@ Error::parse(FILE *fp)
     if (!fp)
         throw InternalErr(__FILE__, __LINE__, "Null input stream");
 
-    void *buffer = Error_buffer(fp);
-    Error_switch_to_buffer(buffer);
-
     parser_arg arg(this);
 
     bool status;
     try {
-        status = Errorparse(&arg) == 0;
-        Error_delete_buffer(buffer);
+        status = Error_parse(fp, &arg) == 0;
     }
     catch (Error &e) {
-        Error_delete_buffer(buffer);
         throw InternalErr(__FILE__, __LINE__, e.get_error_message());
     }
 
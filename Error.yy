@@ -55,20 +55,25 @@ using namespace libdap;
 #define YYERROR_VERBOSE 0
 //#define YYPARSE_PARAM arg
 
-extern int error_line_num;	// defined in Error.lex
-
 }
 
 %code {
 
-int Errorlex();			// the scanner
-void Errorerror(parser_arg *arg, const string &s);	// gotta love automatically generated names...
+int Errorlex(YYSTYPE *lvalp, void *scanner);	// the scanner; see Error.lex
+int Errorget_lineno(void *scanner);
+void Errorerror(parser_arg *arg, void *scanner, const string &s);	// gotta love automatically generated names...
+
+// Glue routines defined in Error.lex
+void *Error_scanner(FILE *fp);
+void Error_delete_scanner(void *scanner);
 
 }
 
 %require "2.4"
-%parse-param {parser_arg *arg}
+%parse-param {parser_arg *arg} {void *scanner}
+%lex-param {void *scanner}
 %name-prefix "Error"
+%define api.pure full
 // %define api.prefix {Error}
 %defines
 %debug
@@ -132,13 +137,32 @@ message:	SCAN_MSG '=' SCAN_STR
 %%
 
 void
-Errorerror(parser_arg *, const string &s)
+Errorerror(parser_arg *, void *scanner, const string &s)
 {
   string msg = s;
   msg += " line: ";
-  append_long_to_string(error_line_num, 10, msg);
+  append_long_to_string(Errorget_lineno(scanner), 10, msg);
   msg += "\n";
 
   throw Error(unknown_error, msg);
 }
 
+/** Parse the Error object read from \c in into the Error held by \c arg.
+    Each call makes its own scanner, so several threads can parse Error
+    objects at the same time.
+    @return The value returned by Errorparse(); zero if the parse worked. */
+int
+Error_parse(FILE *in, parser_arg *arg)
+{
+    void *scanner = Error_scanner(in);
+
+    try {
+        int status = Errorparse(arg, scanner);
+        Error_delete_scanner(scanner);
+        return status;
+    }
+    catch (...) {
+        Error_delete_scanner(scanner);
+        throw;
+    }
+}
@@ -0,0 +1,760 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cstdlib>
+#include <cctype>
+
+#include <exception>
+#include <sstream>
+#include <streambuf>
+
+//#define DODS_DEBUG
+
+#include "FunctionResultCache.h"
+
+#include "BaseType.h"
+#include "Array.h"
+#include "Constructor.h"
+#include "D4Enum.h"
+#include "D4EnumDefs.h"
+#include "D4Dimensions.h"
+#include "D4Maps.h"
+#include "D4Group.h"
+#include "DDS.h"
+#include "DMR.h"
+
+#include "BinaryMetadata.h"
+#include "D4StreamMarshaller.h"
+#include "D4StreamUnMarshaller.h"
+
+#include "CancelToken.h"
+#include "InternalErr.h"
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+namespace {
+
+class cache_lock {
+private:
+    pthread_mutex_t &d_mutex;
+
+public:
+    cache_lock(pthread_mutex_t &mutex) : d_mutex(mutex)
+    {
+        pthread_mutex_lock(&d_mutex);
+    }
+
+    ~cache_lock()
+    {
+        pthread_mutex_unlock(&d_mutex);
+    }
+};
+
+// Read the values of a cached result where they are, without copying them
+// into an istringstream.
+class memory_buf: public streambuf {
+public:
+    memory_buf(const char *buf, unsigned long size)
+    {
+        char *b = const_cast<char*>(buf);
+        setg(b, b, b + size);
+    }
+};
+
+// Can the values of this variable be written and read back using the
+// binary metadata for it? Sequences read their values as they are sent and
+// the binary metadata of an Array holds its whole shape.
+bool cacheable_var(BaseType *btp)
+{
+    if (btp->type() == dods_sequence_c)
+        return false;
+
+    if (btp->type() == dods_array_c) {
+        Array *a = static_cast<Array*>(btp);
+        for (Array::Dim_iter d = a->dim_begin(), de = a->dim_end(); d != de; ++d) {
+            if (a->dimension_size(d, true) != a->dimension_size(d, false))
+                return false;
+        }
+
+        return a->var() && a->var()->is_simple_type();
+    }
+
+    if (btp->is_constructor_type()) {
+        Constructor *c = static_cast<Constructor*>(btp);
+        for (Constructor::Vars_iter i = c->var_begin(), e = c->var_end(); i != e; ++i) {
+            if (!cacheable_var(*i))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// The Dimensions, Enumerations and Maps of a DMR's variables are written
+// by name; they must name things in the result itself or the result will
+// not read back. A function's result can use the Dimensions of the source
+// dataset.
+bool cacheable_group(D4Group *root, D4Group *grp)
+{
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i) {
+        if (!cacheable_var(*i))
+            return false;
+
+        if ((*i)->type() == dods_array_c) {
+            Array *a = static_cast<Array*>(*i);
+            for (Array::Dim_iter d = a->dim_begin(), de = a->dim_end(); d != de; ++d) {
+                if (d->dim && !root->find_dim(d->dim->fully_qualified_name()))
+                    return false;
+            }
+
+            for (D4Maps::D4MapsIter m = a->maps()->map_begin(), me = a->maps()->map_end(); m != me; ++m) {
+                const string &name = (*m)->name();
+                if (name.empty() || !(name[0] == '/' ? root->find_map_source(name) : grp->find_map_source(name)))
+                    return false;
+            }
+        }
+        else if ((*i)->type() == dods_enum_c) {
+            D4EnumDef *enum_def = static_cast<D4Enum*>(*i)->enumeration();
+            if (!enum_def || !enum_def->parent() || !root->find_enum_def(
+                static_cast<D4Group*>(enum_def->parent()->parent())->FQN() + enum_def->name()))
+                return false;
+        }
+    }
+
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g) {
+        if (!cacheable_group(root, *g))
+            return false;
+    }
+
+    return true;
+}
+
+// The variables of a group and then its child groups, without the
+// checksums D4Group::serialize() adds.
+void serialize_group(D4Group *grp, D4StreamMarshaller &m, DMR &dmr)
+{
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i)
+        (*i)->serialize(m, dmr);
+
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        serialize_group(*g, m, dmr);
+}
+
+void deserialize_group(D4Group *grp, D4StreamUnMarshaller &um, DMR &dmr)
+{
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i)
+        (*i)->deserialize(um, dmr);
+
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        deserialize_group(*g, um, dmr);
+}
+
+// A value is the size of the binary metadata, a newline, the binary metadata
+// and then the values.
+void start_value(const string &metadata, string &value)
+{
+    ostringstream oss;
+    oss << metadata.size() << '\n';
+    value = oss.str();
+    value.append(metadata);
+}
+
+// Find the binary metadata in a value; the values follow it.
+void find_metadata(const string &value, string::size_type &start, string::size_type &size)
+{
+    start = value.find('\n');
+    if (start == string::npos || start == 0)
+        throw Error("A cached function result is malformed.");
+
+    size = strtoul(value.substr(0, start).c_str(), 0, 10);
+    ++start;
+    if (size > value.size() - start)
+        throw Error("A cached function result is truncated.");
+}
+
+} // namespace
+
+/** @brief Make an empty cache
+
+    @param max_size The cache holds at most this many bytes of keys and
+    values. */
+FunctionResultCache::FunctionResultCache(unsigned long long max_size) :
+        d_entries(), d_lru(), d_max_size(max_size), d_size(0), d_hits(0), d_misses(0)
+{
+    if (pthread_mutex_init(&d_mutex, 0) != 0)
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the function result cache mutex.");
+
+    if (pthread_cond_init(&d_cond, 0) != 0) {
+        pthread_mutex_destroy(&d_mutex);
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the function result cache condition.");
+    }
+}
+
+FunctionResultCache::~FunctionResultCache()
+{
+    pthread_cond_destroy(&d_cond);
+    pthread_mutex_destroy(&d_mutex);
+}
+
+/** @brief Remove the white space outside of quoted strings.
+
+    Two expressions that differ only in their spacing call the same
+    functions with the same arguments. Quoted strings are kept as they
+    are, including backslash escapes within them. */
+string
+FunctionResultCache::normalize(const string &expr)
+{
+    string result;
+    result.reserve(expr.size());
+
+    bool quoted = false;
+    for (string::size_type i = 0, e = expr.size(); i < e; ++i) {
+        char c = expr[i];
+        if (quoted) {
+            result += c;
+            if (c == '\\' && i + 1 < e)
+                result += expr[++i];
+            else if (c == '"')
+                quoted = false;
+        }
+        else if (c == '"') {
+            result += c;
+            quoted = true;
+        }
+        else if (!isspace(static_cast<unsigned char>(c))) {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+/** @brief Make the key of a function expression's result.
+
+    @param dataset The name of the dataset (e.g., its pathname)
+    @param last_modified The time the dataset was last modified
+    @param expr The function expression
+    @return The key */
+string
+FunctionResultCache::make_key(const string &dataset, time_t last_modified, const string &expr)
+{
+    ostringstream oss;
+    oss << dataset.size() << ':' << dataset << ':' << last_modified << ':' << normalize(expr);
+    return oss.str();
+}
+
+/** @brief Can the variables of this DDS be cached? */
+bool
+FunctionResultCache::cacheable(DDS &dds)
+{
+    if (!dds.get_factory())
+        return false;
+
+    for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i) {
+        if (!cacheable_var(*i))
+            return false;
+    }
+
+    return true;
+}
+
+/** @brief Can the variables of this DMR be cached? */
+bool
+FunctionResultCache::cacheable(DMR &dmr)
+{
+    if (!dmr.factory())
+        return false;
+
+    return cacheable_group(dmr.root(), dmr.root());
+}
+
+/** @brief Write a DDS and the values of its variables in the cache's form
+
+    All of the variables are marked to be sent, as a server does before it
+    sends a function's result.
+
+    @param dds The variables must hold their values.
+    @param value The result */
+void
+FunctionResultCache::write_value(DDS &dds, string &value)
+{
+    ostringstream metadata;
+    BinaryMetadataWriter().print(dds, metadata);
+    start_value(metadata.str(), value);
+
+    // Constructor::serialize() skips the variables that are not sent
+    dds.mark_all(true);
+
+    ostringstream values;
+    {
+        // The marshaller may write using a child thread; it waits for that
+        // thread when it is deleted.
+        D4StreamMarshaller m(values);
+        DMR dmr;
+        for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i)
+            (*i)->serialize(m, dmr);
+    }
+
+    value.append(values.str());
+}
+
+/** @brief Write a DMR and the values of its variables in the cache's form
+
+    All of the variables are marked to be sent.
+
+    @param dmr The variables must hold their values.
+    @param value The result */
+void
+FunctionResultCache::write_value(DMR &dmr, string &value)
+{
+    ostringstream metadata;
+    BinaryMetadataWriter().print(dmr, metadata);
+    start_value(metadata.str(), value);
+
+    dmr.root()->set_send_p(true);
+
+    ostringstream values;
+    {
+        D4StreamMarshaller m(values);
+        serialize_group(dmr.root(), m, dmr);
+    }
+
+    value.append(values.str());
+}
+
+/** @brief Build a DDS and the values of its variables from a cached value
+
+    @param value Made by write_value(DDS&, string&)
+    @param dds Add the variables here; it must have a factory and should
+    be empty.
+    @exception Error if the value is malformed. */
+void
+FunctionResultCache::read_value(const string &value, DDS &dds)
+{
+    string::size_type start, size;
+    find_metadata(value, start, size);
+
+    BinaryMetadataReader().intern(value.data() + start, size, &dds);
+
+    memory_buf buf(value.data() + start + size, value.size() - start - size);
+    istream in(&buf);
+    D4StreamUnMarshaller um(in);
+    DMR dmr;
+    for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i) {
+        (*i)->deserialize(um, dmr);
+        (*i)->set_read_p(true);
+        (*i)->set_send_p(true);
+    }
+}
+
+/** @brief Build a DMR and the values of its variables from a cached value
+
+    @param value Made by write_value(DMR&, string&)
+    @param dmr Add the variables here; it must have a factory and should
+    be empty.
+    @exception Error if the value is malformed. */
+void
+FunctionResultCache::read_value(const string &value, DMR &dmr)
+{
+    string::size_type start, size;
+    find_metadata(value, start, size);
+
+    BinaryMetadataReader().intern(value.data() + start, size, &dmr);
+
+    memory_buf buf(value.data() + start + size, value.size() - start - size);
+    istream in(&buf);
+    D4StreamUnMarshaller um(in);
+    deserialize_group(dmr.root(), um, dmr);
+    dmr.root()->set_read_p(true);
+    dmr.root()->set_send_p(true);
+}
+
+/** @brief Share the value of rhs
+    @param rhs The handle to share */
+FunctionResultCache::value_handle &
+FunctionResultCache::value_handle::operator=(const value_handle &rhs)
+{
+    if (d_rep == rhs.d_rep)
+        return *this;
+
+    m_release();
+    d_rep = rhs.d_rep;
+    m_acquire();
+
+    return *this;
+}
+
+const string &
+FunctionResultCache::value_handle::value() const
+{
+    static const string empty_value;
+    return d_rep ? d_rep->value : empty_value;
+}
+
+void
+FunctionResultCache::value_handle::m_acquire()
+{
+    if (d_rep)
+        __sync_add_and_fetch(&d_rep->refs, 1);
+}
+
+void
+FunctionResultCache::value_handle::m_release()
+{
+    if (d_rep && __sync_sub_and_fetch(&d_rep->refs, 1) == 0)
+        delete d_rep;
+    d_rep = 0;
+}
+
+// Remove an entry; call with the mutex locked.
+void
+FunctionResultCache::m_erase(entry_map::iterator i)
+{
+    if (i->second.state != building) {
+        d_size -= i->first.size() + i->second.value.size();
+        d_lru.erase(i->second.lru);
+    }
+
+    d_entries.erase(i);
+}
+
+// Remove the entries used least recently until the cache is not too big;
+// call with the mutex locked.
+void
+FunctionResultCache::m_evict()
+{
+    while (d_size > d_max_size && !d_lru.empty()) {
+        DBG(cerr << "Evicting the function result: " << *d_lru.back() << endl);
+        m_erase(d_entries.find(*d_lru.back()));
+    }
+}
+
+// Replace the entry for key and wake the threads waiting for it. An entry
+// larger than the cache is not added. Call with the mutex locked.
+void
+FunctionResultCache::m_store(const string &key, const value_handle &value, entry_state state)
+{
+    entry_map::iterator i = d_entries.find(key);
+    if (i != d_entries.end())
+        m_erase(i);
+
+    if (key.size() + value.size() <= d_max_size) {
+        i = d_entries.insert(make_pair(key, entry())).first;
+        i->second.value = value;
+        i->second.state = state;
+        d_lru.push_front(&i->first);
+        i->second.lru = d_lru.begin();
+        d_size += key.size() + value.size();
+
+        m_evict();
+    }
+
+    pthread_cond_broadcast(&d_cond);
+}
+
+// Wait for another thread to finish with a key; call with the mutex
+// locked. Without a token this waits until the cache changes. With one it
+// waits in short slices, and no longer than the token's deadline, so that
+// it notices when the request is cancelled.
+void
+FunctionResultCache::m_wait(const CancelToken *token)
+{
+    if (!token) {
+        pthread_cond_wait(&d_cond, &d_mutex);
+        return;
+    }
+
+    token->check();
+
+    // The slice is measured from now; if the clock is reset, the next
+    // check of the token still sees the deadline.
+    const long slice = 100;     // milliseconds
+    long milliseconds = token->time_left();
+    if (milliseconds < 0 || milliseconds > slice)
+        milliseconds = slice;
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += milliseconds / 1000;
+    until.tv_nsec += (milliseconds % 1000) * 1000000;
+    if (until.tv_nsec >= 1000000000) {
+        until.tv_sec += 1;
+        until.tv_nsec -= 1000000000;
+    }
+
+    pthread_cond_timedwait(&d_cond, &d_mutex, &until);
+
+    token->check();
+}
+
+/** @brief Look for a value, or reserve the key to add one.
+
+    If the key is in the cache, share its value and return true. If the key
+    is marked with put_uncacheable(), return false at once. If another
+    thread has reserved the key, wait until it adds the value or abandons
+    the key. Otherwise reserve the key and return false; the caller must
+    then call put(), put_uncacheable() or abandon() for the key, or the
+    other threads that ask for it will wait until their requests are
+    cancelled.
+
+    @param key The key, usually made with make_key()
+    @param value The value, if found
+    @param token If not null, stop waiting for another thread when this is
+    cancelled or its deadline passes.
+    @return True if the value was found
+    @exception Error Thrown if the token is cancelled while this waits. */
+bool
+FunctionResultCache::get(const string &key, value_handle &value, const CancelToken *token)
+{
+    cache_lock lock(d_mutex);
+
+    for (;;) {
+        entry_map::iterator i = d_entries.find(key);
+        if (i == d_entries.end()) {
+            d_entries.insert(make_pair(key, entry()));
+            ++d_misses;
+            return false;
+        }
+
+        switch (i->second.state) {
+        case ready:
+            d_lru.splice(d_lru.begin(), d_lru, i->second.lru);
+            value = i->second.value;
+            ++d_hits;
+            return true;
+
+        case uncacheable:
+            d_lru.splice(d_lru.begin(), d_lru, i->second.lru);
+            ++d_misses;
+            return false;
+
+        case building:
+            m_wait(token);
+            break;
+        }
+    }
+}
+
+/** @brief Look for a value and copy it.
+    @see get(const string&, value_handle&, const CancelToken*) */
+bool
+FunctionResultCache::get(const string &key, string &value, const CancelToken *token)
+{
+    value_handle handle;
+    if (!get(key, handle, token))
+        return false;
+
+    value = handle.value();
+    return true;
+}
+
+/** @brief Add a value to the cache.
+
+    This replaces any value the key already has and wakes the threads
+    waiting for it. A value larger than the cache is marked with
+    put_uncacheable() instead.
+
+    @param key The key
+    @param value The value */
+void
+FunctionResultCache::put(const string &key, const string &value)
+{
+    if (key.size() + value.size() > d_max_size) {
+        put_uncacheable(key);
+        return;
+    }
+
+    value_handle handle(value);     // Copy the value before taking the lock
+
+    cache_lock lock(d_mutex);
+    m_store(key, handle, ready);
+}
+
+/** @brief Mark a key whose value cannot be cached.
+
+    The threads waiting for the key wake up and, like the threads that ask
+    for it later, evaluate the functions themselves. The mark takes the
+    space of the key and is removed like a value. */
+void
+FunctionResultCache::put_uncacheable(const string &key)
+{
+    cache_lock lock(d_mutex);
+    m_store(key, value_handle(), uncacheable);
+}
+
+/** @brief Give up a key reserved by get().
+
+    Use this when the functions failed. The threads waiting for the key
+    wake up and one of them reserves it. */
+void
+FunctionResultCache::abandon(const string &key)
+{
+    cache_lock lock(d_mutex);
+
+    entry_map::iterator i = d_entries.find(key);
+    if (i != d_entries.end() && i->second.state == building)
+        d_entries.erase(i);
+
+    pthread_cond_broadcast(&d_cond);
+}
+
+/** @brief Look for the result of a DAP2 function expression.
+
+    If the key is in the cache, the result is read into dds. Otherwise the
+    key may be reserved as with get(const string&, value_handle&,
+    const CancelToken*) and the caller must call put() or abandon() once
+    it has evaluated the functions. The result is read without holding the
+    cache's lock.
+
+    @param key The key
+    @param dds An empty DDS with a factory
+    @param token If not null, stop waiting for another thread when this is
+    cancelled.
+    @return True if the result was found */
+bool
+FunctionResultCache::get(const string &key, DDS &dds, const CancelToken *token)
+{
+    value_handle value;
+    if (!get(key, value, token))
+        return false;
+
+    read_value(value.value(), dds);
+    return true;
+}
+
+/** @brief Look for the result of a DAP4 function expression.
+    @see get(const string&, DDS&) */
+bool
+FunctionResultCache::get(const string &key, DMR &dmr, const CancelToken *token)
+{
+    value_handle value;
+    if (!get(key, value, token))
+        return false;
+
+    read_value(value.value(), dmr);
+    return true;
+}
+
+/** @brief Add the result of a DAP2 function expression.
+
+    If the result cannot be cached the key is marked with
+    put_uncacheable() instead. This does not throw; a result that is not
+    cached is still a result.
+
+    @param key The key
+    @param dds The result */
+void
+FunctionResultCache::put(const string &key, DDS &dds)
+{
+    try {
+        if (cacheable(dds)) {
+            string value;
+            write_value(dds, value);
+            put(key, value);
+            return;
+        }
+    }
+    catch (Error &e) {
+        DBG(cerr << "Could not cache a function result: " << e.get_error_message() << endl);
+    }
+    catch (std::exception &e) {
+        DBG(cerr << "Could not cache a function result: " << e.what() << endl);
+    }
+
+    put_uncacheable(key);
+}
+
+/** @brief Add the result of a DAP4 function expression.
+    @see put(const string&, DDS&) */
+void
+FunctionResultCache::put(const string &key, DMR &dmr)
+{
+    try {
+        if (cacheable(dmr)) {
+            string value;
+            write_value(dmr, value);
+            put(key, value);
+            return;
+        }
+    }
+    catch (Error &e) {
+        DBG(cerr << "Could not cache a function result: " << e.get_error_message() << endl);
+    }
+    catch (std::exception &e) {
+        DBG(cerr << "Could not cache a function result: " << e.what() << endl);
+    }
+
+    put_uncacheable(key);
+}
+
+/** @brief Remove all of the values.
+
+    Keys reserved by get() stay reserved. */
+void
+FunctionResultCache::clear()
+{
+    cache_lock lock(d_mutex);
+
+    while (!d_lru.empty())
+        m_erase(d_entries.find(*d_lru.back()));
+}
+
+/** @brief The number of bytes of keys and values in the cache */
+unsigned long long
+FunctionResultCache::size()
+{
+    cache_lock lock(d_mutex);
+    return d_size;
+}
+
+/** @brief The number of values in the cache, with the keys marked by
+    put_uncacheable() */
+unsigned long
+FunctionResultCache::entries()
+{
+    cache_lock lock(d_mutex);
+    return d_lru.size();
+}
+
+/** @brief The number of times get() found a value */
+unsigned long
+FunctionResultCache::hits()
+{
+    cache_lock lock(d_mutex);
+    return d_hits;
+}
+
+/** @brief The number of times get() reserved a key */
+unsigned long
+FunctionResultCache::misses()
+{
+    cache_lock lock(d_mutex);
+    return d_misses;
+}
+
+} // namespace libdap
@@ -0,0 +1,190 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _function_result_cache_h
+#define _function_result_cache_h 1
+
+#include <pthread.h>
+#include <ctime>
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace libdap
+{
+
+class DDS;
+class DMR;
+class CancelToken;
+
+/** @brief An in-memory cache of the results of server functions.
+
+    Clients often ask for the same function expression over and over, and
+    the functions can be much more expensive than sending their results.
+    ConstraintEvaluator::eval_function_clauses() and
+    D4FunctionEvaluator::eval() use a cache, when they are given one, to
+    keep the results they build. The key of a result is made from the
+    dataset, the time the dataset was last modified and the function
+    expression with the white space outside of quotes removed (see
+    make_key()), so a new version of a dataset does not match the results
+    of the old one.
+
+    A result is stored as its binary metadata (see BinaryMetadataWriter)
+    followed by its values in the DAP4 binary form written by
+    D4StreamMarshaller, without checksums. This is used for both DDSs and
+    DMRs; it holds a result in about the space of its values and is rebuilt
+    without running any of the functions again. Caching a result marks all
+    of its variables to be sent, as a server does before it sends one.
+    Results with Sequences or constrained Arrays are not cached.
+
+    The cache is MT-safe and one cache can be shared by the evaluators of
+    many threads. When several threads ask for the same key at the same
+    time, only the first evaluates the functions; the others wait for its
+    result (or, if it fails, for one of them to try again). A waiting
+    thread gives up when the CancelToken of its request is cancelled. A
+    result that cannot be cached is remembered as such, so the threads
+    that ask for it later evaluate the functions at once, side by side,
+    instead of taking turns. When the values held exceed the size of the
+    cache, the results used least recently are removed.
+
+    Values are shared using value_handle, so a value is not copied to be
+    read and it stays readable after it is removed from the cache.
+
+    The cache does not belong to the evaluators that use it. */
+class FunctionResultCache
+{
+public:
+    /** @brief A value shared with the cache.
+
+        Copying a handle does not copy its value. The value cannot be
+        changed, so the handles that share it may be used by different
+        threads. */
+    class value_handle {
+    private:
+        struct rep {
+            const std::string value;
+            unsigned long refs;
+
+            rep(const std::string &v) : value(v), refs(1) { }
+        };
+
+        rep *d_rep;
+
+        void m_acquire();
+        void m_release();
+
+    public:
+        value_handle() : d_rep(0) { }
+        explicit value_handle(const std::string &value) : d_rep(new rep(value)) { }
+        value_handle(const value_handle &rhs) : d_rep(rhs.d_rep) { m_acquire(); }
+        ~value_handle() { m_release(); }
+
+        value_handle &operator=(const value_handle &rhs);
+
+        /// True if the handle has no value
+        bool empty() const { return d_rep == 0; }
+
+        /// The value; empty if the handle has none
+        const std::string &value() const;
+
+        std::string::size_type size() const { return d_rep ? d_rep->value.size() : 0; }
+    };
+
+private:
+    enum entry_state {
+        building,       // A thread has reserved the key and is building the value
+        ready,
+        uncacheable     // The value cannot be cached; get() does not reserve the key
+    };
+
+    struct entry {
+        value_handle value;
+        entry_state state;
+        std::list<const std::string*>::iterator lru;
+
+        entry() : value(), state(building), lru() { }
+    };
+
+    typedef std::map<std::string, entry> entry_map;
+
+    entry_map d_entries;
+    std::list<const std::string*> d_lru;    // Most recently used first; not entries being built
+
+    unsigned long long d_max_size;
+    unsigned long long d_size;
+
+    unsigned long d_hits;
+    unsigned long d_misses;
+
+    pthread_mutex_t d_mutex;
+    pthread_cond_t d_cond;
+
+    void m_erase(entry_map::iterator i);
+    void m_evict();
+    void m_store(const std::string &key, const value_handle &value, entry_state state);
+    void m_wait(const CancelToken *token);
+
+    FunctionResultCache(const FunctionResultCache &);
+    FunctionResultCache &operator=(const FunctionResultCache &);
+
+public:
+    FunctionResultCache(unsigned long long max_size);
+    virtual ~FunctionResultCache();
+
+    static std::string normalize(const std::string &expr);
+    static std::string make_key(const std::string &dataset, time_t last_modified, const std::string &expr);
+
+    static bool cacheable(DDS &dds);
+    static bool cacheable(DMR &dmr);
+
+    static void write_value(DDS &dds, std::string &value);
+    static void write_value(DMR &dmr, std::string &value);
+    static void read_value(const std::string &value, DDS &dds);
+    static void read_value(const std::string &value, DMR &dmr);
+
+    virtual bool get(const std::string &key, value_handle &value, const CancelToken *token = 0);
+    virtual bool get(const std::string &key, std::string &value, const CancelToken *token = 0);
+    virtual void put(const std::string &key, const std::string &value);
+    virtual void put_uncacheable(const std::string &key);
+    virtual void abandon(const std::string &key);
+
+    virtual bool get(const std::string &key, DDS &dds, const CancelToken *token = 0);
+    virtual bool get(const std::string &key, DMR &dmr, const CancelToken *token = 0);
+    virtual void put(const std::string &key, DDS &dds);
+    virtual void put(const std::string &key, DMR &dmr);
+
+    virtual void clear();
+
+    /// The most bytes of keys and values the cache holds
+    unsigned long long max_size() const { return d_max_size; }
+
+    unsigned long long size();
+    unsigned long entries();
+    unsigned long hits();
+    unsigned long misses();
+};
+
+} // namespace libdap
+
+#endif // _function_result_cache_h
@@ -413,6 +413,7 @@ void Grid::set_array(Array* p_new_arr)
 		// clean out old array
 		delete get_array();
 		d_vars[0] = p_new_arr;
+		m_var_index_changed();
 	}
 
 	d_is_array_set = true;
@@ -807,9 +808,9 @@ Grid::print_decl(ostream &out, string space, bool print_semi,
 void
 Grid::print_xml(FILE *out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer(xml, constrained);
-    fwrite(xml.get_doc(), sizeof(char), xml.get_doc_size(), out);
+    xml.end_doc();
 }
 
 /**
@@ -818,9 +819,9 @@ Grid::print_xml(FILE *out, string space, bool constrained)
 void
 Grid::print_xml(ostream &out, string space, bool constrained)
 {
-    XMLWriter xml(space);
+    XMLWriter xml(out, space);
     print_xml_writer(xml, constrained);
-    out << xml.get_doc();
+    xml.end_doc();
 }
 
 
@@ -0,0 +1,177 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+
+#include <iostream>
+#include <map>
+
+#include "InternedString.h"
+
+using namespace std;
+
+namespace libdap {
+
+// The pool maps each string to the number of InternedStrings that use it.
+// The nodes of a map don't move, so an InternedString points at its
+// string's node. The pool is made the first time it is used and is never
+// deleted so that strings in static objects can be released safely at exit.
+typedef map<string, unsigned long> string_pool;
+
+static string_pool *pool = 0;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Read without the lock each time a string is made. An aligned int is
+// read and written whole; set_pooling() uses an atomic write.
+static volatile int pooling = 0;
+
+class pool_lock {
+public:
+    pool_lock() { pthread_mutex_lock(&pool_mutex); }
+    ~pool_lock() { pthread_mutex_unlock(&pool_mutex); }
+};
+
+InternedString::InternedString(const string &s) : d_pooled(0)
+{
+    if (pooling && !s.empty())
+        d_pooled = m_intern(s);
+    else
+        d_value = s;
+}
+
+// Find or add 's' in the pool and count one more reference to it
+InternedString::pool_entry *
+InternedString::m_intern(const string &s)
+{
+    pool_lock lock;
+    if (!pool)
+        pool = new string_pool;
+
+    string_pool::iterator i = pool->insert(make_pair(s, 0UL)).first;
+    __sync_add_and_fetch(&i->second, 1);
+    return &*i;
+}
+
+// The caller holds a reference to 'p', so its count is at least one and
+// the entry can't be removed while it is counted.
+void
+InternedString::m_acquire(pool_entry *p)
+{
+    __sync_add_and_fetch(&p->second, 1);
+}
+
+// Drop a reference without the lock unless it might be the last one. The
+// last reference is dropped with the lock held so that m_intern() can't
+// find the entry while it is being removed.
+void
+InternedString::m_release(pool_entry *p)
+{
+    for (;;) {
+        unsigned long count = p->second;
+        if (count <= 1)
+            break;
+        if (__sync_bool_compare_and_swap(&p->second, count, count - 1))
+            return;
+    }
+
+    pool_lock lock;
+    if (__sync_sub_and_fetch(&p->second, 1) == 0)
+        pool->erase(pool->find(p->first));
+}
+
+InternedString &
+InternedString::operator=(const InternedString &rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    d_value = rhs.d_value;
+
+    if (d_pooled != rhs.d_pooled) {
+        if (rhs.d_pooled)
+            m_acquire(rhs.d_pooled);
+        if (d_pooled)
+            m_release(d_pooled);
+        d_pooled = rhs.d_pooled;
+    }
+
+    return *this;
+}
+
+InternedString &
+InternedString::operator=(const string &s)
+{
+    // 's' may be this string's own value, so it is used before the old
+    // value is released
+    if (pooling && !s.empty()) {
+        pool_entry *p = m_intern(s);
+        if (d_pooled)
+            m_release(d_pooled);
+        d_pooled = p;
+        d_value.clear();
+    }
+    else {
+        d_value = s;
+        if (d_pooled)
+            m_release(d_pooled);
+        d_pooled = 0;
+    }
+
+    return *this;
+}
+
+/** @brief Turn the process-wide string pool on or off.
+
+    When the pool is on, strings made afterward share storage with equal
+    strings. Strings that already exist are not changed. */
+void
+InternedString::set_pooling(bool state)
+{
+    __sync_lock_test_and_set(&pooling, state ? 1 : 0);
+    __sync_synchronize();
+}
+
+/** @brief Is the string pool on? */
+bool
+InternedString::get_pooling()
+{
+    return pooling != 0;
+}
+
+/** @brief The number of distinct strings in the pool. */
+unsigned long
+InternedString::pool_size()
+{
+    pool_lock lock;
+    return pool ? pool->size() : 0;
+}
+
+ostream &
+operator<<(ostream &out, const InternedString &s)
+{
+    return out << s.str();
+}
+
+} // namespace libdap
@@ -0,0 +1,105 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _interned_string_h
+#define _interned_string_h 1
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+
+namespace libdap
+{
+
+/** @brief A string that can share its storage with every equal string.
+
+    BaseType uses this for the names of variables and datasets and
+    D4Attribute for the names of attributes. A process that holds many
+    DDSs or DMRs for the same kinds of datasets stores the same names over
+    and over; when pooling is turned on with set_pooling(true), each
+    distinct string is stored once in a process-wide pool and the objects
+    that use it hold a pointer to it. The pool counts the references to
+    each string and frees it when the last one is gone. The pool is
+    MT-safe; copying or destroying a pooled string only changes its count
+    and takes the pool's lock only to remove the last reference.
+
+    When pooling is off (the default) each InternedString holds its value
+    in a std::string, so it costs what a std::string costs and short names
+    use no heap at all. Turning pooling on or off affects only the strings
+    made after the change.
+
+    The value is read using str() or the conversion to a const std::string
+    reference, so most code that used a std::string can use this
+    unchanged. */
+class InternedString
+{
+private:
+    // A node of the pool: the string and the number of InternedStrings
+    // that use it
+    typedef std::pair<const std::string, unsigned long> pool_entry;
+
+    std::string d_value;    // The value when it is not pooled
+    pool_entry *d_pooled;   // ...and when it is
+
+    static pool_entry *m_intern(const std::string &s);
+    static void m_acquire(pool_entry *p);
+    static void m_release(pool_entry *p);
+
+public:
+    InternedString() : d_pooled(0) { }
+    InternedString(const std::string &s);
+    InternedString(const InternedString &rhs) : d_value(rhs.d_value), d_pooled(rhs.d_pooled)
+    {
+        if (d_pooled) m_acquire(d_pooled);
+    }
+    ~InternedString() { if (d_pooled) m_release(d_pooled); }
+
+    InternedString &operator=(const InternedString &rhs);
+    InternedString &operator=(const std::string &s);
+
+    const std::string &str() const { return d_pooled ? d_pooled->first : d_value; }
+    operator const std::string &() const { return str(); }
+
+    bool empty() const { return str().empty(); }
+
+    /// Is this string shared using the pool?
+    bool pooled() const { return d_pooled != 0; }
+
+    static void set_pooling(bool state);
+    static bool get_pooling();
+
+    static unsigned long pool_size();
+};
+
+inline bool operator==(const InternedString &lhs, const InternedString &rhs) { return lhs.str() == rhs.str(); }
+inline bool operator==(const InternedString &lhs, const std::string &rhs) { return lhs.str() == rhs; }
+inline bool operator==(const std::string &lhs, const InternedString &rhs) { return lhs == rhs.str(); }
+inline bool operator!=(const InternedString &lhs, const InternedString &rhs) { return !(lhs == rhs); }
+inline bool operator!=(const InternedString &lhs, const std::string &rhs) { return !(lhs == rhs); }
+inline bool operator!=(const std::string &lhs, const InternedString &rhs) { return !(lhs == rhs); }
+
+std::ostream &operator<<(std::ostream &out, const InternedString &s);
+
+} // namespace libdap
+
+#endif // _interned_string_h
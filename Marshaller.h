@@ -40,6 +40,7 @@
 #include "Type.h"
 #include "dods-datatypes.h"
 #include "InternalErr.h"
+#include "CancelToken.h"
 
 namespace libdap {
 
@@ -48,7 +49,32 @@ class Vector;
 /** @brief abstract base class used to marshal/serialize dap data objects
  */
 class Marshaller: public DapObj {
+private:
+    const CancelToken *d_cancel_token; // Weak pointer; may be null
+
 public:
+    Marshaller() : d_cancel_token(0) { }
+
+    /**
+     * Get/set the token that can stop serialization. The marshallers
+     * check it before each vector is written; the serialize() methods of
+     * Vector, Sequence and D4Sequence check it between elements and rows.
+     * The token is not deleted by the marshaller. Use null (the default)
+     * for no checks.
+     */
+    //@{
+    const CancelToken *cancel_token() const { return d_cancel_token; }
+    void set_cancel_token(const CancelToken *token) { d_cancel_token = token; }
+    //@}
+
+    /**
+     * Throw Error if the cancel token has been cancelled or its deadline
+     * has passed; do nothing if there is no token.
+     */
+    void check_cancel() const {
+        if (d_cancel_token) d_cancel_token->check();
+    }
+
     virtual void put_byte(dods_byte val) = 0;
 
     virtual void put_int16(dods_int16 val) = 0;
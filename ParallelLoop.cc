@@ -0,0 +1,160 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "ParallelLoop.h"
+#include "Error.h"
+#include "InternalErr.h"
+
+// #define DODS_DEBUG
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+/**
+ * @param body The body of the loop
+ * @param count The number of iterations
+ */
+ParallelLoop::ParallelLoop(Body &body, unsigned long count) :
+    d_body(body), d_count(count), d_next(0), d_error(0), d_internal(false)
+{
+    if (pthread_mutex_init(&d_mutex, 0) != 0)
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the parallel loop mutex.");
+}
+
+ParallelLoop::~ParallelLoop()
+{
+    pthread_mutex_destroy(&d_mutex);
+    delete d_error;
+}
+
+// Get the next iteration to run. Returns false when there are no more or
+// an iteration has failed.
+bool
+ParallelLoop::m_next(unsigned long &i)
+{
+    pthread_mutex_lock(&d_mutex);
+    bool more = !d_error && d_next < d_count;
+    if (more)
+        i = d_next++;
+    pthread_mutex_unlock(&d_mutex);
+
+    return more;
+}
+
+// Keep the first exception; later ones are dropped
+void
+ParallelLoop::m_record(const Error &e, bool internal)
+{
+    pthread_mutex_lock(&d_mutex);
+    if (!d_error) {
+        d_error = internal ? new InternalErr(static_cast<const InternalErr&>(e)) : new Error(e);
+        d_internal = internal;
+    }
+    pthread_mutex_unlock(&d_mutex);
+}
+
+void
+ParallelLoop::m_work()
+{
+    unsigned long i;
+    while (m_next(i)) {
+        try {
+            d_body.run(i);
+        }
+        catch (InternalErr &e) {
+            m_record(e, true);
+        }
+        catch (Error &e) {
+            m_record(e, false);
+        }
+        catch (std::exception &e) {
+            m_record(InternalErr(__FILE__, __LINE__, string("Parallel loop: ") + e.what()), true);
+        }
+        catch (...) {
+            m_record(InternalErr(__FILE__, __LINE__, "Parallel loop: unknown exception."), true);
+        }
+    }
+}
+
+void *
+ParallelLoop::m_worker(void *arg)
+{
+    static_cast<ParallelLoop*>(arg)->m_work();
+    return 0;
+}
+
+/**
+ * Run the loop. With one thread (or one iteration) the body is run in
+ * order, in the calling thread.
+ *
+ * @param threads The number of threads to use, counting the calling thread.
+ * If a thread cannot be started, the loop runs using the ones that were.
+ * @exception Error or InternalErr if an iteration throws
+ */
+void
+ParallelLoop::run(unsigned int threads)
+{
+    if (threads <= 1 || d_count <= 1) {
+        for (unsigned long i = 0; i < d_count; ++i)
+            d_body.run(i);
+        return;
+    }
+
+    if (threads > d_count)
+        threads = d_count;
+
+    vector<pthread_t> workers;
+    for (unsigned int t = 1; t < threads; ++t) {
+        pthread_t thread;
+        int status = pthread_create(&thread, 0, m_worker, this);
+        if (status != 0) {
+            DBG(cerr << "ParallelLoop::run() - Could not start a thread: " << strerror(status) << endl);
+            break;
+        }
+        workers.push_back(thread);
+    }
+
+    m_work();
+
+    for (vector<pthread_t>::iterator i = workers.begin(), e = workers.end(); i != e; ++i)
+        pthread_join(*i, 0);
+
+    if (d_error) {
+        if (d_internal)
+            throw InternalErr(*static_cast<InternalErr*>(d_error));
+        throw Error(*d_error);
+    }
+}
+
+} // namespace libdap
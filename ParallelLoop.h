@@ -0,0 +1,98 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _parallel_loop_h
+#define _parallel_loop_h 1
+
+#include <pthread.h>
+
+namespace libdap
+{
+
+class Error;
+
+/** @brief Run the iterations of a loop using several threads.
+
+    The body of the loop is a subclass of ParallelLoop::Body. Its run()
+    method is called once for each value from 0 to count - 1; the values
+    are handed out to the threads one at a time, so the order in which
+    they run is not fixed. Each iteration must be independent of the
+    others, and anything they share must be safe to use from more than
+    one thread.
+
+    The calling thread does some of the work and run() returns when every
+    iteration is done. If an iteration throws, no more iterations are
+    started and, once the running ones finish, the first exception is
+    thrown again by run(). An Error or InternalErr is rethrown as itself;
+    anything else becomes an InternalErr.
+
+    @code
+    class scale : public ParallelLoop::Body {
+        ...
+        void run(unsigned long i) { d_out[i] = d_in[i] * d_factor; }
+    };
+
+    scale body(in, out, 2.0);
+    ParallelLoop(body, in.size()).run(4);
+    @endcode */
+class ParallelLoop
+{
+public:
+    /// The body of the loop
+    class Body
+    {
+    public:
+        virtual ~Body() { }
+
+        /// Run iteration \e i of the loop
+        virtual void run(unsigned long i) = 0;
+    };
+
+private:
+    Body &d_body;
+    unsigned long d_count;
+
+    pthread_mutex_t d_mutex;
+    unsigned long d_next;   // next iteration to hand out
+    Error *d_error;         // the first exception thrown
+    bool d_internal;        // ...and was it an InternalErr?
+
+    ParallelLoop(const ParallelLoop &);
+    ParallelLoop &operator=(const ParallelLoop &);
+
+    bool m_next(unsigned long &i);
+    void m_work();
+    void m_record(const Error &e, bool internal);
+
+    static void *m_worker(void *arg);
+
+public:
+    ParallelLoop(Body &body, unsigned long count);
+    virtual ~ParallelLoop();
+
+    void run(unsigned int threads);
+};
+
+} // namespace libdap
+
+#endif // _parallel_loop_h
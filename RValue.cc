@@ -179,5 +179,21 @@ rvalue::bvalue(DDS &dds)
     }
 }
 
+/** Add the variables this rvalue uses, including those used by the
+    arguments of a function, to \e vars.
+
+    @param vars Value-result parameter */
+void
+rvalue::variables(std::vector<BaseType*> &vars) const
+{
+    if (d_value)
+        vars.push_back(d_value);
+
+    if (d_args) {
+        for (Args_citer i = d_args->begin(), e = d_args->end(); i != e; ++i)
+            (*i)->variables(vars);
+    }
+}
+
 } // namespace libdap
 
@@ -50,6 +50,8 @@ private:
     btp_func d_func;  // pointer to a function returning BaseType *
     std::vector<rvalue *> *d_args;  // arguments to the function
 
+    friend class SelectionProgram;
+
 public:
     typedef std::vector<rvalue *>::iterator Args_iter ;
     typedef std::vector<rvalue *>::const_iterator Args_citer ;
@@ -62,6 +64,8 @@ public:
     std::string value_name();
 
     BaseType *bvalue(DDS &dds);
+
+    void variables(std::vector<BaseType*> &vars) const;
 };
 
 // This type def must come after the class definition above. It is used in
@@ -0,0 +1,383 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+//#define DODS_DEBUG
+
+#include <algorithm>
+#include <typeinfo>
+
+#include "Byte.h"
+#include "Int8.h"
+#include "Int16.h"
+#include "UInt16.h"
+#include "Int32.h"
+#include "UInt32.h"
+#include "Int64.h"
+#include "UInt64.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Str.h"
+#include "Url.h"
+
+#include "DDS.h"
+#include "Clause.h"
+#include "SelectionProgram.h"
+
+#include "GNURegex.h"
+#include "Operators.h"
+#include "InternalErr.h"
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+typedef SelectionProgram::operand operand;
+
+// Map each of the scalar classes to its value type and to the field of
+// operand::d_num that holds its constants.
+template<class B> struct selection_traits;
+
+#define SELECTION_TRAITS(B, T, field) \
+template<> struct selection_traits<B> { \
+    typedef T value_type; \
+    static T constant(const operand &o) { return o.d_num.field; } \
+    static void set_constant(operand &o, BaseType *btp) { o.d_num.field = static_cast<B*>(btp)->value(); } \
+}
+
+SELECTION_TRAITS(Byte, dods_byte, d_byte);
+SELECTION_TRAITS(Int8, dods_int8, d_int8);
+SELECTION_TRAITS(Int16, dods_int16, d_int16);
+SELECTION_TRAITS(UInt16, dods_uint16, d_uint16);
+SELECTION_TRAITS(Int32, dods_int32, d_int32);
+SELECTION_TRAITS(UInt32, dods_uint32, d_uint32);
+SELECTION_TRAITS(Int64, dods_int64, d_int64);
+SELECTION_TRAITS(UInt64, dods_uint64, d_uint64);
+SELECTION_TRAITS(Float32, dods_float32, d_float32);
+SELECTION_TRAITS(Float64, dods_float64, d_float64);
+
+#undef SELECTION_TRAITS
+
+template<> struct selection_traits<Str> {
+    typedef string value_type;
+    static const string &constant(const operand &o) { return o.d_str; }
+    static void set_constant(operand &o, BaseType *btp) { o.d_str = static_cast<Str*>(btp)->value(); }
+};
+
+// The value of the left operand. The BaseType::ops() methods use the
+// variable's own d_buf, which is what the qualified call returns.
+template<class B>
+static inline typename selection_traits<B>::value_type lhs_value(const operand &o)
+{
+    if (!o.d_var)
+        return selection_traits<B>::constant(o);
+
+    if (!o.d_var->read_p() && !o.d_var->read())
+        throw InternalErr(__FILE__, __LINE__, "This value not read!");
+
+    return static_cast<B*>(o.d_var)->B::value();
+}
+
+// The value of a right operand. The BaseType::ops() methods use the virtual
+// value() accessor for their argument.
+template<class B>
+static inline typename selection_traits<B>::value_type rhs_value(const operand &o)
+{
+    if (!o.d_var)
+        return selection_traits<B>::constant(o);
+
+    if (!(o.d_var->read_p() || o.d_var->read()))
+        throw InternalErr(__FILE__, __LINE__, "Argument value was not read!");
+
+    return static_cast<B*>(o.d_var)->value();
+}
+
+template<class B1, class B2>
+static bool num_kernel(int op, const operand &lhs, const operand &rhs)
+{
+    return Cmp<typename selection_traits<B1>::value_type, typename selection_traits<B2>::value_type>(op,
+        lhs_value<B1>(lhs), rhs_value<B2>(rhs));
+}
+
+// Float32::ops() and Float64::ops() compare these two types as floats
+template<>
+bool num_kernel<Float32, Float64>(int op, const operand &lhs, const operand &rhs)
+{
+    return Cmp<dods_float32, dods_float32>(op, lhs_value<Float32>(lhs), (float) rhs_value<Float64>(rhs));
+}
+
+template<>
+bool num_kernel<Float64, Float32>(int op, const operand &lhs, const operand &rhs)
+{
+    return Cmp<dods_float32, dods_float32>(op, (float) lhs_value<Float64>(lhs), rhs_value<Float32>(rhs));
+}
+
+static bool str_kernel(int op, const operand &lhs, const operand &rhs)
+{
+    return StrCmp<string, string>(op, lhs_value<Str>(lhs), rhs_value<Str>(rhs));
+}
+
+template<class B1>
+static SelectionProgram::kernel pick_num_kernel(Type rhs)
+{
+    switch (rhs) {
+    case dods_byte_c: return &num_kernel<B1, Byte>;
+    case dods_int8_c: return &num_kernel<B1, Int8>;
+    case dods_int16_c: return &num_kernel<B1, Int16>;
+    case dods_uint16_c: return &num_kernel<B1, UInt16>;
+    case dods_int32_c: return &num_kernel<B1, Int32>;
+    case dods_uint32_c: return &num_kernel<B1, UInt32>;
+    case dods_int64_c: return &num_kernel<B1, Int64>;
+    case dods_uint64_c: return &num_kernel<B1, UInt64>;
+    case dods_float32_c: return &num_kernel<B1, Float32>;
+    case dods_float64_c: return &num_kernel<B1, Float64>;
+    default: return 0;
+    }
+}
+
+// Return the comparison kernel for a pair of operand types or null if the
+// pair cannot be compared (in which case ops() throws an Error).
+static SelectionProgram::kernel pick_kernel(Type lhs, Type rhs)
+{
+    switch (lhs) {
+    case dods_byte_c: return pick_num_kernel<Byte>(rhs);
+    case dods_int8_c: return pick_num_kernel<Int8>(rhs);
+    case dods_int16_c: return pick_num_kernel<Int16>(rhs);
+    case dods_uint16_c: return pick_num_kernel<UInt16>(rhs);
+    case dods_int32_c: return pick_num_kernel<Int32>(rhs);
+    case dods_uint32_c: return pick_num_kernel<UInt32>(rhs);
+    case dods_int64_c: return pick_num_kernel<Int64>(rhs);
+    case dods_uint64_c: return pick_num_kernel<UInt64>(rhs);
+    case dods_float32_c: return pick_num_kernel<Float32>(rhs);
+    case dods_float64_c: return pick_num_kernel<Float64>(rhs);
+    case dods_str_c:
+    case dods_url_c:
+        return (rhs == dods_str_c || rhs == dods_url_c) ? &str_kernel : 0;
+    default:
+        return 0;
+    }
+}
+
+// The kernels do what the built-in ops() methods do. A handler's subclass
+// may override ops(), so only compile a clause whose left operand, the
+// object whose ops() Clause::value() would call, is one of the built-in
+// classes.
+static bool builtin_ops(BaseType *btp)
+{
+    const type_info &t = typeid(*btp);
+
+    switch (btp->type()) {
+    case dods_byte_c: return t == typeid(Byte);
+    case dods_int8_c: return t == typeid(Int8);
+    case dods_int16_c: return t == typeid(Int16);
+    case dods_uint16_c: return t == typeid(UInt16);
+    case dods_int32_c: return t == typeid(Int32);
+    case dods_uint32_c: return t == typeid(UInt32);
+    case dods_int64_c: return t == typeid(Int64);
+    case dods_uint64_c: return t == typeid(UInt64);
+    case dods_float32_c: return t == typeid(Float32);
+    case dods_float64_c: return t == typeid(Float64);
+    case dods_str_c: return t == typeid(Str);
+    case dods_url_c: return t == typeid(Url);
+    default: return false;
+    }
+}
+
+// Fill in an operand from a BaseType. Constants (the BaseTypes the parser
+// made for literals in the CE) are copied into the operand so they are
+// never read again.
+static bool make_operand(operand &o, BaseType *btp, const vector<BaseType*> &constants)
+{
+    if (!btp || !btp->is_simple_type())
+        return false;
+
+    o.d_type = btp->type();
+
+    if (find(constants.begin(), constants.end(), btp) == constants.end()) {
+        o.d_var = btp;
+        return true;
+    }
+
+    // A constant should have a value; if not, let Clause::value() sort it out
+    if (!btp->read_p())
+        return false;
+
+    switch (o.d_type) {
+    case dods_byte_c: selection_traits<Byte>::set_constant(o, btp); break;
+    case dods_int8_c: selection_traits<Int8>::set_constant(o, btp); break;
+    case dods_int16_c: selection_traits<Int16>::set_constant(o, btp); break;
+    case dods_uint16_c: selection_traits<UInt16>::set_constant(o, btp); break;
+    case dods_int32_c: selection_traits<Int32>::set_constant(o, btp); break;
+    case dods_uint32_c: selection_traits<UInt32>::set_constant(o, btp); break;
+    case dods_int64_c: selection_traits<Int64>::set_constant(o, btp); break;
+    case dods_uint64_c: selection_traits<UInt64>::set_constant(o, btp); break;
+    case dods_float32_c: selection_traits<Float32>::set_constant(o, btp); break;
+    case dods_float64_c: selection_traits<Float64>::set_constant(o, btp); break;
+    case dods_str_c:
+    case dods_url_c: selection_traits<Str>::set_constant(o, btp); break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+/** Build the program for a list of clauses.
+
+    @param clauses The clauses of the selection; the program does not take
+    ownership of these.
+    @param constants The constants the parser made for this CE. Operands
+    found in this list are treated as constants. */
+SelectionProgram::SelectionProgram(const vector<Clause*> &clauses, const vector<BaseType*> &constants)
+{
+    d_program.resize(clauses.size());
+
+    try {
+        vector<instruction>::iterator inst = d_program.begin();
+        for (vector<Clause*>::const_iterator i = clauses.begin(), e = clauses.end(); i != e; ++i, ++inst) {
+            inst->d_clause = *i;
+            inst->d_boolean = (*i)->boolean_clause();
+            if (inst->d_boolean)
+                inst->d_compiled = m_compile(*inst, constants);
+
+            DBG(cerr << "SelectionProgram: clause " << (inst - d_program.begin())
+                << (inst->d_compiled ? " compiled" : " interpreted") << endl);
+        }
+    }
+    catch (...) {
+        // The destructor is not run if the constructor throws
+        m_delete_regexes();
+        throw;
+    }
+}
+
+SelectionProgram::~SelectionProgram()
+{
+    m_delete_regexes();
+}
+
+void SelectionProgram::m_delete_regexes()
+{
+    for (vector<instruction>::iterator i = d_program.begin(), e = d_program.end(); i != e; ++i) {
+        for (vector<Regex*>::iterator r = i->d_regexes.begin(), re = i->d_regexes.end(); r != re; ++r)
+            delete *r;
+        i->d_regexes.clear();
+    }
+}
+
+// Compile one relational clause. Return false if the clause must be
+// evaluated by Clause::value().
+bool SelectionProgram::m_compile(instruction &inst, const vector<BaseType*> &constants)
+{
+    Clause &clause = *inst.d_clause;
+
+    // Boolean functions and clauses whose operands are function calls are
+    // not compiled.
+    if (!clause._op || !clause._arg1 || !clause._args || clause._arg1->d_func)
+        return false;
+
+    inst.d_op = clause._op;
+
+    if (!make_operand(inst.d_lhs, clause._arg1->d_value, constants) || !builtin_ops(clause._arg1->d_value))
+        return false;
+
+    for (rvalue_list_iter i = clause._args->begin(), e = clause._args->end(); i != e; ++i) {
+        if ((*i)->d_func)
+            return false;
+
+        operand rhs;
+        if (!make_operand(rhs, (*i)->d_value, constants))
+            return false;
+
+        kernel k = pick_kernel(inst.d_lhs.d_type, rhs.d_type);
+        if (!k)
+            return false;
+
+        // Push the slot first so the Regex is never unowned
+        inst.d_rhs.push_back(rhs);
+        inst.d_kernels.push_back(k);
+        inst.d_regexes.push_back(0);
+        if (clause._op == SCAN_REGEXP && k == &str_kernel && !rhs.d_var) {
+            try {
+                inst.d_regexes.back() = new Regex(rhs.d_str.c_str());
+            }
+            catch (Error &) {
+                // A bad pattern; let Clause::value() report it when the
+                // clause is evaluated, as it would without the program.
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SelectionProgram::m_eval(instruction &inst, DDS &dds)
+{
+    if (!inst.d_compiled)
+        return inst.d_clause->value(dds);
+
+    // The list of rvalues is an implicit logical OR. See Clause::value().
+    for (unsigned int i = 0, e = inst.d_rhs.size(); i < e; ++i) {
+        if (inst.d_regexes[i]) {
+            string s = lhs_value<Str>(inst.d_lhs);
+            if (inst.d_regexes[i]->match(s.c_str(), s.length()) > 0)
+                return true;
+        }
+        else if ((*inst.d_kernels[i])(inst.d_op, inst.d_lhs, inst.d_rhs[i])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/** Evaluate the selection; the logical AND of the clauses.
+
+    @param dds Passed to clauses evaluated by Clause::value()
+    @return True if the current values satisfy the selection. */
+bool SelectionProgram::eval(DDS &dds)
+{
+    for (vector<instruction>::iterator i = d_program.begin(), e = d_program.end(); i != e; ++i) {
+        // A selection expression *must* contain only boolean clauses!
+        if (!i->d_boolean)
+            throw InternalErr(__FILE__, __LINE__, "A selection expression must contain only boolean clauses.");
+        if (!m_eval(*i, dds))
+            return false;
+    }
+
+    return true;
+}
+
+unsigned int SelectionProgram::compiled_clauses() const
+{
+    unsigned int n = 0;
+    for (vector<instruction>::const_iterator i = d_program.begin(), e = d_program.end(); i != e; ++i)
+        if (i->d_compiled) ++n;
+
+    return n;
+}
+
+} // namespace libdap
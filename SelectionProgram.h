@@ -0,0 +1,126 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _selection_program_h
+#define _selection_program_h
+
+#include <string>
+#include <vector>
+
+#include "dods-datatypes.h"
+#include "Type.h"
+
+namespace libdap
+{
+
+class BaseType;
+class DDS;
+class Regex;
+struct Clause;
+
+/** A DAP2 selection expression compiled for repeated evaluation.
+
+    ConstraintEvaluator::eval_selection() is called once for every row of
+    a Sequence. Evaluating the Clause objects directly means calling
+    rvalue::bvalue() and the virtual BaseType::ops() for every operand,
+    and ops() switches on the type of its argument and then on the
+    operator. This class does that work once: each relational clause whose
+    operands are scalar variables or constants is turned into a list of
+    operands and a comparison kernel picked for the pair of operand types.
+    Constants are converted to their native C++ type when the program is
+    built and regular expressions are compiled once.
+
+    Clauses that cannot be compiled (boolean functions, operands computed
+    by functions, non-scalar operands, incompatible types or a left operand
+    whose class is not one of the built-in classes, since a subclass may
+    override ops()) are evaluated
+    using Clause::value(), so the result, including any Error thrown, is
+    the same as evaluating the clause list directly.
+
+    The program holds pointers to the variables named in the clauses, so it
+    must be rebuilt if the clause list changes.
+
+    @see ConstraintEvaluator::eval_selection */
+class SelectionProgram
+{
+public:
+    /// The operand of a compiled comparison; either a variable or a constant.
+    struct operand {
+        BaseType *d_var;    // null for constants
+        Type d_type;
+        union {
+            dods_byte d_byte;
+            dods_int8 d_int8;
+            dods_int16 d_int16;
+            dods_uint16 d_uint16;
+            dods_int32 d_int32;
+            dods_uint32 d_uint32;
+            dods_int64 d_int64;
+            dods_uint64 d_uint64;
+            dods_float32 d_float32;
+            dods_float64 d_float64;
+        } d_num;
+        std::string d_str;
+
+        operand() : d_var(0), d_type(dods_null_c), d_str("") { d_num.d_uint64 = 0; }
+    };
+
+    typedef bool (*kernel)(int op, const operand &lhs, const operand &rhs);
+
+private:
+    struct instruction {
+        Clause *d_clause;               // Evaluate with Clause::value() if d_compiled is false
+        bool d_compiled;
+        bool d_boolean;                 // False for a btp_func clause; an error in a selection
+        int d_op;
+        operand d_lhs;
+        std::vector<operand> d_rhs;     // The clause is true if lhs op rhs[i] for any i
+        std::vector<kernel> d_kernels;  // One per rhs operand
+        std::vector<Regex*> d_regexes;  // One per rhs operand, non-null for constant patterns
+
+        instruction() : d_clause(0), d_compiled(false), d_boolean(true), d_op(0) { }
+    };
+
+    std::vector<instruction> d_program;
+
+    bool m_compile(instruction &inst, const std::vector<BaseType*> &constants);
+    bool m_eval(instruction &inst, DDS &dds);
+    void m_delete_regexes();
+
+    SelectionProgram(const SelectionProgram &);
+    SelectionProgram &operator=(const SelectionProgram &);
+
+public:
+    SelectionProgram(const std::vector<Clause*> &clauses, const std::vector<BaseType*> &constants);
+    virtual ~SelectionProgram();
+
+    bool eval(DDS &dds);
+
+    /// How many of the clauses were compiled; the rest use Clause::value()
+    unsigned int compiled_clauses() const;
+    unsigned int size() const { return d_program.size(); }
+};
+
+} // namespace libdap
+
+#endif // _selection_program_h
@@ -635,6 +635,7 @@ bool Sequence::serialize_parent_part_one(DDS &dds, ConstraintEvaluator &eval, Ma
     DBG2(cerr << "Sequence::serialize_parent_part_one::read_row() status: " << status << endl);
 
     while (status && !is_end_of_rows(i)) {
+        m.check_cancel();
         i += d_row_stride;
 
         // DBG(cerr << "Writing Start of Instance marker" << endl);
@@ -740,6 +741,7 @@ bool Sequence::serialize_leaf(DDS &dds, ConstraintEvaluator &eval, Marshaller &m
 
     d_wrote_soi = false;
     while (status && !is_end_of_rows(i)) {
+        m.check_cancel();
         i += d_row_stride;
 
         DBG(cerr << "Writing Start of Instance marker" << endl);
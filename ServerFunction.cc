@@ -37,7 +37,7 @@ using namespace std;
 
 namespace libdap {
 
-ServerFunction::ServerFunction() : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0)
+ServerFunction::ServerFunction() : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0), d_result_is_new(false)
 {
 	setName("abstract_function");
 	setDescriptionString("This function does nothing.");
@@ -47,7 +47,7 @@ ServerFunction::ServerFunction() : d_bool_func(0), d_btp_func(0), d_proj_func(0)
 }
 
 ServerFunction::ServerFunction(string name, string version, string description, string usage, string doc_url,
-		string role, bool_func f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0)
+		string role, bool_func f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0), d_result_is_new(false)
 {
 	setName(name);
 	setVersion(version);
@@ -59,7 +59,7 @@ ServerFunction::ServerFunction(string name, string version, string description,
 }
 
 ServerFunction::ServerFunction(string name, string version, string description, string usage, string doc_url,
-		string role, btp_func f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0)
+		string role, btp_func f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0), d_result_is_new(false)
 {
 	setName(name);
 	setVersion(version);
@@ -72,7 +72,7 @@ ServerFunction::ServerFunction(string name, string version, string description,
 }
 
 ServerFunction::ServerFunction(string name, string version, string description, string usage, string doc_url,
-		string role, proj_func f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0)
+		string role, proj_func f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0), d_result_is_new(false)
 {
 	setName(name);
 	setVersion(version);
@@ -84,7 +84,7 @@ ServerFunction::ServerFunction(string name, string version, string description,
 }
 
 ServerFunction::ServerFunction(string name, string version, string description, string usage, string doc_url,
-		string role, D4Function f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0)
+		string role, D4Function f) : d_bool_func(0), d_btp_func(0), d_proj_func(0), d_d4_function(0), d_result_is_new(false)
 {
 	setName(name);
 	setVersion(version);
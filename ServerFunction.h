@@ -39,6 +39,29 @@
 
 namespace libdap {
 
+/**
+ * A server function: its name, documentation and the C functions that
+ * implement it for DAP2 and DAP4.
+ *
+ * @note ConstraintEvaluator::eval_function_clauses() and
+ * D4FunctionEvaluator::eval() can evaluate several function calls at the
+ * same time when set_function_threads() has been given a value larger
+ * than one. Calls that use the same variable are always evaluated in
+ * order, one after the other, but calls that use different variables may
+ * run in different threads. A server should only turn that on when all of
+ * the functions it registers are MT-safe: they must not change global or
+ * static data, and the read() methods of the variables they read, along
+ * with anything those share (a file handle or a library that is not
+ * thread-safe), must work when read() is called for different variables
+ * of the same dataset at the same time.
+ *
+ * @note D4FunctionEvaluator::eval() copies the value a DAP4 function
+ * returns into the result DMR, because the value may belong to someone
+ * else: it could be an argument, a variable of the dataset or an object
+ * the function keeps. A function that always returns a new BaseType can
+ * say so with setResultIsNew(true); its values are then added to the
+ * result without being copied, and the result DMR deletes them.
+ */
 class ServerFunction {
 
 private:
@@ -56,6 +79,7 @@ private:
     proj_func d_proj_func;
 
     D4Function d_d4_function;
+    bool d_result_is_new;   // d_d4_function returns a new BaseType
 
 public:
     ServerFunction();
@@ -133,6 +157,18 @@ public:
 		d_d4_function = pf;
 	}
 
+	/**
+	 * Does the DAP4 function return a new BaseType each time it is
+	 * called? If so, its caller owns the value and can keep it without
+	 * making a copy. False by default.
+	 * @param state True if each call returns a new BaseType
+	 */
+	void setResultIsNew(bool state) {
+		d_result_is_new = state;
+	}
+
+	bool getResultIsNew() { return d_result_is_new; }
+
 	std::string getTypeString() {
 		if (d_bool_func) return "boolean";
 		if (d_btp_func) return "basetype";
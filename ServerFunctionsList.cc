@@ -32,6 +32,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <memory>
 
 //#define DODS_DEBUG
 
@@ -39,6 +40,7 @@
 #include "debug.h"
 
 #include "ServerFunctionsList.h"
+#include "InternalErr.h"
 
 using namespace std;
 using namespace libdap;
@@ -47,6 +49,26 @@ namespace libdap {
 
 static pthread_once_t ServerFunctionsList_instance_control = PTHREAD_ONCE_INIT;
 
+namespace {
+
+class list_lock {
+private:
+    pthread_mutex_t &d_mutex;
+
+public:
+    list_lock(pthread_mutex_t &mutex) : d_mutex(mutex)
+    {
+        pthread_mutex_lock(&d_mutex);
+    }
+
+    ~list_lock()
+    {
+        pthread_mutex_unlock(&d_mutex);
+    }
+};
+
+} // namespace
+
 ServerFunctionsList *ServerFunctionsList::d_instance = 0 ;
 
 /**
@@ -71,6 +93,15 @@ void ServerFunctionsList::delete_instance() {
     d_instance = 0;
 }
 
+ServerFunctionsList::ServerFunctionsList() :
+    d_func_list(), d_table(new function_table), d_old_tables(), d_old_table_count(0), d_readers(0)
+{
+    if (pthread_mutex_init(&d_mutex, 0) != 0) {
+        delete d_table;
+        throw InternalErr(__FILE__, __LINE__, "Could not initialize the server functions list mutex.");
+    }
+}
+
 /**
  * Private method insures that nobody can try to delete the singleton class.
  */
@@ -83,6 +114,12 @@ ServerFunctionsList::~ServerFunctionsList() {
         delete func;
     }
     d_func_list.clear();
+
+    delete d_table;
+    for (vector<function_table *>::iterator i = d_old_tables.begin(), e = d_old_tables.end(); i != e; ++i)
+        delete *i;
+
+    pthread_mutex_destroy(&d_mutex);
 }
 
 ServerFunctionsList * ServerFunctionsList::TheList() {
@@ -103,7 +140,79 @@ ServerFunctionsList * ServerFunctionsList::TheList() {
 void ServerFunctionsList::add_function(ServerFunction *func )
 {
     DBG(cerr << "ServerFunctionsList::add_function() - Adding ServerFunction " << func->getName() << endl);
+
+    list_lock lock(d_mutex);
+
+    // Readers may be using the current table, so copy it, add the function
+    // to the copy and then make the copy the current table.
+    auto_ptr<function_table> table(new function_table(*d_table));
+    (*table)[func->getName()].push_back(func);
+
     d_func_list.insert(std::make_pair(func->getName(),func));
+
+    d_old_tables.push_back(d_table);
+    __sync_add_and_fetch(&d_old_table_count, 1);
+
+    // The new table must be complete before other threads can see it.
+    __sync_synchronize();
+    d_table = table.release();
+    __sync_synchronize();
+
+    // A reader that starts now sees only the new table.
+    if (d_readers == 0)
+        m_delete_old_tables();
+}
+
+// The table used by find_function(); call m_release_table() when done with
+// it. The count of readers is raised before the table is read, so
+// m_delete_old_tables() does not delete a table that is in use. The
+// barrier implied by the increment pairs with the ones in add_function().
+const ServerFunctionsList::function_table *ServerFunctionsList::m_acquire_table() const
+{
+    __sync_add_and_fetch(&d_readers, 1);
+    return d_table;
+}
+
+// The last reader out deletes the tables replaced while it read. This waits
+// for the lock only when there are such tables, which happens only while
+// functions are being added.
+void ServerFunctionsList::m_release_table() const
+{
+    if (__sync_sub_and_fetch(&d_readers, 1) == 0 && d_old_table_count != 0) {
+        list_lock lock(d_mutex);
+        if (d_readers == 0)
+            m_delete_old_tables();
+    }
+}
+
+// Delete the tables that find_function() no longer uses. Call with the
+// mutex locked and only when no reader holds a table; readers that start
+// later read only the current table.
+void ServerFunctionsList::m_delete_old_tables() const
+{
+    for (vector<function_table *>::iterator i = d_old_tables.begin(), e = d_old_tables.end(); i != e; ++i)
+        delete *i;
+    d_old_tables.clear();
+    __sync_lock_test_and_set(&d_old_table_count, 0);
+}
+
+// Look for the first function named 'name' that has the kind returned by
+// 'get'. The kinds are read from the ServerFunction objects, so a function
+// changed since it was added is found as it is now.
+template<typename F>
+bool ServerFunctionsList::m_find(const string &name, F (ServerFunction::*get)(), F *f) const
+{
+    *f = 0;
+
+    const function_table *table = m_acquire_table();
+    function_table::const_iterator i = table->find(name);
+    if (i != table->end()) {
+        for (vector<ServerFunction *>::const_iterator j = i->second.begin(), e = i->second.end(); j != e && !*f; ++j)
+            *f = ((*j)->*get)();
+    }
+    m_release_table();
+
+    return *f != 0;
 }
 
 /**
@@ -112,14 +221,11 @@ void ServerFunctionsList::add_function(ServerFunction *func )
  * the boolean function held by the ServerFunction object extracted from the list.
  *
  * Method:
- * Looks through the list of ServerFunctions and compares each function's key value (which
- * would be the value of SurverFunction.getName()) with the value of the string parameter
- * 'name'. When they match then the returned value parameter is set to the value returned
- * by ServerFunction.get_btp_func(). If the ServerFunction _is not_  a instance of a boolean
- * function then the return value will be 0 (null) and the search for matching function will continue.
- * If the ServerFunction _is_ a boolean function then the returned value will be non-zero and
- * the search will return true (it found the thing) and the returned value parameter *f will have
- * it's value set to the boolean function.
+ * Looks for 'name' in the table made by add_function() and returns the value of
+ * ServerFunction.get_bool_func() for the first of the ServerFunctions with that
+ * name that has one; the functions with other names are not searched. If no
+ * boolean function has the name, *f is set to 0 (null).
+ * This takes no lock and may be called by many threads at once.
  *
  *  @brief Find a boolean function with a given name in the function list.
  *  @param name A string containing the name of the function to find.
@@ -128,19 +234,7 @@ void ServerFunctionsList::add_function(ServerFunction *func )
  */
 bool ServerFunctionsList::find_function(const std::string &name, bool_func *f) const
 {
-    if (d_func_list.empty())
-        return false;
-
-    std::pair <SFLCIter, SFLCIter> ret;
-    ret = d_func_list.equal_range(name);
-    for (SFLCIter it = ret.first; it != ret.second; ++it) {
-        if (name == it->first && (*f = it->second->get_bool_func())){
-            DBG(cerr << "ServerFunctionsList::find_function() - Found boolean function " << it->second->getName() << endl);
-            return true;
-        }
-    }
-
-    return false;
+    return m_find(name, &ServerFunction::get_bool_func, f);
 }
 
 /**
@@ -149,14 +243,11 @@ bool ServerFunctionsList::find_function(const std::string &name, bool_func *f) c
  * the BaseType function held by the ServerFunction object extracted from the list.
  *
  * Method:
- * Looks through the list of ServerFunctions and compares each function's key value (which
- * would be the value of SurverFunction.getName()) with the value of the string parameter
- * 'name'. When they match then the returned value parameter is set to the value returned
- * by ServerFunction.get_btp_func(). If the ServerFunction _is not_  a instance of a BaseType
- * function then the return value will be 0 (null) and the search for matching function will continue.
- * If the ServerFunction _is_ a BaseType function then the returned value will be non-zero and
- * the search will return true (it found the thing) and the returned value parameter *f will have
- * it's value set to the BaseType function.
+ * Looks for 'name' in the table made by add_function() and returns the value of
+ * ServerFunction.get_btp_func() for the first of the ServerFunctions with that
+ * name that has one; the functions with other names are not searched. If no
+ * BaseType function has the name, *f is set to 0 (null).
+ * This takes no lock and may be called by many threads at once.
  *
  *  @brief Find a BaseType function with a given name in the function list.
  *  @param name A string containing the name of the function to find.
@@ -165,20 +256,7 @@ bool ServerFunctionsList::find_function(const std::string &name, bool_func *f) c
  */
 bool ServerFunctionsList::find_function(const string &name, btp_func *f) const
 {
-    if (d_func_list.empty())
-        return false;
-    DBG(cerr << "ServerFunctionsList::find_function() - Looking for ServerFunction '" << name << "'" << endl);
-
-    std::pair <SFLCIter, SFLCIter> ret;
-    ret = d_func_list.equal_range(name);
-    for (SFLCIter it = ret.first; it != ret.second; ++it) {
-        if (name == it->first && (*f = it->second->get_btp_func())){
-            DBG(cerr << "ServerFunctionsList::find_function() - Found basetype function " << it->second->getName() << endl);
-            return true;
-        }
-    }
-
-    return false;
+    return m_find(name, &ServerFunction::get_btp_func, f);
 }
 
 /**
@@ -187,14 +265,11 @@ bool ServerFunctionsList::find_function(const string &name, btp_func *f) const
  * the projection function held by the ServerFunction object extracted from the list.
  *
  * Method:
- * Looks through the list of ServerFunctions and looks at each function's key value (which
- * would be the value of SurverFunction.getName() for each function). When a function has the same
- * key name as the value of the string parameter 'name', then the returned value parameter is set
- * the value returned by ServerFunction.get_proj_func(). If the ServerFunction _is not_  a projection
- * function then the return value will be 0 (null) and the search for matching function will continue.
- * If the ServerFunction _is_ a projection then the returned value will be non-zero and the search will
- * return true (it found the thing) and the returned value parameter *f will have it's value set
- * to the projection function.
+ * Looks for 'name' in the table made by add_function() and returns the value of
+ * ServerFunction.get_proj_func() for the first of the ServerFunctions with that
+ * name that has one; the functions with other names are not searched. If no
+ * projection function has the name, *f is set to 0 (null).
+ * This takes no lock and may be called by many threads at once.
  *
  *  @brief Find a projection function with a given name in the function list.
  *  @param name A string containing the name of the function to find.
@@ -203,19 +278,7 @@ bool ServerFunctionsList::find_function(const string &name, btp_func *f) const
  */
 bool ServerFunctionsList::find_function(const string &name, proj_func *f) const
 {
-    if (d_func_list.empty())
-        return false;
-
-    std::pair <SFLCIter, SFLCIter> ret;
-    ret = d_func_list.equal_range(name);
-    for (SFLCIter it = ret.first; it != ret.second; ++it) {
-        if (name == it->first && (*f = it->second->get_proj_func())){
-            DBG(cerr << "ServerFunctionsList::find_function() - Found projection function " << it->second->getName() << endl);
-           return true;
-        }
-    }
-
-    return false;
+    return m_find(name, &ServerFunction::get_proj_func, f);
 }
 
 /**
@@ -227,18 +290,36 @@ bool ServerFunctionsList::find_function(const string &name, proj_func *f) const
  */
 bool ServerFunctionsList::find_function(const string &name, D4Function *f) const
 {
-    if (d_func_list.empty())
-        return false;
-
-    std::pair <SFLCIter, SFLCIter> ret;
-    ret = d_func_list.equal_range(name);
-    for (SFLCIter it = ret.first; it != ret.second; ++it) {
-        if (name == it->first && (*f = it->second->get_d4_function())) {
-            return true;
+    bool result_is_new;
+    return find_function(name, f, &result_is_new);
+}
+
+/**
+ * Find a DAP4 function and whether it returns a new BaseType.
+ *
+ * @param name Look for this function name
+ * @param f Value-result parameter. NULL if the function is not found
+ * @param result_is_new Value-result parameter. True if the function
+ * returns a new BaseType that the caller owns; see
+ * ServerFunction::setResultIsNew()
+ * @return True if the function was found, otherwise false.
+ */
+bool ServerFunctionsList::find_function(const string &name, D4Function *f, bool *result_is_new) const
+{
+    *f = 0;
+    *result_is_new = false;
+
+    const function_table *table = m_acquire_table();
+    function_table::const_iterator i = table->find(name);
+    if (i != table->end()) {
+        for (vector<ServerFunction *>::const_iterator j = i->second.begin(), e = i->second.end(); j != e && !*f; ++j) {
+            *f = (*j)->get_d4_function();
+            *result_is_new = *f && (*j)->getResultIsNew();
         }
     }
+    m_release_table();
 
-    return false;
+    return *f != 0;
 }
 
 /** @brief Returns an iterator pointing to the first key pair in the ServerFunctionList. */
@@ -265,6 +346,8 @@ ServerFunction *ServerFunctionsList::getFunction(SFLIter it)
 }
 
 void ServerFunctionsList::getFunctionNames(vector<string> *names){
+    list_lock lock(d_mutex);
+
 	SFLIter fit;
     for(fit = d_func_list.begin(); fit != d_func_list.end(); fit++) {
         ServerFunction *func = fit->second;
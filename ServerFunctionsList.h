@@ -30,8 +30,11 @@
 #ifndef I_ServerFunctionsList_h
 #define I_ServerFunctionsList_h 1
 
+#include <pthread.h>
+
 #include <map>
 #include <string>
+#include <vector>
 
 #include <expr.h>
 #include <D4Function.h>
@@ -43,11 +46,39 @@ namespace libdap {
 class ServerFunctionsListUnitTest;
 class ConstraintEvaluator;
 
+/** @brief The server functions known to the constraint evaluators.
+
+    Modules add their functions when they are loaded; the constraint
+    evaluators look them up by name and kind while they parse. Lookups use
+    a table of the functions with each name, in the order they were added,
+    so find_function() searches only the functions that have the name. The
+    table holds the ServerFunction objects themselves, so a function
+    changed after it is added is found as it is now.
+
+    find_function() takes no lock, so the threads of a server can look up
+    functions at the same time without waiting for each other. A table is
+    never changed once find_function() can see it; add_function() makes a
+    new one and deletes the old ones as soon as no thread is reading them. */
 class ServerFunctionsList {
 private:
+    typedef std::map<std::string, std::vector<ServerFunction *> > function_table;
+
     static ServerFunctionsList * d_instance;
     std::multimap<std::string, ServerFunction *> d_func_list;
 
+    function_table *d_table;                            // The functions by name; see find_function()
+    mutable std::vector<function_table *> d_old_tables; // May still be used by find_function()
+    mutable volatile int d_old_table_count;             // The size of d_old_tables
+    mutable volatile int d_readers;                     // The calls of find_function() reading a table
+
+    mutable pthread_mutex_t d_mutex;                    // Held while functions are added
+
+    const function_table *m_acquire_table() const;
+    void m_release_table() const;
+    void m_delete_old_tables() const;
+
+    template<typename F> bool m_find(const std::string &name, F (ServerFunction::*get)(), F *f) const;
+
     static void initialize_instance();
     static void delete_instance();
 
@@ -56,7 +87,7 @@ private:
     friend class ServerFunctionsListUnitTest;
 
 protected:
-    ServerFunctionsList() {}
+    ServerFunctionsList();
 
 public:
     // Added typedefs to reduce clutter jhrg 3/12/14
@@ -71,6 +102,7 @@ public:
     virtual bool find_function(const std::string &name, btp_func  *f) const;
     virtual bool find_function(const std::string &name, proj_func *f) const;
     virtual bool find_function(const std::string &name, D4Function *f) const;
+    virtual bool find_function(const std::string &name, D4Function *f, bool *result_is_new) const;
 
     SFLIter begin();
     SFLIter end();
@@ -0,0 +1,129 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include "BaseType.h"
+#include "VarIndex.h"
+
+// #define DODS_DEBUG
+#include "debug.h"
+
+using namespace std;
+
+namespace libdap {
+
+// Vectors with fewer variables than this are searched without an index
+static const VarIndex::Vars::size_type index_threshold = 16;
+
+// Map the name of every variable to its position. Private.
+void
+VarIndex::m_build(const Vars &vars)
+{
+    DBG(cerr << "VarIndex::m_build: indexing " << vars.size() << " variables" << endl);
+
+    if (!d_table)
+        d_table = new table;
+
+    d_table->d_names.clear();
+    d_table->d_constructors.clear();
+    d_table->d_size = 0;
+
+    d_table->d_names.rehash(vars.size());
+    for (Vars::size_type i = 0; i < vars.size(); ++i) {
+        // insert() keeps the first position when a name is used twice
+        d_table->d_names.insert(make_pair(vars[i]->name(), i));
+        if (vars[i]->is_constructor_type())
+            d_table->d_constructors.push_back(i);
+    }
+
+    d_table->d_size = vars.size();
+}
+
+// Search the vector for 'name'. Private.
+VarIndex::Vars::size_type
+VarIndex::m_search(const Vars &vars, const string &name) const
+{
+    for (Vars::size_type i = 0; i < vars.size(); ++i) {
+        if (vars[i]->name() == name)
+            return i;
+    }
+
+    return vars.size();
+}
+
+/** Rebuild the index after variables were removed, replaced, inserted or
+    renamed, or drop it if the vector is now too small to need one.
+    @param vars The vector this index describes */
+void
+VarIndex::changed(const Vars &vars)
+{
+    if (vars.size() >= index_threshold)
+        m_build(vars);
+    else
+        clear();
+}
+
+/** Add the last variable in \e vars to the index. Call this after
+    appending a variable to the vector. The index is built when the
+    vector grows large enough to need one.
+    @param vars The vector this index describes */
+void
+VarIndex::added(const Vars &vars)
+{
+    if (!d_table || d_table->d_size + 1 != vars.size()) {
+        changed(vars);
+        return;
+    }
+
+    Vars::size_type i = vars.size() - 1;
+    d_table->d_names.insert(make_pair(vars[i]->name(), i));
+    if (vars[i]->is_constructor_type())
+        d_table->d_constructors.push_back(i);
+
+    d_table->d_size = vars.size();
+}
+
+/** Find the first variable named \e name.
+    @param vars The vector this index describes
+    @param name The name to look for
+    @return The position of the variable in \e vars or vars.size() if
+    there is no variable with that name. */
+VarIndex::Vars::size_type
+VarIndex::find(const Vars &vars, const string &name) const
+{
+    if (!indexed(vars))
+        return m_search(vars, name);
+
+    Names::const_iterator i = d_table->d_names.find(name);
+    if (i == d_table->d_names.end())
+        return vars.size();
+
+    // A variable was renamed or replaced without telling the index
+    if (vars[i->second]->name() != name)
+        return m_search(vars, name);
+
+    return i->second;
+}
+
+} // namespace libdap
@@ -0,0 +1,113 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _var_index_h
+#define _var_index_h 1
+
+#include <string>
+#include <vector>
+
+#if defined __cplusplus && 201103L <= __cplusplus
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
+
+namespace libdap
+{
+
+class BaseType;
+
+/** An index of the names in a vector of variables.
+
+    Constructor and DDS look up variables by name for every identifier in
+    a constraint expression and, when the name is not qualified, search
+    every constructor they hold as well. This class maps each name to the
+    position of the first variable with that name and records the
+    positions of the constructor variables, so a lookup is a hash probe
+    and a leaf search only needs to descend into the constructors that
+    come before the match. The names are hashed, not sorted, since the
+    index is only used to find a name (std::unordered_map when built with
+    CXX11_FLAG, std::tr1::unordered_map otherwise).
+
+    As in AttrTable, the owner keeps the index current: it calls added()
+    after it appends a variable and changed() after it removes, replaces,
+    inserts or renames one. Those build the index once the vector is large
+    enough to need one; smaller vectors have no index and are searched.
+    Lookups (find(), indexed() and constructors()) only read the index, so
+    several threads can search a shared DDS or DMR at once without a lock;
+    the variables must not be changed while they do. If the vector was
+    changed without telling the index, find() notices a size that does not
+    match or a name that does not match and searches the vector. */
+class VarIndex
+{
+public:
+    typedef std::vector<BaseType *> Vars;
+
+private:
+#if defined __cplusplus && 201103L <= __cplusplus
+    typedef std::unordered_map<std::string, Vars::size_type> Names;
+#else
+    typedef std::tr1::unordered_map<std::string, Vars::size_type> Names;
+#endif
+
+    struct table {
+        Names d_names;
+        std::vector<Vars::size_type> d_constructors;
+        Vars::size_type d_size;
+    };
+
+    table *d_table;     // Null if the vector is too small to need an index
+
+    void m_build(const Vars &vars);
+    Vars::size_type m_search(const Vars &vars, const std::string &name) const;
+
+public:
+    VarIndex() : d_table(0) {}
+    /// A copy starts empty; the owner calls changed() once it has copied its variables
+    VarIndex(const VarIndex &) : d_table(0) {}
+    ~VarIndex() { clear(); }
+
+    VarIndex &operator=(const VarIndex &) { clear(); return *this; }
+
+    /// Drop the index; lookups search the vector until changed() is called
+    void clear() { delete d_table; d_table = 0; }
+
+    void changed(const Vars &vars);
+    void added(const Vars &vars);
+
+    /** Is there an index of \e vars? If not, constructors() must not be
+        used; find() searches the vector.
+        @param vars The vector this index describes */
+    bool indexed(const Vars &vars) const { return d_table && d_table->d_size == vars.size(); }
+
+    Vars::size_type find(const Vars &vars, const std::string &name) const;
+
+    /** The positions of the constructor variables, in order. Use only when
+        indexed() is true. */
+    const std::vector<Vars::size_type> &constructors() const { return d_table->d_constructors; }
+};
+
+} // namespace libdap
+
+#endif // _var_index_h
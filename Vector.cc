@@ -702,8 +702,10 @@ bool Vector::serialize(ConstraintEvaluator & eval, DDS & dds, Marshaller &m, boo
 
             m.put_int(num);
 
-            for (int i = 0; i < num; ++i)
+            for (int i = 0; i < num; ++i) {
+                m.check_cancel();
                 m.put_str(d_str[i]);
+            }
 
             status = true;
             break;
@@ -719,8 +721,10 @@ bool Vector::serialize(ConstraintEvaluator & eval, DDS & dds, Marshaller &m, boo
 
             m.put_int(num);
             status = true;
-            for (int i = 0; i < num && status; ++i)
+            for (int i = 0; i < num && status; ++i) {
+                m.check_cancel();
                 status = status && d_compound_buf[i]->serialize(eval, dds, m, false);
+            }
 
             break;
 
@@ -997,8 +1001,10 @@ Vector::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter /*= false*/)
         case dods_url_c:
             assert((int64_t)d_str.capacity() >= num);
 
-            for (int64_t i = 0; i < num; ++i)
+            for (int64_t i = 0; i < num; ++i) {
+                m.check_cancel();
                 m.put_str(d_str[i]);
+            }
 
             break;
 
@@ -1011,6 +1017,7 @@ Vector::serialize(D4StreamMarshaller &m, DMR &dmr, bool filter /*= false*/)
             assert(d_compound_buf.capacity() >= 0);
 
             for (int64_t i = 0; i < num; ++i) {
+                m.check_cancel();
                 DBG(cerr << __func__ << "d_compound_buf[" << i << "] " << d_compound_buf[i] << endl);
                 d_compound_buf[i]->serialize(m, dmr, filter);
             }
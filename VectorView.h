@@ -0,0 +1,189 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#ifndef _vector_view_h
+#define _vector_view_h 1
+
+#include <algorithm>
+#include <string>
+#include <typeinfo>
+
+#include "Vector.h"
+#include "D4Enum.h"
+#include "InternalErr.h"
+
+namespace libdap
+{
+
+/** @brief A typed view of the values held by a Vector or of a plain C array.
+
+    A VectorView points at values that something else owns; making one
+    does not copy them and it must not outlive the storage it points at.
+    The values can be read with operator[], which skips over 'stride'
+    elements between values, so a view can also describe a column or a
+    hyperslab row of a larger array.
+
+    A view made from a Vector (or Array) uses the Vector's own buffer, so
+    the Vector must already hold its values and the type T must be the
+    C++ type of its elements (e.g., dods_int16 for an Array of Int16). Use
+    a view of 'const T' to read the values and a view of 'T' to change
+    them. Views of the cardinal types only; Str, Url and the constructor
+    types are not held in a single buffer.
+
+    @see convert_values() */
+template<typename T>
+class VectorView
+{
+private:
+    T *d_data;
+    unsigned long d_size;
+    unsigned long d_stride;
+
+    // Is T the C++ type used for values of the DAP type 't'?
+    static bool m_type_matches(Type t)
+    {
+        switch (t) {
+        case dods_byte_c:
+        case dods_char_c:
+        case dods_uint8_c:
+            return typeid(T) == typeid(dods_byte);
+        case dods_int8_c:
+            return typeid(T) == typeid(dods_int8);
+        case dods_int16_c:
+            return typeid(T) == typeid(dods_int16);
+        case dods_uint16_c:
+            return typeid(T) == typeid(dods_uint16);
+        case dods_int32_c:
+            return typeid(T) == typeid(dods_int32);
+        case dods_uint32_c:
+            return typeid(T) == typeid(dods_uint32);
+        case dods_int64_c:
+            return typeid(T) == typeid(dods_int64);
+        case dods_uint64_c:
+            return typeid(T) == typeid(dods_uint64);
+        case dods_float32_c:
+            return typeid(T) == typeid(dods_float32);
+        case dods_float64_c:
+            return typeid(T) == typeid(dods_float64);
+        default:
+            return false;
+        }
+    }
+
+public:
+    /// An empty view
+    VectorView() : d_data(0), d_size(0), d_stride(1) { }
+
+    /** @brief A view of 'size' values, starting at 'data'
+
+        @param data The first value
+        @param size The number of values in the view
+        @param stride The distance between the values, in elements */
+    VectorView(T *data, unsigned long size, unsigned long stride = 1) : d_data(data), d_size(size), d_stride(stride)
+    {
+        if (!d_data && d_size > 0)
+            throw InternalErr(__FILE__, __LINE__, "A view of values must point at some values.");
+        if (d_stride == 0)
+            throw InternalErr(__FILE__, __LINE__, "The stride of a view must be at least one.");
+    }
+
+    /** @brief A view of the values held by a Vector
+
+        @param v The Vector; it must hold values of type T.
+        @exception InternalErr if the elements of v are not of type T or if
+        v does not hold its values. */
+    explicit VectorView(Vector &v) : d_data(0), d_size(v.length() > 0 ? v.length() : 0), d_stride(1)
+    {
+        Type t = v.var()->type();
+        if (t == dods_enum_c)
+            t = static_cast<D4Enum*>(v.var())->element_type();
+
+        if (!m_type_matches(t))
+            throw InternalErr(__FILE__, __LINE__, std::string("The values of '") + v.name() + "' are not of the type requested.");
+
+        if (d_size > v.get_value_capacity() || (!v.get_buf() && d_size > 0))
+            throw InternalErr(__FILE__, __LINE__, std::string("The variable '") + v.name() + "' does not hold its values.");
+
+        d_data = reinterpret_cast<T*>(v.get_buf());
+    }
+
+    /// The first value of the view
+    T *data() const { return d_data; }
+
+    /// The number of values in the view
+    unsigned long size() const { return d_size; }
+
+    /// The distance between the values, in elements
+    unsigned long stride() const { return d_stride; }
+
+    bool empty() const { return d_size == 0; }
+
+    /// Are the values next to one another in memory?
+    bool contiguous() const { return d_stride == 1 || d_size < 2; }
+
+    /// The i-th value of the view; i is not checked
+    T &operator[](unsigned long i) const { return d_data[i * d_stride]; }
+
+    /** @brief A view of some of the values of this view
+
+        @param start The index, in this view, of the first value
+        @param count The number of values
+        @param stride Use every stride-th value of this view
+        @exception InternalErr if the values are not all in this view. */
+    VectorView slice(unsigned long start, unsigned long count, unsigned long stride = 1) const
+    {
+        if (stride == 0 || (count > 0 && (start >= d_size || (count - 1) * stride >= d_size - start)))
+            throw InternalErr(__FILE__, __LINE__, "A slice of a view must lie within the view.");
+
+        return VectorView(count > 0 ? d_data + start * d_stride : 0, count, d_stride * stride);
+    }
+};
+
+/** @brief Copy the values of one view to another, converting their type.
+
+    The values are converted as a C++ assignment would convert them. When
+    both views are contiguous this is a simple loop over the two arrays
+    that the compiler can vectorize, or a memmove() when the types are the
+    same.
+
+    @param src Read these values
+    @param dest Write them here
+    @exception InternalErr if the views are not the same size. */
+template<typename T, typename U>
+void convert_values(const VectorView<T> &src, const VectorView<U> &dest)
+{
+    if (src.size() != dest.size())
+        throw InternalErr(__FILE__, __LINE__, "The source and destination views are not the same size.");
+
+    if (src.contiguous() && dest.contiguous()) {
+        std::copy(src.data(), src.data() + src.size(), dest.data());
+    }
+    else {
+        for (unsigned long i = 0, e = src.size(); i < e; ++i)
+            dest[i] = src[i];
+    }
+}
+
+} // namespace libdap
+
+#endif // _vector_view_h
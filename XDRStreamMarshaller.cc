@@ -65,7 +65,6 @@ using namespace std;
 
 namespace libdap {
 
-char *XDRStreamMarshaller::d_buf = 0;
 static const int XDR_DAP_BUFF_SIZE=256;
 
 
@@ -78,9 +77,9 @@ static const int XDR_DAP_BUFF_SIZE=256;
  * @param write_data If true, write data values. True by default
  */
 XDRStreamMarshaller::XDRStreamMarshaller(ostream &out) :
-    d_out(out), d_partial_put_byte_count(0), tm(0)
+    d_buf(0), d_out(out), d_partial_put_byte_count(0), tm(0)
 {
-    if (!d_buf) d_buf = (char *) malloc(XDR_DAP_BUFF_SIZE);
+    d_buf = (char *) malloc(XDR_DAP_BUFF_SIZE);
     if (!d_buf) throw Error(internal_error, "Failed to allocate memory for data serialization.");
 
     xdrmem_create(&d_sink, d_buf, XDR_DAP_BUFF_SIZE, XDR_ENCODE);
@@ -98,6 +97,7 @@ XDRStreamMarshaller::~XDRStreamMarshaller()
     delete tm;
 #endif
     xdr_destroy(&d_sink);
+    free(d_buf);
 }
 
 void XDRStreamMarshaller::put_byte(dods_byte val)
@@ -358,6 +358,8 @@ void XDRStreamMarshaller::put_vector(char *val, int num, int width, Vector &vec)
  */
 void XDRStreamMarshaller::put_vector_start(int num)
 {
+    check_cancel();
+
     put_int(num);
     put_int(num);
 
@@ -394,6 +396,8 @@ void XDRStreamMarshaller::put_vector_end()
 // Start of parallel I/O support. jhrg 8/19/15
 void XDRStreamMarshaller::put_vector(char *val, int num, Vector &)
 {
+    check_cancel();
+
     if (!val) throw InternalErr(__FILE__, __LINE__, "Could not send byte vector data. Buffer pointer is not set.");
 
     // write the number of members of the array being written and then set the position to 0
@@ -450,6 +454,8 @@ void XDRStreamMarshaller::put_vector(char *val, int num, Vector &)
  */
 void XDRStreamMarshaller::put_vector(char *val, unsigned int num, int width, Type type)
 {
+    check_cancel();
+
     assert(val || num == 0);
 
     // write the number of array members being written, then set the position back to 0
@@ -516,6 +522,8 @@ void XDRStreamMarshaller::put_vector(char *val, unsigned int num, int width, Typ
  */
 void XDRStreamMarshaller::put_vector_part(char *val, unsigned int num, int width, Type type)
 {
+    check_cancel();
+
     if (width == 1) {
         // Add space for the 4 bytes of length info and 4 bytes for padding, even though
         // we will not send either of those.
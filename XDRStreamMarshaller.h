@@ -53,7 +53,7 @@ class MarshallerThread;
  */
 class XDRStreamMarshaller: public Marshaller {
 private:
-    static char * d_buf;
+    char *d_buf;        // XDR encodes into this; one per instance
     XDR d_sink;
     ostream & d_out;
 
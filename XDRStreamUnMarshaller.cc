@@ -48,13 +48,10 @@
 
 namespace libdap {
 
-char *XDRStreamUnMarshaller::d_buf = 0;
-
 XDRStreamUnMarshaller::XDRStreamUnMarshaller(istream &in) : /*&d_source( 0 ),*/
-        d_in(in)
+        d_in(in), d_buf(0)
 {
-    if (!d_buf)
-        d_buf = (char *) malloc(XDR_DAP_BUFF_SIZE);
+    d_buf = (char *) malloc(XDR_DAP_BUFF_SIZE);
     if (!d_buf)
         throw Error(internal_error, "Failed to allocate memory for data serialization.");
 
@@ -63,13 +60,13 @@ XDRStreamUnMarshaller::XDRStreamUnMarshaller(istream &in) : /*&d_source( 0 ),*/
 }
 
 XDRStreamUnMarshaller::XDRStreamUnMarshaller() :
-        UnMarshaller(), /*&d_source( 0 ),*/d_in(cin)
+        UnMarshaller(), /*&d_source( 0 ),*/d_in(cin), d_buf(0)
 {
     throw InternalErr(__FILE__, __LINE__, "Default constructor not implemented.");
 }
 
 XDRStreamUnMarshaller::XDRStreamUnMarshaller(const XDRStreamUnMarshaller &um) :
-        UnMarshaller(um), /*&d_source( 0 ),*/d_in(cin)
+        UnMarshaller(um), /*&d_source( 0 ),*/d_in(cin), d_buf(0)
 {
     throw InternalErr(__FILE__, __LINE__, "Copy constructor not implemented.");
 }
@@ -84,6 +81,7 @@ XDRStreamUnMarshaller::~XDRStreamUnMarshaller()
 {
     xdr_destroy( &d_source );
     //&d_source = 0;
+    free(d_buf);
 }
 
 void XDRStreamUnMarshaller::get_byte(dods_byte &val)
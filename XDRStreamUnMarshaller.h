@@ -54,7 +54,7 @@ class XDRStreamUnMarshaller : public UnMarshaller
 private:
     XDR 			d_source ;
     istream &		d_in;
-    static char *	d_buf;
+    char *		d_buf;		// XDR decodes from this; one per instance
 
     				XDRStreamUnMarshaller() ;
     				XDRStreamUnMarshaller( const XDRStreamUnMarshaller &um ) ;
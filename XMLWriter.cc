@@ -38,11 +38,31 @@
 
 // TODO - Bite the bullet and make the encoding UTF-8 as required by dap4. This will break a lot of tests but the baselines could be amended using  a bash script and sed.
 const char *ENCODING = "ISO-8859-1";
-const int XML_BUF_SIZE = 2000000;
+// The initial size of the memory buffer; it doubles as needed.
+const int XML_BUF_SIZE = 65536;
 
 using namespace libdap;
 
-XMLWriter::XMLWriter(const string &pad) {
+// xmlOutputBuffer callback for XMLWriters that write to an ostream
+static int
+ostream_write(void *context, const char *buffer, int len)
+{
+    ostream *out = static_cast<ostream*>(context);
+    out->write(buffer, len);
+    return out->good() ? len : -1;
+}
+
+// xmlOutputBuffer callback for XMLWriters that write to a FILE
+static int
+file_write(void *context, const char *buffer, int len)
+{
+    FILE *out = static_cast<FILE*>(context);
+    return (fwrite(buffer, 1, len, out) == (size_t)len) ? len : -1;
+}
+
+/** Build the XML document in memory. Use get_doc() to get the result.
+    @param pad Indent child elements using this string. */
+XMLWriter::XMLWriter(const string &pad) : d_writer(0), d_doc_buf(0), d_started(false), d_ended(false) {
     // LEAK The LIBXML_TEST_VERSION macro leaks 40 bytes according to valgrind
     // on centos7. jhrg 6/19/19
     // LIBXML_TEST_VERSION;
@@ -60,26 +80,87 @@ XMLWriter::XMLWriter(const string &pad) {
         if (!(d_writer = xmlNewTextWriterMemory(d_doc_buf, 0)))
             throw InternalErr(__FILE__, __LINE__, "Error allocating memory for xml writer");
 
-        if (xmlTextWriterSetIndent(d_writer, pad.length()) < 0)
-            throw InternalErr(__FILE__, __LINE__, "Error starting indentation for response document ");
+        m_start(pad);
+    }
+    catch (InternalErr &e) {
+        m_cleanup();
+        throw;
+    }
+}
+
+/** Write the XML document to \c out as it is built. The stream must stay
+    open until end_doc() is called or this writer is deleted.
+    @param out Write to this stream
+    @param pad Indent child elements using this string. */
+XMLWriter::XMLWriter(ostream &out, const string &pad) : d_writer(0), d_doc_buf(0), d_started(false), d_ended(false) {
+    try {
+        xmlOutputBufferPtr buf = xmlOutputBufferCreateIO(ostream_write, 0, &out, 0);
+        if (!buf)
+            throw InternalErr(__FILE__, __LINE__, "Error allocating the xml output buffer");
+
+        // The writer owns buf from here on, even if this fails
+        if (!(d_writer = xmlNewTextWriter(buf)))
+            throw InternalErr(__FILE__, __LINE__, "Error allocating memory for xml writer");
+
+        m_start(pad);
+    }
+    catch (InternalErr &e) {
+        m_cleanup();
+        throw;
+    }
+}
 
-        if (xmlTextWriterSetIndentString(d_writer, (const xmlChar*)pad.c_str()) < 0)
-            throw InternalErr(__FILE__, __LINE__, "Error setting indentation for response document ");
+/** Write the XML document to \c out as it is built. The caller closes \c out.
+    @param out Write to this FILE
+    @param pad Indent child elements using this string. */
+XMLWriter::XMLWriter(FILE *out, const string &pad) : d_writer(0), d_doc_buf(0), d_started(false), d_ended(false) {
+    try {
+        xmlOutputBufferPtr buf = xmlOutputBufferCreateIO(file_write, 0, out, 0);
+        if (!buf)
+            throw InternalErr(__FILE__, __LINE__, "Error allocating the xml output buffer");
 
-        d_started = true;
-        d_ended = false;
+        if (!(d_writer = xmlNewTextWriter(buf)))
+            throw InternalErr(__FILE__, __LINE__, "Error allocating memory for xml writer");
 
-        /* Start the document with the xml default for the version,
-         * encoding ISO 8859-1 and the default for the standalone
-         * declaration. MY_ENCODING defined at top of this file*/
-        if (xmlTextWriterStartDocument(d_writer, NULL, ENCODING, NULL) < 0)
-            throw InternalErr(__FILE__, __LINE__, "Error starting xml response document");
+        m_start(pad);
     }
     catch (InternalErr &e) {
         m_cleanup();
         throw;
     }
+}
 
+void XMLWriter::m_start(const string &pad) {
+    if (xmlTextWriterSetIndent(d_writer, pad.length()) < 0)
+        throw InternalErr(__FILE__, __LINE__, "Error starting indentation for response document ");
+
+    if (xmlTextWriterSetIndentString(d_writer, (const xmlChar*)pad.c_str()) < 0)
+        throw InternalErr(__FILE__, __LINE__, "Error setting indentation for response document ");
+
+    d_started = true;
+    d_ended = false;
+
+    /* Start the document with the xml default for the version,
+     * encoding ISO 8859-1 and the default for the standalone
+     * declaration. MY_ENCODING defined at top of this file*/
+    if (xmlTextWriterStartDocument(d_writer, NULL, ENCODING, NULL) < 0)
+        throw InternalErr(__FILE__, __LINE__, "Error starting xml response document");
+}
+
+// Close any open elements and free the writer, which flushes whatever it
+// still holds to the memory buffer or the stream.
+void XMLWriter::m_end() {
+    if (d_writer && d_started) {
+        if (xmlTextWriterEndDocument(d_writer) < 0)
+            throw InternalErr(__FILE__, __LINE__, "Error ending the document");
+
+        d_ended = true;
+
+        // must call this before getting the buffer content. Odd, but appears to be true.
+        // jhrg
+        xmlFreeTextWriter(d_writer);
+        d_writer = 0;
+    }
 }
 
 XMLWriter::~XMLWriter() {
@@ -105,17 +186,10 @@ void XMLWriter::m_cleanup() {
 }
 
 const char *XMLWriter::get_doc() {
-    if (d_writer && d_started) {
-        if (xmlTextWriterEndDocument(d_writer) < 0)
-            throw InternalErr(__FILE__, __LINE__, "Error ending the document");
+    if (is_streaming())
+        throw InternalErr(__FILE__, __LINE__, "The response document was written to a stream");
 
-        d_ended = true;
-
-        // must call this before getting the buffer content. Odd, but appears to be true.
-        // jhrg
-        xmlFreeTextWriter(d_writer);
-        d_writer = 0;
-    }
+    m_end();
 
     if (!d_doc_buf->content)
         throw InternalErr(__FILE__, __LINE__, "Error retrieving response document as string");
@@ -124,17 +198,10 @@ const char *XMLWriter::get_doc() {
 }
 
 unsigned int XMLWriter::get_doc_size() {
-    if (d_writer && d_started) {
-        if (xmlTextWriterEndDocument(d_writer) < 0)
-            throw InternalErr(__FILE__, __LINE__, "Error ending the document");
+    if (is_streaming())
+        throw InternalErr(__FILE__, __LINE__, "The response document was written to a stream");
 
-        d_ended = true;
-
-        // must call this before getting the buffer content. Odd, but appears to be true.
-        // jhrg
-        xmlFreeTextWriter(d_writer);
-        d_writer = 0;
-    }
+    m_end();
 
     if (!d_doc_buf->content)
         throw InternalErr(__FILE__, __LINE__, "Error retrieving response document as string");
@@ -142,3 +209,11 @@ unsigned int XMLWriter::get_doc_size() {
     // how much of the buffer is in use?
     return d_doc_buf->use;
 }
+
+/** Finish the document: close any elements that are still open and write
+    everything that remains to the stream. Once this is called, nothing more
+    can be added to the document. For a writer that builds the document in
+    memory, this is the same as calling get_doc() and ignoring the result. */
+void XMLWriter::end_doc() {
+    m_end();
+}
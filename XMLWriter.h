@@ -32,10 +32,20 @@
 
 #include <libxml/xmlwriter.h>
 
+#include <cstdio>
+#include <iostream>
 #include <string>
 
 namespace libdap {
 
+/** Build an XML document using libxml2's xmlTextWriter.
+
+    By default the document is built in memory and retrieved with get_doc()
+    once it is complete. A writer made with an ostream or a FILE pointer
+    instead sends the document to that destination as it is written, using
+    a small fixed-size buffer, so the size of the document does not matter.
+    For those, call end_doc() once the document is complete; get_doc() and
+    get_doc_size() are errors. */
 class XMLWriter {
 private:
     // Various xml writer stuff
@@ -46,15 +56,24 @@ private:
 
     std::string d_doc;
 
+    void m_start(const std::string &pad);
+    void m_end();
     void m_cleanup() ;
 
 public:
     XMLWriter(const std::string &pad = "    ");
+    XMLWriter(std::ostream &out, const std::string &pad = "    ");
+    XMLWriter(FILE *out, const std::string &pad = "    ");
     virtual ~XMLWriter();
 
     xmlTextWriterPtr get_writer() const { return d_writer; }
     const char *get_doc();
     unsigned int get_doc_size();
+
+    void end_doc();
+
+    /// True if this writer sends the document to a stream as it's written
+    bool is_streaming() const { return d_doc_buf == 0; }
 };
 
 } // namespace libdap
@@ -92,8 +92,6 @@ using namespace libdap ;
 
 #define YYERROR_VERBOSE 0
 
-int ce_exprlex(void);           /* the scanner; see expr.lex */
-
 // NB: never pass a variable name or other string from the CE to these functions.
 // Only string literals are allowed. This is to prevent information in the CE that
 // could be an attack from being transferred to the error response and then
@@ -147,7 +145,9 @@ rvalue *build_constant_array(vector<t> *values, DDS *dds);
 %require "2.4"
 
 %parse-param {ce_parser_arg *arg}
+%lex-param {ce_parser_arg *arg}
 %define api.prefix {ce_expr}
+%define api.pure full
 // %name-prefix "ce_expr"
 %defines
 %debug
@@ -243,9 +243,8 @@ rvalue *build_constant_array(vector<t> *values, DDS *dds);
 %type <float64_values> fast_float64_arg_list
 
 %code {
-/* This global is used by the rule 'arg_length_hint' so that the hint can
-   be used during the parent rule's parse. See fast_int32_arg_list. */
-unsigned long arg_length_hint_value = 0;
+int ce_exprlex(YYSTYPE *lvalp, void *scanner);    /* the scanner; see ce_expr.lex */
+int ce_exprlex(YYSTYPE *lvalp, ce_parser_arg *arg);
 }
 
 %%
@@ -373,7 +372,7 @@ array_const_special_form: SCAN_HASH_FLOAT64 '(' arg_length_hint ':' fast_float64
 }
 ;
 
-/* Here the arg length hint is stored in a global so it can be used by the
+/* Here the arg length hint is stored in 'arg' so it can be used by the
    function that allocates the vector. The value is passed to vector::reserve(). */
 
 arg_length_hint: SCAN_WORD
@@ -381,7 +380,7 @@ arg_length_hint: SCAN_WORD
     if (!check_int32($1))
         throw Error(malformed_expr, "$<type>(hint, value, ...) special form expected hint to be an integer");
 
-    arg_length_hint_value = atoi($1);
+    arg->set_arg_length_hint(atoi($1));
     $$ = true;
 }
 ;
@@ -389,7 +388,7 @@ arg_length_hint: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_byte_arg_list: fast_byte_arg
 {
-    $$ = make_fast_arg_list<byte_arg_list, dods_byte>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<byte_arg_list, dods_byte>(arg->get_arg_length_hint(), $1);
 }
 | fast_byte_arg_list ',' fast_byte_arg
 {
@@ -408,7 +407,7 @@ fast_byte_arg: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_int16_arg_list: fast_int16_arg
 {
-    $$ = make_fast_arg_list<int16_arg_list, dods_int16>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<int16_arg_list, dods_int16>(arg->get_arg_length_hint(), $1);
 }
 | fast_int16_arg_list ',' fast_int16_arg
 {
@@ -427,7 +426,7 @@ fast_int16_arg: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_uint16_arg_list: fast_uint16_arg
 {
-    $$ = make_fast_arg_list<uint16_arg_list, dods_uint16>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<uint16_arg_list, dods_uint16>(arg->get_arg_length_hint(), $1);
 }
 | fast_uint16_arg_list ',' fast_uint16_arg
 {
@@ -446,7 +445,7 @@ fast_uint16_arg: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_int32_arg_list: fast_int32_arg
 {
-    $$ = make_fast_arg_list<int32_arg_list, dods_int32>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<int32_arg_list, dods_int32>(arg->get_arg_length_hint(), $1);
 }
 | fast_int32_arg_list ',' fast_int32_arg
 {
@@ -465,7 +464,7 @@ fast_int32_arg: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_uint32_arg_list: fast_uint32_arg
 {
-    $$ = make_fast_arg_list<uint32_arg_list, dods_uint32>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<uint32_arg_list, dods_uint32>(arg->get_arg_length_hint(), $1);
 }
 | fast_uint32_arg_list ',' fast_uint32_arg
 {
@@ -484,7 +483,7 @@ fast_uint32_arg: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_float32_arg_list: fast_float32_arg
 {
-    $$ = make_fast_arg_list<float32_arg_list, dods_float32>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<float32_arg_list, dods_float32>(arg->get_arg_length_hint(), $1);
 }
 | fast_float32_arg_list ',' fast_float32_arg
 {
@@ -503,7 +502,7 @@ fast_float32_arg: SCAN_WORD
 /* return an int_arg_list (a std::vector<int>*) */
 fast_float64_arg_list: fast_float64_arg
 {
-    $$ = make_fast_arg_list<float64_arg_list, dods_float64>(arg_length_hint_value, $1);
+    $$ = make_fast_arg_list<float64_arg_list, dods_float64>(arg->get_arg_length_hint(), $1);
 }
 | fast_float64_arg_list ',' fast_float64_arg
 {
@@ -930,6 +929,12 @@ void ce_exprerror(ce_parser_arg *, const string &s)
     throw Error(malformed_expr, string("Constraint expression parse error: ").append(s));
 }
 
+// Read the next token using the scanner held by 'arg'.
+int ce_exprlex(YYSTYPE *lvalp, ce_parser_arg *arg)
+{
+    return ce_exprlex(lvalp, arg->get_scanner());
+}
+
 void no_such_ident(const string &thing)
 {
     throw Error(no_such_variable, string("Constraint expression parse error: the expression referenced a ").append(thing).append(" not found in the dataset."));
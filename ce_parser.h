@@ -10,9 +10,17 @@ struct ce_parser_arg
     ConstraintEvaluator *eval;
     DDS *dds;
 
-    ce_parser_arg() : eval(0), dds(0)
+    // The scanner reading the CE; see ce_expr_scanner() in ce_expr.lex
+    void *scanner;
+
+    // Used by the rule 'arg_length_hint' so that the hint can be used
+    // during the parent rule's parse. See fast_int32_arg_list.
+    unsigned long arg_length_hint;
+
+    ce_parser_arg() : eval(0), dds(0), scanner(0), arg_length_hint(0)
     {}
-    ce_parser_arg(ConstraintEvaluator *e, DDS *d) : eval(e), dds(d)
+    ce_parser_arg(ConstraintEvaluator *e, DDS *d) :
+        eval(e), dds(d), scanner(0), arg_length_hint(0)
     {}
     virtual ~ce_parser_arg()
     {}
@@ -34,6 +42,24 @@ struct ce_parser_arg
     {
         dds = obj;
     }
+
+    void *get_scanner()
+    {
+        return scanner;
+    }
+    void set_scanner(void *obj)
+    {
+        scanner = obj;
+    }
+
+    unsigned long get_arg_length_hint()
+    {
+        return arg_length_hint;
+    }
+    void set_arg_length_hint(unsigned long hint)
+    {
+        arg_length_hint = hint;
+    }
 };
 
 } // namespace libdap
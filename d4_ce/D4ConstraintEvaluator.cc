@@ -56,20 +56,201 @@
 
 namespace libdap {
 
+/**
+ * Parse the CE and mark the variables of the DMR it names.
+ *
+ * The parser builds a list of operations that depend only on the text of
+ * the CE and then those are applied to the DMR. If there is a parse cache
+ * (see set_parse_cache()), the operations for each CE are kept in it and
+ * a CE found there is not scanned or parsed again.
+ *
+ * @param expr The constraint expression
+ * @return True if the CE was parsed
+ * @exception Error if the CE cannot be parsed or does not match the DMR
+ */
 bool D4ConstraintEvaluator::parse(const std::string &expr)
 {
     d_expr = expr;	// set for error messages. See the %initial-action section of .yy
 
-    std::istringstream iss(expr);
-    D4CEScanner scanner(iss);
-    D4CEParser parser(scanner, *this /* driver */);
+    vector<operation> operations;
+    if (d_parse_cache && d_parse_cache->get(expr, operations)) {
+        DBG(cerr << "Found the parsed CE in the cache: " << expr << endl);
+        // Every CE that parses has the value true; see the 'expression' rule.
+        set_result(true);
+    }
+    else {
+        d_operations.clear();
+        d_indexes.clear();
+
+        std::istringstream iss(expr);
+        D4CEScanner scanner(iss);
+        D4CEParser parser(scanner, *this /* driver */);
+
+        if (trace_parsing()) {
+            parser.set_debug_level(1);
+            parser.set_debug_stream(std::cerr);
+        }
+
+        if (parser.parse() != 0)
+            return false;
+
+        operations.swap(d_operations);
+
+        // Cache the operations before they are applied; a CE that names a
+        // variable this DMR does not have may well match another one.
+        if (d_parse_cache)
+            d_parse_cache->put(expr, operations);
+    }
+
+    apply(operations);
+
+    return true;
+}
+
+/**
+ * Carry out the operations built by the parser, in order, on the DMR.
+ *
+ * @param operations The operations for one CE
+ * @exception Error if a variable or dimension is not in the DMR or if a
+ * slice or filter does not match it.
+ */
+void D4ConstraintEvaluator::apply(const vector<operation> &operations)
+{
+    d_indexes.clear();
+    while (!d_basetype_stack.empty())
+        d_basetype_stack.pop();
+
+    for (vector<operation>::const_iterator i = operations.begin(), e = operations.end(); i != e; ++i) {
+        switch (i->type) {
+        case operation::slice_dim:
+            slice_dimension(i->id, i->indexes.front());
+            break;
+
+        case operation::subset:
+        case operation::subset_indexes:
+        case operation::subset_fields:
+        case operation::subset_indexes_fields:
+            mark_subset(*i);
+            break;
+
+        case operation::filter:
+            add_filter_clause(i->id, i->arg1, i->arg2);
+            break;
+
+        case operation::end_clause:
+            pop_basetype();
+            break;
+
+        default:
+            throw InternalErr(__FILE__, __LINE__, "Unknown constraint expression operation.");
+        }
+    }
+}
+
+/**
+ * Find the variable of a subset, mark it and make it the top basetype so
+ * that fields and filters that follow can be found using it. Variables
+ * are looked up in the top basetype if there is one, otherwise from the
+ * root group of the DMR.
+ *
+ * @param op A subset operation
+ */
+void D4ConstraintEvaluator::mark_subset(const operation &op)
+{
+    BaseType *btp = 0;
+    if (top_basetype()) {
+        btp = top_basetype()->var(op.id);
+    }
+    else {
+        btp = dmr()->root()->find_var(op.id);
+    }
+
+    d_indexes = op.indexes;
+
+    switch (op.type) {
+    case operation::subset:
+        if (!btp)
+            throw_not_found(op.id, "id");
+
+        mark_variable(btp);
+        break;
+
+    case operation::subset_indexes:
+        if (!btp)
+            throw_not_found(op.id, "id indexes");
+
+        if (btp->type() != dods_array_c)
+            throw_not_array(op.id, "id indexes");
+
+        mark_variable(btp);
+        break;
+
+    case operation::subset_fields:
+        if (!btp)
+            throw_not_found(op.id, "id fields");
+
+        if (btp->type() == dods_array_c) {
+            if (btp->var() && !btp->var()->is_constructor_type())
+                throw Error(no_such_variable, "The constraint expression referenced a variable that must be a Structure or Sequence to be used with {}.");
+
+            // This call also tests the btp to make sure it's an array
+            mark_array_variable(btp);
+        }
+        else {
+            // Don't mark the variable here because only some fields are to be sent and those
+            // will be marked when the fields are applied
+            if (!btp->is_constructor_type())
+                throw Error(no_such_variable, "The constraint expression referenced a variable that must be a Structure or Sequence to be used with {}.");
+        }
+        break;
+
+    case operation::subset_indexes_fields:
+        if (!btp)
+            throw_not_found(op.id, "id indexes fields");
+
+        if (btp->type() != dods_array_c)
+            throw_not_array(op.id, "id indexes fields");
+
+        // This call also tests the btp to make sure it's an array
+        mark_array_variable(btp);
 
-    if (trace_parsing()) {
-        parser.set_debug_level(1);
-        parser.set_debug_stream(std::cerr);
+        if (!btp->var()->is_constructor_type())
+            throw Error(no_such_variable, "The constraint expression referenced a variable that must be a Structure or Sequence to be used with {}.");
+
+        // The fields are found in the Array's template
+        btp = btp->var();
+        break;
+
+    default:
+        throw InternalErr(__FILE__, __LINE__, "Expected a subset operation.");
     }
 
-    return parser.parse() == 0;
+    // push the basetype so that it is accessible when fields and filters
+    // are applied
+    push_basetype(btp);
+}
+
+// These are called by the parser to build the list of operations. The
+// indexes pushed by the 'indexes' rule go with the next subset.
+void D4ConstraintEvaluator::add_slice(const std::string &id, const index &i)
+{
+    operation op(operation::slice_dim, id);
+    op.indexes.push_back(i);
+    d_operations.push_back(op);
+}
+
+void D4ConstraintEvaluator::add_subset(operation::kind type, const std::string &id)
+{
+    d_operations.push_back(operation(type, id));
+    d_operations.back().indexes.swap(d_indexes);
+}
+
+void D4ConstraintEvaluator::add_predicate(const std::string &op, const std::string &arg1, const std::string &arg2)
+{
+    operation o(operation::filter, op);
+    o.arg1 = arg1;
+    o.arg2 = arg2;
+    d_operations.push_back(o);
 }
 
 /**
@@ -388,6 +569,10 @@ static D4FilterClause::ops get_op_code(const std::string &op)
  * Note that the D4FilterClause objects use the same numerical codes as the DAP2
  * parser/evaluator.
  *
+ * Handlers can inspect the clauses (D4Sequence::clauses()) before they read
+ * the data and mark the ones they apply themselves; see D4FilterClause::set_enforced()
+ * and D4FilterClauseList::get_range().
+ *
  * @note The parser will have pushed the Sequence onto the BaseType stack during
  * the parse, so variables can be looked up using the top_basetype() (which
  * must be a D4Sequence).
@@ -30,6 +30,8 @@
 #include <vector>
 #include <stack>
 
+#include "ConstraintCache.h"
+
 namespace libdap {
 
 class location;
@@ -69,6 +71,28 @@ class D4ConstraintEvaluator {
 			: start(i), stride(s), stop(e), rest(r), empty(em), dim_name(n) {}
 	};
 
+	// The parser does not change the DMR; it builds a list of these and
+	// apply() carries them out, in order. The list depends only on the text
+	// of the CE, so it can be cached and applied to other DMRs.
+	struct operation {
+		enum kind {
+			slice_dim,				// id = index
+			subset,					// id
+			subset_indexes,			// id indexes
+			subset_fields,			// id fields; the fields are the operations that follow
+			subset_indexes_fields,	// id indexes fields
+			filter,					// A predicate of a filter; the id is the operator
+			end_clause				// The end of the current clause
+		};
+
+		kind type;
+		std::string id;
+		std::string arg1, arg2;		// The arguments of a predicate
+		std::vector<index> indexes;
+
+		operation(kind t, const std::string &i): type(t), id(i), arg1(""), arg2(""), indexes() {}
+	};
+
 	index make_index() { return index(0, 1, 0, true /*rest*/, true /*empty*/, ""); }
 
 	index make_index(const std::string &is);
@@ -86,6 +110,10 @@ class D4ConstraintEvaluator {
 
 	DMR *d_dmr;
 
+	ConstraintCache<std::vector<operation> > *d_parse_cache;	// Weak pointer; see set_parse_cache()
+
+	std::vector<operation> d_operations;
+
 	std::vector<index> d_indexes;
 
 	std::stack<BaseType*> d_basetype_stack;
@@ -102,6 +130,14 @@ class D4ConstraintEvaluator {
 
 	void push_index(const index &i) { d_indexes.push_back(i); }
 
+	void add_slice(const std::string &id, const index &i);
+	void add_subset(operation::kind type, const std::string &id);
+	void add_predicate(const std::string &op, const std::string &arg1, const std::string &arg2);
+	void end_clause() { d_operations.push_back(operation(operation::end_clause, "")); }
+
+	void apply(const std::vector<operation> &operations);
+	void mark_subset(const operation &op);
+
 	void push_basetype(BaseType *btp) { d_basetype_stack.push(btp); }
 	BaseType *top_basetype() const { return d_basetype_stack.empty() ? 0 : d_basetype_stack.top(); }
 	// throw on pop with an empty stack?
@@ -118,8 +154,10 @@ class D4ConstraintEvaluator {
 	friend class D4CEParser;
 
 public:
-	D4ConstraintEvaluator() : d_trace_scanning(false), d_trace_parsing(false), d_result(false), d_expr(""), d_dmr(0) { }
-	D4ConstraintEvaluator(DMR *dmr) : d_trace_scanning(false), d_trace_parsing(false), d_result(false), d_expr(""), d_dmr(dmr) { }
+	typedef ConstraintCache<std::vector<operation> > Parse_cache;
+
+	D4ConstraintEvaluator() : d_trace_scanning(false), d_trace_parsing(false), d_result(false), d_expr(""), d_dmr(0), d_parse_cache(0) { }
+	D4ConstraintEvaluator(DMR *dmr) : d_trace_scanning(false), d_trace_parsing(false), d_result(false), d_expr(""), d_dmr(dmr), d_parse_cache(0) { }
 
 	virtual ~D4ConstraintEvaluator() { }
 
@@ -137,6 +175,14 @@ public:
 	DMR *dmr() const { return d_dmr; }
 	void set_dmr(DMR *dmr) { d_dmr = dmr; }
 
+	/** Get/set the cache of parsed CEs used by parse(). The cache is not
+	    deleted by the evaluator and may be shared by many of them. Use null
+	    (the default) to parse every CE. */
+	//@{
+	Parse_cache *parse_cache() const { return d_parse_cache; }
+	void set_parse_cache(Parse_cache *cache) { d_parse_cache = cache; }
+	//@}
+
 	void error(const libdap::location &l, const std::string &m);
 };
 
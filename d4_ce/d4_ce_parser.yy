@@ -155,7 +155,8 @@ dimensions : dimension { $$ = $1; }
 
 dimension : id "=" index
 {
-    $$ = driver.slice_dimension($1, $3);
+    driver.add_slice($1, $3);
+    $$ = true;
 }
 ;
 
@@ -169,96 +170,39 @@ clauses : clause { $$ = $1; }
 // when processing the 'filter' part of the grammar. I need the
 // the top basetype so that I know which Sequence to use.
 // jhrg 4/23/16
+//
+// The actions no longer look at the DMR. Each one adds an operation that
+// D4ConstraintEvaluator::apply() carries out once the whole CE has been
+// parsed; see D4ConstraintEvaluator::mark_subset() for the checks made
+// for each kind of subset. The order of the operations is the order in
+// which these actions used to change the DMR.
                
-clause : subset { $$ = $1; driver.pop_basetype(); }
+clause : subset { $$ = $1; driver.end_clause(); }
 
 // For the DAP4 at this time (3/18/15) filters apply only to D4Sequences 
 
-| subset "|" filter { driver.pop_basetype(); $$ = $1 && $3; }
+| subset "|" filter { driver.end_clause(); $$ = $1 && $3; }
 ;
 
-// mark_variable returns a BaseType* or throws Error
-// Note that this is a fairly long production rule with a number
-// of different right hand sides spanning about 110 lines.
-// jhrg 4/8/16
 subset : id 
 {
-    BaseType *btp = 0;
-    if (driver.top_basetype()) {
-        btp = driver.top_basetype()->var($1);
-    }
-    else {
-        btp = driver.dmr()->root()->find_var($1);
-    }
-    
-    if (!btp)
-        driver.throw_not_found($1, "id");
-
-    $$ = driver.mark_variable(btp);
-    
-    // push the basetype so that it is
-    // accessible if/while filters are parsed
-    driver.push_basetype(btp);
+    driver.add_subset(D4ConstraintEvaluator::operation::subset, $1);
+    $$ = true;
 }
 
 | id indexes 
 {
-    BaseType *btp = 0;
-    if (driver.top_basetype()) {
-        btp = driver.top_basetype()->var($1);
-    }
-    else {
-        btp = driver.dmr()->root()->find_var($1);
-    }
-    
-    if (!btp)
-        driver.throw_not_found($1, "id indexes");
-        
-    if (btp->type() != dods_array_c)
-        driver.throw_not_array($1, "id indexes");
-        
-    $$ = driver.mark_variable(btp);
-    
-    // push the basetype so that it is
-    // accessible if/while filters are parsed
-    driver.push_basetype(btp);
+    driver.add_subset(D4ConstraintEvaluator::operation::subset_indexes, $1);
+    $$ = true;
 }
 
 // Note this case is '| id fields'
 | id 
 {
-    BaseType *btp = 0;
-    if (driver.top_basetype()) {
-        btp = driver.top_basetype()->var($1);
-    }
-    else {
-        btp = driver.dmr()->root()->find_var($1);
-    }
-
-    if (!btp)
-        driver.throw_not_found($1, "id fields");
-    
-    if (btp->type() == dods_array_c) {
-        if (btp->var() && !btp->var()->is_constructor_type())
-            throw Error(no_such_variable, "The constraint expression referenced a variable that must be a Structure or Sequence to be used with {}.");
-            
-        // This call also tests the btp to make sure it's an array
-        driver.mark_array_variable(btp);
-    }
-    else {
-        // Don't mark the variable here because only some fields are to be sent and those
-        // will be marked when the fields are parsed
-        if (!btp->is_constructor_type())
-            throw Error(no_such_variable, "The constraint expression referenced a variable that must be a Structure or Sequence to be used with {}.");
-    }
-    
-    // push the basetype so that it is
-    // accessible when fields and if/while filters are parsed
-    driver.push_basetype(btp);
+    driver.add_subset(D4ConstraintEvaluator::operation::subset_fields, $1);
 } 
 fields 
 { 
-    //driver.pop_basetype(); 
     $$ = true; 
 }
 
@@ -266,27 +210,7 @@ fields
 
 | id indexes
 {
-    BaseType *btp = 0;
-    if (driver.top_basetype()) {
-        btp = driver.top_basetype()->var($1);
-    }
-    else {
-        btp = driver.dmr()->root()->find_var($1);
-    }
-
-    if (!btp)
-        driver.throw_not_found($1, "id indexes fields");
-    
-    if (btp->type() != dods_array_c)
-        driver.throw_not_array($1, "id indexes fields");
-
-    // This call also tests the btp to make sure it's an array
-    driver.mark_array_variable(btp);
-    
-    if (!btp->var()->is_constructor_type())
-        throw Error(no_such_variable, "The constraint expression referenced a variable that must be a Structure or Sequence to be used with {}.");
-      
-    driver.push_basetype(btp->var());       
+    driver.add_subset(D4ConstraintEvaluator::operation::subset_indexes_fields, $1);
 } 
 fields 
 {
@@ -294,7 +218,8 @@ fields
 }
 ;
 
-// push_index stores the index in the D4ConstraintEvaluator
+// push_index stores the index in the D4ConstraintEvaluator until the
+// subset that uses it is added
 indexes : index 
 { 
     driver.push_index($1); 
@@ -332,12 +257,12 @@ filter : predicate { $$ = true; }
 // odd characters that clash with the operators, et cetera).
 
 predicate : id op id
-{ driver.add_filter_clause($2, $1, $3); $$ = true; }
+{ driver.add_predicate($2, $1, $3); $$ = true; }
           
 | id op id op id 
 { 
-    driver.add_filter_clause($2, $1, $3); 
-    driver.add_filter_clause($4, $3, $5); 
+    driver.add_predicate($2, $1, $3); 
+    driver.add_predicate($4, $3, $5); 
     $$ = true; 
 
 }
@@ -28,7 +28,8 @@
 #include <string>
 #include <sstream>
 #include <iterator>
-#include <list>
+#include <vector>
+#include <set>
 #include <algorithm>
 
 //#define DODS_DEBUG
@@ -44,6 +45,8 @@
 #include "BaseType.h"
 #include "Array.h"
 #include "D4Enum.h"
+#include "ParallelLoop.h"
+#include "FunctionResultCache.h"
 
 #include "escaping.h"
 #include "util.h"
@@ -79,6 +82,86 @@ bool D4FunctionEvaluator::parse(const std::string &expr)
     return parser.parse() == 0;
 }
 
+namespace {
+
+// Does the value of 'rvalue' belong to the caller? Only a function that says
+// it returns a new BaseType hands over its value; variables and constants
+// belong to the source dataset and the rvalue.
+bool owns_value(const D4RValue *rvalue)
+{
+    return rvalue->get_kind() == D4RValue::function && rvalue->result_is_new();
+}
+
+// Find the values of the rvalues in each group in order. The groups share
+// no variables, so different groups can be evaluated at the same time.
+class eval_rvalue_groups: public ParallelLoop::Body {
+    const vector<D4RValue*> &d_rvalues;
+    const vector<vector<unsigned long> > &d_groups;
+    DMR &d_dmr;
+    vector<BaseType*> &d_results;
+
+public:
+    eval_rvalue_groups(const vector<D4RValue*> &rvalues, const vector<vector<unsigned long> > &groups, DMR &dmr,
+        vector<BaseType*> &results) :
+        d_rvalues(rvalues), d_groups(groups), d_dmr(dmr), d_results(results) { }
+
+    void run(unsigned long g)
+    {
+        for (vector<unsigned long>::const_iterator i = d_groups[g].begin(), e = d_groups[g].end(); i != e; ++i)
+            d_results[*i] = d_rvalues[*i]->value(d_dmr);
+    }
+};
+
+} // anonymous namespace
+
+/**
+ * Find the values of the parsed rvalues using several threads and add them
+ * to 'root' in the order they appear in the expression. Function calls that
+ * use none of the same variables are evaluated at the same time.
+ *
+ * @param root Add the results to this group
+ */
+void D4FunctionEvaluator::eval_in_parallel(D4Group *root)
+{
+    vector<D4RValue*> rvalues(d_result->begin(), d_result->end());
+
+    vector<vector<BaseType*> > uses(rvalues.size());
+    for (vector<D4RValue*>::size_type i = 0; i < rvalues.size(); ++i)
+        rvalues[i]->variables(uses[i]);
+
+    vector<vector<unsigned long> > groups;
+    independent_groups(uses, groups);
+
+    vector<BaseType*> results(rvalues.size(), static_cast<BaseType*>(0));
+    try {
+        eval_rvalue_groups body(rvalues, groups, *d_dmr, results);
+        ParallelLoop(body, groups.size()).run(d_function_threads);
+    }
+    catch (...) {
+        // Only new function results belong to this code
+        for (vector<D4RValue*>::size_type i = 0; i < rvalues.size(); ++i) {
+            if (owns_value(rvalues[i]))
+                delete results[i];
+        }
+        throw;
+    }
+
+    if (find(results.begin(), results.end(), static_cast<BaseType*>(0)) != results.end()) {
+        for (vector<D4RValue*>::size_type i = 0; i < rvalues.size(); ++i) {
+            if (owns_value(rvalues[i]))
+                delete results[i];
+        }
+        throw InternalErr(__FILE__, __LINE__, "A function was called but failed to return a value.");
+    }
+
+    for (vector<D4RValue*>::size_type i = 0; i < rvalues.size(); ++i) {
+        if (owns_value(rvalues[i]))
+            root->add_var_nocopy(results[i]);
+        else
+            root->add_var(results[i]);
+    }
+}
+
 /**
  * Evaluate the recently parsed function expression and put the resulting
  * rvalues (which return values packaged in libdap BaseType objects) into
@@ -103,6 +186,10 @@ bool D4FunctionEvaluator::parse(const std::string &expr)
  * @note Calling this method will delete the D4RValueList object built
  * by the parse() method.
  *
+ * @note If the evaluator has a function result cache and function_result
+ * is empty, the result may be read from the cache and none of the
+ * functions called.
+ *
  * @param dmr Store the results here
  * @exception Throws Error if the evaluation fails.
  */
@@ -127,13 +214,54 @@ void D4FunctionEvaluator::eval(DMR *function_result)
 
     if (!d_result) throw InternalErr(__FILE__, __LINE__, "Must parse() the function expression before calling eval()");
 
+    // Only a result that makes the whole DMR can be cached and read back
+    D4Group *root = function_result->root();
+    if (!d_function_cache || d_expr.empty() || !function_result->factory() || root->var_begin() != root->var_end()
+        || root->grp_begin() != root->grp_end()) {
+        eval_functions(function_result);
+        return;
+    }
+
+    string key = FunctionResultCache::make_key(d_cache_dataset, d_cache_last_modified, d_expr);
+    if (d_function_cache->get(key, *function_result, d_cancel_token)) {
+        DBG(cerr << "Found the function result for: " << key << endl);
+        delete d_result;    // None of the functions were called
+        d_result = 0;
+        return;
+    }
+
+    try {
+        eval_functions(function_result);
+    }
+    catch (...) {
+        d_function_cache->abandon(key);
+        throw;
+    }
+
+    d_function_cache->put(key, *function_result);
+}
+
+// Evaluate the functions and add their results to the root group of
+// function_result, with the Dimensions and Enumerations they use.
+void D4FunctionEvaluator::eval_functions(DMR *function_result)
+{
     D4Group *root = function_result->root();	// Load everything in the root group
 
-    for (D4RValueList::iter i = d_result->begin(), e = d_result->end(); i != e; ++i) {
-        // Copy the BaseTypes; this means all of the function results can
-        // be deleted, which addresses the memory leak issue with function
-        // results. This should also copy the D4Dimensions. jhrg 3/17/14
-        root->add_var((*i)->value(*d_dmr));
+    if (d_function_threads > 1 && d_result->size() > 1) {
+        eval_in_parallel(root);
+    }
+    else {
+        for (D4RValueList::iter i = d_result->begin(), e = d_result->end(); i != e; ++i) {
+            // A function that returns a new BaseType hands it over, so it goes
+            // into the result without being copied; for a function that returns
+            // a large array the copy doubled the memory needed. Anything else
+            // may belong to the source dataset, the rvalue or the function, so
+            // it is copied. This should also copy the D4Dimensions. jhrg 3/17/14
+            if (owns_value(*i))
+                root->add_var_nocopy((*i)->value(*d_dmr));
+            else
+                root->add_var((*i)->value(*d_dmr));
+        }
     }
 
     delete d_result;	// The parser/function allocates the BaseType*s that hold the results.
@@ -146,8 +274,9 @@ void D4FunctionEvaluator::eval(DMR *function_result)
     // Make a set of D4Dimensions. For each variable in 'function_result', look
     // for its dimensions in 'dataset' (by name) and add a pointer to those to the
     // set. Then copy all the stuff in the set into the root group of 'function_
-    // result.'
-    list<D4Dimension*> dim_set;
+    // result.' The vector keeps the order in which the dimensions were found.
+    vector<D4Dimension*> dims;
+    set<D4Dimension*> dim_set;
 
     for (Constructor::Vars_iter i = root->var_begin(), ie = root->var_end(); i != ie; ++i) {
         if ((*i)->is_vector_type()) {
@@ -155,11 +284,8 @@ void D4FunctionEvaluator::eval(DMR *function_result)
             for (Array::Dim_iter d = a->dim_begin(), de = a->dim_end(); d != de; ++d) {
                 // Only add Dimensions that are not already present; share dims are not repeated. jhrg 2/7/18
                 D4Dimension *d4_dim = a->dimension_D4dim(d);
-                if (d4_dim) {
-                    bool found = (std::find(dim_set.begin(), dim_set.end(), d4_dim) != dim_set.end());
-                    if (!found)
-                        dim_set.push_back(a->dimension_D4dim(d));
-                }
+                if (d4_dim && dim_set.insert(d4_dim).second)
+                    dims.push_back(d4_dim);
             }
         }
     }
@@ -167,19 +293,22 @@ void D4FunctionEvaluator::eval(DMR *function_result)
     // Copy the D4Dimensions and EnumDefs because this all goes in a new DMR - we don't
     // want to share those across DMRs because the DMRs delete those (so sharing htem
     // across DMRs would lead to dangling pointers.
-    for (list<D4Dimension*>::iterator i = dim_set.begin(), e = dim_set.end(); i != e; ++i) {
+    for (vector<D4Dimension*>::iterator i = dims.begin(), e = dims.end(); i != e; ++i) {
         root->dims()->add_dim(*i);
     }
 
-    // Now lets do the enumerations....
-    list<D4EnumDef*> enum_def_set;
+    // Now lets do the enumerations.... Several variables can use the same one.
+    vector<D4EnumDef*> enum_defs;
+    set<D4EnumDef*> enum_def_set;
     for (Constructor::Vars_iter i = root->var_begin(), ie = root->var_end(); i != ie; ++i) {
         if ((*i)->type() == dods_enum_c) {
-            enum_def_set.push_back(static_cast<D4Enum*>(*i)->enumeration());
+            D4EnumDef *enum_def = static_cast<D4Enum*>(*i)->enumeration();
+            if (enum_def && enum_def_set.insert(enum_def).second)
+                enum_defs.push_back(enum_def);
         }
     }
 
-    for (list<D4EnumDef*>::iterator i = enum_def_set.begin(), e = enum_def_set.end(); i != e; ++i) {
+    for (vector<D4EnumDef*>::iterator i = enum_defs.begin(), e = enum_defs.end(); i != e; ++i) {
         root->enum_defs()->add_enum(*i);
     }
 }
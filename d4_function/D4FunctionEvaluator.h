@@ -25,6 +25,8 @@
 #ifndef D4_FUNCTION_DRIVER_H_
 #define D4_FUNCTION_DRIVER_H_
 
+#include <ctime>
+
 #include <string>
 #include <vector>
 #include <stack>
@@ -39,8 +41,11 @@ class ServerFunctionsList;
 
 class DMR;
 class D4Dimension;
+class D4Group;
 class D4RValue;
 class D4RValueList;
+class FunctionResultCache;
+class CancelToken;
 
 /**
  * Driver for the DAP4 Functional expression parser.
@@ -60,6 +65,13 @@ class D4FunctionEvaluator
 
     unsigned long long d_arg_length_hint;
 
+    unsigned int d_function_threads;
+
+    FunctionResultCache *d_function_cache;  // Weak pointer
+    std::string d_cache_dataset;
+    time_t d_cache_last_modified;
+    const CancelToken *d_cancel_token;      // Weak pointer
+
     // d_expr should be set by parse! Its value is used by the parser right before
     // the actual parsing operation starts. jhrg 11/26/13
     std::string *expression()
@@ -82,17 +94,22 @@ class D4FunctionEvaluator
 
     D4RValue *build_rvalue(const std::string &id);
 
+    void eval_in_parallel(D4Group *root);
+    void eval_functions(DMR *function_result);
+
     friend class D4FunctionParser;
 
 public:
     D4FunctionEvaluator() :
             d_trace_scanning(false), d_trace_parsing(false), d_expr(""), d_dmr(0), d_sf_list(0), d_result(0), d_arg_length_hint(
-                    0)
+                    0), d_function_threads(1), d_function_cache(0), d_cache_last_modified(0),
+                    d_cancel_token(0)
     {
     }
     D4FunctionEvaluator(DMR *dmr, ServerFunctionsList *sf_list) :
             d_trace_scanning(false), d_trace_parsing(false), d_expr(""), d_dmr(dmr), d_sf_list(sf_list), d_result(0), d_arg_length_hint(
-                    0)
+                    0), d_function_threads(1), d_function_cache(0), d_cache_last_modified(0),
+                    d_cancel_token(0)
     {
     }
 
@@ -144,6 +161,55 @@ public:
         d_arg_length_hint = alh;
     }
 
+    /** Get/set the number of threads used by eval(). The default is one,
+     * which evaluates the functions in order in the calling thread. With
+     * more than one, function calls that use none of the same variables are
+     * evaluated at the same time; the results are in the same order either
+     * way. Only use more than one thread when the functions and the read()
+     * methods of the variables are MT-safe.
+     * @see ServerFunction
+     */
+    unsigned int function_threads() const
+    {
+        return d_function_threads;
+    }
+    void set_function_threads(unsigned int threads)
+    {
+        d_function_threads = threads;
+    }
+
+    /** Get/set the cache used by eval(). The cache is not deleted by the
+     * evaluator and may be shared by many of them. The results are cached
+     * using the dataset, the time it was last modified and the expression
+     * given to parse(); only results put in an empty DMR are cached. Use
+     * null (the default) to turn caching off.
+     * @see FunctionResultCache
+     */
+    FunctionResultCache *function_cache() const
+    {
+        return d_function_cache;
+    }
+    void set_function_cache(FunctionResultCache *cache, const std::string &dataset, time_t last_modified)
+    {
+        d_function_cache = cache;
+        d_cache_dataset = dataset;
+        d_cache_last_modified = last_modified;
+    }
+
+    /** Get/set the token of the request being evaluated. When another
+     * thread is evaluating the same functions, eval() waits for its result
+     * only until this token is cancelled. Use null (the default) to wait
+     * without a limit.
+     */
+    const CancelToken *cancel_token() const
+    {
+        return d_cancel_token;
+    }
+    void set_cancel_token(const CancelToken *token)
+    {
+        d_cancel_token = token;
+    }
+
     DMR *dmr() const
     {
         return d_dmr;
@@ -49,6 +49,8 @@
 
 #define YYERROR_VERBOSE 0
 
+#include <utility>
+
 #include "D4FunctionEvaluator.h"
 #include "D4RValue.h"
 #include "dods-datatypes.h"
@@ -103,7 +105,8 @@ namespace libdap {
 %type <D4RValue*> arg "argument"
 %type <D4RValue*> function "function"
 
-%type <D4Function> fname "function name"
+// The function and whether it returns a new BaseType
+%type <std::pair<D4Function, bool> > fname "function name"
 %type <D4RValue*> variable_or_constant "variable or constant"
 %type <D4RValue*> array_constant "array constant"
 
@@ -174,19 +177,20 @@ functions : function
                     
 function : fname "(" args ")" 
 { 
-    $$ = new D4RValue($1, $3); // Build a D4RValue from a D4Function pointer and a D4RValueList 
+    $$ = new D4RValue($1.first, $3, $1.second); // Build a D4RValue from a D4Function pointer and a D4RValueList 
 } 
 ;
 
 fname: WORD 
 { 
     D4Function f;
-    if (!evaluator.sf_list()->find_function($1, &f)) {
+    bool result_is_new;
+    if (!evaluator.sf_list()->find_function($1, &f, &result_is_new)) {
         // ...cloud use @1.{first,last}_column in these error messages.
         throw Error(malformed_expr, "'" + $1 + "' is not a registered DAP4 server function.");
     }
 
-    $$ = f;
+    $$ = std::make_pair(f, result_is_new);
 }        
 ;
 
@@ -34,6 +34,10 @@
    generator to build a parser for the DAS. It assumes that a scanner called
    `daslex()' exists and that the objects DAS and AttrTable also exist.
 
+   The parser is pure and keeps the state of a parse in a das_parser_state
+   object, so several threads can parse DAS objects at once. Use das_parse()
+   to parse a DAS.
+
    jhrg 7/12/94 
 */
 
@@ -79,28 +83,53 @@ using namespace libdap ;
 
 //#define YYPARSE_PARAM arg
 
-extern int das_line_num;	/* defined in das.lex */
+struct das_parser_state;    // The state of one parse; see below
 
 } // code requires
 
 %code {
+// Glue routines defined in das.lex
+void *das_scanner(FILE *fp);
+void das_delete_scanner(void *scanner);
+
+int daslex(YYSTYPE *lvalp, void *scanner);
+int dasget_lineno(void *scanner);
+
 // No global static objects. We go through this every so often, I guess I
 // should learn... 1/24/2000 jhrg
-static string *name;	/* holds name in attr_pair rule */
-static string *type;	/* holds type in attr_pair rule */
+//
+// All of the state of one parse is held here, so parses in different
+// threads do not share anything.
+struct das_parser_state {
+    void *scanner;      // see das.lex
+
+    string name;        // holds name in attr_pair rule
+    string type;        // holds type in attr_pair rule
+
+    // I use a vector of AttrTable pointers for a stack
+    vector<AttrTable *> attr_tab_stack;
+
+    das_parser_state(FILE *in) : scanner(das_scanner(in)), name(), type(), attr_tab_stack()
+    {}
+    ~das_parser_state()
+    {
+        das_delete_scanner(scanner);
+    }
+};
 
-static vector<AttrTable *> *attr_tab_stack;
+// These macros use the parser state passed to the parser (and to the
+// functions below) as 'state.'
 
-// I use a vector of AttrTable pointers for a stack
+#define TOP_OF_STACK (state->attr_tab_stack.back())
+#define PUSH(x) (state->attr_tab_stack.push_back((x)))
+#define POP (state->attr_tab_stack.pop_back())
+#define STACK_LENGTH (state->attr_tab_stack.size())
+#define OUTER_TABLE_ONLY (state->attr_tab_stack.size() == 1)
+#define STACK_EMPTY (state->attr_tab_stack.empty())
 
-#define TOP_OF_STACK (attr_tab_stack->back())
-#define PUSH(x) (attr_tab_stack->push_back((x)))
-#define POP (attr_tab_stack->pop_back())
-#define STACK_LENGTH (attr_tab_stack->size())
-#define OUTER_TABLE_ONLY (attr_tab_stack->size() == 1)
-#define STACK_EMPTY (attr_tab_stack->empty())
+#define LINE_NUM (dasget_lineno(state->scanner))
 
-#define TYPE_NAME_VALUE(x) *type << " " << *name << " " << (x)
+#define TYPE_NAME_VALUE(x) state->type << " " << state->name << " " << (x)
 
 static const char *ATTR_TUPLE_MSG = 
 "Expected an attribute type (Byte, Int16, UInt16, Int32, UInt32, Float32,\n\
@@ -111,11 +140,11 @@ Check that the URL is correct.";
 
 typedef int checker(const char *);
 
-int daslex(void);
-static void daserror(parser_arg *arg, const string &s /*char *s*/);
-static void add_attribute(const string &type, const string &name, 
+static int daslex(YYSTYPE *lvalp, das_parser_state *state);
+static void daserror(parser_arg *arg, das_parser_state *state, const string &s /*char *s*/);
+static void add_attribute(das_parser_state *state, const string &type, const string &name,
 			  const string &value, checker *chk) throw (Error);
-static void add_alias(AttrTable *das, AttrTable *current, const string &name, 
+static void add_alias(das_parser_state *state, AttrTable *das, AttrTable *current, const string &name,
 		      const string &src) throw (Error);
 static void add_bad_attribute(AttrTable *attr, const string &type,
 			      const string &name, const string &value,
@@ -125,10 +154,12 @@ static void add_bad_attribute(AttrTable *attr, const string &type,
 
 %require "2.4"
 
-%parse-param {parser_arg *arg}
+%parse-param {parser_arg *arg} {das_parser_state *state}
+%lex-param {das_parser_state *state}
 %name-prefix "das"
 // This define should work, replacing name-prefix, but it does not.
 // %define api.prefix {das}
+%define api.pure full
 %defines
 %debug
 %verbose
@@ -195,19 +226,12 @@ static void add_bad_attribute(AttrTable *attr, const string &type,
 
 attr_start:
 	{
-		if (!name) name = new string();
-		if (!type) type = new string();
-		if (!attr_tab_stack) attr_tab_stack = new vector<AttrTable *>;
-
 		// push outermost AttrTable
 		PUSH(DAS_OBJ(arg)->get_top_level_attributes());
 	}
     attributes
     {
 		POP;	// pop the DAS/AttrTable before stack's dtor
-		delete name; name = 0;
-		delete type; type = 0;
-		delete attr_tab_stack; attr_tab_stack = 0;
 	}
 ;
 
@@ -219,7 +243,7 @@ attributes:     attribute
 attribute:    	SCAN_ATTR '{' attr_list '}'
         | error
         {
-		    parse_error((parser_arg *)arg, NO_DAS_MSG, das_line_num);
+		    parse_error((parser_arg *)arg, NO_DAS_MSG, LINE_NUM);
 		}
 ;
 
@@ -230,44 +254,44 @@ attr_list:  	/* empty */
 
 attr_tuple:	alias
 
-        | SCAN_BYTE { save_str(*type, "Byte", das_line_num); }
-                name { save_str(*name, $3, das_line_num); } 
+        | SCAN_BYTE { save_str(state->type, "Byte", LINE_NUM); }
+                name { save_str(state->name, $3, LINE_NUM); } 
 		bytes ';'
 
-		| SCAN_INT16 { save_str(*type, "Int16", das_line_num); } 
-                name { save_str(*name, $3, das_line_num); } 
+		| SCAN_INT16 { save_str(state->type, "Int16", LINE_NUM); } 
+                name { save_str(state->name, $3, LINE_NUM); } 
 		int16 ';'
 
-		| SCAN_UINT16 { save_str(*type, "UInt16", das_line_num); } 
-                name { save_str(*name, $3, das_line_num); } 
+		| SCAN_UINT16 { save_str(state->type, "UInt16", LINE_NUM); } 
+                name { save_str(state->name, $3, LINE_NUM); } 
 		uint16 ';'
 
-		| SCAN_INT32 { save_str(*type, "Int32", das_line_num); } 
-                name { save_str(*name, $3, das_line_num); } 
+		| SCAN_INT32 { save_str(state->type, "Int32", LINE_NUM); } 
+                name { save_str(state->name, $3, LINE_NUM); } 
 		int32 ';'
 
-		| SCAN_UINT32 { save_str(*type, "UInt32", das_line_num); } 
-                name { save_str(*name, $3, das_line_num); } 
+		| SCAN_UINT32 { save_str(state->type, "UInt32", LINE_NUM); } 
+                name { save_str(state->name, $3, LINE_NUM); } 
 		uint32 ';'
 
-		| SCAN_FLOAT32 { save_str(*type, "Float32", das_line_num); } 
-                name { save_str(*name, $3, das_line_num); } 
+		| SCAN_FLOAT32 { save_str(state->type, "Float32", LINE_NUM); } 
+                name { save_str(state->name, $3, LINE_NUM); } 
 		float32 ';'
 
-		| SCAN_FLOAT64 { save_str(*type, "Float64", das_line_num); } 
-                name { save_str(*name, $3, das_line_num); } 
+		| SCAN_FLOAT64 { save_str(state->type, "Float64", LINE_NUM); } 
+                name { save_str(state->name, $3, LINE_NUM); } 
 		float64 ';'
 
-		| SCAN_STRING { *type = "String"; } 
-                name { *name = $3; } 
+		| SCAN_STRING { state->type = "String"; } 
+                name { state->name = $3; } 
 		strs ';'
 
-                | SCAN_URL { *type = "Url"; } 
-                name { *name = $3; } 
+                | SCAN_URL { state->type = "Url"; } 
+                name { state->name = $3; } 
                 urls ';'
 
-                | SCAN_XML { *type = "OtherXML"; } 
-                name { *name = $3; } 
+                | SCAN_XML { state->type = "OtherXML"; } 
+                name { state->name = $3; } 
                 xml ';'
 
 		| SCAN_WORD
@@ -282,7 +306,7 @@ attr_tuple:	alias
 			catch (Error &e) {
 			    // re-throw with line number info
 			    parse_error(e.get_error_message().c_str(), 
-					das_line_num);
+					LINE_NUM);
 			}
 		    }
 		    PUSH(at);
@@ -300,99 +324,99 @@ attr_tuple:	alias
 
 		| error 
                 { 
-		    parse_error(ATTR_TUPLE_MSG, das_line_num, $1);
+		    parse_error(ATTR_TUPLE_MSG, LINE_NUM, $1);
 		} ';'
 ;
 
 bytes:		SCAN_WORD
 		{
-		    add_attribute(*type, *name, $1, &check_byte);
+		    add_attribute(state, state->type, state->name, $1, &check_byte);
 		}
 		| bytes ',' SCAN_WORD
 		{
-		    add_attribute(*type, *name, $3, &check_byte);
+		    add_attribute(state, state->type, state->name, $3, &check_byte);
 		}
 ;
 
 int16:		SCAN_WORD
 		{
-		    add_attribute(*type, *name, $1, &check_int16);
+		    add_attribute(state, state->type, state->name, $1, &check_int16);
 		}
 		| int16 ',' SCAN_WORD
 		{
-		    add_attribute(*type, *name, $3, &check_int16);
+		    add_attribute(state, state->type, state->name, $3, &check_int16);
 		}
 ;
 
 uint16:		SCAN_WORD
 		{
-		    add_attribute(*type, *name, $1, &check_uint16);
+		    add_attribute(state, state->type, state->name, $1, &check_uint16);
 		}
 		| uint16 ',' SCAN_WORD
 		{
-		    add_attribute(*type, *name, $3, &check_uint16);
+		    add_attribute(state, state->type, state->name, $3, &check_uint16);
 		}
 ;
 
 int32:		SCAN_WORD
 		{
-		    add_attribute(*type, *name, $1, &check_int32);
+		    add_attribute(state, state->type, state->name, $1, &check_int32);
 		}
 		| int32 ',' SCAN_WORD
 		{
-		    add_attribute(*type, *name, $3, &check_int32);
+		    add_attribute(state, state->type, state->name, $3, &check_int32);
 		}
 ;
 
 uint32:		SCAN_WORD
 		{
-		    add_attribute(*type, *name, $1, &check_uint32);
+		    add_attribute(state, state->type, state->name, $1, &check_uint32);
 		}
 		| uint32 ',' SCAN_WORD
 		{
-		    add_attribute(*type, *name, $3, &check_uint32);
+		    add_attribute(state, state->type, state->name, $3, &check_uint32);
 		}
 ;
 
 float32:	float_or_int
 		{
-		    add_attribute(*type, *name, $1, &check_float32);
+		    add_attribute(state, state->type, state->name, $1, &check_float32);
 		}
 		| float32 ',' float_or_int
 		{
-		    add_attribute(*type, *name, $3, &check_float32);
+		    add_attribute(state, state->type, state->name, $3, &check_float32);
 		}
 ;
 
 float64:	float_or_int
 		{
-		    add_attribute(*type, *name, $1, &check_float64);
+		    add_attribute(state, state->type, state->name, $1, &check_float64);
 		}
 		| float64 ',' float_or_int
 		{
-		    add_attribute(*type, *name, $3, &check_float64);
+		    add_attribute(state, state->type, state->name, $3, &check_float64);
 		}
 ;
 
 strs:		str_or_id
 		{
 		    string attr = remove_quotes($1);
-		    add_attribute(*type, *name, attr, 0);
+		    add_attribute(state, state->type, state->name, attr, 0);
 		}
 		| strs ',' str_or_id
 		{
 		    string attr = remove_quotes($3);
-		    add_attribute(*type, *name, attr, 0);
+		    add_attribute(state, state->type, state->name, attr, 0);
 		}
 ;
 
 urls:           url
                 {
-                    add_attribute(*type, *name, $1, &check_url);
+                    add_attribute(state, state->type, state->name, $1, &check_url);
                 }
                 | urls ',' url
                 {
-                    add_attribute(*type, *name, $3, &check_url);
+                    add_attribute(state, state->type, state->name, $3, &check_url);
                 }
 ;
 
@@ -404,9 +428,9 @@ xml:            SCAN_WORD
                     string xml = unescape_double_quotes($1);
                     
                     if (is_quoted(xml))
-                        add_attribute(*type, *name, remove_quotes(xml), 0);
+                        add_attribute(state, state->type, state->name, remove_quotes(xml), 0);
                     else
-                        add_attribute(*type, *name, xml, 0);
+                        add_attribute(state, state->type, state->name, xml, 0);
                 }
 ;
 
@@ -426,12 +450,12 @@ name:           SCAN_WORD | SCAN_ATTR | SCAN_ALIAS | SCAN_BYTE | SCAN_INT16
 
 alias:          SCAN_ALIAS SCAN_WORD
                 { 
-		    *name = $2;
+		    state->name = $2;
 		} 
                 SCAN_WORD
                 {
-		    add_alias( DAS_OBJ(arg)->get_top_level_attributes(),
-		               TOP_OF_STACK, *name, string($4) ) ;
+		    add_alias(state, DAS_OBJ(arg)->get_top_level_attributes(),
+		               TOP_OF_STACK, state->name, string($4) ) ;
                 }
                 ';'
 ;
@@ -442,8 +466,26 @@ alias:          SCAN_ALIAS SCAN_WORD
 // reporting mechanism.
 
 static void
-daserror(parser_arg *, const string &)
+daserror(parser_arg *, das_parser_state *, const string &)
+{
+}
+
+// Read the next token using the scanner of this parse
+static int
+daslex(YYSTYPE *lvalp, das_parser_state *state)
+{
+    return daslex(lvalp, state->scanner);
+}
+
+/** Parse the DAS read from \c in into the DAS held by \c arg. Each call
+    makes its own scanner and parser state, so several threads can parse
+    DAS objects at the same time.
+    @return The value returned by dasparse(); zero if the parse worked. */
+int
+das_parse(FILE *in, parser_arg *arg)
 {
+    das_parser_state state(in);
+    return dasparse(arg, &state);
 }
 
 static string
@@ -463,7 +505,7 @@ a_or_an(const string &subject)
 // and stores the parser's error message in a string attribute named
 // `explanation.' 
 static void
-add_attribute(const string &type, const string &name, const string &value,
+add_attribute(das_parser_state *state, const string &type, const string &name, const string &value,
 	      checker *chk) throw (Error)
 {
     DBG(cerr << "Adding: " << type << " " << name << " " << value \
@@ -479,7 +521,7 @@ add_attribute(const string &type, const string &name, const string &value,
     if (STACK_EMPTY) {
 		string msg = "Whoa! Attribute table stack empty when adding `" ;
 		msg += name + ".' ";
-		parse_error(msg, das_line_num);
+		parse_error(msg, LINE_NUM);
     }
     
     try {
@@ -494,12 +536,12 @@ add_attribute(const string &type, const string &name, const string &value,
     }
     catch (Error &e) {
 	 	// re-throw with line number
-		parse_error(e.get_error_message().c_str(), das_line_num);
+		parse_error(e.get_error_message().c_str(), LINE_NUM);
     }
 }
 
 static void
-add_alias(AttrTable *das, AttrTable *current, const string &name, 
+add_alias(das_parser_state *state, AttrTable *das, AttrTable *current, const string &name,
 	  const string &src) throw (Error)
 {
     DBG(cerr << "Adding an alias: " << name << ": " << src << endl);
@@ -510,7 +552,7 @@ add_alias(AttrTable *das, AttrTable *current, const string &name,
 	    current->add_container_alias(name, table);
 	}
 	catch (Error &e) {
-	    parse_error(e.get_error_message().c_str(), das_line_num);
+	    parse_error(e.get_error_message().c_str(), LINE_NUM);
 	}
     }
     else {
@@ -518,7 +560,7 @@ add_alias(AttrTable *das, AttrTable *current, const string &name,
 	    current->add_value_alias(das, name, src);
 	}
 	catch (Error &e) {
-	    parse_error(e.get_error_message().c_str(), das_line_num);
+	    parse_error(e.get_error_message().c_str(), LINE_NUM);
 	}
     }
 }
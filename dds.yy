@@ -34,14 +34,14 @@
    generator to build a parser for the DDS. It assumes that a scanner called
    `ddslex()' exists and returns several token types (see das.tab.h)
    in addition to several single character token types. The matched lexeme
-   for an ID is stored by the scanner in a global char * `ddslval'.
-   Because the scanner returns a value via this global and because the parser
-   stores ddslval (not the information pointed to), the values of rule
-   components must be stored as they are parsed and used once accumulated at
-   or near the end of a rule. If ddslval returned a value (instead of a
-   pointer to a value) this would not be necessary.
+   for an ID is stored by the scanner in the value passed to it by the
+   parser.
 
    jhrg 8/29/94 
+
+   The parser is pure and keeps the state of a parse in a dds_parser_state
+   object, so several threads can parse DDS objects at once. Use dds_parse()
+   to parse a DDS.
 */
 
 %code requires {
@@ -87,17 +87,46 @@ using namespace libdap;
 
 // #define YYPARSE_PARAM arg
 
-extern int dds_line_num;	/* defined in dds.lex */
+struct dds_parser_state;    // The state of one parse; see below
 
 } // code requires
 
 %code {
 
+// Glue routines defined in dds.lex
+void *dds_scanner(FILE *fp);
+void dds_delete_scanner(void *scanner);
+
+int ddslex(YYSTYPE *lvalp, void *scanner);
+int ddsget_lineno(void *scanner);
+
+void error_exit_cleanup(dds_parser_state *state);
+
 // No global static objects in the dap library! 1/24/2000 jhrg
-static stack<BaseType *> *ctor;
-static BaseType *current;
-static string *id;
-static Part part = nil;		/* Part is defined in BaseType */
+//
+// All of the state of one parse is held here, so parses in different
+// threads do not share anything.
+struct dds_parser_state {
+    void *scanner;              // see dds.lex
+
+    stack<BaseType *> *ctor;
+    BaseType *current;
+    string *id;
+    Part part;                  /* Part is defined in BaseType */
+
+    dds_parser_state(FILE *in) : scanner(dds_scanner(in)), ctor(0), current(0), id(0), part(nil)
+    {}
+    ~dds_parser_state()
+    {
+        // Frees anything left by a parse that failed
+        error_exit_cleanup(this);
+        dds_delete_scanner(scanner);
+    }
+};
+
+// The line number used in error messages; 'state' is the parser state
+// passed to the parser (and to the functions below).
+#define LINE_NUM (ddsget_lineno(state->scanner))
 
 static const char *NO_DDS_MSG =
 "The descriptor object returned from the dataset was null.\n\
@@ -109,21 +138,22 @@ static const char *BAD_DECLARATION =
 of a datatype and that the Array: and Maps: sections of a Grid are\n\
 labeled properly.";
 
-int ddslex();
-void ddserror(parser_arg *arg, const string &s /*char *s*/);
-void error_exit_cleanup();
+static int ddslex(YYSTYPE *lvalp, dds_parser_state *state);
+void ddserror(parser_arg *arg, dds_parser_state *state, const string &s /*char *s*/);
 void add_entry(DDS &table, stack<BaseType *> **ctor, BaseType **current, 
 	       Part p);
-void invalid_declaration(parser_arg *arg, string semantic_err_msg, 
+void invalid_declaration(parser_arg *arg, dds_parser_state *state, string semantic_err_msg,
 			 char *type, char *name);
 
 } // code
 
 %require "2.4"
 
-%parse-param {parser_arg *arg}
+%parse-param {parser_arg *arg} {dds_parser_state *state}
+%lex-param {dds_parser_state *state}
 %name-prefix "dds"
 // %define api.prefix {dds}
+%define api.pure full
 %defines
 %debug
 %verbose
@@ -161,17 +191,17 @@ void invalid_declaration(parser_arg *arg, string semantic_err_msg,
 start:
         {
 		    /* On entry to the parser, make the BaseType stack. 
-		       I use if (!ctor) here because in the tab.cc file,
+		       I use if (!state->ctor) here because in the tab.cc file,
 		       this is a case block in a switch, so it could be
 		       run more than once, causing the storage to be
 		       overwritten. jhrg 6/26/15 */
 		       
-		    if (!ctor)
-		    	ctor = new stack<BaseType *>;
+		    if (!state->ctor)
+		    	state->ctor = new stack<BaseType *>;
         }
         datasets
         {
-		    delete ctor; ctor = 0;
+		    delete state->ctor; state->ctor = 0;
 		}
 ;
 
@@ -185,8 +215,8 @@ dataset:	SCAN_DATASET '{' declarations '}' name ';'
 		}
         | error
         {
-		    parse_error((parser_arg *)arg, NO_DDS_MSG, dds_line_num, $<word>1);
-		    error_exit_cleanup();
+		    parse_error((parser_arg *)arg, NO_DDS_MSG, LINE_NUM, $<word>1);
+		    error_exit_cleanup(state);
 		    YYABORT;
 		}
 ;
@@ -208,11 +238,11 @@ declarations:	/* empty */
 declaration:  base_type var ';' 
         { 
 		    string smsg;
-		    if (current->check_semantics(smsg)) {
-			    add_entry(*DDS_OBJ(arg), &ctor, &current, part); 
+		    if (state->current->check_semantics(smsg)) {
+			    add_entry(*DDS_OBJ(arg), &state->ctor, &state->current, state->part); 
 		    } else {
-		      invalid_declaration((parser_arg *)arg, smsg, $1, $2);
-		      error_exit_cleanup();
+		      invalid_declaration((parser_arg *)arg, state, smsg, $1, $2);
+		      error_exit_cleanup(state);
 		      YYABORT;
 		    }
             strncpy($$,$2,ID_MAX);
@@ -221,19 +251,19 @@ declaration:  base_type var ';'
 
 		| structure  '{' declarations '}' 
 		{ 
-		    if( current ) delete current ;
-		    current = ctor->top(); 
-		    ctor->pop();
+		    if( state->current ) delete state->current ;
+		    state->current = state->ctor->top(); 
+		    state->ctor->pop();
 		} 
         var ';' 
         { 
 		    string smsg;
-		    if (current->check_semantics(smsg)) {
-			    add_entry(*DDS_OBJ(arg), &ctor, &current, part); 
+		    if (state->current->check_semantics(smsg)) {
+			    add_entry(*DDS_OBJ(arg), &state->ctor, &state->current, state->part); 
 			}
 		    else {
-		        invalid_declaration((parser_arg *)arg, smsg, $1, $6);
-		        error_exit_cleanup();
+		        invalid_declaration((parser_arg *)arg, state, smsg, $1, $6);
+		        error_exit_cleanup(state);
 		        YYABORT;
 		    }
             strncpy($$,$6,ID_MAX);
@@ -242,19 +272,19 @@ declaration:  base_type var ';'
 
 		| sequence '{' declarations '}' 
         { 
-		    if( current ) delete current ;
-		    current = ctor->top(); 
-		    ctor->pop();
+		    if( state->current ) delete state->current ;
+		    state->current = state->ctor->top(); 
+		    state->ctor->pop();
 		} 
         var ';' 
         { 
 		    string smsg;
-		    if (current->check_semantics(smsg)) {
-			    add_entry(*DDS_OBJ(arg), &ctor, &current, part); 
+		    if (state->current->check_semantics(smsg)) {
+			    add_entry(*DDS_OBJ(arg), &state->ctor, &state->current, state->part); 
 			}
 		    else {
-		      invalid_declaration((parser_arg *)arg, smsg, $1, $6);
-		      error_exit_cleanup();
+		      invalid_declaration((parser_arg *)arg, state, smsg, $1, $6);
+		      error_exit_cleanup(state);
 		      YYABORT;
 		    }
             strncpy($$,$6,ID_MAX);
@@ -264,43 +294,43 @@ declaration:  base_type var ';'
 		| grid '{' SCAN_WORD ':'
 		{ 
 		    if (is_keyword(string($3), "array")) {
-			    part = libdap::array;
+			    state->part = libdap::array;
 			}
 		    else {
 			    ostringstream msg;
 			    msg << BAD_DECLARATION;
-			    parse_error((parser_arg *)arg, msg.str().c_str(), dds_line_num, $3);
+			    parse_error((parser_arg *)arg, msg.str().c_str(), LINE_NUM, $3);
 			    YYABORT;
 		    }
         }
         declaration SCAN_WORD ':'
 		{ 
 		    if (is_keyword(string($7), "maps")) {
-			    part = maps; 
+			    state->part = maps; 
 			}
 		    else {
 			    ostringstream msg;
 			    msg << BAD_DECLARATION;
-			    parse_error((parser_arg *)arg, msg.str().c_str(), dds_line_num, $7);
+			    parse_error((parser_arg *)arg, msg.str().c_str(), LINE_NUM, $7);
 			    YYABORT;
 		    }
         }
         declarations '}' 
 		{
-		    if( current ) delete current ;
-		    current = ctor->top(); 
-		    ctor->pop();
+		    if( state->current ) delete state->current ;
+		    state->current = state->ctor->top(); 
+		    state->ctor->pop();
 		}
         var ';' 
         {
 		    string smsg;
-		    if (current->check_semantics(smsg)) {
-			    part = nil; 
-			    add_entry(*DDS_OBJ(arg), &ctor, &current, part); 
+		    if (state->current->check_semantics(smsg)) {
+			    state->part = nil; 
+			    add_entry(*DDS_OBJ(arg), &state->ctor, &state->current, state->part); 
 		    }
 		    else {
-		      invalid_declaration((parser_arg *)arg, smsg, $1, $13);
-		      error_exit_cleanup();
+		      invalid_declaration((parser_arg *)arg, state, smsg, $1, $13);
+		      error_exit_cleanup(state);
 		      YYABORT;
 		    }
         strncpy($$,$13,ID_MAX);
@@ -311,7 +341,7 @@ declaration:  base_type var ';'
         {
 		    ostringstream msg;
 		    msg << BAD_DECLARATION;
-		    parse_error((parser_arg *)arg, msg.str().c_str(), dds_line_num, $<word>1);
+		    parse_error((parser_arg *)arg, msg.str().c_str(), LINE_NUM, $<word>1);
 		    YYABORT;
 		}
 ;
@@ -319,34 +349,34 @@ declaration:  base_type var ';'
 
 structure:	SCAN_STRUCTURE
 		{ 
-		    ctor->push(DDS_OBJ(arg)->get_factory()->NewStructure()); 
+		    state->ctor->push(DDS_OBJ(arg)->get_factory()->NewStructure()); 
 		}
 ;
 
 sequence:	SCAN_SEQUENCE 
 		{ 
-		    ctor->push(DDS_OBJ(arg)->get_factory()->NewSequence()); 
+		    state->ctor->push(DDS_OBJ(arg)->get_factory()->NewSequence()); 
 		}
 ;
 
 grid:		SCAN_GRID 
 		{ 
-		    ctor->push(DDS_OBJ(arg)->get_factory()->NewGrid()); 
+		    state->ctor->push(DDS_OBJ(arg)->get_factory()->NewGrid()); 
 		}
 ;
 
-base_type:	SCAN_BYTE { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewByte(); }
-		| SCAN_INT16 { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewInt16(); }
-		| SCAN_UINT16 { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewUInt16(); }
-		| SCAN_INT32 { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewInt32(); }
-		| SCAN_UINT32 { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewUInt32(); }
-		| SCAN_FLOAT32 { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewFloat32(); }
-		| SCAN_FLOAT64 { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewFloat64(); }
-		| SCAN_STRING { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewStr(); }
-		| SCAN_URL { if( current ) delete current ;current = DDS_OBJ(arg)->get_factory()->NewUrl(); }
+base_type:	SCAN_BYTE { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewByte(); }
+		| SCAN_INT16 { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewInt16(); }
+		| SCAN_UINT16 { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewUInt16(); }
+		| SCAN_INT32 { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewInt32(); }
+		| SCAN_UINT32 { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewUInt32(); }
+		| SCAN_FLOAT32 { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewFloat32(); }
+		| SCAN_FLOAT64 { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewFloat64(); }
+		| SCAN_STRING { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewStr(); }
+		| SCAN_URL { if( state->current ) delete state->current ;state->current = DDS_OBJ(arg)->get_factory()->NewUrl(); }
 ;
 
-var:		var_name { current->set_name($1); }
+var:		var_name { state->current->set_name($1); }
  		| var array_decl
 ;
 
@@ -361,17 +391,17 @@ array_decl:	'[' SCAN_WORD ']'
 		    if (!check_int32($2)) {
 			    string msg = "In the dataset descriptor object:\n";
 			    msg += "Expected an array subscript.\n";
-			    parse_error((parser_arg *)arg, msg.c_str(), dds_line_num, $2);
+			    parse_error((parser_arg *)arg, msg.c_str(), LINE_NUM, $2);
 		    }
-		    if (current->type() == dods_array_c && check_int32($2)) {
-			    ((Array *)current)->append_dim(atoi($2));
+		    if (state->current->type() == dods_array_c && check_int32($2)) {
+			    ((Array *)state->current)->append_dim(atoi($2));
 		    }
 		    else {
 			    Array *a = DDS_OBJ(arg)->get_factory()->NewArray(); 
-			    a->add_var(current); 
+			    a->add_var(state->current); 
 			    a->append_dim(atoi($2));
-			    if( current ) delete current ;
-			    current = a;
+			    if( state->current ) delete state->current ;
+			    state->current = a;
 		    }
 
 		    $$ = true;
@@ -379,29 +409,29 @@ array_decl:	'[' SCAN_WORD ']'
 
 		 | '[' SCAN_WORD 
 		 {
-		     if (!id) id = new string($2);
+		     if (!state->id) state->id = new string($2);
 		 } 
          '=' SCAN_WORD 
          { 
 		     if (!check_int32($5)) {
 			     string msg = "In the dataset descriptor object:\n";
 			     msg += "Expected an array subscript.\n";
-			     parse_error((parser_arg *)arg, msg.c_str(), dds_line_num, $5);
-			     error_exit_cleanup();
+			     parse_error((parser_arg *)arg, msg.c_str(), LINE_NUM, $5);
+			     error_exit_cleanup(state);
 			     YYABORT;
 		     }
-		     if (current->type() == dods_array_c) {
-			     ((Array *)current)->append_dim(atoi($5), *id);
+		     if (state->current->type() == dods_array_c) {
+			     ((Array *)state->current)->append_dim(atoi($5), *state->id);
 		     }
 		     else {
 			     Array *a = DDS_OBJ(arg)->get_factory()->NewArray(); 
-			     a->add_var(current); 
-			     a->append_dim(atoi($5), *id);
-			     if( current ) delete current ;
-			     current = a;
+			     a->add_var(state->current); 
+			     a->append_dim(atoi($5), *state->id);
+			     if( state->current ) delete state->current ;
+			     state->current = a;
 		     }
 
-		     delete id; id = 0;
+		     delete state->id; state->id = 0;
 		 }
 		 ']'
          {
@@ -413,7 +443,7 @@ array_decl:	'[' SCAN_WORD ']'
 		     ostringstream msg;
 		     msg << "In the dataset descriptor object:" << endl
 			     << "Expected an array subscript." << endl;
-		     parse_error((parser_arg *)arg, msg.str().c_str(), dds_line_num, $<word>1);
+		     parse_error((parser_arg *)arg, msg.str().c_str(), LINE_NUM, $<word>1);
 		     YYABORT;
 		 }
 ;
@@ -425,7 +455,7 @@ name:		var_name { (*DDS_OBJ(arg)).set_dataset_name($1); $$ = true;}
 		    ostringstream msg;
 		    msg << "Error parsing the dataset name." << endl
 		        << "The name may be missing or may contain an illegal character." << endl;
-		    parse_error((parser_arg *)arg, msg.str().c_str(), dds_line_num, $<word>1);
+		    parse_error((parser_arg *)arg, msg.str().c_str(), LINE_NUM, $<word>1);
 		    YYABORT;
 		}
 ;
@@ -438,8 +468,26 @@ name:		var_name { (*DDS_OBJ(arg)).set_dataset_name($1); $$ = true;}
  */
 
 void
-ddserror(parser_arg *, const string &)
+ddserror(parser_arg *, dds_parser_state *, const string &)
+{
+}
+
+// Read the next token using the scanner of this parse
+static int
+ddslex(YYSTYPE *lvalp, dds_parser_state *state)
+{
+    return ddslex(lvalp, state->scanner);
+}
+
+/** Parse the DDS read from \c in into the DDS held by \c arg. Each call
+    makes its own scanner and parser state, so several threads can parse
+    DDS objects at the same time.
+    @return The value returned by ddsparse(); zero if the parse worked. */
+int
+dds_parse(FILE *in, parser_arg *arg)
 {
+    dds_parser_state state(in);
+    return ddsparse(arg, &state);
 }
 
 /*
@@ -447,26 +495,26 @@ ddserror(parser_arg *, const string &)
  normal exit.
  */
 
-void error_exit_cleanup()
+void error_exit_cleanup(dds_parser_state *state)
 {
-    delete id;
-    id = 0;
-    delete current;
-    current = 0;
-    delete ctor;
-    ctor = 0;
+    delete state->id;
+    state->id = 0;
+    delete state->current;
+    state->current = 0;
+    delete state->ctor;
+    state->ctor = 0;
 }
 
 /*
  Invalid declaration message.
  */
 
-void invalid_declaration(parser_arg *arg, string semantic_err_msg, char *type, char *name)
+void invalid_declaration(parser_arg *arg, dds_parser_state *state, string semantic_err_msg, char *type, char *name)
 {
     ostringstream msg;
     msg << "In the dataset descriptor object: `" << type << " " << name << "'" << endl << "is not a valid declaration."
             << endl << semantic_err_msg;
-    parse_error((parser_arg *) arg, msg.str().c_str(), dds_line_num);
+    parse_error((parser_arg *) arg, msg.str().c_str(), LINE_NUM);
 }
 
 /*
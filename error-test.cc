@@ -52,10 +52,12 @@ void test_object(Error &err);
 #endif
 void usage();
 
-int Errorlex();
+int Errorlex(YYSTYPE *lvalp, void *scanner);
 //int Errorparse(parser_arg *);
 
-extern YYSTYPE Errorlval;
+// Glue routines declared in Error.lex
+void *Error_scanner(FILE *fp);
+void Error_delete_scanner(void *scanner);
 extern int Errordebug;
 const char *prompt = "error-test: ";
 
@@ -141,11 +143,13 @@ usage()
 void
 test_scanner()
 {
+    void *scanner = Error_scanner(stdin);
+    YYSTYPE lval;
     int tok;
 
     fprintf(stdout, "%s", prompt) ;   // first prompt
     fflush(stdout) ;
-    while ((tok = Errorlex())) {
+    while ((tok = Errorlex(&lval, scanner))) {
         switch (tok) {
         case SCAN_ERROR:
             fprintf(stdout, "ERROR\n") ;
@@ -163,10 +167,10 @@ test_scanner()
             fprintf(stdout, "PROGRAM\n") ;
             break;
         case SCAN_STR:
-            fprintf(stdout, "%s\n", Errorlval.string) ;
+            fprintf(stdout, "%s\n", lval.string) ;
             break;
         case SCAN_INT:
-            fprintf(stdout, "%d\n", Errorlval.integer) ;
+            fprintf(stdout, "%d\n", lval.integer) ;
             break;
         case '{':
             fprintf(stdout, "Left Brace\n") ;
@@ -186,6 +190,8 @@ test_scanner()
         fprintf(stdout, "%s", prompt) ;   // print prompt after output
         fflush(stdout) ;
     }
+
+    Error_delete_scanner(scanner);
 }
 
 void
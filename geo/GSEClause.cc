@@ -46,7 +46,6 @@
 
 #include "GSEClause.h"
 #include "parser.h"
-#include "gse.tab.hh"
 
 using namespace std;
 using namespace libdap;
@@ -94,57 +93,165 @@ GSEClause::set_map_min_max_value(T min, T max)
     d_map_max_value = oss2.str();
 }
 
-// Read the map array, scan, set start and stop.
+// The order of the values in a map vector
+enum map_order { unordered, ascending, descending };
+
+// Are vals[0] to vals[end] in order? Repeated values are allowed. A NaN
+// fails every comparison, so a map that holds one is unordered.
+template<class T>
+static map_order
+find_order(const T *vals, int end)
+{
+    int i = 0;
+    while (i < end && vals[i] == vals[i + 1])
+        ++i;
+
+    if (i >= end)
+        return ascending;   // all the same (or just one value)
+
+    if (vals[i] < vals[i + 1]) {
+        for (; i < end; ++i)
+            if (!(vals[i] <= vals[i + 1]))
+                return unordered;
+        return ascending;
+    }
+    else if (vals[i] > vals[i + 1]) {
+        for (; i < end; ++i)
+            if (!(vals[i] >= vals[i + 1]))
+                return unordered;
+        return descending;
+    }
+
+    return unordered;
+}
+
+// Return the first index in [lo, hi + 1] where compare() is 'state', given
+// that it is !state for all the indices before that one and state for all
+// of those after it.
+template<class T>
+static int
+partition_point(const T *vals, int lo, int hi, relop op, double value, bool state)
+{
+    int count = hi - lo + 1;
+    while (count > 0) {
+        int step = count / 2;
+        int mid = lo + step;
+        if (compare<T>(vals[mid], op, value) != state) {
+            lo = mid + 1;
+            count -= step + 1;
+        }
+        else {
+            count = step;
+        }
+    }
+
+    return lo;
+}
+
+// Scan the map values for one relational operator. Set start to the first
+// index in [start, stop] where the comparison is true and stop to the last
+// one in [0, stop]. If there are none, start is stop + 1 (if start <= stop)
+// and stop is -1. The scan is a binary search if the map is in order.
+template<class T>
+static void
+scan(const T *vals, map_order order, relop op, double value, int &start, int &stop)
+{
+    int s = start;
+    int e = stop;
+
+    if (order == unordered || op == dods_not_equal_op) {
+        // Starting at the current start point in the map (initially index
+        // position zero), scan forward until the comparison is true. Note
+        // that each clause applies to exactly one map. The 'i <= e' test
+        // keeps us from setting start _past_ the end ;-)
+        int i = s;
+        while (i <= e && !compare<T>(vals[i], op, value))
+            i++;
+        start = i;
+
+        // Now scan backward from the end. We scan all the way to the actual
+        // start although it would probably work to stop at 'i >= start'.
+        i = e;
+        while (i >= 0 && !compare<T>(vals[i], op, value))
+            i--;
+        stop = i;
+
+        return;
+    }
+
+    bool up = (order == ascending);
+    switch (op) {
+    case dods_greater_op:
+    case dods_greater_equal_op:
+    case dods_less_op:
+    case dods_less_equal_op: {
+        // The values for which the comparison is true are either at the
+        // end (e.g., 'x > 3' with ascending values) or at the start.
+        bool greater = (op == dods_greater_op || op == dods_greater_equal_op);
+        if (greater == up) {
+            if (s <= e)
+                start = partition_point(vals, s, e, op, value, true);
+            if (e >= 0)
+                stop = compare<T>(vals[e], op, value) ? e : -1;
+        }
+        else {
+            if (s <= e)
+                start = compare<T>(vals[s], op, value) ? s : e + 1;
+            if (e >= 0)
+                stop = partition_point(vals, 0, e, op, value, false) - 1;
+        }
+        break;
+    }
+
+    case dods_equal_op: {
+        // The equal values are a run; find its ends
+        relop before = up ? dods_greater_equal_op : dods_less_equal_op;
+        relop after = up ? dods_less_equal_op : dods_greater_equal_op;
+        if (s <= e) {
+            int i = partition_point(vals, s, e, before, value, true);
+            start = (i <= e && compare<T>(vals[i], op, value)) ? i : e + 1;
+        }
+        if (e >= 0) {
+            int i = partition_point(vals, 0, e, after, value, false) - 1;
+            stop = (i >= 0 && compare<T>(vals[i], op, value)) ? i : -1;
+        }
+        break;
+    }
+
+    default:
+        // Let compare() report the error
+        compare<T>(vals[s], op, value);
+        break;
+    }
+}
+
+// Scan the map values for the clause's operators and set start and stop.
+// The values are read in place.
 template<class T>
 void
 GSEClause::set_start_stop()
 {
-    T *vals = new T[d_map->length()];
-    d_map->value(vals);
+    const T *vals = reinterpret_cast<const T*>(d_map->get_buf());
+    if (!vals)
+        throw Error(malformed_expr, "The map vector '" + d_map->name() + "' has no values.");
 
     // Set the map's max and min values for use in error messages (it's a lot
     // easier to do here, now, than later... 9/20/2001 jhrg)
     set_map_min_max_value<T>(vals[d_start], vals[d_stop]);
 
-    // Starting at the current start point in the map (initially index position
-    // zero), scan forward until the comparison is true. Set the new value
-    // of d_start to that location. Note that each clause applies to exactly
-    // one map. The 'i <= end' test keeps us from setting start _past_ the
-    // end ;-)
-    int i = d_start;
-    int end = d_stop;
-    while (i <= end && !compare<T>(vals[i], d_op1, d_value1))
-        i++;
-
-    d_start = i;
-
-    // Now scan backward from the end. We scan all the way to the actual start
-    // although it would probably work to stop at 'i >= d_start'.
-    i = end;
-    while (i >= 0 && !compare<T>(vals[i], d_op1, d_value1))
-        i--;
-    d_stop = i;
+    // The order is found once for both operators. The second scan below
+    // (and the backward scans) can look at any value up to d_stop.
+    map_order order = find_order(vals, d_stop);
+    DBG(cerr << "Map " << d_map->name() << " order: " << order << endl);
+
+    scan(vals, order, d_op1, d_value1, d_start, d_stop);
 
     // Every clause must have one operator but the second is optional since
-    // the more complex form of a clause is optional. That is, the above two
-    // loops took care of constraints like 'x < 7' but we need the following
+    // the more complex form of a clause is optional. That is, the above
+    // scan took care of constraints like 'x < 7' but we need the following
     // for ones like '3 < x < 7'.
-    if (d_op2 != dods_nop_op) {
-        int i = d_start;
-        int end = d_stop;
-        while (i <= end && !compare<T>(vals[i], d_op2, d_value2))
-            i++;
-
-        d_start = i;
-
-        i = end;
-        while (i >= 0 && !compare<T>(vals[i], d_op2, d_value2))
-            i--;
-
-        d_stop = i;
-    }
-    
-    delete[] vals;
+    if (d_op2 != dods_nop_op)
+        scan(vals, order, d_op2, d_value2, d_start, d_stop);
 }
 
 void
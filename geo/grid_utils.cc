@@ -42,11 +42,10 @@
 using namespace libdap;
 
 int gse_parse(functions::gse_arg *arg);
-void gse_restart(FILE * in);
 
-// Glue routines declared in gse.lex
-void gse_delete_buffer(void *buffer);
-void *gse_string(const char *yy_str);
+// Glue routines declared in gse.ll
+void *gse_scanner(const char *str);
+void gse_delete_scanner(void *scanner);
 
 namespace functions {
 
@@ -122,13 +121,25 @@ bool is_geo_grid(Grid *grid)
 }
 #endif
 
+// The parser is reentrant; each call uses its own scanner, held by 'arg'
+// while the expression is parsed.
 void parse_gse_expression(gse_arg *arg, BaseType *expr)
 {
-    gse_restart(0); // Restart the scanner.
-    void *cls = gse_string(extract_string_argument(expr).c_str());
-    // gse_switch_to_buffer(cls); // Get set to scan the string.
-    bool status = gse_parse(arg) == 0;
-    gse_delete_buffer(cls);
+    void *scanner = gse_scanner(extract_string_argument(expr).c_str());
+    arg->set_scanner(scanner);
+
+    bool status;
+    try {
+        status = gse_parse(arg) == 0;
+    }
+    catch (...) {
+        arg->set_scanner(0);
+        gse_delete_scanner(scanner);
+        throw;
+    }
+
+    arg->set_scanner(0);
+    gse_delete_scanner(scanner);
     if (!status)
         throw Error(malformed_expr, "Error parsing grid selection.");
 }
@@ -28,14 +28,16 @@
 */ 
 
 /*
-  Scanner for grid selection sub-expressions. The scanner is not reentrant,
-  but can share a name space with other scanners.
+  Scanner for grid selection sub-expressions. The scanner is reentrant:
+  each parse makes its own scanner (see gse_scanner()), so many threads can
+  scan grid selection expressions at once.
 
    Note:
    1) The `defines' file gse.tab.h is built using `bison -d'.
    2) Define YY_DECL such that the scanner is called `gse_lex'.
-   3) When bison builds the gse.tab.h file, it uses `gse_' instead
-   of `yy' for variable name prefixes (e.g., yylval --> gse_lval).
+   3) The parser is pure, so there is no global gse_lval; the scanner
+   stores the value of a token using the pointer the parser passes to
+   gse_lex().
 
    1/13/99 jhrg
 */
@@ -53,7 +55,7 @@
 #define YY_PROTO(proto) proto
 #endif
 
-#define YY_DECL int gse_lex YY_PROTO(( void ))
+#define YY_DECL int gse_lex(YYSTYPE *yylval_param, void *yyscanner)
 #define ID_MAX 256
 #define YY_NO_UNPUT 1
 #define YY_NO_INPUT 1
@@ -61,7 +63,7 @@
 /* The call to yy_fatal_error() suppresses a warning message. jhrg 8/20/13 */
 #define YY_FATAL_ERROR(msg) {\
     throw(Error(string("Error scanning grid constraint expression text: ") + string(msg)));\
-    yy_fatal_error("never called");\
+    yy_fatal_error("never called", yyscanner);\
 }
 
 #include "gse.tab.hh"
@@ -69,13 +71,15 @@
 using namespace std;
 using namespace libdap;
 
-static void store_int32();
-static void store_float64();
-static void store_id();
-static void store_op(int op);
+static void store_int32(YYSTYPE *lval, const char *text);
+static void store_float64(YYSTYPE *lval, const char *text);
+static void store_id(YYSTYPE *lval, const char *text);
+static void store_op(YYSTYPE *lval, int op);
 
 %}
 
+%option reentrant
+%option bison-bridge
 %option noyywrap
 %option nounput
 %option 8bit
@@ -108,69 +112,66 @@ NEVER		[^a-zA-Z0-9_/%.#:+\-,]
 
 %%
 
-{SCAN_INT}	store_int32(); return SCAN_INT;
-{SCAN_FLOAT}	store_float64(); return SCAN_FLOAT;
+{SCAN_INT}	store_int32(yylval, yytext); return SCAN_INT;
+{SCAN_FLOAT}	store_float64(yylval, yytext); return SCAN_FLOAT;
 
-{SCAN_WORD}	store_id(); return SCAN_WORD;
+{SCAN_WORD}	store_id(yylval, yytext); return SCAN_WORD;
 
-{SCAN_EQUAL}	store_op(SCAN_EQUAL); return SCAN_EQUAL;
-{SCAN_NOT_EQUAL} store_op(SCAN_NOT_EQUAL); return SCAN_NOT_EQUAL;
-{SCAN_GREATER}	store_op(SCAN_GREATER); return SCAN_GREATER;
-{SCAN_GREATER_EQL} store_op(SCAN_GREATER_EQL); return SCAN_GREATER_EQL;
-{SCAN_LESS}	store_op(SCAN_LESS); return SCAN_LESS;
-{SCAN_LESS_EQL}	store_op(SCAN_LESS_EQL); return SCAN_LESS_EQL;
+{SCAN_EQUAL}	store_op(yylval, SCAN_EQUAL); return SCAN_EQUAL;
+{SCAN_NOT_EQUAL} store_op(yylval, SCAN_NOT_EQUAL); return SCAN_NOT_EQUAL;
+{SCAN_GREATER}	store_op(yylval, SCAN_GREATER); return SCAN_GREATER;
+{SCAN_GREATER_EQL} store_op(yylval, SCAN_GREATER_EQL); return SCAN_GREATER_EQL;
+{SCAN_LESS}	store_op(yylval, SCAN_LESS); return SCAN_LESS;
+{SCAN_LESS_EQL}	store_op(yylval, SCAN_LESS_EQL); return SCAN_LESS_EQL;
 
 %%
 
-// Three glue routines for string scanning. These are not declared in the
-// header gse.tab.h nor is YY_BUFFER_STATE. Including these here allows them
-// to see the type definitions in lex.gse.c (where YY_BUFFER_STATE is
-// defined) and allows callers to declare them (since callers outside of this
-// file cannot declare YY_BUFFER_STATE variable).
+// Two glue routines for string scanning. These are not declared in the
+// header gse.tab.h. Including them here allows them to see the definitions
+// in lex.gse.cc and allows callers to declare them (yyscan_t is a void
+// pointer).
 
 void *
-gse_string(const char *str)
+gse_scanner(const char *str)
 {
-    return (void *)gse__scan_string(str);
-}
+    yyscan_t scanner;
+    if (gse_lex_init(&scanner) != 0)
+        throw Error(internal_error, "Could not make the grid selection expression scanner.");
 
-void
-gse_switch_to_buffer(void *buf)
-{
-    gse__switch_to_buffer((YY_BUFFER_STATE)buf);
+    gse__scan_string(str, scanner);
+    return scanner;
 }
 
 void
-gse_delete_buffer(void *buf)
+gse_delete_scanner(void *scanner)
 {
-    gse__delete_buffer((YY_BUFFER_STATE)buf);
+    gse_lex_destroy(scanner);
 }
 
 // Note that the grid() CE function only deals with numeric maps (8/28/2001
 // jhrg) and that all comparisons are done using doubles. 
 
 static void
-store_int32()
+store_int32(YYSTYPE *lval, const char *text)
 {
-    gse_lval.val = atof(yytext);
+    lval->val = atof(text);
 }
 
 static void
-store_float64()
+store_float64(YYSTYPE *lval, const char *text)
 {
-    gse_lval.val = atof(yytext);
+    lval->val = atof(text);
 }
 
 static void
-store_id()
+store_id(YYSTYPE *lval, const char *text)
 {
-    strncpy(gse_lval.id, yytext, ID_MAX-1);
-    gse_lval.id[ID_MAX-1] = '\0';
+    strncpy(lval->id, text, ID_MAX-1);
+    lval->id[ID_MAX-1] = '\0';
 }
 
 static void
-store_op(int op)
+store_op(YYSTYPE *lval, int op)
 {
-    gse_lval.op = op;
+    lval->op = op;
 }
-
@@ -58,7 +58,8 @@ using namespace functions;
 
 %code {
 
-int gse_lex(void);
+int gse_lex(YYSTYPE *lvalp, void *scanner);	// the scanner; see gse.ll
+static int gse_lex(YYSTYPE *lvalp, gse_arg *arg);
 void gse_error(gse_arg *arg, const char *str);
 GSEClause *build_gse_clause(gse_arg *arg, char id[ID_MAX], int op, double val);
 GSEClause *build_rev_gse_clause(gse_arg *arg, char id[ID_MAX], int op,
@@ -72,7 +73,9 @@ build_dual_gse_clause(gse_arg *arg, char id[ID_MAX], int op1, double val1,
 %require "2.4"
 
 %parse-param {gse_arg *arg}
+%lex-param {gse_arg *arg}
 %name-prefix "gse_"
+%define api.pure full
 %defines
 %debug
 %verbose
@@ -142,6 +145,13 @@ relop:	SCAN_EQUAL
 
 %%
 
+// Read the next token using the scanner in 'arg'
+static int
+gse_lex(YYSTYPE *lvalp, gse_arg *arg)
+{
+    return gse_lex(lvalp, arg->get_scanner());
+}
+
 void
 gse_error(gse_arg *, const char *)
 {
@@ -49,10 +49,11 @@ struct gse_arg
     GSEClause *_gsec;           // The gse parsed.
     libdap::Grid *_grid;                // The Grid being constrained.
     int _status;                // The parser's status.
+    void *_scanner;             // The scanner; see gse_scanner() in gse.ll
 
-    gse_arg(): _gsec(0), _grid(0), _status(1)
+    gse_arg(): _gsec(0), _grid(0), _status(1), _scanner(0)
     {}
-    gse_arg(libdap::Grid *g): _gsec(0), _grid(g), _status(1)
+    gse_arg(libdap::Grid *g): _gsec(0), _grid(g), _status(1), _scanner(0)
     {}
     virtual ~gse_arg()
     {}
@@ -81,6 +82,14 @@ struct gse_arg
     {
         return _status;
     }
+    void set_scanner(void *scanner)
+    {
+        _scanner = scanner;
+    }
+    void *get_scanner()
+    {
+        return _scanner;
+    }
 };
 
 } // namespace libdap
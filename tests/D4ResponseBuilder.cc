@@ -119,9 +119,10 @@ void D4ResponseBuilder::send_dmr(ostream &out, DMR &dmr, bool with_mime_headers,
 {
 	if (with_mime_headers) set_mime_text(out, dap4_dmr, x_plain, last_modified_time(d_dataset), dmr.dap_version());
 
-	XMLWriter xml;
+	XMLWriter xml(out);
 	dmr.print_dap4(xml, constrained /* true == constrained */);
-	out << xml.get_doc() << flush;
+	xml.end_doc();
+	out << flush;
 }
 
 void D4ResponseBuilder::send_dap(ostream &out, DMR &dmr, bool with_mime_headers, bool constrained)
@@ -152,9 +153,17 @@ void D4ResponseBuilder::send_dap(ostream &out, DMR &dmr, bool with_mime_headers,
 	    // using flush means that the DMR and CRLF are in the first chunk.
 	    cos << xml.get_doc() << CRLF << flush;
 
-	    // Write the data, chunked with checksums
-	    D4StreamMarshaller m(cos);
-	    dmr.root()->serialize(m, dmr, constrained);
+	    // Write the data, chunked with checksums. If that fails, replace the
+	    // buffered data with an error chunk; the marshaller (and its writer
+	    // thread) must be gone first.
+	    try {
+	        D4StreamMarshaller m(cos);
+	        dmr.root()->serialize(m, dmr, constrained);
+	    }
+	    catch (Error &e) {
+	        cos.write_err_chunk(e.get_error_message());
+	        throw;
+	    }
 
 		out << flush;
 
@@ -56,6 +56,7 @@ public:
 		setVersion("1.0");
 
 		setFunction(function_scale_dap4);
+		setResultIsNew(true);
     }
     virtual ~D4TestFunction()
     {
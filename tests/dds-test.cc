@@ -52,9 +52,11 @@ void test_scanner();
 void test_parser(const string &name);
 void test_class();
 
-int ddslex();
+int ddslex(YYSTYPE *lvalp, void *scanner);
 
-extern YYSTYPE ddslval;
+// Glue routines declared in dds.lex
+void *dds_scanner(FILE *fp);
+void dds_delete_scanner(void *scanner);
 extern int ddsdebug;
 static bool print_ddx = false;
 
@@ -121,11 +123,13 @@ int main(int argc, char *argv[])
 
 void test_scanner(void)
 {
+    void *scanner = dds_scanner(stdin);
+    YYSTYPE lval;
     int tok;
 
     cout << prompt << flush; // first prompt
 
-    while ((tok = ddslex())) {
+    while ((tok = ddslex(&lval, scanner))) {
         switch (tok) {
         case SCAN_DATASET:
             cout << "DATASET" << endl;
@@ -173,7 +177,7 @@ void test_scanner(void)
             cout << "Url" << endl;
             break;
         case SCAN_WORD:
-            cout << "WORD: " << ddslval.word << endl;
+            cout << "WORD: " << lval.word << endl;
             break;
         case '{':
             cout << "Left Brace" << endl;
@@ -202,6 +206,8 @@ void test_scanner(void)
         }
         cout << prompt << flush; // print prompt after output
     }
+
+    dds_delete_scanner(scanner);
 }
 
 void test_parser(const string &name)
@@ -27,6 +27,7 @@
 #include "config.h"
 
 #include <stdint.h>
+#include <cstdlib>
 #include <cstring>
 
 #include <fstream>
@@ -69,6 +70,8 @@
 
 int test_variable_sleep_interval = 0;   // Used in Test* classes for testing timeouts.
 
+static unsigned int function_threads = 1;   // Threads used to evaluate functions (-T)
+
 using namespace libdap;
 
 /**
@@ -160,6 +163,7 @@ send_data(DMR *dataset, const string &constraint, const string &function, bool s
 
 		D4FunctionEvaluator parser(dataset, sf_list);
 		if (ce_parser_debug) parser.set_trace_parsing(true);
+		parser.set_function_threads(function_threads);
 		bool parse_ok = parser.parse(function);
 		if (!parse_ok)
 			Error("Function Expression failed to parse.");
@@ -233,18 +237,20 @@ read_data_plain(const string &file_name, bool debug)
         // force chunk read
         // get chunk size
         int chunk_size = cis.read_next_chunk();
-        // get chunk
-        char chunk[chunk_size];
-        cis.read(chunk, chunk_size);
-        // parse char * with given size
+        // The chunk holds the DMR and the CRLF pair that ends it
+        if (chunk_size < 2)
+            throw Error("The DMR chunk of the data response is too short.");
+
+        // parse the DMR directly from the chunked stream
     	D4ParserSax2 parser;
 
     	// Mirror the behavior in D4Connect where we are permissive with DAP4
     	// data responses' parsing, as per Hyrax-98 in Jira. jhrg 4/13/16
     	parser.set_strict(false);
 
-    	// '-2' to discard the CRLF pair
-        parser.intern(chunk, chunk_size-2, dmr, debug);
+    	// '-2' to leave the CRLF pair; then discard it
+        parser.intern(cis, chunk_size - 2, dmr, debug);
+        cis.ignore(2);
     }
     catch(Error &e) {
     	delete factory;
@@ -276,13 +282,14 @@ read_data_plain(const string &file_name, bool debug)
 
 static void usage()
 {
-    cerr << "Usage: dmr-test -p|s|t|i <file> [-c <expr>] [-f <function expression>] [-d -x -e]" << endl
+    cerr << "Usage: dmr-test -p|s|t|i <file> [-c <expr>] [-f <function expression>] [-T <threads>] [-d -x -e]" << endl
             << "p: Parse a file (use \"-\" for stdin; if a ce or a function is passed those are parsed too)" << endl
             << "s: Send: parse and then 'send' a response to a file" << endl
             << "t: Transmit: parse, send and then read the response file" << endl
             << "i: Intern values (ce and function will be ignored by this)" << endl
             << "c: Constraint expression " << endl
             << "f: Function expression" << endl
+            << "T: Evaluate the functions using this many threads" << endl
             << "d: turn on detailed xml parser debugging" << endl
             << "D: turn on detailed ce parser debugging" << endl
             << "x: print the binary object(s) built by the parse, send, trans or intern operations." << endl
@@ -292,7 +299,7 @@ static void usage()
 int
 main(int argc, char *argv[])
 {
-    GetOpt getopt(argc, argv, "p:s:t:i:c:f:xdDeh?");
+    GetOpt getopt(argc, argv, "p:s:t:i:c:f:T:xdDeh?");
     int option_char;
     bool parse = false;
     bool debug = false;
@@ -342,6 +349,10 @@ main(int argc, char *argv[])
         	function = getopt.optarg;
         	break;
 
+        case 'T':
+            function_threads = atoi(getopt.optarg);
+            break;
+
         case 'd':
             debug = true;
             break;
@@ -86,7 +86,7 @@ int test_variable_sleep_interval = 0;   // Used in Test* classes for testing
 #define YY_BUFFER_STATE (void *)
 
 void test_scanner(const string & str);
-void test_scanner(bool show_prompt);
+void test_scanner(void *scanner, bool show_prompt);
 void test_parser(ConstraintEvaluator & eval, DDS & table,
                  const string & dds_name, string constraint);
 bool read_table(DDS & table, const string & name, bool print);
@@ -96,14 +96,14 @@ void constrained_trans(const string & dds_name, const bool constraint_expr,
 void intern_data_test(const string & dds_name, const bool constraint_expr,
                  const string & ce, const bool series_values);
 
-int ce_exprlex();               // exprlex() uses the global ce_exprlval
+int ce_exprlex(CE_EXPRSTYPE *lvalp, void *scanner);    // the reentrant scanner
 // int ce_exprparse(void *arg);
-void ce_exprrestart(FILE * in);
+int ce_exprlex_init(void **scanner);
+int ce_exprlex_destroy(void *scanner);
 
-// Glue routines declared in expr.lex
-void ce_expr_switch_to_buffer(void *new_buffer);
-void ce_expr_delete_buffer(void *buffer);
-void *ce_expr_string(const char *yy_str);
+// Glue routines declared in ce_expr.lex
+void *ce_expr_scanner(const char *str);
+void ce_expr_delete_scanner(void *scanner);
 
 extern int ce_exprdebug;
 
@@ -239,8 +239,13 @@ int main(int argc, char *argv[])
         if (scanner_test) {
             if (scan_string)
                 test_scanner(constraint);
-            else
-                test_scanner(true);
+            else {
+                // A scanner with no input reads from stdin
+                void *scanner = 0;
+                ce_exprlex_init(&scanner);
+                test_scanner(scanner, true);
+                ce_exprlex_destroy(scanner);
+            }
 
             exit(0);
         }
@@ -278,52 +283,51 @@ int main(int argc, char *argv[])
 
 void test_scanner(const string & str)
 {
-    ce_exprrestart(0);
-    void *buffer = ce_expr_string(str.c_str());
-    ce_expr_switch_to_buffer(buffer);
+    void *scanner = ce_expr_scanner(str.c_str());
 
-    test_scanner(false);
+    test_scanner(scanner, false);
 
-    ce_expr_delete_buffer(buffer);
+    ce_expr_delete_scanner(scanner);
 }
 
-void test_scanner(bool show_prompt)
+void test_scanner(void *scanner, bool show_prompt)
 {
     if (show_prompt)
         cout << prompt;
 
+    CE_EXPRSTYPE lval;
     int tok;
-    while ((tok = ce_exprlex())) {
+    while ((tok = ce_exprlex(&lval, scanner))) {
         switch (tok) {
         case SCAN_WORD:
-            cout << "WORD: " << ce_exprlval.id << endl;
+            cout << "WORD: " << lval.id << endl;
             break;
         case SCAN_STR:
-            cout << "STR: " << *ce_exprlval.str << endl;
+            cout << "STR: " << *lval.str << endl;
             break;
         case SCAN_EQUAL:
-            cout << "EQUAL: " << ce_exprlval.op << endl;
+            cout << "EQUAL: " << lval.op << endl;
             break;
         case SCAN_NOT_EQUAL:
-            cout << "NOT_EQUAL: " << ce_exprlval.op << endl;
+            cout << "NOT_EQUAL: " << lval.op << endl;
             break;
         case SCAN_GREATER:
-            cout << "GREATER: " << ce_exprlval.op << endl;
+            cout << "GREATER: " << lval.op << endl;
             break;
         case SCAN_GREATER_EQL:
-            cout << "GREATER_EQL: " << ce_exprlval.op << endl;
+            cout << "GREATER_EQL: " << lval.op << endl;
             break;
         case SCAN_LESS:
-            cout << "LESS: " << ce_exprlval.op << endl;
+            cout << "LESS: " << lval.op << endl;
             break;
         case SCAN_LESS_EQL:
-            cout << "LESS_EQL: " << ce_exprlval.op << endl;
+            cout << "LESS_EQL: " << lval.op << endl;
             break;
         case SCAN_REGEXP:
-            cout << "REGEXP: " << ce_exprlval.op << endl;
+            cout << "REGEXP: " << lval.op << endl;
             break;
         case SCAN_STAR:
-            cout << "STAR: " << ce_exprlval.op << endl;
+            cout << "STAR: " << lval.op << endl;
             break;
         case '.':
             cout << "Field Selector" << endl;
@@ -0,0 +1,305 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Time DAP2 requests answered by DAP2RequestHandler in a pool of threads
+// and, for comparison, by a DODSFilter in a new process for each request.
+// The dataset is a DDS file (and, optionally, a DAS file) read using the
+// Test* types, so the values are made up.
+
+#include "config.h"
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "GetOpt.h"
+
+#include "DAS.h"
+#include "DDS.h"
+#include "ConstraintEvaluator.h"
+#include "DODSFilter.h"
+#include "DAP2RequestHandler.h"
+#include "Error.h"
+
+#include "TestTypeFactory.h"
+
+using namespace std;
+using namespace libdap;
+
+int test_variable_sleep_interval = 0;   // Used in Test* classes for testing
+                                      // timeouts.
+
+static string das_file = "";
+
+// Serve a DDS file and the DAS file named with -a
+class FileHandler: public DAP2RequestHandler {
+protected:
+    virtual void build_dds(const string &dataset, DDS &dds)
+    {
+        dds.parse(dataset);
+    }
+
+    virtual void build_das(const string &, DAS &das)
+    {
+        if (!das_file.empty())
+            das.parse(das_file);
+    }
+
+public:
+    FileHandler(BaseTypeFactory *factory) : DAP2RequestHandler(factory) { }
+};
+
+struct bench_arg {
+    DAP2RequestHandler *handler;
+    DODSFilter::Response response;
+    string dataset;
+    string ce;
+    long timeout;
+    int requests;
+    unsigned long long bytes;
+    int errors;
+};
+
+static void *run_requests(void *arg)
+{
+    bench_arg *ba = static_cast<bench_arg*>(arg);
+    for (int i = 0; i < ba->requests; ++i) {
+        DAP2Request request(ba->response, ba->dataset, ba->ce);
+        request.set_timeout(ba->timeout);
+
+        ostringstream oss;
+        try {
+            ba->handler->handle(request, oss);
+        }
+        catch (Error &e) {
+            cerr << "Error: " << e.get_error_message() << endl;
+            ++ba->errors;
+        }
+
+        ba->bytes += oss.str().size();
+    }
+
+    return 0;
+}
+
+// What a forked filter program does for each request
+static void filter_request(DODSFilter::Response response, const string &dataset, const string &ce)
+{
+    TestTypeFactory factory;
+    DODSFilter df;
+    df.set_dataset_name(dataset);
+    df.set_ce(ce);
+
+    DDS dds(&factory);
+    dds.parse(dataset);
+    DAS das;
+    if (!das_file.empty())
+        das.parse(das_file);
+    dds.transfer_attributes(&das);
+
+    ConstraintEvaluator eval;
+    ostringstream oss;
+    switch (response) {
+    case DODSFilter::DAS_Response:
+        df.send_das(oss, das);
+        break;
+    case DODSFilter::DDS_Response:
+        df.send_dds(oss, dds, eval, !ce.empty());
+        break;
+    case DODSFilter::DDX_Response:
+        df.send_ddx(dds, eval, oss);
+        break;
+    default:
+        df.send_data(dds, eval, oss);
+        break;
+    }
+}
+
+static double elapsed(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+static void usage(const string &name)
+{
+    cerr << "Usage: " << name << " [-r das|dds|ddx|dods] [-e ce] [-a das_file] [-n requests] [-t threads] [-T ms] [-f] dds_file"
+        << endl << "r: The response (default: dods)." << endl << "e: The constraint expression." << endl
+        << "a: Read the DAS from this file." << endl << "n: The number of requests (default: 1000)." << endl
+        << "t: Use this many threads or, with -f, processes at once (default: 4)." << endl
+        << "T: The deadline of each request in milliseconds (default: none)." << endl
+        << "f: Fork a DODSFilter for each request instead of using DAP2RequestHandler." << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    GetOpt getopt(argc, argv, "r:e:a:n:t:T:fh");
+    int option_char;
+
+    DODSFilter::Response response = DODSFilter::DataDDS_Response;
+    string ce = "";
+    int requests = 1000;
+    int threads = 4;
+    long timeout = 0;
+    bool fork_filter = false;
+
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'r': {
+            string r = getopt.optarg;
+            if (r == "das")
+                response = DODSFilter::DAS_Response;
+            else if (r == "dds")
+                response = DODSFilter::DDS_Response;
+            else if (r == "ddx")
+                response = DODSFilter::DDX_Response;
+            else
+                response = DODSFilter::DataDDS_Response;
+            break;
+        }
+        case 'e':
+            ce = getopt.optarg;
+            break;
+        case 'a':
+            das_file = getopt.optarg;
+            break;
+        case 'n':
+            requests = atoi(getopt.optarg);
+            break;
+        case 't':
+            threads = atoi(getopt.optarg);
+            break;
+        case 'T':
+            timeout = atol(getopt.optarg);
+            break;
+        case 'f':
+            fork_filter = true;
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+
+    if (getopt.optind >= argc || threads < 1 || requests < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    string dataset = argv[getopt.optind];
+
+    try {
+        struct timeval start;
+        gettimeofday(&start, 0);
+
+        if (fork_filter) {
+            int running = 0, failed = 0;
+            for (int i = 0; i < requests; ++i) {
+                if (running == threads) {
+                    int status;
+                    wait(&status);
+                    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+                    --running;
+                }
+
+                pid_t pid = fork();
+                if (pid < 0) {
+                    cerr << "Could not fork." << endl;
+                    return 1;
+                }
+                if (pid == 0) {
+                    try {
+                        filter_request(response, dataset, ce);
+                    }
+                    catch (Error &e) {
+                        cerr << "Error: " << e.get_error_message() << endl;
+                        _exit(1);
+                    }
+                    _exit(0);
+                }
+                ++running;
+            }
+
+            while (running-- > 0) {
+                int status;
+                wait(&status);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+            }
+
+            double seconds = elapsed(start);
+            cout << "DODSFilter, one process per request: " << requests << " requests, " << threads
+                << " at once, in " << seconds << "s (" << requests / seconds << " requests/s); " << failed
+                << " failed" << endl;
+        }
+        else {
+            TestTypeFactory factory;
+            FileHandler handler(&factory);
+
+            vector<bench_arg> args(threads);
+            vector<pthread_t> ids(threads);
+            for (int i = 0; i < threads; ++i) {
+                bench_arg &ba = args[i];
+                ba.handler = &handler;
+                ba.response = response;
+                ba.dataset = dataset;
+                ba.ce = ce;
+                ba.timeout = timeout;
+                ba.requests = requests / threads + (i < requests % threads ? 1 : 0);
+                ba.bytes = 0;
+                ba.errors = 0;
+                if (pthread_create(&ids[i], 0, run_requests, &ba) != 0) {
+                    cerr << "Could not start a thread." << endl;
+                    return 1;
+                }
+            }
+
+            unsigned long long bytes = 0;
+            int errors = 0;
+            for (int i = 0; i < threads; ++i) {
+                pthread_join(ids[i], 0);
+                bytes += args[i].bytes;
+                errors += args[i].errors;
+            }
+
+            double seconds = elapsed(start);
+            cout << "DAP2RequestHandler: " << requests << " requests, " << threads << " threads, in " << seconds
+                << "s (" << requests / seconds << " requests/s); " << bytes << " bytes, " << errors << " errors; "
+                << handler.template_misses() << " templates built" << endl;
+        }
+    }
+    catch (Error &e) {
+        cerr << "Error: " << e.get_error_message() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -36,6 +36,8 @@
 #include <unistd.h>
 #endif
 
+#include <pthread.h>
+
 #include "GNURegex.h"
 #include "AttrTable.h"
 #include "debug.h"
@@ -64,6 +66,28 @@ static string build_fqn(AttrTable *at, string fqn)
 
 namespace libdap {
 
+// Search a table from several threads at once
+struct find_arg {
+    AttrTable *d_table;
+    int d_errors;
+};
+
+static void *find_attrs(void *arg)
+{
+    find_arg &fa = *static_cast<find_arg*>(arg);
+    for (int i = 1; i < 1000; ++i) {
+        ostringstream oss;
+        oss << "attr " << i;
+        AttrTable::Attr_iter p = fa.d_table->simple_find(oss.str());
+        if (p == fa.d_table->attr_end() || fa.d_table->get_name(p) != oss.str())
+            ++fa.d_errors;
+        if ((i % 10 == 0) != (fa.d_table->simple_find_container(oss.str()) != 0))
+            ++fa.d_errors;
+    }
+
+    return 0;
+}
+
 class AttrTableTest: public TestFixture {
 private:
     AttrTable *at1;
@@ -149,14 +173,130 @@ public:
     CPPUNIT_TEST (get_attr_iter_test);
     CPPUNIT_TEST (del_attr_table_test);
     CPPUNIT_TEST (append_attr_vector_test);
+    CPPUNIT_TEST (get_attr_values_test);
     CPPUNIT_TEST (print_xml_test);
     CPPUNIT_TEST (print_simple_test);
+    CPPUNIT_TEST (large_table_test);
+    CPPUNIT_TEST (large_table_alias_test);
+    CPPUNIT_TEST (large_table_threads_test);
 
     CPPUNIT_TEST_SUITE_END();
 
     // Tests for methods
 
     // This is to test for leaks in the clone() method.
+    // Tables this big are searched using an index
+    void large_table_test()
+    {
+        AttrTable at;
+        for (int i = 0; i < 100; ++i) {
+            ostringstream oss;
+            oss << "attr%20" << i;
+            if (i % 10 == 0)
+                at.append_container(oss.str())->append_attr("value", "Int32", "1");
+            else
+                at.append_attr(oss.str(), "Int32", "1");
+        }
+
+        CPPUNIT_ASSERT(at.get_size() == 100);
+        CPPUNIT_ASSERT(at.get_attr_num("attr 3") == 1);
+        CPPUNIT_ASSERT(at.simple_find("attr 99") == at.attr_begin() + 99);
+        CPPUNIT_ASSERT(at.simple_find("attr 100") == at.attr_end());
+        CPPUNIT_ASSERT(at.get_attr_table("attr 10") == at.get_attr_table(at.attr_begin() + 10));
+        CPPUNIT_ASSERT(at.get_attr_table("attr 11") == 0);
+        CPPUNIT_ASSERT(at.find_container("attr 20")->get_attr("value") == "1");
+
+        // A value appended to an existing attribute
+        CPPUNIT_ASSERT(at.append_attr("attr%2033", "Int32", "2") == 2);
+        CPPUNIT_ASSERT(at.get_size() == 100);
+        CPPUNIT_ASSERT_THROW(at.append_attr("attr 33", "String", "2"), Error);
+        CPPUNIT_ASSERT_THROW(at.append_container("attr%2040"), Error);
+
+        at.del_attr("attr 5");
+        CPPUNIT_ASSERT(at.get_size() == 99);
+        CPPUNIT_ASSERT(at.simple_find("attr 5") == at.attr_end());
+        CPPUNIT_ASSERT(at.simple_find("attr 6") == at.attr_begin() + 5);
+
+        at.del_attr_table(at.attr_begin());
+        CPPUNIT_ASSERT(at.get_attr_table("attr 0") == 0);
+        CPPUNIT_ASSERT(at.simple_find("attr 6") == at.attr_begin() + 4);
+
+        AttrTable copy(at);
+        CPPUNIT_ASSERT(copy.get_attr_table("attr 90") && copy.get_attr_table("attr 90") != at.get_attr_table("attr 90"));
+
+        at.erase();
+        CPPUNIT_ASSERT(at.simple_find("attr 6") == at.attr_end());
+    }
+
+    // The index is current after every change, so lookups, which may be
+    // made by several threads, only read it
+    void large_table_threads_test()
+    {
+        AttrTable at;
+        for (int i = 0; i < 1000; ++i) {
+            ostringstream oss;
+            oss << "attr%20" << i;
+            if (i % 10 == 0)
+                at.append_container(oss.str())->append_attr("value", "Int32", "1");
+            else
+                at.append_attr(oss.str(), "Int32", "1");
+        }
+        CPPUNIT_ASSERT(at.m_use_index());
+
+        at.del_attr("attr 0");
+        CPPUNIT_ASSERT(at.m_use_index());
+
+        AttrTable copy(at);
+        CPPUNIT_ASSERT(copy.m_use_index());
+
+        const int num_threads = 8;
+        pthread_t threads[num_threads];
+        find_arg args[num_threads];
+        for (int t = 0; t < num_threads; ++t) {
+            args[t].d_table = &copy;
+            args[t].d_errors = 0;
+            CPPUNIT_ASSERT(pthread_create(&threads[t], 0, find_attrs, &args[t]) == 0);
+        }
+
+        int errors = 0;
+        for (int t = 0; t < num_threads; ++t) {
+            pthread_join(threads[t], 0);
+            errors += args[t].d_errors;
+        }
+
+        CPPUNIT_ASSERT(errors == 0);
+
+        // A small table is searched without an index
+        at.erase();
+        at.append_attr("small", "Int32", "1");
+        CPPUNIT_ASSERT(!at.m_use_index());
+        CPPUNIT_ASSERT(at.simple_find("small") == at.attr_begin());
+    }
+
+    void large_table_alias_test()
+    {
+        AttrTable at;
+        for (int i = 0; i < 50; ++i) {
+            ostringstream oss;
+            oss << "c" << i;
+            at.append_container(oss.str())->append_attr("units", "String", "m");
+        }
+
+        at.add_container_alias("alias_1", at.get_attr_table("c7"));
+        at.add_container_alias("alias%202", at.get_attr_table("c8"));
+        at.get_attr_table("c9")->add_value_alias(&at, "alias_3", "c8.units");
+
+        CPPUNIT_ASSERT(at.get_attr_table("alias_1") == at.get_attr_table("c7"));
+        CPPUNIT_ASSERT(at.get_attr_table("alias 2") == at.get_attr_table("c8"));
+        CPPUNIT_ASSERT(at.get_attr_table("c9")->get_attr("alias_3") == "m");
+        CPPUNIT_ASSERT_THROW(at.add_container_alias("c9", at.get_attr_table("c7")), Error);
+
+        AttrTable *at2;
+        AttrTable::Attr_iter iter;
+        at.find("alias_1.units", &at2, &iter);
+        CPPUNIT_ASSERT(at2 == at.get_attr_table("c7") && iter != at2->attr_end());
+    }
+
     void clone_test()
     {
         AttrTable *att = new AttrTable;
@@ -449,6 +589,25 @@ String longer%20name \"second test\";";
         CPPUNIT_ASSERT(cont_a->get_attr_num("size") == 3);
     }
 
+    void get_attr_values_test()
+    {
+        vector<string> vs;
+        vs.push_back("8.5");
+        vs.push_back("-1e3");
+        cont_a->append_attr("range", "Float64", &vs);
+
+        vector<double> values;
+        CPPUNIT_ASSERT(cont_a->get_attr_values("range", values));
+        CPPUNIT_ASSERT(values.size() == 2);
+        CPPUNIT_ASSERT(values[0] == 8.5 && values[1] == -1000.0);
+
+        CPPUNIT_ASSERT(!cont_a->get_attr_values("no_such_attr", values));
+        CPPUNIT_ASSERT(values.size() == 2);
+
+        cont_a->append_attr("bad", "Float32", "1.0x");
+        CPPUNIT_ASSERT_THROW(cont_a->get_attr_values("bad", values), Error);
+    }
+
     void print_xml_test()
     {
         ostringstream sof;
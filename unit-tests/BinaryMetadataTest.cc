@@ -0,0 +1,495 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/time.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <fstream>
+#include <sstream>
+
+//#define DODS_DEBUG
+
+#include "Byte.h"
+#include "Int16.h"
+#include "Int32.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Str.h"
+#include "Array.h"
+#include "Structure.h"
+#include "Sequence.h"
+#include "Grid.h"
+
+#include "BaseTypeFactory.h"
+#include "D4BaseTypeFactory.h"
+#include "D4Group.h"
+#include "D4Dimensions.h"
+#include "D4Attributes.h"
+#include "D4ParserSax2.h"
+#include "DDS.h"
+#include "DMR.h"
+#include "XMLWriter.h"
+#include "BinaryMetadata.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+#include "testFile.h"
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// The number of variables in the DMR used to time loading it
+static const int num_vars = 20000;
+
+static double elapsed(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1.0e6;
+}
+
+class BinaryMetadataTest: public TestFixture {
+private:
+    BaseTypeFactory d_factory;
+    D4BaseTypeFactory d_d4_factory;
+
+    static string dmr_doc(DMR &dmr)
+    {
+        XMLWriter xml;
+        dmr.print_dap4(xml);
+        return xml.get_doc();
+    }
+
+    static string binary_doc(DMR &dmr)
+    {
+        ostringstream oss;
+        BinaryMetadataWriter writer;
+        writer.print(dmr, oss);
+        return oss.str();
+    }
+
+    static string binary_doc(DDS &dds)
+    {
+        ostringstream oss;
+        BinaryMetadataWriter writer;
+        writer.print(dds, oss);
+        return oss.str();
+    }
+
+    static string dds_doc(DDS &dds)
+    {
+        ostringstream oss;
+        dds.print(oss);
+        dds.print_das(oss);
+        return oss.str();
+    }
+
+    // Parse the DMR document, write it in binary and read that back; the
+    // two DMRs must be the same.
+    void dmr_round_trip(const string &src)
+    {
+        try {
+            string name = string(TEST_SRC_DIR) + src;
+            ifstream ifile(name.c_str(), ifstream::in);
+            if (!ifile) throw InternalErr(__FILE__, __LINE__, "Could not open file: " + src);
+
+            DMR dmr(&d_d4_factory);
+            D4ParserSax2 parser;
+            parser.intern(ifile, &dmr);
+
+            string binary = binary_doc(dmr);
+
+            DMR dmr_2(&d_d4_factory);
+            BinaryMetadataReader reader;
+            reader.intern(binary.data(), binary.size(), &dmr_2);
+
+            string doc = dmr_doc(dmr_2);
+            DBG(cerr << src << ": " << binary.size() << " bytes; " << doc << endl);
+            CPPUNIT_ASSERT(doc == dmr_doc(dmr));
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(src + ": " + e.get_error_message());
+        }
+    }
+
+    void build_dds(DDS &dds)
+    {
+        dds.set_dataset_name("binary_test");
+        dds.filename("binary_test.nc");
+        dds.set_dap_version("3.2");
+        dds.set_request_xml_base("http://test.opendap.org/binary_test");
+
+        AttrTable *global = dds.get_attr_table().append_container("NC_GLOBAL");
+        global->append_attr("title", "String", "\"A test\"");
+        global->append_attr("history", "String", "\"made\"");
+        global->append_attr("history", "String", "\"changed\"");
+
+        Byte *b = new Byte("b");
+        b->get_attr_table().append_attr("units", "String", "\"count\"");
+        dds.add_var_nocopy(b);
+
+        Array *a = new Array("a", new Int32("a"));
+        a->append_dim(10, "x");
+        a->append_dim(20);
+        a->get_attr_table().append_attr("valid_range", "Int32", "0");
+        a->get_attr_table().append_attr("valid_range", "Int32", "100");
+        a->get_attr_table().append_container("meta")->append_attr("source", "Url", "http://test.opendap.org/");
+        dds.add_var_nocopy(a);
+
+        Structure *s = new Structure("s");
+        s->add_var_nocopy(new Float64("f"));
+        s->add_var_nocopy(new Str("name"));
+        s->var("f")->get_attr_table().append_attr("scale", "Float64", "0.5");
+        dds.add_var_nocopy(s);
+
+        Sequence *seq = new Sequence("seq");
+        seq->add_var_nocopy(new Int16("i"));
+        seq->add_var_nocopy(new Float32("t"));
+        dds.add_var_nocopy(seq);
+
+        Grid *g = new Grid("g");
+        Array *ga = new Array("g", new Float32("g"));
+        ga->append_dim(4, "lat");
+        ga->append_dim(5, "lon");
+        g->set_array(ga);
+        Array *lat = new Array("lat", new Float64("lat"));
+        lat->append_dim(4, "lat");
+        g->add_map(lat, false);
+        Array *lon = new Array("lon", new Float64("lon"));
+        lon->append_dim(5, "lon");
+        g->add_map(lon, false);
+        g->get_attr_table().append_attr("long_name", "String", "\"gridded\"");
+        dds.add_var_nocopy(g);
+    }
+
+    void build_large_dmr(DMR &dmr)
+    {
+        D4Group *root = dmr.root();
+        root->dims()->add_dim_nocopy(new D4Dimension("time", 12));
+        root->dims()->add_dim_nocopy(new D4Dimension("lat", 180));
+
+        D4Attribute *title = new D4Attribute("title", attr_str_c);
+        title->add_value("Many variables");
+        root->attributes()->add_attribute_nocopy(title);
+
+        for (int i = 0; i < num_vars; ++i) {
+            ostringstream name;
+            name << "var_" << i;
+
+            Array *a = new Array(name.str(), new Float32(name.str()));
+            a->set_is_dap4(true);
+            a->append_dim(root->find_dim("/time"));
+            a->append_dim(root->find_dim("/lat"));
+
+            D4Attribute *units = new D4Attribute("units", attr_str_c);
+            units->add_value("K");
+            a->attributes()->add_attribute_nocopy(units);
+            D4Attribute *fill = new D4Attribute("_FillValue", attr_float32_c);
+            fill->add_value("-9999");
+            a->attributes()->add_attribute_nocopy(fill);
+            D4Attribute *long_name = new D4Attribute("long_name", attr_str_c);
+            long_name->add_value("Variable " + name.str());
+            a->attributes()->add_attribute_nocopy(long_name);
+
+            root->add_var_nocopy(a);
+        }
+    }
+
+public:
+    BinaryMetadataTest()
+    {
+    }
+
+    ~BinaryMetadataTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_dmr_empty() { dmr_round_trip("/D4-xml/DMR_empty.xml"); }
+    void test_dmr_0() { dmr_round_trip("/D4-xml/DMR_0.xml"); }
+    void test_dmr_1() { dmr_round_trip("/D4-xml/DMR_1.xml"); }
+    void test_dmr_2() { dmr_round_trip("/D4-xml/DMR_2.xml"); }
+    void test_dmr_2_1() { dmr_round_trip("/D4-xml/DMR_2.1.xml"); }
+    void test_dmr_3() { dmr_round_trip("/D4-xml/DMR_3.xml"); }
+    void test_dmr_3_1() { dmr_round_trip("/D4-xml/DMR_3.1.xml"); }
+    void test_dmr_3_2() { dmr_round_trip("/D4-xml/DMR_3.2.xml"); }
+    void test_dmr_3_3() { dmr_round_trip("/D4-xml/DMR_3.3.xml"); }
+    void test_dmr_3_4() { dmr_round_trip("/D4-xml/DMR_3.4.xml"); }
+    void test_dmr_3_5() { dmr_round_trip("/D4-xml/DMR_3.5.xml"); }
+    void test_dmr_4() { dmr_round_trip("/D4-xml/DMR_4.xml"); }
+    void test_dmr_4_1() { dmr_round_trip("/D4-xml/DMR_4.1.xml"); }
+    void test_dmr_5() { dmr_round_trip("/D4-xml/DMR_5.xml"); }
+    void test_dmr_5_1() { dmr_round_trip("/D4-xml/DMR_5.1.xml"); }
+    void test_dmr_6() { dmr_round_trip("/D4-xml/DMR_6.xml"); }
+    void test_dmr_6_1() { dmr_round_trip("/D4-xml/DMR_6.1.xml"); }
+    void test_dmr_6_2() { dmr_round_trip("/D4-xml/DMR_6.2.xml"); }
+    void test_dmr_7() { dmr_round_trip("/D4-xml/DMR_7.xml"); }
+    void test_dmr_7_1() { dmr_round_trip("/D4-xml/DMR_7.1.xml"); }
+    void test_dmr_7_2() { dmr_round_trip("/D4-xml/DMR_7.2.xml"); }
+    void test_dmr_7_3() { dmr_round_trip("/D4-xml/DMR_7.3.xml"); }
+    void test_dmr_7_4() { dmr_round_trip("/D4-xml/DMR_7.4.xml"); }
+    void test_dmr_7_5() { dmr_round_trip("/D4-xml/DMR_7.5.xml"); }
+    void test_dmr_8() { dmr_round_trip("/D4-xml/DMR_8.xml"); }
+    void test_dmr_coads() { dmr_round_trip("/D4-xml/coads_climatology.nc.xml"); }
+
+    void test_dmr_stream()
+    {
+        DMR dmr(&d_d4_factory, "stream");
+        build_large_dmr(dmr);
+        string binary = binary_doc(dmr);
+
+        istringstream iss(binary);
+        DMR dmr_2(&d_d4_factory);
+        BinaryMetadataReader reader;
+        reader.intern(iss, &dmr_2);
+
+        CPPUNIT_ASSERT(dmr_2.name() == "stream");
+        CPPUNIT_ASSERT(dmr_doc(dmr_2) == dmr_doc(dmr));
+
+        // Shared dimensions are linked to the definitions in the new DMR
+        Array *a = static_cast<Array*>(dmr_2.root()->find_var("/var_10"));
+        CPPUNIT_ASSERT(a && a->dim_begin()->dim == dmr_2.root()->find_dim("/time"));
+    }
+
+    // Writing a frozen DMR must only read its attributes; the shared
+    // attributes of a template are not copied (see DMR::freeze()).
+    void test_dmr_frozen()
+    {
+        DMR dmr(&d_d4_factory, "frozen");
+        D4Group *root = dmr.root();
+
+        D4Attribute *meta = new D4Attribute("meta", attr_container_c);
+        D4Attribute *source = new D4Attribute("source", attr_url_c);
+        source->add_value("http://test.opendap.org/");
+        meta->attributes()->add_attribute_nocopy(source);
+        root->attributes()->add_attribute_nocopy(meta);
+
+        Int32 *x = new Int32("x");
+        x->set_is_dap4(true);
+        D4Attribute *units = new D4Attribute("units", attr_str_c);
+        units->add_value("m");
+        x->attributes()->add_attribute_nocopy(units);
+        root->add_var_nocopy(x);
+
+        string expected = binary_doc(dmr);
+
+        dmr.freeze();
+        string binary = binary_doc(dmr);
+
+        const D4Attributes *root_attrs = root->attributes();
+        CPPUNIT_ASSERT(root_attrs->frozen());
+        CPPUNIT_ASSERT(root_attrs->find("meta")->attributes()->frozen());
+        CPPUNIT_ASSERT(root->var("x")->attributes()->frozen());
+        CPPUNIT_ASSERT(binary == expected);
+    }
+
+    void test_dds()
+    {
+        DDS dds(&d_factory);
+        build_dds(dds);
+        string binary = binary_doc(dds);
+
+        DDS dds_2(&d_factory);
+        BinaryMetadataReader reader;
+        reader.intern(binary.data(), binary.size(), &dds_2);
+
+        DBG(cerr << dds_doc(dds_2) << endl);
+        CPPUNIT_ASSERT(dds_doc(dds_2) == dds_doc(dds));
+        CPPUNIT_ASSERT(dds_2.get_dataset_name() == "binary_test");
+        CPPUNIT_ASSERT(dds_2.filename() == "binary_test.nc");
+        CPPUNIT_ASSERT(dds_2.get_dap_version() == "3.2");
+        CPPUNIT_ASSERT(dds_2.get_dap_major() == 3 && dds_2.get_dap_minor() == 2);
+        CPPUNIT_ASSERT(dds_2.get_request_xml_base() == "http://test.opendap.org/binary_test");
+
+        Grid *g = static_cast<Grid*>(dds_2.var("g"));
+        CPPUNIT_ASSERT(g->get_array() && g->get_array()->name() == "g");
+        CPPUNIT_ASSERT(g->map_end() - g->map_begin() == 2);
+    }
+
+    void test_errors()
+    {
+        DMR dmr(&d_d4_factory, "errors");
+        build_large_dmr(dmr);
+        string binary = binary_doc(dmr);
+        BinaryMetadataReader reader;
+
+        {
+            DMR dmr_2(&d_d4_factory);
+            CPPUNIT_ASSERT_THROW(reader.intern(binary.data(), binary.size() / 2, &dmr_2), Error);
+        }
+        {
+            DMR dmr_2(&d_d4_factory);
+            CPPUNIT_ASSERT_THROW(reader.intern(binary.data(), 3, &dmr_2), Error);
+        }
+        {
+            string not_binary = "<?xml version=\"1.0\"?>";
+            DMR dmr_2(&d_d4_factory);
+            CPPUNIT_ASSERT_THROW(reader.intern(not_binary.data(), not_binary.size(), &dmr_2), Error);
+        }
+        {
+            // A DMR is not a DDS
+            DDS dds(&d_factory);
+            CPPUNIT_ASSERT_THROW(reader.intern(binary.data(), binary.size(), &dds), Error);
+        }
+        {
+            string extra = binary + "x";
+            DMR dmr_2(&d_d4_factory);
+            CPPUNIT_ASSERT_THROW(reader.intern(extra.data(), extra.size(), &dmr_2), Error);
+        }
+
+        // The reader can be used again after an error
+        DMR dmr_2(&d_d4_factory);
+        reader.intern(binary.data(), binary.size(), &dmr_2);
+        CPPUNIT_ASSERT(dmr_doc(dmr_2) == dmr_doc(dmr));
+    }
+
+    // Compare the time to load a large DMR from XML and from the binary form
+    void test_load_time()
+    {
+        DMR dmr(&d_d4_factory, "large");
+        build_large_dmr(dmr);
+        string xml = dmr_doc(dmr);
+        string binary = binary_doc(dmr);
+
+        struct timeval start;
+        gettimeofday(&start, 0);
+        DMR from_xml(&d_d4_factory);
+        D4ParserSax2 parser;
+        parser.intern(xml, &from_xml);
+        double xml_time = elapsed(start);
+
+        gettimeofday(&start, 0);
+        DMR from_binary(&d_d4_factory);
+        BinaryMetadataReader reader;
+        reader.intern(binary.data(), binary.size(), &from_binary);
+        double binary_time = elapsed(start);
+
+        DBG(cerr << endl << "Loading " << num_vars << " variables: XML " << xml.size() << " bytes, "
+            << xml_time << "s; binary " << binary.size() << " bytes, " << binary_time << "s" << endl);
+
+        CPPUNIT_ASSERT(binary.size() < xml.size());
+        CPPUNIT_ASSERT(dmr_doc(from_binary) == dmr_doc(from_xml));
+    }
+
+    CPPUNIT_TEST_SUITE (BinaryMetadataTest);
+
+    CPPUNIT_TEST (test_dmr_empty);
+    CPPUNIT_TEST (test_dmr_0);
+    CPPUNIT_TEST (test_dmr_1);
+    CPPUNIT_TEST (test_dmr_2);
+    CPPUNIT_TEST (test_dmr_2_1);
+    CPPUNIT_TEST (test_dmr_3);
+    CPPUNIT_TEST (test_dmr_3_1);
+    CPPUNIT_TEST (test_dmr_3_2);
+    CPPUNIT_TEST (test_dmr_3_3);
+    CPPUNIT_TEST (test_dmr_3_4);
+    CPPUNIT_TEST (test_dmr_3_5);
+    CPPUNIT_TEST (test_dmr_4);
+    CPPUNIT_TEST (test_dmr_4_1);
+    CPPUNIT_TEST (test_dmr_5);
+    CPPUNIT_TEST (test_dmr_5_1);
+    CPPUNIT_TEST (test_dmr_6);
+    CPPUNIT_TEST (test_dmr_6_1);
+    CPPUNIT_TEST (test_dmr_6_2);
+    CPPUNIT_TEST (test_dmr_7);
+    CPPUNIT_TEST (test_dmr_7_1);
+    CPPUNIT_TEST (test_dmr_7_2);
+    CPPUNIT_TEST (test_dmr_7_3);
+    CPPUNIT_TEST (test_dmr_7_4);
+    CPPUNIT_TEST (test_dmr_7_5);
+    CPPUNIT_TEST (test_dmr_8);
+    CPPUNIT_TEST (test_dmr_coads);
+    CPPUNIT_TEST (test_dmr_stream);
+    CPPUNIT_TEST (test_dmr_frozen);
+    CPPUNIT_TEST (test_dds);
+    CPPUNIT_TEST (test_errors);
+    CPPUNIT_TEST (test_load_time);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (BinaryMetadataTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: BinaryMetadataTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = BinaryMetadataTest::suite()->getTests();
+            unsigned int prefix_len = BinaryMetadataTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = BinaryMetadataTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "ConstraintCache.h"
+#include "D4ConstraintEvaluator.h"
+
+#include "D4BaseTypeFactory.h"
+#include "DMR.h"
+#include "D4Group.h"
+#include "D4Dimensions.h"
+#include "Array.h"
+#include "Int32.h"
+#include "Error.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static const int num_threads = 8;
+static const int num_lookups = 2000;
+
+// Look up a few expressions over and over, adding the ones not found.
+static void *use_cache(void *arg)
+{
+    ConstraintCache<string> *cache = static_cast<ConstraintCache<string>*>(arg);
+    for (int i = 0; i < num_lookups; ++i) {
+        ostringstream expr;
+        expr << "x" << i % 7;
+        string value;
+        if (cache->get(expr.str(), value)) {
+            if (value != expr.str() + " parsed")
+                return arg;    // Not null; the value was wrong
+        }
+        else {
+            cache->put(expr.str(), expr.str() + " parsed");
+        }
+    }
+
+    return 0;
+}
+
+class ConstraintCacheTest: public TestFixture {
+private:
+    D4BaseTypeFactory d_d4_factory;
+
+    // Two Arrays that use the shared dimension 'row' and an Int32
+    void m_load_dmr(DMR &dmr)
+    {
+        D4Group *root = dmr.root();
+
+        D4Dimension *row = new D4Dimension("row", 4);
+        root->dims()->add_dim_nocopy(row);
+
+        Array *a = new Array("a", new Int32("a"));
+        a->append_dim(row);
+        root->add_var_nocopy(a);
+
+        Array *b = new Array("b", new Int32("b"));
+        b->append_dim(row);
+        root->add_var_nocopy(b);
+
+        root->add_var_nocopy(new Int32("x"));
+    }
+
+public:
+    ConstraintCacheTest()
+    {
+    }
+    ~ConstraintCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_get_put()
+    {
+        ConstraintCache<string> cache(10);
+        string value;
+        CPPUNIT_ASSERT(!cache.get("x", value));
+
+        cache.put("x", "parsed x");
+        CPPUNIT_ASSERT(cache.get("x", value));
+        CPPUNIT_ASSERT_EQUAL(string("parsed x"), value);
+
+        cache.put("x", "parsed x again");
+        CPPUNIT_ASSERT(cache.get("x", value));
+        CPPUNIT_ASSERT_EQUAL(string("parsed x again"), value);
+
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+        CPPUNIT_ASSERT_EQUAL(2UL, cache.hits());
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.misses());
+
+        cache.clear();
+        CPPUNIT_ASSERT_EQUAL(0UL, cache.entries());
+        CPPUNIT_ASSERT(!cache.get("x", value));
+    }
+
+    // The expression used least recently is removed when the cache is full
+    void test_eviction()
+    {
+        ConstraintCache<string> cache(2);
+        string value;
+
+        cache.put("x", "parsed x");
+        cache.put("y", "parsed y");
+        CPPUNIT_ASSERT(cache.get("x", value));
+
+        cache.put("z", "parsed z");
+        CPPUNIT_ASSERT_EQUAL(2UL, cache.entries());
+        CPPUNIT_ASSERT(cache.get("x", value));
+        CPPUNIT_ASSERT(!cache.get("y", value));
+        CPPUNIT_ASSERT(cache.get("z", value));
+
+        ConstraintCache<string> none(0);
+        none.put("x", "parsed x");
+        CPPUNIT_ASSERT_EQUAL(0UL, none.entries());
+        CPPUNIT_ASSERT(!none.get("x", value));
+    }
+
+    void test_threads()
+    {
+        ConstraintCache<string> cache(5);
+
+        vector<pthread_t> threads(num_threads);
+        for (int i = 0; i < num_threads; ++i)
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, use_cache, &cache) == 0);
+
+        for (int i = 0; i < num_threads; ++i) {
+            void *status = 0;
+            pthread_join(threads[i], &status);
+            CPPUNIT_ASSERT(status == 0);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(5UL, cache.entries());
+        CPPUNIT_ASSERT_EQUAL((unsigned long) num_threads * num_lookups, cache.hits() + cache.misses());
+    }
+
+    // The same CE applied to two DMRs, the second time using the cached operations
+    void test_dap4_parse()
+    {
+        D4ConstraintEvaluator::Parse_cache cache(10);
+        const string ce = "/row=[1:2];a[];x";
+
+        for (int i = 0; i < 2; ++i) {
+            DMR dmr(&d_d4_factory, "test");
+            m_load_dmr(dmr);
+
+            D4ConstraintEvaluator eval(&dmr);
+            eval.set_parse_cache(&cache);
+            CPPUNIT_ASSERT(eval.parse(ce));
+
+            D4Group *root = dmr.root();
+            CPPUNIT_ASSERT(root->var("a")->send_p());
+            CPPUNIT_ASSERT(!root->var("b")->send_p());
+            CPPUNIT_ASSERT(root->var("x")->send_p());
+            CPPUNIT_ASSERT_EQUAL(2, static_cast<Array*>(root->var("a"))->length());
+        }
+
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.hits());
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+    }
+
+    // A CE that parses is cached even when it does not match the DMR; it
+    // may match the next one.
+    void test_dap4_parse_not_found()
+    {
+        D4ConstraintEvaluator::Parse_cache cache(10);
+        DMR dmr(&d_d4_factory, "test");
+        m_load_dmr(dmr);
+
+        D4ConstraintEvaluator eval(&dmr);
+        eval.set_parse_cache(&cache);
+        CPPUNIT_ASSERT_THROW(eval.parse("y"), Error);
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+
+        // The cached operations are applied and fail the same way
+        CPPUNIT_ASSERT_THROW(eval.parse("y"), Error);
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.hits());
+
+        CPPUNIT_ASSERT_THROW(eval.parse("a[[0]"), Error);
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+    }
+
+    CPPUNIT_TEST_SUITE (ConstraintCacheTest);
+
+    CPPUNIT_TEST (test_get_put);
+    CPPUNIT_TEST (test_eviction);
+    CPPUNIT_TEST (test_threads);
+    CPPUNIT_TEST (test_dap4_parse);
+    CPPUNIT_TEST (test_dap4_parse_not_found);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (ConstraintCacheTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: ConstraintCacheTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = ConstraintCacheTest::suite()->getTests();
+            unsigned int prefix_len = ConstraintCacheTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = ConstraintCacheTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
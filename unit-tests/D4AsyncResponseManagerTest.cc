@@ -0,0 +1,424 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <fstream>
+#include <sstream>
+#include <set>
+
+//#define DODS_DEBUG
+
+#include <GetOpt.h>
+
+#include "DMR.h"
+#include "D4Group.h"
+#include "D4BaseTypeFactory.h"
+#include "Int32.h"
+#include "Float64.h"
+#include "XMLWriter.h"
+#include "D4AsyncResponseManager.h"
+#include "chunked_istream.h"
+#include "chunked_stream.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// An Int32 that takes 20ms to read
+class SlowInt32: public Int32 {
+public:
+    SlowInt32(const string &n) : Int32(n) { }
+
+    virtual BaseType *ptr_duplicate() { return new SlowInt32(*this); }
+
+    virtual bool read()
+    {
+        usleep(20000);
+        set_value(42);
+        set_read_p(true);
+        return true;
+    }
+};
+
+class D4AsyncResponseManagerTest: public TestFixture {
+private:
+    D4BaseTypeFactory d_factory;
+    char d_spool[32];
+
+    DMR *make_dmr()
+    {
+        DMR *dmr = new DMR(&d_factory, "async_test");
+
+        Int32 *i = new Int32("i32");
+        i->set_value(17);
+        dmr->root()->add_var_nocopy(i);
+
+        Float64 *f = new Float64("f64");
+        f->set_value(3.5);
+        dmr->root()->add_var_nocopy(f);
+
+        return dmr;
+    }
+
+    // Twenty variables that take 400ms to send
+    DMR *make_slow_dmr()
+    {
+        DMR *dmr = new DMR(&d_factory, "slow_async_test");
+
+        for (int i = 0; i < 20; ++i) {
+            ostringstream oss;
+            oss << "slow_" << i;
+            dmr->root()->add_var_nocopy(new SlowInt32(oss.str()));
+        }
+
+        return dmr;
+    }
+
+    // Read a spooled response to its end and return the message of the
+    // error chunk, or the empty string if there is none.
+    string spooled_error(const string &id)
+    {
+        ifstream in((string(d_spool) + "/" + id + ".dap").c_str(), ios::in | ios::binary);
+        CPPUNIT_ASSERT(in.good());
+
+        chunked_istream cis(in, CHUNK_SIZE);
+        vector<char> buf(1024);
+        while (cis.read(&buf[0], buf.size()))
+            ;
+
+        return cis.error() ? cis.error_message() : "";
+    }
+
+    // Wait up to 10 seconds for a job to leave the accepted/pending states
+    D4AsyncStatus wait_for(D4AsyncResponseManager &arm, const string &id)
+    {
+        for (int i = 0; i < 1000; ++i) {
+            D4AsyncStatus s = arm.status(id);
+            if (s != async_accepted && s != async_pending) return s;
+            usleep(10000);
+        }
+
+        return arm.status(id);
+    }
+
+public:
+    D4AsyncResponseManagerTest()
+    {
+    }
+
+    ~D4AsyncResponseManagerTest()
+    {
+    }
+
+    void setUp()
+    {
+        strcpy(d_spool, "/tmp/d4_async_XXXXXX");
+        if (!mkdtemp(d_spool))
+            CPPUNIT_FAIL("Could not make the spool directory");
+    }
+
+    void tearDown()
+    {
+        rmdir(d_spool);
+    }
+
+    void test_bad_spool_dir()
+    {
+        CPPUNIT_ASSERT_THROW(D4AsyncResponseManager("/no/such/dir/for/async"), Error);
+    }
+
+    void test_complete_response()
+    {
+        D4AsyncResponseManager arm(d_spool, 2);
+        string id = arm.submit(make_dmr());
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_complete);
+        CPPUNIT_ASSERT(arm.response_size(id) > 0);
+
+        XMLWriter xml;
+        CPPUNIT_ASSERT(!arm.write_status(xml, id, "http://localhost/async"));
+
+        ostringstream oss;
+        arm.send_response(id, oss);
+        string response = oss.str();
+        DBG(cerr << "Response size: " << response.size() << endl);
+
+        CPPUNIT_ASSERT(response.size() == arm.response_size(id));
+        CPPUNIT_ASSERT(response.find("<Dataset") != string::npos);
+        CPPUNIT_ASSERT(response.find("i32") != string::npos);
+        CPPUNIT_ASSERT(response.find("f64") != string::npos);
+    }
+
+    void test_constrained_response()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        string id = arm.submit(make_dmr(), "f64");
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_complete);
+
+        ostringstream oss;
+        arm.send_response(id, oss);
+        string response = oss.str();
+
+        CPPUNIT_ASSERT(response.find("f64") != string::npos);
+        CPPUNIT_ASSERT(response.find("i32") == string::npos);
+    }
+
+    void test_send_response_fd()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        string id = arm.submit(make_dmr());
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_complete);
+
+        string out_name = string(d_spool) + "/out.dap";
+        FILE *out = fopen(out_name.c_str(), "w");
+        CPPUNIT_ASSERT(out);
+        arm.send_response(id, fileno(out));
+        fclose(out);
+
+        struct stat buf;
+        CPPUNIT_ASSERT(stat(out_name.c_str(), &buf) == 0);
+        remove(out_name.c_str());
+
+        CPPUNIT_ASSERT((unsigned long long)buf.st_size == arm.response_size(id));
+    }
+
+    void test_many_jobs()
+    {
+        D4AsyncResponseManager arm(d_spool, 4);
+        vector<string> ids;
+        for (int i = 0; i < 20; ++i)
+            ids.push_back(arm.submit(make_dmr()));
+
+        for (vector<string>::iterator i = ids.begin(); i != ids.end(); ++i)
+            CPPUNIT_ASSERT(wait_for(arm, *i) == async_complete);
+    }
+
+    void test_bad_ce_is_rejected()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        string id = arm.submit(make_dmr(), "no_such_var");
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_failed);
+        CPPUNIT_ASSERT(!arm.error_message(id).empty());
+        CPPUNIT_ASSERT_THROW(arm.send_response(id, cerr), Error);
+
+        XMLWriter xml;
+        CPPUNIT_ASSERT(arm.write_status(xml, id, "http://localhost/async"));
+        string doc = xml.get_doc();
+        DBG(cerr << doc << endl);
+        CPPUNIT_ASSERT(doc.find("status=\"rejected\"") != string::npos);
+    }
+
+    void test_unknown_is_gone()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        CPPUNIT_ASSERT(arm.status("no_such_job") == async_unknown);
+
+        XMLWriter xml;
+        CPPUNIT_ASSERT(arm.write_status(xml, "no_such_job", "http://localhost/async"));
+        CPPUNIT_ASSERT(string(xml.get_doc()).find("status=\"gone\"") != string::npos);
+    }
+
+    void test_expired_is_gone()
+    {
+        // A negative lifetime expires responses as soon as they are built
+        D4AsyncResponseManager arm(d_spool, 1, 60, -1);
+        string id = arm.submit(make_dmr());
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_gone);
+        CPPUNIT_ASSERT(arm.response_size(id) == 0);
+        CPPUNIT_ASSERT_THROW(arm.send_response(id, cerr), Error);
+    }
+
+    void test_gone_is_forgotten()
+    {
+        D4AsyncResponseManager arm(d_spool, 1, 60, -1);
+        string id = arm.submit(make_dmr());
+        string spool_file = string(d_spool) + "/" + id + ".dap";
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_gone);
+        CPPUNIT_ASSERT(access(spool_file.c_str(), F_OK) != 0);
+
+        // With a negative lifetime, a gone job is forgotten a second later
+        sleep(2);
+        CPPUNIT_ASSERT(arm.status(id) == async_unknown);
+
+        XMLWriter xml;
+        CPPUNIT_ASSERT(arm.write_status(xml, id, "http://localhost/async"));
+        CPPUNIT_ASSERT(string(xml.get_doc()).find("status=\"gone\"") != string::npos);
+    }
+
+    void test_random_ids()
+    {
+        D4AsyncResponseManager arm(d_spool, 2);
+
+        set<string> ids;
+        for (int i = 0; i < 50; ++i) {
+            string id = arm.submit(make_dmr());
+            DBG(cerr << "id: " << id << endl);
+            CPPUNIT_ASSERT(id.find("dap4_async_") == 0);
+            CPPUNIT_ASSERT(id.size() == 11 + 32);
+            CPPUNIT_ASSERT(id.find_first_not_of("0123456789abcdef", 11) == string::npos);
+            ids.insert(id);
+        }
+
+        CPPUNIT_ASSERT(ids.size() == 50);
+
+        for (set<string>::iterator i = ids.begin(); i != ids.end(); ++i)
+            CPPUNIT_ASSERT(wait_for(arm, *i) == async_complete);
+    }
+
+    void test_timeout()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        arm.set_timeout(100);
+        CPPUNIT_ASSERT(arm.timeout() == 100);
+
+        string id = arm.submit(make_slow_dmr());
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_failed);
+        DBG(cerr << "Error: " << arm.error_message(id) << endl);
+        CPPUNIT_ASSERT(arm.error_message(id).find("deadline") != string::npos);
+
+        // The response ends with an error chunk instead of the rest of the data
+        CPPUNIT_ASSERT(spooled_error(id) == arm.error_message(id));
+        CPPUNIT_ASSERT_THROW(arm.send_response(id, cerr), Error);
+    }
+
+    void test_no_timeout()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        string id = arm.submit(make_slow_dmr());
+
+        CPPUNIT_ASSERT(wait_for(arm, id) == async_complete);
+        CPPUNIT_ASSERT(spooled_error(id).empty());
+    }
+
+    void test_cancel()
+    {
+        D4AsyncResponseManager arm(d_spool, 1);
+        CPPUNIT_ASSERT(!arm.cancel("no_such_job"));
+
+        // With one worker the second job waits in the queue
+        string pending = arm.submit(make_slow_dmr());
+        string queued = arm.submit(make_slow_dmr());
+
+        for (int i = 0; i < 1000 && arm.status(pending) != async_pending; ++i)
+            usleep(1000);
+
+        CPPUNIT_ASSERT(arm.cancel(pending));
+        CPPUNIT_ASSERT(arm.cancel(queued));
+
+        CPPUNIT_ASSERT(wait_for(arm, pending) == async_failed);
+        CPPUNIT_ASSERT(arm.error_message(pending).find("cancelled") != string::npos);
+        CPPUNIT_ASSERT(spooled_error(pending) == arm.error_message(pending));
+
+        CPPUNIT_ASSERT(wait_for(arm, queued) == async_failed);
+        CPPUNIT_ASSERT(arm.error_message(queued).find("cancelled") != string::npos);
+
+        // A finished job cannot be cancelled
+        CPPUNIT_ASSERT(!arm.cancel(pending));
+    }
+
+    CPPUNIT_TEST_SUITE (D4AsyncResponseManagerTest);
+
+    CPPUNIT_TEST (test_bad_spool_dir);
+    CPPUNIT_TEST (test_complete_response);
+    CPPUNIT_TEST (test_constrained_response);
+    CPPUNIT_TEST (test_send_response_fd);
+    CPPUNIT_TEST (test_many_jobs);
+    CPPUNIT_TEST (test_bad_ce_is_rejected);
+    CPPUNIT_TEST (test_unknown_is_gone);
+    CPPUNIT_TEST (test_expired_is_gone);
+    CPPUNIT_TEST (test_gone_is_forgotten);
+    CPPUNIT_TEST (test_random_ids);
+    CPPUNIT_TEST (test_timeout);
+    CPPUNIT_TEST (test_no_timeout);
+    CPPUNIT_TEST (test_cancel);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (D4AsyncResponseManagerTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: D4AsyncResponseManagerTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = D4AsyncResponseManagerTest::suite()->getTests();
+            unsigned int prefix_len = D4AsyncResponseManagerTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = D4AsyncResponseManagerTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
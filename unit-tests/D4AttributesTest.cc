@@ -28,9 +28,13 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <sstream>
+
 //#define DODS_DEBUG
 
 #include "D4Attributes.h"
+#include "InternalErr.h"
+#include "dods-datatypes.h"
 #include "XMLWriter.h"
 #include "debug.h"
 
@@ -358,6 +362,222 @@ public:
         CPPUNIT_ASSERT(baseline == get_result);
     }
 
+    // Enough attributes that find() and get() use an index
+    void add_many(D4Attributes *attrs, int n)
+    {
+        for (int i = 0; i < n; ++i) {
+            ostringstream oss;
+            oss << "attr_" << i;
+            D4Attribute *attr = new D4Attribute(oss.str(), attr_int32_c);
+            attr->add_value("1");
+            attrs->add_attribute_nocopy(attr);
+        }
+    }
+
+    void test_find_many()
+    {
+        add_many(attrs, 50);
+        attrs->add_attribute(&c2);      // 'control' and container_1.color
+        attrs->add_attribute(&a3);      // 'color'
+
+        CPPUNIT_ASSERT(attrs->find("attr_49") == *(attrs->attribute_begin() + 49));
+        CPPUNIT_ASSERT(attrs->find("no_such_attr") == 0);
+
+        // The 'color' in container_2.container_1 comes first
+        D4Attribute *color = attrs->find("color");
+        CPPUNIT_ASSERT(color && color != *(attrs->attribute_begin() + 51));
+        CPPUNIT_ASSERT(color == attrs->get("container_2.container_1.color"));
+        CPPUNIT_ASSERT(attrs->find("control") && attrs->find("control")->value(0) == "10000");
+
+        // Renaming an attribute updates the index
+        D4Attribute *last = *(attrs->attribute_begin() + 49);
+        last->set_name("renamed");
+        CPPUNIT_ASSERT(attrs->find("attr_49") == 0);
+        CPPUNIT_ASSERT(attrs->find("renamed") == last);
+    }
+
+    void test_get_many()
+    {
+        add_many(attrs, 50);
+        attrs->add_attribute(&c);
+        attrs->add_attribute(&c2);
+
+        CPPUNIT_ASSERT(attrs->get("attr_0") == *attrs->attribute_begin());
+        CPPUNIT_ASSERT(attrs->get("attr_0.color") == 0);
+        CPPUNIT_ASSERT(attrs->get("container_1.color") == *(*(attrs->attribute_begin() + 50))->attributes()->attribute_begin());
+        CPPUNIT_ASSERT(attrs->get("container_2.container_1.color")->value(2) == "green");
+        CPPUNIT_ASSERT(attrs->get("container_3.color") == 0);
+
+        D4Attributes copy(*attrs);
+        CPPUNIT_ASSERT(copy.get("attr_10") && copy.get("attr_10") != attrs->get("attr_10"));
+        CPPUNIT_ASSERT(copy.get("container_1.color") && copy.get("container_1.color")->value(0) == "red");
+    }
+
+    void test_freeze_copy_shares()
+    {
+        attrs->add_attribute(&a);
+        attrs->add_attribute(&c2);
+        attrs->freeze();
+        CPPUNIT_ASSERT(attrs->frozen());
+
+        D4Attributes copy(*attrs);
+        CPPUNIT_ASSERT(copy.frozen());
+        CPPUNIT_ASSERT(!copy.empty());
+
+        attrs->print_dap4(*xml);
+        XMLWriter copy_xml;
+        copy.print_dap4(copy_xml);
+        CPPUNIT_ASSERT(string(copy_xml.get_doc()) == string(xml->get_doc()));
+
+        // find() returns a modifiable attribute, so the copy stops sharing
+        D4Attribute *first = copy.find("first");
+        CPPUNIT_ASSERT(!copy.frozen());
+        CPPUNIT_ASSERT(first && first->value(1) == "2");
+
+        // Only this level is copied; the containers still share theirs
+        const D4Attribute *container = static_cast<const D4Attributes&>(copy).find("container_2");
+        CPPUNIT_ASSERT(container && container->attributes()->frozen());
+        CPPUNIT_ASSERT(copy.get("container_2.container_1.color")->value(0) == "red");
+    }
+
+    void test_freeze_const_reads()
+    {
+        add_many(attrs, 50);
+        attrs->add_attribute(&c2);
+        attrs->freeze();
+
+        D4Attributes copy(*attrs);
+        const D4Attributes &ccopy = copy;
+
+        // Reads through the const interface use the shared attributes
+        const D4Attribute *attr = ccopy.get("attr_42");
+        CPPUNIT_ASSERT(attr && attr->value(0) == "1");
+        CPPUNIT_ASSERT(ccopy.find("attr_7") != 0);
+        CPPUNIT_ASSERT(ccopy.get("container_2.container_1.color")->value(1) == "blue");
+        CPPUNIT_ASSERT(ccopy.find("color") != 0);
+        CPPUNIT_ASSERT(ccopy.get("container_2.missing") == 0);
+        CPPUNIT_ASSERT(ccopy.get("no_such_attr") == 0);
+        CPPUNIT_ASSERT(ccopy.attribute_cend() - ccopy.attribute_cbegin() == 51);
+        CPPUNIT_ASSERT(copy.frozen());
+
+        // Both copies read the same attribute
+        const D4Attributes &cattrs = *attrs;
+        CPPUNIT_ASSERT(cattrs.get("attr_42") == attr);
+    }
+
+    void test_freeze_copy_modified()
+    {
+        attrs->add_attribute(&a);
+        attrs->add_attribute(&c2);
+        attrs->freeze();
+
+        D4Attributes copy(*attrs);
+        copy.get("first")->add_value("3");
+        copy.get("container_2.control")->set_name("renamed");
+        copy.add_attribute(&a2);
+
+        CPPUNIT_ASSERT(attrs->frozen());
+        CPPUNIT_ASSERT(attrs->get("first")->num_values() == 2);
+        CPPUNIT_ASSERT(attrs->get("container_2.control") != 0);
+        CPPUNIT_ASSERT(attrs->get("second") == 0);
+
+        CPPUNIT_ASSERT(copy.get("first")->num_values() == 3);
+        CPPUNIT_ASSERT(copy.get("container_2.renamed") != 0);
+        CPPUNIT_ASSERT(copy.get("container_2.control") == 0);
+        CPPUNIT_ASSERT(copy.get("second") != 0);
+    }
+
+    void test_freeze_many_copies()
+    {
+        add_many(attrs, 50);
+        attrs->add_attribute(&c2);
+        attrs->freeze();
+
+        vector<D4Attributes*> copies;
+        for (int i = 0; i < 10; ++i)
+            copies.push_back(new D4Attributes(*attrs));
+
+        // Assigning a shared copy and deleting the original leaves the
+        // others intact
+        D4Attributes assigned;
+        assigned = *copies[3];
+        delete attrs;
+        attrs = 0;
+
+        CPPUNIT_ASSERT(assigned.frozen());
+        CPPUNIT_ASSERT(assigned.get("attr_49") != 0);
+        for (vector<D4Attributes*>::iterator i = copies.begin(); i != copies.end(); ++i) {
+            CPPUNIT_ASSERT((*i)->get("container_2.container_1.color")->value(1) == "blue");
+            delete *i;
+        }
+    }
+
+    void test_binary_values()
+    {
+        vector<dods_float64> range;
+        range.push_back(-2.5);
+        range.push_back(0.1);
+        D4Attribute valid_range("valid_range", attr_float32_c);
+        valid_range.set_values(range);
+
+        CPPUNIT_ASSERT(valid_range.type() == attr_float64_c);
+        CPPUNIT_ASSERT(valid_range.num_values() == 2);
+        CPPUNIT_ASSERT(valid_range.values<dods_float64>()[1] == 0.1);
+
+        // Formatted only when read as text, with all the digits needed
+        CPPUNIT_ASSERT(valid_range.value(0) == "-2.5");
+        CPPUNIT_ASSERT(valid_range.value(1) == "0.10000000000000001");
+
+        valid_range.print_dap4(*xml);
+        string doc = xml->get_doc();
+        DBG(cerr << "D4Attribute: " << doc << endl);
+        CPPUNIT_ASSERT(doc.find("<Value>-2.5</Value>") != string::npos);
+
+        // Copies keep the binary values; modifying the text drops them
+        D4Attribute copy(valid_range);
+        CPPUNIT_ASSERT(copy.values<dods_float64>()[0] == -2.5);
+        copy.add_value("7");
+        CPPUNIT_ASSERT(copy.num_values() == 3);
+        CPPUNIT_ASSERT(copy.value(0) == "-2.5");
+        CPPUNIT_ASSERT(copy.values<dods_float64>()[2] == 7.0);
+
+        CPPUNIT_ASSERT_THROW(valid_range.values<dods_int32>(), InternalErr);
+
+        vector<dods_byte> flags(3, 255);
+        D4Attribute mask("mask", attr_uint8_c);
+        mask.set_values(flags);
+        CPPUNIT_ASSERT(mask.type() == attr_uint8_c);
+        CPPUNIT_ASSERT(mask.value(2) == "255");
+    }
+
+    // Values read as text are converted once
+    void test_text_to_binary()
+    {
+        D4Attribute scale("scale_factor", attr_float32_c);
+        scale.add_value("0.01");
+        const dods_float32 *values = scale.values<dods_float32>();
+        CPPUNIT_ASSERT(values[0] == 0.01f);
+        CPPUNIT_ASSERT(scale.values<dods_float32>() == values);
+        CPPUNIT_ASSERT(scale.value(0) == "0.01");
+
+        D4Attribute fill("_FillValue", attr_float64_c);
+        fill.add_value("NaN");
+        CPPUNIT_ASSERT(fill.values<dods_float64>()[0] != fill.values<dods_float64>()[0]);
+
+        D4Attribute counts("counts", attr_int16_c);
+        counts.add_value("-7");
+        counts.add_value("40000");
+        CPPUNIT_ASSERT_THROW(counts.values<dods_int16>(), Error);
+
+        D4Attribute sizes("sizes", attr_uint32_c);
+        sizes.add_value("-1");
+        CPPUNIT_ASSERT_THROW(sizes.values<dods_uint32>(), Error);
+
+        D4Attribute big("big", attr_uint64_c);
+        big.add_value("18446744073709551615");
+        CPPUNIT_ASSERT(big.values<dods_uint64>()[0] == 18446744073709551615ULL);
+    }
+
     CPPUNIT_TEST_SUITE (D4AttributesTest);
 
     CPPUNIT_TEST (test_type_to_string);
@@ -378,6 +598,16 @@ public:
     CPPUNIT_TEST (test_find);
     CPPUNIT_TEST (test_get);
     CPPUNIT_TEST (test_get2);
+    CPPUNIT_TEST (test_find_many);
+    CPPUNIT_TEST (test_get_many);
+
+    CPPUNIT_TEST (test_freeze_copy_shares);
+    CPPUNIT_TEST (test_freeze_const_reads);
+    CPPUNIT_TEST (test_freeze_copy_modified);
+    CPPUNIT_TEST (test_freeze_many_copies);
+
+    CPPUNIT_TEST (test_binary_values);
+    CPPUNIT_TEST (test_text_to_binary);
 
     CPPUNIT_TEST_SUITE_END();
 };
@@ -215,6 +215,36 @@ public:
         CPPUNIT_ASSERT(doc == baseline);
     }
 
+    // find_dim() uses an index; it must see added, inserted and renamed
+    // dimensions and return the first of two with the same name
+    void test_find_dim()
+    {
+        D4Dimension *first = new D4Dimension("first", 10);
+        d->add_dim_nocopy(first);
+        d->add_dim_nocopy(new D4Dimension("second", 100));
+        CPPUNIT_ASSERT(d->find_dim("first") == first);
+        CPPUNIT_ASSERT(d->find_dim("third") == 0);
+
+        D4Dimension *third = new D4Dimension("third", 1000);
+        d->add_dim_nocopy(third);
+        CPPUNIT_ASSERT(d->find_dim("third") == third);
+
+        d->add_dim_nocopy(new D4Dimension("first", 20));
+        CPPUNIT_ASSERT(d->find_dim("first") == first);
+
+        D4Dimension *odd = new D4Dimension("odd", 20);
+        d->insert_dim_nocopy(odd, d->dim_begin());
+        CPPUNIT_ASSERT(d->find_dim("odd") == odd);
+
+        first->set_name("renamed");
+        CPPUNIT_ASSERT(d->find_dim("renamed") == first);
+        CPPUNIT_ASSERT(d->find_dim("first")->size() == 20);
+
+        D4Dimensions copy(*d);
+        CPPUNIT_ASSERT(copy.find_dim("third") != 0 && copy.find_dim("third") != third);
+        CPPUNIT_ASSERT(copy.find_dim("third")->size() == 1000);
+    }
+
     CPPUNIT_TEST_SUITE (D4DimensionsTest);
 
     CPPUNIT_TEST (test_print_empty);
@@ -230,6 +260,7 @@ public:
     CPPUNIT_TEST (test_print_insert_dim);
     CPPUNIT_TEST (test_print_assignment);
     CPPUNIT_TEST (test_print_copy_ctor);
+    CPPUNIT_TEST (test_find_dim);
 
     CPPUNIT_TEST_SUITE_END();
 };
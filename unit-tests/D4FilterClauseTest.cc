@@ -547,6 +547,179 @@ public:
         }
     }
 
+    // The block version of value() must agree with the row-at-a-time version
+    void block_value_test()
+    {
+        vector<BaseType*> columns;
+        columns.push_back(byte);
+        columns.push_back(f32);
+        columns.push_back(str);
+
+        vector<vector<BaseType*>*> rows;
+        for (int i = 0; i < 40; ++i) {
+            vector<BaseType*> *row = new vector<BaseType*>;
+            Byte *b = new Byte("byte");
+            b->set_value(i * 5);
+            row->push_back(b);
+            Float32 *f = new Float32("f32");
+            f->set_value(i / 4.0 - 5.0);
+            row->push_back(f);
+            Str *s = new Str("str");
+            s->set_value(i % 3 ? "Einstein" : "Bohr");
+            row->push_back(s);
+            rows.push_back(row);
+        }
+
+        D4FilterClause::ops ops[] = { D4FilterClause::less, D4FilterClause::greater, D4FilterClause::less_equal,
+            D4FilterClause::greater_equal, D4FilterClause::equal, D4FilterClause::not_equal };
+
+        vector<D4FilterClause*> clauses;
+        for (unsigned int i = 0; i < sizeof(ops) / sizeof(D4FilterClause::ops); ++i) {
+            clauses.push_back(new D4FilterClause(ops[i], new D4RValue(byte), new D4RValue((long long) 70)));
+            clauses.push_back(new D4FilterClause(ops[i], new D4RValue((unsigned long long) 70), new D4RValue(byte)));
+            clauses.push_back(new D4FilterClause(ops[i], new D4RValue(f32), new D4RValue(-2.25)));
+            clauses.push_back(new D4FilterClause(ops[i], new D4RValue(0.1), new D4RValue(f32)));
+            clauses.push_back(new D4FilterClause(ops[i], new D4RValue(byte), new D4RValue(f32)));
+            clauses.push_back(new D4FilterClause(ops[i], new D4RValue(str), new D4RValue(string("Bohr"))));
+        }
+        clauses.push_back(new D4FilterClause(D4FilterClause::match, new D4RValue(str), new D4RValue(string("^Ein"))));
+
+        for (vector<D4FilterClause*>::iterator c = clauses.begin(); c != clauses.end(); ++c) {
+            vector<unsigned char> selection(rows.size(), 1);
+            (*c)->value(rows, columns, selection);
+
+            for (unsigned int r = 0; r < rows.size(); ++r) {
+                byte->set_value(static_cast<Byte*>((*rows[r])[0])->value());
+                f32->set_value(static_cast<Float32*>((*rows[r])[1])->value());
+                str->set_value(static_cast<Str*>((*rows[r])[2])->value());
+
+                DBG(cerr << "clause " << c - clauses.begin() << ", row " << r << endl);
+                CPPUNIT_ASSERT((selection[r] != 0) == (*c)->value());
+            }
+
+            delete *c;
+        }
+
+        // A list of clauses; the second clause only sees rows the first selected
+        D4FilterClauseList list;
+        list.add_clause(new D4FilterClause(D4FilterClause::greater, new D4RValue(byte), new D4RValue((long long) 70)));
+        list.add_clause(new D4FilterClause(D4FilterClause::equal, new D4RValue(str), new D4RValue(string("Bohr"))));
+
+        vector<unsigned char> selection;
+        CPPUNIT_ASSERT(list.value(rows, columns, selection) == 9);
+        CPPUNIT_ASSERT(selection.size() == rows.size());
+        CPPUNIT_ASSERT(selection[15] && !selection[16] && !selection[12]);
+
+        for (vector<vector<BaseType*>*>::iterator r = rows.begin(); r != rows.end(); ++r) {
+            for (vector<BaseType*>::iterator v = (*r)->begin(); v != (*r)->end(); ++v)
+                delete *v;
+            delete *r;
+        }
+    }
+
+    void block_value_error_test()
+    {
+        vector<BaseType*> columns;
+        columns.push_back(byte);
+
+        vector<vector<BaseType*>*> rows;
+        rows.push_back(new vector<BaseType*>(1, byte->ptr_duplicate()));
+
+        vector<unsigned char> selection(1, 1);
+
+        // f32 is not one of the columns
+        D4FilterClause not_a_column(D4FilterClause::less, new D4RValue(f32), new D4RValue((long long) 1));
+        CPPUNIT_ASSERT_THROW(not_a_column.value(rows, columns, selection), InternalErr);
+
+        D4FilterClause byte_and_string(D4FilterClause::less, new D4RValue(byte), new D4RValue(string("1")));
+        CPPUNIT_ASSERT_THROW(byte_and_string.value(rows, columns, selection), Error);
+
+        delete rows[0]->at(0);
+        delete rows[0];
+    }
+
+    void accessors_test()
+    {
+        D4FilterClause c1(D4FilterClause::less, new D4RValue(byte), new D4RValue((long long) 21));
+        CPPUNIT_ASSERT(c1.get_op() == D4FilterClause::less);
+        CPPUNIT_ASSERT(c1.get_variable() == byte);
+        CPPUNIT_ASSERT(c1.get_constant() && c1.get_constant()->type() == dods_int64_c);
+        CPPUNIT_ASSERT(c1.get_variable_op() == D4FilterClause::less);
+
+        // '21 < byte' is 'byte > 21'
+        D4FilterClause c2(D4FilterClause::less, new D4RValue((long long) 21), new D4RValue(byte));
+        CPPUNIT_ASSERT(c2.get_op() == D4FilterClause::less);
+        CPPUNIT_ASSERT(c2.get_variable() == byte);
+        CPPUNIT_ASSERT(c2.get_variable_op() == D4FilterClause::greater);
+
+        D4FilterClause c3(D4FilterClause::equal, new D4RValue(byte), new D4RValue(f32));
+        CPPUNIT_ASSERT(c3.get_variable() == byte);
+        CPPUNIT_ASSERT(c3.get_constant() == 0);
+    }
+
+    void range_test()
+    {
+        D4FilterClauseList clauses;
+        clauses.add_clause(new D4FilterClause(D4FilterClause::greater, new D4RValue(byte), new D4RValue((long long) 2)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::less_equal, new D4RValue(3.5), new D4RValue(byte)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::less, new D4RValue(byte), new D4RValue((long long) 20)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::less_equal, new D4RValue(byte), new D4RValue((long long) 20)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::not_equal, new D4RValue(byte), new D4RValue((long long) 5)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::equal, new D4RValue(str), new D4RValue(string("Einstein"))));
+
+        D4FilterRange range;
+        CPPUNIT_ASSERT(clauses.get_range(byte, range));
+        CPPUNIT_ASSERT(range.d_variable == byte);
+        CPPUNIT_ASSERT(!range.d_empty);
+
+        // byte >= 3.5 is tighter than byte > 2
+        CPPUNIT_ASSERT(range.d_lower && range.d_lower->type() == dods_float64_c);
+        CPPUNIT_ASSERT(range.d_lower_inclusive);
+        // byte < 20 is tighter than byte <= 20
+        CPPUNIT_ASSERT(range.d_upper && range.d_upper->type() == dods_int64_c);
+        CPPUNIT_ASSERT(!range.d_upper_inclusive);
+
+        CPPUNIT_ASSERT(clauses.get_range(str, range));
+        CPPUNIT_ASSERT(range.d_lower && range.d_lower == range.d_upper);
+        CPPUNIT_ASSERT(range.d_lower_inclusive && range.d_upper_inclusive);
+
+        CPPUNIT_ASSERT(!clauses.get_range(f32, range));
+        CPPUNIT_ASSERT(!range.d_lower && !range.d_upper && !range.d_empty);
+    }
+
+    void empty_range_test()
+    {
+        D4FilterClauseList clauses;
+        clauses.add_clause(new D4FilterClause(D4FilterClause::greater, new D4RValue(f32), new D4RValue(10.0)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::less, new D4RValue(f32), new D4RValue((long long) 10)));
+
+        D4FilterRange range;
+        CPPUNIT_ASSERT(clauses.get_range(f32, range));
+        CPPUNIT_ASSERT(range.d_empty);
+    }
+
+    void enforced_test()
+    {
+        D4FilterClauseList clauses;
+        clauses.add_clause(new D4FilterClause(D4FilterClause::less, new D4RValue(byte), new D4RValue((long long) 10)));
+        clauses.add_clause(new D4FilterClause(D4FilterClause::equal, new D4RValue(str), new D4RValue(string("Einstein"))));
+
+        // byte holds 17
+        CPPUNIT_ASSERT(!clauses.value());
+        CPPUNIT_ASSERT(!clauses.value(dmr));
+
+        // The handler says it only returns rows with byte < 10
+        clauses.get_clause(0)->set_enforced();
+        CPPUNIT_ASSERT(clauses.get_clause(0)->enforced());
+        CPPUNIT_ASSERT(clauses.value());
+        CPPUNIT_ASSERT(clauses.value(dmr));
+
+        D4FilterClauseList copy(clauses);
+        CPPUNIT_ASSERT(copy.get_clause(0)->enforced());
+        CPPUNIT_ASSERT(!copy.get_clause(1)->enforced());
+        CPPUNIT_ASSERT(copy.value());
+    }
+
     CPPUNIT_TEST_SUITE (D4FilterClauseTest);
 
     CPPUNIT_TEST (Byte_and_long_long_test);
@@ -577,6 +750,14 @@ public:
     CPPUNIT_TEST (evaluation_order_test);
     CPPUNIT_TEST (evaluation_order_test_2);
 
+    CPPUNIT_TEST (block_value_test);
+    CPPUNIT_TEST (block_value_error_test);
+
+    CPPUNIT_TEST (accessors_test);
+    CPPUNIT_TEST (range_test);
+    CPPUNIT_TEST (empty_range_test);
+    CPPUNIT_TEST (enforced_test);
+
     CPPUNIT_TEST_SUITE_END();
 };
 
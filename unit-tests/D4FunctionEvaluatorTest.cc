@@ -0,0 +1,303 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <sstream>
+
+//#define DODS_DEBUG
+
+#include "DMR.h"
+#include "D4Group.h"
+#include "D4RValue.h"
+#include "D4FunctionEvaluator.h"
+#include "Array.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Error.h"
+
+#include "../tests/D4TestTypeFactory.h"
+#include "../tests/D4TestFunction.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+int test_variable_sleep_interval = 0; // Used in Test* classes for testing timeouts.
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// A function that returns its first argument, which it does not own
+static BaseType *function_identity(D4RValueList *args, DMR &dmr)
+{
+    return args->get_rvalue(0)->value(dmr);
+}
+
+// A function that returns a new variable and remembers it
+static BaseType *new_result = 0;
+
+static BaseType *function_new_value(D4RValueList *, DMR &)
+{
+    new_result = new Float64("new_value");
+    return new_result;
+}
+
+class D4FunctionEvaluatorTest: public TestFixture {
+private:
+    D4TestTypeFactory d_factory;
+
+    // A dataset with three 100 by 50 Float32 arrays
+    DMR *make_dmr()
+    {
+        DMR *dmr = new DMR(&d_factory, "test");
+        const char *names[] = { "lat", "lon", "temp", 0 };
+        for (const char **n = names; *n; ++n) {
+            Array *a = d_factory.NewArray(*n, d_factory.NewFloat32(*n));
+            a->append_dim(100);
+            a->append_dim(50);
+            dmr->root()->add_var_nocopy(a);
+        }
+
+        return dmr;
+    }
+
+    // The rvalue for scale(var, m)
+    static D4RValue *scale(DMR &dmr, const string &var, long long m)
+    {
+        D4RValueList *args = new D4RValueList(new D4RValue(dmr.root()->var(var)));
+        args->add_rvalue(new D4RValue(m));
+        return new D4RValue(function_scale_dap4, args, true);
+    }
+
+    // Evaluate the expressions built by 'build' using 'threads' threads and
+    // return the names and values of the results
+    string eval(D4RValueList *(*build)(DMR &), unsigned int threads)
+    {
+        auto_ptr<DMR> dataset(make_dmr());
+        D4FunctionEvaluator evaluator(dataset.get(), 0);
+        evaluator.set_function_threads(threads);
+        evaluator.set_result(build(*dataset));
+
+        DMR result(&d_factory, "function_results");
+        evaluator.eval(&result);
+
+        ostringstream oss;
+        for (Constructor::Vars_iter i = result.root()->var_begin(), e = result.root()->var_end(); i != e; ++i)
+            (*i)->print_val(oss, "", true);
+
+        DBG(cerr << oss.str() << endl);
+        return oss.str();
+    }
+
+    static D4RValueList *three_variables(DMR &dmr)
+    {
+        D4RValueList *rvalues = new D4RValueList(scale(dmr, "lat", 10));
+        rvalues->add_rvalue(scale(dmr, "lon", 2));
+        rvalues->add_rvalue(scale(dmr, "temp", 3));
+        return rvalues;
+    }
+
+    // Calls that use the same variable, nested calls and a variable
+    static D4RValueList *shared_variables(DMR &dmr)
+    {
+        D4RValueList *rvalues = new D4RValueList(scale(dmr, "lat", 10));
+        rvalues->add_rvalue(scale(dmr, "lon", 2));
+        rvalues->add_rvalue(scale(dmr, "lat", 3));
+
+        D4RValueList *args = new D4RValueList(scale(dmr, "temp", 10));
+        args->add_rvalue(new D4RValue((long long)-1));
+        rvalues->add_rvalue(new D4RValue(function_scale_dap4, args, true));
+
+        rvalues->add_rvalue(new D4RValue(dmr.root()->var("lon")));
+        return rvalues;
+    }
+
+    // scale() with one argument is an error
+    static D4RValueList *bad_call(DMR &dmr)
+    {
+        D4RValueList *rvalues = new D4RValueList(scale(dmr, "lat", 10));
+        rvalues->add_rvalue(new D4RValue(function_scale_dap4, new D4RValueList(new D4RValue(dmr.root()->var("lon"))), true));
+        rvalues->add_rvalue(scale(dmr, "temp", 3));
+        return rvalues;
+    }
+
+public:
+    D4FunctionEvaluatorTest()
+    {
+    }
+
+    ~D4FunctionEvaluatorTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_eval()
+    {
+        string values = eval(three_variables, 1);
+        CPPUNIT_ASSERT(values.find("Float64 lat[100][50]") != string::npos);
+        CPPUNIT_ASSERT(values.find("lat") < values.find("lon"));
+        CPPUNIT_ASSERT(values.find("lon") < values.find("temp"));
+    }
+
+    // The results are the same, and in the same order, using several threads
+    void test_parallel_eval()
+    {
+        CPPUNIT_ASSERT_EQUAL(eval(three_variables, 1), eval(three_variables, 4));
+    }
+
+    void test_parallel_eval_shared_variables()
+    {
+        CPPUNIT_ASSERT_EQUAL(eval(shared_variables, 1), eval(shared_variables, 4));
+    }
+
+    void test_parallel_eval_error()
+    {
+        CPPUNIT_ASSERT_THROW(eval(bad_call, 1), Error);
+        CPPUNIT_ASSERT_THROW(eval(bad_call, 4), Error);
+    }
+
+    // A function that returns a variable of the dataset does not give the
+    // variable to the result; the result holds a copy
+    void test_result_is_copied()
+    {
+        for (unsigned int threads = 1; threads <= 4; threads += 3) {
+            auto_ptr<DMR> dataset(make_dmr());
+            BaseType *lat = dataset->root()->var("lat");
+
+            D4RValueList *rvalues = new D4RValueList(
+                new D4RValue(function_identity, new D4RValueList(new D4RValue(lat))));
+            rvalues->add_rvalue(new D4RValue(function_identity, new D4RValueList(new D4RValue(dataset->root()->var("lon")))));
+
+            D4FunctionEvaluator evaluator(dataset.get(), 0);
+            evaluator.set_function_threads(threads);
+            evaluator.set_result(rvalues);
+
+            auto_ptr<DMR> result(new DMR(&d_factory, "function_results"));
+            evaluator.eval(result.get());
+
+            CPPUNIT_ASSERT(result->root()->var("lat") != 0);
+            CPPUNIT_ASSERT(result->root()->var("lat") != lat);
+            CPPUNIT_ASSERT(result->root()->var("lon") != dataset->root()->var("lon"));
+
+            // Each DMR deletes only its own variables
+            result.reset();
+            CPPUNIT_ASSERT(dataset->root()->var("lat") == lat);
+            CPPUNIT_ASSERT(lat->name() == "lat");
+        }
+    }
+
+    // A function that returns a new variable hands it to the result
+    void test_new_result_is_not_copied()
+    {
+        for (unsigned int threads = 1; threads <= 4; threads += 3) {
+            auto_ptr<DMR> dataset(make_dmr());
+
+            D4RValueList *rvalues = new D4RValueList(new D4RValue(function_new_value, new D4RValueList(), true));
+            rvalues->add_rvalue(scale(*dataset, "lat", 2));
+
+            D4FunctionEvaluator evaluator(dataset.get(), 0);
+            evaluator.set_function_threads(threads);
+            evaluator.set_result(rvalues);
+
+            DMR result(&d_factory, "function_results");
+            evaluator.eval(&result);
+
+            CPPUNIT_ASSERT(new_result && result.root()->var("new_value") == new_result);
+        }
+    }
+
+    CPPUNIT_TEST_SUITE (D4FunctionEvaluatorTest);
+
+    CPPUNIT_TEST (test_eval);
+    CPPUNIT_TEST (test_parallel_eval);
+    CPPUNIT_TEST (test_parallel_eval_shared_variables);
+    CPPUNIT_TEST (test_parallel_eval_error);
+    CPPUNIT_TEST (test_result_is_copied);
+    CPPUNIT_TEST (test_new_result_is_not_copied);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (D4FunctionEvaluatorTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: D4FunctionEvaluatorTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = D4FunctionEvaluatorTest::suite()->getTests();
+            unsigned int prefix_len = D4FunctionEvaluatorTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = D4FunctionEvaluatorTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -36,6 +36,7 @@
 #endif
 #include <fcntl.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <iostream>
 #include <fstream>
@@ -44,6 +45,9 @@
 #include <cstring>
 
 #include "D4StreamMarshaller.h"
+#include "CancelToken.h"
+#include "chunked_ostream.h"
+#include "chunked_istream.h"
 
 #include "GetOpt.h"
 #include "debug.h"
@@ -75,6 +79,8 @@ class D4MarshallerTest: public CppUnit::TestFixture {
     CPPUNIT_TEST (test_str);
     CPPUNIT_TEST (test_opaque);
     CPPUNIT_TEST (test_vector);
+    CPPUNIT_TEST (test_cancel_token);
+    CPPUNIT_TEST (test_cancel_vector);
 
     CPPUNIT_TEST_SUITE_END( );
 
@@ -316,6 +322,84 @@ public:
             CPPUNIT_FAIL("Caught an exception.");
         }
     }
+
+    void test_cancel_token()
+    {
+        CancelToken token;
+        CPPUNIT_ASSERT(!token.has_deadline());
+        CPPUNIT_ASSERT(!token.cancelled());
+        token.check();
+
+        token.set_timeout(1);
+        CPPUNIT_ASSERT(token.has_deadline());
+        usleep(5000);
+        CPPUNIT_ASSERT(token.expired());
+        CPPUNIT_ASSERT(token.cancelled());
+        CPPUNIT_ASSERT_THROW(token.check(), Error);
+
+        token.set_timeout(0);
+        CPPUNIT_ASSERT(!token.cancelled());
+
+        // Deadlines are times of the monotonic clock
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += 10;
+        token.set_deadline(deadline);
+        CPPUNIT_ASSERT(token.get_deadline().tv_sec == deadline.tv_sec);
+        CPPUNIT_ASSERT(!token.expired());
+        CPPUNIT_ASSERT(token.time_left() > 9000 && token.time_left() <= 10000);
+
+        deadline.tv_sec -= 20;
+        token.set_deadline(deadline);
+        CPPUNIT_ASSERT(token.expired());
+        CPPUNIT_ASSERT_EQUAL(0L, token.time_left());
+
+        token.set_timeout(0);
+        CPPUNIT_ASSERT_EQUAL(-1L, token.time_left());
+
+        token.cancel();
+        CPPUNIT_ASSERT(token.cancel_called());
+        CPPUNIT_ASSERT(!token.expired());
+        CPPUNIT_ASSERT_THROW(token.check(), Error);
+    }
+
+    // A cancelled token stops the marshaller at the next vector; the data
+    // still buffered by the chunked stream are replaced by an error chunk.
+    void test_cancel_vector()
+    {
+        vector<dods_int32> buf(1024, 7);
+        ostringstream oss;
+        {
+            chunked_ostream cos(oss, 1024);
+            CancelToken token;
+            try {
+                D4StreamMarshaller dsm(cos);
+                dsm.set_cancel_token(&token);
+
+                dsm.put_vector(reinterpret_cast<char*>(&buf[0]), buf.size(), sizeof(dods_int32));
+                token.cancel();
+                dsm.put_vector(reinterpret_cast<char*>(&buf[0]), buf.size(), sizeof(dods_int32));
+                CPPUNIT_FAIL("put_vector() should have thrown");
+            }
+            catch (Error &e) {
+                cos.write_err_chunk(e.get_error_message());
+            }
+        }
+
+        istringstream iss(oss.str());
+        chunked_istream cis(iss, 1024);
+        char c;
+        int bytes = 0;
+        while (cis.read(&c, 1))
+            ++bytes;
+        DBG(cerr << "Read " << bytes << " bytes before the error" << endl);
+
+        // Only (some of) the first vector was sent
+        CPPUNIT_ASSERT(cis.error());
+        CPPUNIT_ASSERT(cis.error_message() == "The request was cancelled.");
+        CPPUNIT_ASSERT(bytes > 0 && bytes <= 4096);
+    }
+
 #if 0
     void test_varying_vector() {
         ostringstream oss;
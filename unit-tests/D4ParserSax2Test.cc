@@ -25,9 +25,11 @@
 #include "config.h"
 
 #include <cstring>
+#include <algorithm>
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include <cppunit/TextTestRunner.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -301,6 +303,72 @@ public:
         CPPUNIT_ASSERT((*m)->parent() == b1);
     }
 
+    // The whole document on one line is parsed in blocks, not lines
+    void test_one_line_stream()
+    {
+        try {
+            string document = read_test_baseline(string(TEST_SRC_DIR) + "/D4-xml/DMR_8.xml");
+            replace(document.begin(), document.end(), '\n', ' ');
+            istringstream iss(document);
+
+            parser->intern(iss, dmr, parser_debug);
+
+            dmr->print_dap4(*xml, false);
+            string baseline = read_test_baseline(string(TEST_SRC_DIR) + "/D4-xml/DMR_8_baseline.xml");
+            CPPUNIT_ASSERT(xml->get_doc() == baseline);
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message().c_str());
+        }
+    }
+
+    // A document bigger than the parser's block size
+    void test_large_stream()
+    {
+        try {
+            const int num_vars = 5000;
+            ostringstream oss;
+            oss << "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+                << "<Dataset xmlns=\"http://xml.opendap.org/ns/DAP/4.0#\" name=\"large\" dapVersion=\"4.0\" dmrVersion=\"1.0\">\n";
+            for (int i = 0; i < num_vars; ++i)
+                oss << "    <Int32 name=\"var_" << i << "\"/>\n";
+            oss << "</Dataset>\n";
+            CPPUNIT_ASSERT(oss.str().size() > D4_PARSE_BUFF_SIZE);
+
+            istringstream iss(oss.str());
+            parser->intern(iss, dmr, parser_debug);
+
+            CPPUNIT_ASSERT(dmr->name() == "large");
+            CPPUNIT_ASSERT(dmr->root()->var_end() - dmr->root()->var_begin() == num_vars);
+            CPPUNIT_ASSERT(dmr->root()->var("var_4999"));
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message().c_str());
+        }
+    }
+
+    // When told the size of the DMR, the parser must leave what follows it
+    void test_sized_stream()
+    {
+        try {
+            string document = read_test_baseline(string(TEST_SRC_DIR) + "/D4-xml/DMR_8.xml");
+            istringstream iss(document + "trailing data");
+
+            parser->intern(iss, document.size(), dmr, parser_debug);
+
+            dmr->print_dap4(*xml, false);
+            string baseline = read_test_baseline(string(TEST_SRC_DIR) + "/D4-xml/DMR_8_baseline.xml");
+            CPPUNIT_ASSERT(xml->get_doc() == baseline);
+
+            string rest;
+            getline(iss, rest);
+            CPPUNIT_ASSERT(rest == "trailing data");
+        }
+        catch (Error &e) {
+            CPPUNIT_FAIL(e.get_error_message().c_str());
+        }
+    }
+
     CPPUNIT_TEST_SUITE (D4ParserSax2Test);
 
     CPPUNIT_TEST (test_empty_dmr);
@@ -339,6 +407,10 @@ public:
 
     CPPUNIT_TEST (test_map_1);
 
+    CPPUNIT_TEST (test_one_line_stream);
+    CPPUNIT_TEST (test_large_stream);
+    CPPUNIT_TEST (test_sized_stream);
+
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -26,6 +26,8 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <sys/time.h>
+
 #include <string>
 #include <sstream>
 
@@ -35,6 +37,8 @@
 #include "D4Group.h"
 #include "D4RValue.h"
 #include "D4FilterClause.h"
+#include "D4StreamMarshaller.h"
+#include "CancelToken.h"
 
 #include "../tests/D4TestTypeFactory.h"
 #include "../tests/TestD4Sequence.h"
@@ -50,6 +54,7 @@
 #include "debug.h"
 
 static bool debug = false;
+static bool benchmark = false;
 
 #undef DBG
 #define DBG(x) do { if (debug) (x); } while(false);
@@ -67,6 +72,20 @@ const static string two_clause_txt = "TestD4Sequence_two_clause.txt";
 
 namespace libdap {
 
+// Count the calls to read() so the tests can see when reading stopped
+class CountingD4Sequence: public TestD4Sequence {
+public:
+    int d_reads;
+
+    CountingD4Sequence(const string &n) : TestD4Sequence(n), d_reads(0) { }
+
+    virtual bool read()
+    {
+        if (!read_p()) ++d_reads;
+        return TestD4Sequence::read();
+    }
+};
+
 class D4SequenceTest: public TestFixture {
 private:
     TestD4Sequence *s;
@@ -206,6 +225,303 @@ public:
         CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + one_clause_txt));
     }
 
+    // Load the values without the filter and then filter the rows in blocks
+    void one_clause_block_test()
+    {
+        D4RValue *arg1 = new D4RValue(s->var("i32"));
+        D4RValue *arg2 = new D4RValue((long long) 1024);
+        s->clauses().add_clause(new D4FilterClause(D4FilterClause::equal, arg1, arg2));
+
+        s->read_sequence_values(false);
+        CPPUNIT_ASSERT(s->length() == 7);
+
+        s->filter_sequence_values();
+        CPPUNIT_ASSERT(s->length() == 1);
+
+        ostringstream oss;
+        s->output_values(oss);
+
+        DBG(cerr << "one_clause_block_test, s: " << oss.str() << endl);
+        CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + one_clause_txt));
+    }
+
+    void two_variable_block_test()
+    {
+        D4RValue *arg1 = new D4RValue(s->var("i32"));
+        D4RValue *arg2 = new D4RValue((long long) 1024);
+        s->clauses().add_clause(new D4FilterClause(D4FilterClause::greater_equal, arg1, arg2));
+
+        // The constant is on the left here
+        D4RValue *arg1_2 = new D4RValue((long long) 0.0);
+        D4RValue *arg2_2 = new D4RValue(s->var("f32"));
+        s->clauses().add_clause(new D4FilterClause(D4FilterClause::greater, arg1_2, arg2_2));
+
+        s->read_sequence_values(false);
+        s->filter_sequence_values();
+
+        ostringstream oss;
+        s->output_values(oss);
+
+        DBG(cerr << "two_variable_block_test, s: " << oss.str() << endl);
+        CPPUNIT_ASSERT(s->length() == 1);
+        CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + one_clause_txt));
+    }
+
+    // Build a sequence like 's' with filter clauses on two variables. If
+    // 'by_row' is true, the clauses are evaluated as each row is read; a
+    // row-number constraint that selects every row keeps
+    // read_sequence_values() from filtering by block.
+    TestD4Sequence *many_rows_seq(bool by_row = false, int rows = 10000)
+    {
+        TestD4Sequence *seq = new TestD4Sequence("s");
+        seq->add_var_nocopy(new TestInt32("i32"));
+        seq->add_var_nocopy(new TestStr("str"));
+        seq->add_var_nocopy(new TestFloat32("f32"));
+        seq->set_series_values(true);
+        seq->set_send_p(true);
+        seq->set_length(rows);
+        if (by_row)
+            seq->set_row_number_constraint(0, -1);
+
+        D4RValue *arg1 = new D4RValue(seq->var("f32"));
+        D4RValue *arg2 = new D4RValue(0.5);
+        seq->clauses().add_clause(new D4FilterClause(D4FilterClause::less, arg1, arg2));
+
+        D4RValue *arg1_2 = new D4RValue(seq->var("str"));
+        D4RValue *arg2_2 = new D4RValue(string("string: [0-9]*5"));
+        seq->clauses().add_clause(new D4FilterClause(D4FilterClause::match, arg1_2, arg2_2));
+
+        return seq;
+    }
+
+    // More rows than fit in one block; the result must match filtering
+    // as the rows are read
+    void many_rows_block_test()
+    {
+        auto_ptr<TestD4Sequence> by_row(many_rows_seq(true));
+        by_row->intern_data();
+
+        auto_ptr<TestD4Sequence> by_block(many_rows_seq());
+        by_block->read_sequence_values(false);
+        CPPUNIT_ASSERT(by_block->length() == 10000);
+        by_block->filter_sequence_values();
+
+        DBG(cerr << "many_rows_block_test, length: " << by_block->length() << endl);
+        CPPUNIT_ASSERT(by_block->length() > 0 && by_block->length() < 10000);
+        CPPUNIT_ASSERT(by_block->length() == by_row->length());
+
+        ostringstream block_oss, row_oss;
+        by_block->output_values(block_oss);
+        by_row->output_values(row_oss);
+        CPPUNIT_ASSERT(block_oss.str() == row_oss.str());
+    }
+
+    // read_sequence_values() filters by block when it can
+    void read_by_block_test()
+    {
+        vector<BaseType*> columns;
+        auto_ptr<TestD4Sequence> by_row(many_rows_seq(true));
+        CPPUNIT_ASSERT(!by_row->m_filter_by_block(columns));
+        by_row->intern_data();
+
+        auto_ptr<TestD4Sequence> by_block(many_rows_seq());
+        CPPUNIT_ASSERT(by_block->m_filter_by_block(columns));
+        by_block->intern_data();
+
+        DBG(cerr << "read_by_block_test, length: " << by_block->length() << endl);
+        CPPUNIT_ASSERT(by_block->length() > 0 && by_block->length() < 10000);
+        CPPUNIT_ASSERT(by_block->length() == by_row->length());
+
+        ostringstream block_oss, row_oss;
+        by_block->output_values(block_oss);
+        by_row->output_values(row_oss);
+        CPPUNIT_ASSERT(block_oss.str() == row_oss.str());
+    }
+
+    // A filter on a variable that is not sent is evaluated row by row
+    void not_sent_filter_test()
+    {
+        vector<BaseType*> columns;
+        auto_ptr<TestD4Sequence> seq(many_rows_seq());
+        seq->var("f32")->set_send_p(false);
+        CPPUNIT_ASSERT(!seq->m_filter_by_block(columns));
+
+        auto_ptr<TestD4Sequence> by_row(many_rows_seq(true));
+        by_row->var("f32")->set_send_p(false);
+
+        seq->intern_data();
+        by_row->intern_data();
+        CPPUNIT_ASSERT(seq->length() > 0 && seq->length() == by_row->length());
+    }
+
+    // The data response is the same when the rows are filtered by block
+    void serialize_by_block_test()
+    {
+        DMR dmr;
+
+        ostringstream row_oss;
+        {
+            auto_ptr<TestD4Sequence> by_row(many_rows_seq(true));
+            D4StreamMarshaller m(row_oss);
+            by_row->serialize(m, dmr, true);
+        }
+
+        ostringstream block_oss;
+        {
+            auto_ptr<TestD4Sequence> by_block(many_rows_seq());
+            D4StreamMarshaller m(block_oss);
+            by_block->serialize(m, dmr, true);
+        }
+
+        CPPUNIT_ASSERT(block_oss.str().size() > 0);
+        CPPUNIT_ASSERT(block_oss.str() == row_oss.str());
+    }
+
+    // Ten million rows, filtered row by row and by block. Run with -b.
+    void filter_benchmark()
+    {
+        if (!benchmark)
+            return;
+
+        const int rows = 10000000;
+        const char *names[] = { "row by row", "by block" };
+        int64_t lengths[2];
+        for (int by_block = 0; by_block < 2; ++by_block) {
+            auto_ptr<TestD4Sequence> seq(many_rows_seq(!by_block, rows));
+
+            struct timeval start, end;
+            gettimeofday(&start, 0);
+            seq->read_sequence_values(true);
+            gettimeofday(&end, 0);
+
+            lengths[by_block] = seq->length();
+            cerr << "filter_benchmark, " << names[by_block] << ": " << rows << " rows, "
+                << seq->length() << " selected, "
+                << (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0 << " ms" << endl;
+        }
+
+        CPPUNIT_ASSERT(lengths[0] == lengths[1]);
+    }
+
+    CountingD4Sequence *counting_seq()
+    {
+        CountingD4Sequence *seq = new CountingD4Sequence("s");
+        seq->add_var_nocopy(new TestInt32("i32"));
+        seq->add_var_nocopy(new TestStr("str"));
+        seq->add_var_nocopy(new TestFloat32("f32"));
+        seq->set_series_values(true);
+        seq->set_send_p(true);
+        seq->set_length(7);
+
+        return seq;
+    }
+
+    void row_number_test()
+    {
+        auto_ptr<CountingD4Sequence> all(counting_seq());
+        all->intern_data();
+        // seven rows and the read() that finds the end of the sequence
+        CPPUNIT_ASSERT(all->d_reads == 8);
+
+        auto_ptr<CountingD4Sequence> seq(counting_seq());
+        seq->set_row_number_constraint(1, 3);
+        seq->intern_data();
+
+        DBG(cerr << "row_number_test, reads: " << seq->d_reads << endl);
+        CPPUNIT_ASSERT(seq->length() == 3);
+        // Reading stops once the last row has been found
+        CPPUNIT_ASSERT(seq->d_reads == 4);
+
+        for (int i = 0; i < 3; ++i) {
+            ostringstream row_oss, all_oss;
+            seq->var_value(i, "i32")->print_val(row_oss, "", false);
+            all->var_value(i + 1, "i32")->print_val(all_oss, "", false);
+            CPPUNIT_ASSERT(row_oss.str() == all_oss.str());
+        }
+    }
+
+    void row_stride_test()
+    {
+        auto_ptr<CountingD4Sequence> all(counting_seq());
+        all->intern_data();
+
+        auto_ptr<CountingD4Sequence> seq(counting_seq());
+        seq->set_row_number_constraint(0, -1, 3);
+        seq->intern_data();
+
+        CPPUNIT_ASSERT(seq->length() == 3);
+        CPPUNIT_ASSERT(seq->d_reads == 8);
+
+        for (int i = 0; i < 3; ++i) {
+            ostringstream row_oss, all_oss;
+            seq->var_value(i, "str")->print_val(row_oss, "", false);
+            all->var_value(i * 3, "str")->print_val(all_oss, "", false);
+            CPPUNIT_ASSERT(row_oss.str() == all_oss.str());
+        }
+    }
+
+    // The row numbers count rows that satisfy the filter
+    void row_number_filter_test()
+    {
+        D4RValue *arg1 = new D4RValue(s->var("i32"));
+        D4RValue *arg2 = new D4RValue((long long) 1024);
+        s->clauses().add_clause(new D4FilterClause(D4FilterClause::greater_equal, arg1, arg2));
+
+        s->set_row_number_constraint(0, 0);
+        s->intern_data();
+
+        ostringstream oss;
+        s->output_values(oss);
+
+        DBG(cerr << "row_number_filter_test, s: " << oss.str() << endl);
+        CPPUNIT_ASSERT(s->length() == 1);
+        CPPUNIT_ASSERT(oss.str() == read_test_baseline(prefix + one_clause_txt));
+    }
+
+    void row_number_enforced_test()
+    {
+        auto_ptr<CountingD4Sequence> seq(counting_seq());
+        seq->set_row_number_constraint(1, 3);
+        seq->set_row_number_constraint_enforced();
+        seq->intern_data();
+
+        CPPUNIT_ASSERT(seq->length() == 7);
+        CPPUNIT_ASSERT(seq->get_starting_row_number() == 1);
+        CPPUNIT_ASSERT(seq->get_ending_row_number() == 3);
+        CPPUNIT_ASSERT(seq->get_row_stride() == 1);
+    }
+
+    void row_number_error_test()
+    {
+        CPPUNIT_ASSERT(s->get_starting_row_number() == -1);
+        CPPUNIT_ASSERT_THROW(s->set_row_number_constraint(3, 1), Error);
+        CPPUNIT_ASSERT_THROW(s->set_row_number_constraint(-1, 1), Error);
+        CPPUNIT_ASSERT_THROW(s->set_row_number_constraint(0, 1, 0), Error);
+    }
+
+    // A cancelled token stops reading the rows
+    void cancel_test()
+    {
+        CancelToken token;
+        auto_ptr<CountingD4Sequence> seq(counting_seq());
+        seq->read_sequence_values(false, &token);
+        CPPUNIT_ASSERT(seq->length() == 7);
+
+        token.cancel();
+        auto_ptr<CountingD4Sequence> cancelled(counting_seq());
+        CPPUNIT_ASSERT_THROW(cancelled->read_sequence_values(false, &token), Error);
+        CPPUNIT_ASSERT(cancelled->d_reads == 1);
+
+        // serialize() uses the marshaller's token
+        ostringstream oss;
+        D4StreamMarshaller m(oss);
+        m.set_cancel_token(&token);
+        DMR dmr;
+        auto_ptr<CountingD4Sequence> serialized(counting_seq());
+        CPPUNIT_ASSERT_THROW(serialized->serialize(m, dmr, false), Error);
+        CPPUNIT_ASSERT(serialized->d_reads == 1);
+    }
+
     CPPUNIT_TEST_SUITE (D4SequenceTest);
 
     CPPUNIT_TEST (ctor_test);
@@ -216,6 +532,21 @@ public:
     CPPUNIT_TEST (two_clause_test);
     CPPUNIT_TEST (two_variable_test);
 
+    CPPUNIT_TEST (one_clause_block_test);
+    CPPUNIT_TEST (two_variable_block_test);
+    CPPUNIT_TEST (many_rows_block_test);
+    CPPUNIT_TEST (read_by_block_test);
+    CPPUNIT_TEST (not_sent_filter_test);
+    CPPUNIT_TEST (serialize_by_block_test);
+    CPPUNIT_TEST (filter_benchmark);
+
+    CPPUNIT_TEST (row_number_test);
+    CPPUNIT_TEST (row_stride_test);
+    CPPUNIT_TEST (row_number_filter_test);
+    CPPUNIT_TEST (row_number_enforced_test);
+    CPPUNIT_TEST (row_number_error_test);
+    CPPUNIT_TEST (cancel_test);
+
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -225,13 +556,16 @@ CPPUNIT_TEST_SUITE_REGISTRATION (D4SequenceTest);
 
 int main(int argc, char*argv[])
 {
-    GetOpt getopt(argc, argv, "dh");
+    GetOpt getopt(argc, argv, "dbh");
     int option_char;
     while ((option_char = getopt()) != -1)
         switch (option_char) {
         case 'd':
             debug = 1;  // debug is a static global
             break;
+        case 'b':
+            benchmark = true;   // run filter_benchmark
+            break;
         case 'h': {     // help - show test names
             cerr << "Usage: D4SequenceTest has the following tests:" << endl;
             const std::vector<Test*> &tests = libdap::D4SequenceTest::suite()->getTests();
@@ -0,0 +1,545 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "DAP2RequestHandler.h"
+#include "DAS.h"
+#include "DDS.h"
+#include "Error.h"
+
+#include "../tests/TestTypeFactory.h"
+#include "../tests/TestInt32.h"
+#include "../tests/TestArray.h"
+#include "../tests/TestStructure.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+int test_variable_sleep_interval = 0; // Used in Test* classes for testing timeouts.
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static const int num_threads = 8;
+static const int num_requests = 100;
+
+// An Int32 that takes 20ms to read
+class SlowInt32: public TestInt32 {
+public:
+    SlowInt32(const string &n) : TestInt32(n) { }
+
+    virtual BaseType *ptr_duplicate() { return new SlowInt32(*this); }
+
+    virtual bool read()
+    {
+        usleep(20000);
+        return TestInt32::read();
+    }
+};
+
+// An Int32 that always reads the value it was made with
+class FixedInt32: public TestInt32 {
+private:
+    dods_int32 d_fixed;
+
+public:
+    FixedInt32(const string &n, dods_int32 value) : TestInt32(n), d_fixed(value) { }
+
+    virtual BaseType *ptr_duplicate() { return new FixedInt32(*this); }
+
+    virtual bool read()
+    {
+        if (read_p())
+            return true;
+        set_value(d_fixed);
+        set_read_p(true);
+        return true;
+    }
+};
+
+// Datasets named 'slow' have ten SlowInt32s. Datasets named 'value-N' have
+// a Structure of Int32s that read N, N+1, ... and an Array that reads a
+// series of values. All others have an Int32 and an Array.
+class TestHandler: public DAP2RequestHandler {
+private:
+    int d_builds;
+    time_t d_last_modified;
+
+protected:
+    virtual void build_dds(const string &dataset, DDS &dds)
+    {
+        __sync_fetch_and_add(&d_builds, 1);
+
+        dds.set_dataset_name(dataset);
+        if (dataset == "slow") {
+            for (int i = 0; i < 10; ++i) {
+                ostringstream name;
+                name << "s" << i;
+                dds.add_var_nocopy(new SlowInt32(name.str()));
+            }
+        }
+        else if (dataset.find("value-") == 0) {
+            int value = atoi(dataset.substr(6).c_str());
+            TestStructure *s = new TestStructure("s");
+            for (int i = 0; i < 100; ++i) {
+                ostringstream name;
+                name << "x" << i;
+                s->add_var_nocopy(new FixedInt32(name.str(), value + i));
+            }
+            dds.add_var_nocopy(s);
+            TestArray *a = new TestArray("a", new TestInt32("a"));
+            a->append_dim(10, "d");
+            a->set_series_values(true);
+            dds.add_var_nocopy(a);
+        }
+        else {
+            dds.add_var_nocopy(new TestInt32("x"));
+            TestArray *a = new TestArray("a", new TestInt32("a"));
+            a->append_dim(10, "d");
+            dds.add_var_nocopy(a);
+        }
+    }
+
+    virtual void build_das(const string &, DAS &das)
+    {
+        AttrTable *x = new AttrTable;
+        x->append_attr("units", "String", "\"meters\"");
+        das.add_table("x", x);
+    }
+
+    virtual time_t last_modified(const string &)
+    {
+        return d_last_modified;
+    }
+
+public:
+    TestHandler(BaseTypeFactory *factory, unsigned long max_templates = 100) :
+        DAP2RequestHandler(factory, max_templates), d_builds(0), d_last_modified(1000)
+    {
+    }
+
+    int builds() const { return d_builds; }
+    void set_last_modified(time_t t) { d_last_modified = t; }
+};
+
+struct cancel_arg {
+    TestHandler *handler;
+    DAP2Request *request;
+    string error;
+};
+
+// Handle a request that is cancelled by the test while it runs
+static void *send_cancelled_data(void *arg)
+{
+    cancel_arg *ca = static_cast<cancel_arg*>(arg);
+    ostringstream oss;
+    try {
+        ca->handler->handle(*ca->request, oss);
+    }
+    catch (Error &e) {
+        ca->error = e.get_error_message();
+    }
+
+    return 0;
+}
+
+struct thread_arg {
+    TestHandler *handler;
+    string dataset;
+    string ce;
+    string expected;
+};
+
+// Send the same data response over and over; return null if every byte of
+// every response matches the expected one.
+static void *send_data(void *arg)
+{
+    thread_arg *ta = static_cast<thread_arg*>(arg);
+    for (int i = 0; i < num_requests; ++i) {
+        DAP2Request request(DODSFilter::DataDDS_Response, ta->dataset, ta->ce);
+        request.set_with_mime_headers(false);
+        request.set_timeout(10000);
+
+        ostringstream oss;
+        try {
+            ta->handler->handle(request, oss);
+        }
+        catch (Error &e) {
+            DBG(cerr << "Error: " << e.get_error_message() << endl);
+            return arg;
+        }
+
+        const string response = oss.str();
+        if (response.size() != ta->expected.size()) {
+            DBG(cerr << ta->dataset << ": " << response.size() << " bytes, expected " << ta->expected.size() << endl);
+            return arg;
+        }
+        for (string::size_type b = 0; b < response.size(); ++b) {
+            if (response[b] != ta->expected[b]) {
+                DBG(cerr << ta->dataset << ": byte " << b << " differs" << endl);
+                return arg;
+            }
+        }
+    }
+
+    return 0;
+}
+
+class DAP2RequestHandlerTest: public TestFixture {
+private:
+    TestTypeFactory d_factory;
+
+    string m_handle(TestHandler &handler, DODSFilter::Response response, const string &dataset,
+        const string &ce = "")
+    {
+        DAP2Request request(response, dataset, ce);
+        request.set_with_mime_headers(false);
+        ostringstream oss;
+        handler.handle(request, oss);
+        return oss.str();
+    }
+
+public:
+    DAP2RequestHandlerTest()
+    {
+    }
+    ~DAP2RequestHandlerTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_das()
+    {
+        TestHandler handler(&d_factory);
+        string das = m_handle(handler, DODSFilter::DAS_Response, "test");
+        DBG(cerr << das << endl);
+        CPPUNIT_ASSERT_EQUAL(string("Attributes {\n    x {\n        String units \"meters\";\n    }\n}\n"), das);
+    }
+
+    void test_dds()
+    {
+        TestHandler handler(&d_factory);
+        string dds = m_handle(handler, DODSFilter::DDS_Response, "test", "x");
+        DBG(cerr << dds << endl);
+        CPPUNIT_ASSERT_EQUAL(string("Dataset {\n    Int32 x;\n} test;\n"), dds);
+
+        dds = m_handle(handler, DODSFilter::DDS_Response, "test");
+        CPPUNIT_ASSERT(dds.find("Int32 a[d = 10];") != string::npos);
+
+        // The template is not changed by the constraint of the first request
+        CPPUNIT_ASSERT(dds.find("Int32 x;") != string::npos);
+    }
+
+    void test_ddx()
+    {
+        TestHandler handler(&d_factory);
+        string ddx = m_handle(handler, DODSFilter::DDX_Response, "test", "x");
+        DBG(cerr << ddx << endl);
+        CPPUNIT_ASSERT(ddx.find("<Int32 name=\"x\">") != string::npos);
+        CPPUNIT_ASSERT(ddx.find("<Attribute name=\"units\" type=\"String\">") != string::npos);
+        CPPUNIT_ASSERT(ddx.find("name=\"a\"") == string::npos);
+    }
+
+    void test_data()
+    {
+        TestHandler handler(&d_factory);
+        string data = m_handle(handler, DODSFilter::DataDDS_Response, "test", "x");
+
+        string::size_type pos = data.find("Data:\n");
+        CPPUNIT_ASSERT(pos != string::npos);
+        CPPUNIT_ASSERT_EQUAL(string("Dataset {\n    Int32 x;\n} test;\n"), data.substr(0, pos));
+        // 123456789 as an XDR int
+        CPPUNIT_ASSERT_EQUAL(string("\x07\x5b\xcd\x15", 4), data.substr(pos + 6));
+    }
+
+    void test_mime_headers()
+    {
+        TestHandler handler(&d_factory);
+
+        DAP2Request request(DODSFilter::DDS_Response, "test");
+        request.set_version("test/1.0");
+        ostringstream oss;
+        handler.handle(request, oss);
+        DBG(cerr << oss.str() << endl);
+        CPPUNIT_ASSERT(oss.str().find("Content-Description: dods_dds") != string::npos);
+        CPPUNIT_ASSERT(oss.str().find("XDODS-Server: test/1.0") != string::npos);
+
+        // Not modified since the If-Modified-Since time
+        request.set_if_modified_since(1000);
+        CPPUNIT_ASSERT(request.is_conditional());
+        ostringstream oss2;
+        handler.handle(request, oss2);
+        CPPUNIT_ASSERT(oss2.str().find("304") != string::npos);
+        CPPUNIT_ASSERT(oss2.str().find("Dataset {") == string::npos);
+
+        // Modified since
+        handler.set_last_modified(2000);
+        ostringstream oss3;
+        handler.handle(request, oss3);
+        CPPUNIT_ASSERT(oss3.str().find("Dataset {") != string::npos);
+    }
+
+    void test_templates()
+    {
+        TestHandler handler(&d_factory);
+        m_handle(handler, DODSFilter::DDS_Response, "test");
+        m_handle(handler, DODSFilter::DataDDS_Response, "test", "x");
+        m_handle(handler, DODSFilter::DAS_Response, "test");
+
+        CPPUNIT_ASSERT_EQUAL(1, handler.builds());
+        CPPUNIT_ASSERT_EQUAL(2UL, handler.template_hits());
+        CPPUNIT_ASSERT_EQUAL(1UL, handler.template_misses());
+
+        // A new version of the dataset
+        handler.set_last_modified(2000);
+        m_handle(handler, DODSFilter::DDS_Response, "test");
+        CPPUNIT_ASSERT_EQUAL(2, handler.builds());
+        CPPUNIT_ASSERT_EQUAL(1UL, handler.templates());
+
+        m_handle(handler, DODSFilter::DDS_Response, "other");
+        CPPUNIT_ASSERT_EQUAL(2UL, handler.templates());
+
+        handler.clear_templates();
+        CPPUNIT_ASSERT_EQUAL(0UL, handler.templates());
+        m_handle(handler, DODSFilter::DDS_Response, "test");
+        CPPUNIT_ASSERT_EQUAL(4, handler.builds());
+    }
+
+    // The template used least recently is removed
+    void test_max_templates()
+    {
+        TestHandler handler(&d_factory, 2);
+        m_handle(handler, DODSFilter::DDS_Response, "one");
+        m_handle(handler, DODSFilter::DDS_Response, "two");
+        m_handle(handler, DODSFilter::DDS_Response, "one");
+        m_handle(handler, DODSFilter::DDS_Response, "three");
+        CPPUNIT_ASSERT_EQUAL(2UL, handler.templates());
+        CPPUNIT_ASSERT_EQUAL(3, handler.builds());
+
+        m_handle(handler, DODSFilter::DDS_Response, "one");
+        CPPUNIT_ASSERT_EQUAL(3, handler.builds());
+        m_handle(handler, DODSFilter::DDS_Response, "two");
+        CPPUNIT_ASSERT_EQUAL(4, handler.builds());
+
+        TestHandler none(&d_factory, 0);
+        m_handle(none, DODSFilter::DDS_Response, "one");
+        m_handle(none, DODSFilter::DDS_Response, "one");
+        CPPUNIT_ASSERT_EQUAL(0UL, none.templates());
+        CPPUNIT_ASSERT_EQUAL(2, none.builds());
+    }
+
+    void test_errors()
+    {
+        TestHandler handler(&d_factory);
+        CPPUNIT_ASSERT_THROW(m_handle(handler, DODSFilter::DataDDS_Response, "test", "no_such_var"), Error);
+        CPPUNIT_ASSERT_THROW(m_handle(handler, DODSFilter::Version_Response, "test"), Error);
+
+        // The template is still there and can be used
+        m_handle(handler, DODSFilter::DataDDS_Response, "test", "x");
+        CPPUNIT_ASSERT_EQUAL(1, handler.builds());
+    }
+
+    void test_deadline()
+    {
+        TestHandler handler(&d_factory);
+
+        DAP2Request request(DODSFilter::DataDDS_Response, "slow");
+        request.set_with_mime_headers(false);
+        CPPUNIT_ASSERT(!request.has_deadline());
+        CPPUNIT_ASSERT(!request.expired());
+
+        // The deadline passes before all ten variables are read
+        request.set_timeout(50);
+        CPPUNIT_ASSERT(request.has_deadline());
+        ostringstream oss;
+        CPPUNIT_ASSERT_THROW(handler.handle(request, oss), Error);
+        CPPUNIT_ASSERT(request.expired());
+        string::size_type pos = oss.str().find("Data:\n");
+        CPPUNIT_ASSERT(pos != string::npos);
+        CPPUNIT_ASSERT(oss.str().size() - (pos + 6) < 40);
+
+        // Already past
+        ostringstream oss2;
+        CPPUNIT_ASSERT_THROW(handler.handle(request, oss2), Error);
+        CPPUNIT_ASSERT(oss2.str().empty());
+
+        request.set_timeout(0);
+        CPPUNIT_ASSERT(!request.has_deadline());
+        ostringstream oss3;
+        handler.handle(request, oss3);
+        pos = oss3.str().find("Data:\n");
+        CPPUNIT_ASSERT_EQUAL(string::size_type(40), oss3.str().size() - (pos + 6));
+    }
+
+    void test_cancel()
+    {
+        TestHandler handler(&d_factory);
+
+        DAP2Request request(DODSFilter::DataDDS_Response, "slow");
+        request.set_with_mime_headers(false);
+
+        cancel_arg arg;
+        arg.handler = &handler;
+        arg.request = &request;
+
+        // The ten variables take 200ms; cancel the request part way through
+        pthread_t thread;
+        CPPUNIT_ASSERT(pthread_create(&thread, 0, send_cancelled_data, &arg) == 0);
+        usleep(50000);
+        request.cancel();
+        pthread_join(thread, 0);
+
+        DBG(cerr << "Error: " << arg.error << endl);
+        CPPUNIT_ASSERT(arg.error.find("cancelled") != string::npos);
+        CPPUNIT_ASSERT(request.cancel_token().cancelled());
+        CPPUNIT_ASSERT(!request.expired());
+    }
+
+    // Each thread asks for a different dataset and constraint, so a response
+    // that picks up bytes from another thread's response will not match.
+    void test_threads()
+    {
+        TestHandler handler(&d_factory);
+
+        vector<thread_arg> args(num_threads);
+        for (int i = 0; i < num_threads; ++i) {
+            ostringstream dataset, ce;
+            dataset << "value-" << 1000 * (i + 1);
+            ce << "s,a[0:" << i << "]";
+
+            args[i].handler = &handler;
+            args[i].dataset = dataset.str();
+            args[i].ce = ce.str();
+            args[i].expected = m_handle(handler, DODSFilter::DataDDS_Response, args[i].dataset, args[i].ce);
+            CPPUNIT_ASSERT(args[i].expected.find("Data:\n") != string::npos);
+            for (int j = 0; j < i; ++j)
+                CPPUNIT_ASSERT(args[i].expected != args[j].expected);
+        }
+        handler.clear_templates();
+
+        vector<pthread_t> threads(num_threads);
+        for (int i = 0; i < num_threads; ++i)
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, send_data, &args[i]) == 0);
+
+        for (int i = 0; i < num_threads; ++i) {
+            void *status = 0;
+            pthread_join(threads[i], &status);
+            CPPUNIT_ASSERT(status == 0);
+        }
+
+        CPPUNIT_ASSERT_EQUAL((unsigned long) num_threads, handler.templates());
+        CPPUNIT_ASSERT_EQUAL((unsigned long) num_threads * num_requests,
+            handler.template_hits() + handler.template_misses() - num_threads);
+    }
+
+    CPPUNIT_TEST_SUITE (DAP2RequestHandlerTest);
+
+    CPPUNIT_TEST (test_das);
+    CPPUNIT_TEST (test_dds);
+    CPPUNIT_TEST (test_ddx);
+    CPPUNIT_TEST (test_data);
+    CPPUNIT_TEST (test_mime_headers);
+    CPPUNIT_TEST (test_templates);
+    CPPUNIT_TEST (test_max_templates);
+    CPPUNIT_TEST (test_errors);
+    CPPUNIT_TEST (test_deadline);
+    CPPUNIT_TEST (test_cancel);
+    CPPUNIT_TEST (test_threads);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (DAP2RequestHandlerTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: DAP2RequestHandlerTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = DAP2RequestHandlerTest::suite()->getTests();
+            unsigned int prefix_len = DAP2RequestHandlerTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = DAP2RequestHandlerTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
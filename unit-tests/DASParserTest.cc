@@ -0,0 +1,308 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/time.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <sstream>
+
+//#define DODS_DEBUG
+
+#include "DAS.h"
+#include "DASParser.h"
+#include "Error.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// The number of copies of the test DAS files in the large DAS
+static const int num_copies = 1000;
+
+// These files in das-testsuite parse without error; the rest are errors
+static const char *good_files[] = {
+    "bad_value_test.1", "test.1", "test.1.das", "test.11", "test.12", "test.13", "test.14",
+    "test.15", "test.17", "test.18", "test.19", "test.2", "test.20", "test.21", "test.22",
+    "test.23", "test.24", "test.26", "test.27", "test.28", "test.3", "test.31", "test.32",
+    "test.33", "test.34", "test.4", "test.8", "test.9", "test_1.das", 0
+};
+
+static const char *bad_files[] = {
+    "test.16", "test.25", "test.29", "test.30", "test.5", "test.6", "test.7", 0
+};
+
+static double elapsed(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+static string das_file(const string &name)
+{
+    return (string) TEST_SRC_DIR + "/das-testsuite/" + name;
+}
+
+static string print_das(DAS &das)
+{
+    ostringstream oss;
+    das.print(oss);
+    return oss.str();
+}
+
+// Parse a file using either DASParser or the bison parser and return the
+// printed DAS.
+static string parse_file(const string &name, bool fast)
+{
+    DAS das;
+    das.set_fast_parser(fast);
+    das.parse(das_file(name));
+    return print_das(das);
+}
+
+class DASParserTest: public TestFixture {
+private:
+
+public:
+    DASParserTest()
+    {
+    }
+
+    ~DASParserTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_attributes()
+    {
+        DAS das;
+        DASParser().intern(string("Attributes {\n    var1 {\n        String name bob;\n"
+            "        Int32 age 19, 20;\n    }\n}\n"), &das);
+
+        AttrTable *var1 = das.get_table("var1");
+        CPPUNIT_ASSERT(var1);
+        CPPUNIT_ASSERT(var1->get_attr("name") == "bob");
+        CPPUNIT_ASSERT(var1->get_type("age") == "Int32");
+        CPPUNIT_ASSERT(var1->get_attr_num("age") == 2);
+        CPPUNIT_ASSERT(var1->get_attr("age", 1) == "20");
+    }
+
+    // Bad values go into a <name>_dods_errors container and the good values
+    // of the same attribute stay in order.
+    void test_bad_values()
+    {
+        DAS das;
+        DASParser().intern(string("Attributes {\n    v {\n        Int16 a 1, 70000, 2;\n    }\n}\n"), &das);
+
+        AttrTable *v = das.get_table("v");
+        CPPUNIT_ASSERT(v);
+        CPPUNIT_ASSERT(v->get_attr_num("a") == 2);
+        CPPUNIT_ASSERT(v->get_attr("a", 0) == "1");
+        CPPUNIT_ASSERT(v->get_attr("a", 1) == "2");
+
+        AttrTable *errors = v->get_attr_table("v_dods_errors");
+        CPPUNIT_ASSERT(errors);
+        CPPUNIT_ASSERT(errors->get_attr("a") == "70000");
+        CPPUNIT_ASSERT(errors->get_attr("a_explanation") == "`70000' is not an Int16 value.");
+    }
+
+    void test_alias()
+    {
+        DAS das;
+        DASParser().intern(string("Attributes {\n    var1 {\n        Int32 x 14;\n    }\n"
+            "    Alias var2 var1;\n}\n"), &das);
+
+        AttrTable *var2 = das.get_table("var2");
+        CPPUNIT_ASSERT(var2);
+        CPPUNIT_ASSERT(var2->get_attr("x") == "14");
+    }
+
+    void test_unterminated_quote()
+    {
+        DAS das;
+        try {
+            DASParser().intern(string("Attributes {\n    v {\n        String s \"abc;\n    }\n}\n"), &das);
+            CPPUNIT_FAIL("Expected an Error for the unterminated quote");
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(e.get_error_message().find("Unterminated quote (starts on line 3)") != string::npos);
+        }
+    }
+
+    void test_empty()
+    {
+        DAS das;
+        CPPUNIT_ASSERT_THROW(DASParser().intern(string(""), &das), Error);
+    }
+
+    // DASParser and das.yy build the same DAS from each of the test files
+    void test_same_as_bison()
+    {
+        for (const char **f = good_files; *f; ++f) {
+            DBG(cerr << "File: " << *f << endl);
+            CPPUNIT_ASSERT_EQUAL(parse_file(*f, false), parse_file(*f, true));
+        }
+
+        for (const char **f = bad_files; *f; ++f) {
+            DBG(cerr << "Bad file: " << *f << endl);
+            CPPUNIT_ASSERT_THROW(parse_file(*f, false), Error);
+            CPPUNIT_ASSERT_THROW(parse_file(*f, true), Error);
+        }
+    }
+
+    // Build a large DAS from num_copies copies of each of the test files and
+    // compare the time needed to parse it with each parser.
+    void test_large_das()
+    {
+        DAS large;
+        for (const char **f = good_files; *f; ++f) {
+            DAS das;
+            das.set_fast_parser(true);
+            das.parse(das_file(*f));
+            // Aliases name their source by its path, so they can't be copied,
+            // and the explanations of bad values may not parse once printed
+            string text = print_das(das);
+            if (text.find("Alias") != string::npos || text.find("_dods_errors") != string::npos)
+                continue;
+
+            for (int i = 0; i < num_copies; ++i) {
+                ostringstream suffix;
+                suffix << "_" << (f - good_files) << "_" << i;
+                for (AttrTable::Attr_iter a = das.var_begin(), e = das.var_end(); a != e; ++a)
+                    large.add_table(das.get_name(a) + suffix.str(), new AttrTable(*das.get_table(a)));
+            }
+        }
+
+        string document = print_das(large);
+        DBG(cerr << "Large DAS size: " << document.size() << endl);
+
+        struct timeval start;
+        gettimeofday(&start, 0);
+        DAS fast;
+        DASParser().intern(document, &fast);
+        DBG(cerr << "DASParser: " << elapsed(start) << "s" << endl);
+
+        CPPUNIT_ASSERT(print_das(fast) == document);
+
+        // The bison parser reads from a FILE
+        FILE *in = tmpfile();
+        CPPUNIT_ASSERT(in);
+        fwrite(document.data(), 1, document.size(), in);
+        rewind(in);
+        gettimeofday(&start, 0);
+        DAS bison;
+        try {
+            bison.parse(in);
+        }
+        catch (...) {
+            fclose(in);
+            throw;
+        }
+        DBG(cerr << "das.yy: " << elapsed(start) << "s" << endl);
+        fclose(in);
+
+        CPPUNIT_ASSERT(print_das(bison) == document);
+    }
+
+    CPPUNIT_TEST_SUITE (DASParserTest);
+
+    CPPUNIT_TEST (test_attributes);
+    CPPUNIT_TEST (test_bad_values);
+    CPPUNIT_TEST (test_alias);
+    CPPUNIT_TEST (test_unterminated_quote);
+    CPPUNIT_TEST (test_empty);
+    CPPUNIT_TEST (test_same_as_bison);
+    CPPUNIT_TEST (test_large_das);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (DASParserTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: DASParserTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = DASParserTest::suite()->getTests();
+            unsigned int prefix_len = DASParserTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = DASParserTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/time.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstdio>
+#include <sstream>
+
+//#define DODS_DEBUG
+
+#include "Byte.h"
+#include "Int32.h"
+#include "Float64.h"
+#include "Array.h"
+#include "Structure.h"
+#include "Sequence.h"
+#include "Grid.h"
+
+#include "BaseTypeFactory.h"
+#include "DDS.h"
+#include "DDSParser.h"
+#include "Error.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// The number of copies of the test DDS files in the large DDS
+static const int num_copies = 1000;
+
+// These files in dds-testsuite parse without error
+static const char *good_files[] = {
+    "3B42.980909.5.HDF.dds", "AsciiOutputTest1.dds", "S2000415.HDF.dds", "coads_climatology.nc.dds",
+    "fnoc1.nc.dds", "hdf_dimension_attribute_grid.dds", "sequence.1.dds", "test.1", "test.10",
+    "test.11", "test.12", "test.14", "test.15", "test.16", "test.18", "test.19", "test.19b",
+    "test.19c", "test.19d", "test.19e", "test.19f", "test.19g", "test.2", "test.20", "test.3",
+    "test.4", "test.6", "test.7", "test.8", "test.9", 0
+};
+
+static const char *bad_files[] = {
+    "test.13", "test.17", 0
+};
+
+static double elapsed(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+static string dds_file(const string &name)
+{
+    return (string) TEST_SRC_DIR + "/dds-testsuite/" + name;
+}
+
+static string print_dds(DDS &dds)
+{
+    ostringstream oss;
+    dds.print(oss);
+    return oss.str();
+}
+
+class DDSParserTest: public TestFixture {
+private:
+    BaseTypeFactory d_factory;
+
+    // Parse a file using either DDSParser or the bison parser and return the
+    // printed DDS.
+    string parse_file(const string &name, bool fast)
+    {
+        DDS dds(&d_factory);
+        dds.set_fast_parser(fast);
+        dds.parse(dds_file(name));
+        return print_dds(dds);
+    }
+
+public:
+    DDSParserTest()
+    {
+    }
+
+    ~DDSParserTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_declarations()
+    {
+        DDS dds(&d_factory);
+        DDSParser().intern(string("Dataset {\n    Byte b;\n    Float64 f[lat = 10][20];\n"
+            "    Structure {\n        Int32 i;\n    } s;\n"
+            "    Sequence {\n        Int32 j;\n    } q;\n"
+            "    Grid {\n      Array:\n        Byte g[x = 3];\n      Maps:\n        Float64 x[x = 3];\n    } g;\n"
+            "} data;\n"), &dds);
+
+        CPPUNIT_ASSERT(dds.get_dataset_name() == "data");
+        CPPUNIT_ASSERT(dds.num_var() == 5);
+
+        CPPUNIT_ASSERT(dds.var("b")->type() == dods_byte_c);
+
+        Array *f = dynamic_cast<Array*>(dds.var("f"));
+        CPPUNIT_ASSERT(f);
+        CPPUNIT_ASSERT(f->var()->type() == dods_float64_c);
+        CPPUNIT_ASSERT(f->dimensions() == 2);
+        CPPUNIT_ASSERT(f->dimension_name(f->dim_begin()) == "lat");
+        CPPUNIT_ASSERT(f->length() == 200);
+
+        CPPUNIT_ASSERT(dds.var("s.i") && dds.var("s.i")->type() == dods_int32_c);
+        CPPUNIT_ASSERT(dds.var("q")->type() == dods_sequence_c);
+
+        Grid *g = dynamic_cast<Grid*>(dds.var("g"));
+        CPPUNIT_ASSERT(g);
+        CPPUNIT_ASSERT(g->get_array()->name() == "g");
+        CPPUNIT_ASSERT(g->components() == 2);
+    }
+
+    // A line that is just 'Data:' ends the DDS
+    void test_data_marker()
+    {
+        DDS dds(&d_factory);
+        DDSParser().intern(string("Dataset {\n    Int32 a;\n} d;\nData:\n\001\002 not a DDS"), &dds);
+
+        CPPUNIT_ASSERT(dds.num_var() == 1);
+        CPPUNIT_ASSERT(dds.var("a"));
+    }
+
+    void test_errors()
+    {
+        DDS dds(&d_factory);
+        try {
+            DDSParser().intern(string("Dataset {\n    Int32 a[x 10];\n} d;\n"), &dds);
+            CPPUNIT_FAIL("Expected an Error for the bad subscript");
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(e.get_error_message().find("line 2 at or near: 10") != string::npos);
+        }
+
+        DDS empty(&d_factory);
+        CPPUNIT_ASSERT_THROW(DDSParser().intern(string(""), &empty), Error);
+    }
+
+    // DDSParser and dds.yy build the same DDS from each of the test files
+    void test_same_as_bison()
+    {
+        for (const char **f = good_files; *f; ++f) {
+            DBG(cerr << "File: " << *f << endl);
+            CPPUNIT_ASSERT_EQUAL(parse_file(*f, false), parse_file(*f, true));
+        }
+
+        for (const char **f = bad_files; *f; ++f) {
+            DBG(cerr << "Bad file: " << *f << endl);
+            CPPUNIT_ASSERT_THROW(parse_file(*f, false), Error);
+            CPPUNIT_ASSERT_THROW(parse_file(*f, true), Error);
+        }
+    }
+
+    // Build a large DDS with num_copies copies of each of the test files,
+    // each in its own Structure, and compare the time needed to parse it
+    // with each parser.
+    void test_large_dds()
+    {
+        string document = "Dataset {\n";
+        for (const char **f = good_files; *f; ++f) {
+            string text = parse_file(*f, true);
+            // Drop the 'Dataset {' and '} name;' lines and indent the rest
+            string::size_type start = text.find('\n') + 1;
+            string::size_type end = text.rfind('}');
+            string vars;
+            for (string::size_type pos = start; pos < end;) {
+                string::size_type eol = text.find('\n', pos) + 1;
+                vars += "    " + text.substr(pos, eol - pos);
+                pos = eol;
+            }
+
+            for (int i = 0; i < num_copies; ++i) {
+                ostringstream oss;
+                oss << "    Structure {\n" << vars << "    } s_" << (f - good_files) << "_" << i << ";\n";
+                document += oss.str();
+            }
+        }
+        document += "} large;\n";
+        DBG(cerr << "Large DDS size: " << document.size() << endl);
+
+        struct timeval start;
+        gettimeofday(&start, 0);
+        DDS fast(&d_factory);
+        DDSParser().intern(document, &fast);
+        DBG(cerr << "DDSParser: " << elapsed(start) << "s" << endl);
+
+        CPPUNIT_ASSERT(print_dds(fast) == document);
+
+        // The bison parser reads from a FILE
+        FILE *in = tmpfile();
+        CPPUNIT_ASSERT(in);
+        fwrite(document.data(), 1, document.size(), in);
+        rewind(in);
+        gettimeofday(&start, 0);
+        DDS bison(&d_factory);
+        try {
+            bison.parse(in);
+        }
+        catch (...) {
+            fclose(in);
+            throw;
+        }
+        DBG(cerr << "dds.yy: " << elapsed(start) << "s" << endl);
+        fclose(in);
+
+        CPPUNIT_ASSERT(print_dds(bison) == document);
+    }
+
+    CPPUNIT_TEST_SUITE (DDSParserTest);
+
+    CPPUNIT_TEST (test_declarations);
+    CPPUNIT_TEST (test_data_marker);
+    CPPUNIT_TEST (test_errors);
+    CPPUNIT_TEST (test_same_as_bison);
+    CPPUNIT_TEST (test_large_dds);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (DDSParserTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: DDSParserTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = DDSParserTest::suite()->getTests();
+            unsigned int prefix_len = DDSParserTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = DDSParserTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
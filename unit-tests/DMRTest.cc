@@ -28,6 +28,8 @@
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <sys/time.h>
+
 #include <sstream>
 
 #include "Byte.h"
@@ -46,9 +48,12 @@
 
 #include "DDS.h"
 #include "DMR.h"
+#include "D4Group.h"
+#include "D4Attributes.h"
 #include "XMLWriter.h"
 #include "D4BaseTypeFactory.h"
 #include "D4ParserSax2.h"
+#include "InternalErr.h"
 
 #include "GNURegex.h"
 #include "GetOpt.h"
@@ -67,6 +72,84 @@ using namespace CppUnit;
 using namespace std;
 using namespace libdap;
 
+// The number of copies of the variables in the large DDS
+static const int num_copies = 3000;
+
+static double elapsed(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+static Array *make_array(const string &name, BaseType *proto, int size, const string &dim)
+{
+    Array *a = new Array(name, proto);
+    a->append_dim(size, dim);
+    return a;
+}
+
+// Build a DDS with num_copies copies of a handful of variables that share
+// dimensions, some with the same name but a different size, Grids that
+// share their Maps, Structures and Sequences.
+static void build_large_dds(DDS &dds)
+{
+    dds.get_attr_table().append_container("NC_GLOBAL")->append_attr("title", "String", "\"large\"");
+
+    for (int i = 0; i < num_copies; ++i) {
+        ostringstream oss;
+        oss << "_" << i;
+        string n = oss.str();
+
+        Array *a = make_array("temp" + n, new Float32("temp" + n), 10, "time");
+        a->append_dim(20, "lat");
+        a->get_attr_table().append_attr("units", "String", "\"K\"");
+        dds.add_var_nocopy(a);
+
+        // A dimension whose size depends on the copy
+        dds.add_var_nocopy(make_array("count" + n, new Int32("count" + n), 1 + i % 3, "bins"));
+
+        Grid *g = new Grid("sst" + n);
+        Array *ga = make_array("sst" + n, new Float64("sst" + n), 20, "lat");
+        ga->append_dim(30, "lon");
+        g->add_var_nocopy(ga, libdap::array);
+        g->add_var_nocopy(make_array("lat", new Float64("lat"), 20, "lat"), libdap::maps);
+        g->add_var_nocopy(make_array("lon", new Float64("lon"), 30, "lon"), libdap::maps);
+        g->get_attr_table().append_attr("long_name", "String", "\"Sea Surface Temperature\"");
+        dds.add_var_nocopy(g);
+
+        Structure *s = new Structure("station" + n);
+        s->add_var_nocopy(new Int16("id"));
+        s->add_var_nocopy(make_array("obs", new Float32("obs"), 5 + i % 2, "lat"));
+        s->get_attr_table().append_attr("source", "String", "\"buoy\"");
+        dds.add_var_nocopy(s);
+
+        Sequence *q = new Sequence("profile" + n);
+        q->add_var_nocopy(new Float64("depth"));
+        q->add_var_nocopy(new Str("flag"));
+        dds.add_var_nocopy(q);
+
+        Byte *b = new Byte("qc" + n);
+        b->get_attr_table().append_attr("valid_max", "Byte", "3");
+        dds.add_var_nocopy(b);
+    }
+}
+
+static string print_dmr(DMR &dmr)
+{
+    XMLWriter xml;
+    dmr.print_dap4(xml);
+    return xml.get_doc();
+}
+
+static string print_dds(DDS &dds)
+{
+    ostringstream oss;
+    dds.print(oss);
+    dds.print_das(oss);
+    return oss.str();
+}
+
 class DMRTest: public TestFixture {
 private:
 
@@ -173,6 +256,12 @@ CPPUNIT_TEST_SUITE (DMRTest);
     CPPUNIT_TEST(test_copy_ctor_2);
     CPPUNIT_TEST(test_copy_ctor_3);
     CPPUNIT_TEST(test_copy_ctor_4);
+    CPPUNIT_TEST(test_copy_frozen);
+    CPPUNIT_TEST(test_print_dap4_stream);
+
+    CPPUNIT_TEST(test_parallel_build_using_dds);
+    CPPUNIT_TEST(test_parallel_getDDS);
+    CPPUNIT_TEST(test_parallel_round_trip);
 
     CPPUNIT_TEST_SUITE_END()
     ;
@@ -339,6 +428,165 @@ CPPUNIT_TEST_SUITE (DMRTest);
         DBG(cerr << __func__ << "() - END" << endl);
     }
 
+    // Copies of a frozen DMR share its attributes
+    void test_copy_frozen()
+    {
+        DBG(cerr << endl << __func__ << "() - BEGIN" << endl);
+        D4BaseTypeFactory factory;
+        DMR *dmr = new DMR(&factory, "coads");
+
+        string prefix = string(TEST_SRC_DIR) + "/D4-xml/coads_climatology.nc.xml";
+        ifstream ifs(prefix.c_str());
+        D4ParserSax2 parser;
+        parser.intern(ifs, dmr);
+        dmr->freeze();
+
+        XMLWriter xml;
+        dmr->print_dap4(xml);
+        string dmr_src = string(xml.get_doc());
+
+        DMR *dmr_2 = new DMR(*dmr);
+        DMR *dmr_3 = new DMR(*dmr);
+
+        // Transforming a copy to DAP2 only reads its attributes. Do this
+        // while the template exists; copied maps refer to its arrays.
+        delete dmr_3->getDDS();
+        CPPUNIT_ASSERT(dmr_3->root()->find_var("/SST")->attributes()->frozen());
+        delete dmr;
+
+        BaseType *sst = dmr_2->root()->find_var("/SST");
+        CPPUNIT_ASSERT(sst && sst->attributes()->frozen());
+        CPPUNIT_ASSERT(dmr_2->root()->attributes()->frozen());
+
+        // Change an attribute in one copy; the other is unchanged
+        sst->attributes()->find("units")->add_value("Celsius");
+
+        XMLWriter xml2;
+        dmr_2->print_dap4(xml2);
+        string dmr_dest = string(xml2.get_doc());
+        DBG(cerr << "DMR DEST: " << endl << dmr_dest << endl);
+
+        XMLWriter xml3;
+        dmr_3->print_dap4(xml3);
+        string dmr_dest_3 = string(xml3.get_doc());
+
+        delete dmr_2;
+        delete dmr_3;
+        CPPUNIT_ASSERT(dmr_src != dmr_dest);
+        CPPUNIT_ASSERT(dmr_dest.find("Celsius") != string::npos);
+        CPPUNIT_ASSERT(dmr_src == dmr_dest_3);
+
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
+    // An XMLWriter that streams its output must build the same document
+    void test_print_dap4_stream()
+    {
+        DBG(cerr << endl << __func__ << "() - BEGIN" << endl);
+        D4BaseTypeFactory factory;
+        DMR dmr(&factory, "coads");
+
+        string prefix = string(TEST_SRC_DIR) + "/D4-xml/coads_climatology.nc.xml";
+        ifstream ifs(prefix.c_str());
+        D4ParserSax2 parser;
+        parser.intern(ifs, &dmr);
+
+        XMLWriter xml;
+        dmr.print_dap4(xml);
+        string dmr_mem = string(xml.get_doc());
+
+        ostringstream oss;
+        XMLWriter xml_stream(oss);
+        CPPUNIT_ASSERT(xml_stream.is_streaming());
+        dmr.print_dap4(xml_stream);
+        xml_stream.end_doc();
+
+        DBG(cerr << "DMR STREAM: " << endl << oss.str() << endl);
+        CPPUNIT_ASSERT(oss.str() == dmr_mem);
+
+        CPPUNIT_ASSERT_THROW(xml_stream.get_doc(), InternalErr);
+
+        DBG(cerr << __func__ << "() - END" << endl);
+    }
+
+
+    // Building a DMR from a DDS with several threads makes the same DMR
+    void test_parallel_build_using_dds()
+    {
+        BaseTypeFactory factory;
+        DDS dds(&factory, "large");
+        build_large_dds(dds);
+
+        D4BaseTypeFactory d4_factory;
+        struct timeval start;
+        gettimeofday(&start, 0);
+        DMR dmr(&d4_factory);
+        dmr.build_using_dds(dds);
+        DBG(cerr << "build_using_dds(), 1 thread: " << elapsed(start) << "s" << endl);
+
+        gettimeofday(&start, 0);
+        DMR dmr_4(&d4_factory);
+        dmr_4.set_transform_threads(4);
+        dmr_4.build_using_dds(dds);
+        DBG(cerr << "build_using_dds(), 4 threads: " << elapsed(start) << "s" << endl);
+
+        string doc = print_dmr(dmr);
+        CPPUNIT_ASSERT(doc.find("<Dimension name=\"bins_count_1\" size=\"2\"/>") != string::npos);
+        CPPUNIT_ASSERT(doc.find("<Dimension name=\"lat_obs\" size=\"5\"/>") != string::npos);
+        CPPUNIT_ASSERT(print_dmr(dmr_4) == doc);
+
+        // The copy keeps the setting
+        DMR dmr_copy(dmr_4);
+        CPPUNIT_ASSERT(dmr_copy.transform_threads() == 4);
+    }
+
+    // ...and the same is true going the other way
+    void test_parallel_getDDS()
+    {
+        D4BaseTypeFactory factory;
+        DMR dmr(&factory, "coads");
+
+        string prefix = string(TEST_SRC_DIR) + "/D4-xml/coads_climatology.nc.xml";
+        ifstream ifs(prefix.c_str());
+        D4ParserSax2 parser;
+        parser.intern(ifs, &dmr);
+
+        DDS *dds = dmr.getDDS();
+        string doc = print_dds(*dds);
+        delete dds;
+        DBG(cerr << "DDS: " << endl << doc << endl);
+        CPPUNIT_ASSERT(doc.find("Grid {") != string::npos);
+
+        dmr.set_transform_threads(4);
+        dds = dmr.getDDS();
+        CPPUNIT_ASSERT(print_dds(*dds) == doc);
+        delete dds;
+    }
+
+    void test_parallel_round_trip()
+    {
+        BaseTypeFactory factory;
+        DDS dds(&factory, "large");
+        build_large_dds(dds);
+
+        D4BaseTypeFactory d4_factory;
+        DMR dmr(&d4_factory);
+        dmr.build_using_dds(dds);
+
+        struct timeval start;
+        gettimeofday(&start, 0);
+        DDS *dds_1 = dmr.getDDS();
+        DBG(cerr << "getDDS(), 1 thread: " << elapsed(start) << "s" << endl);
+        string doc = print_dds(*dds_1);
+        delete dds_1;
+
+        dmr.set_transform_threads(4);
+        gettimeofday(&start, 0);
+        DDS *dds_4 = dmr.getDDS();
+        DBG(cerr << "getDDS(), 4 threads: " << elapsed(start) << "s" << endl);
+        CPPUNIT_ASSERT(print_dds(*dds_4) == doc);
+        delete dds_4;
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(DMRTest);
@@ -0,0 +1,551 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "FunctionResultCache.h"
+#include "CancelToken.h"
+
+#include "BaseTypeFactory.h"
+#include "D4BaseTypeFactory.h"
+#include "DDS.h"
+#include "DMR.h"
+#include "D4Group.h"
+#include "D4Dimensions.h"
+#include "Array.h"
+#include "Structure.h"
+#include "Sequence.h"
+#include "Int32.h"
+#include "Int64.h"
+#include "Float64.h"
+#include "Str.h"
+#include "Error.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// The number of threads that ask for the same key at once
+static const int num_waiters = 4;
+
+struct waiter {
+    FunctionResultCache *cache;
+    string key;
+    bool found;
+    string value;
+};
+
+// Ask for the key; if this thread gets to build the value, add one.
+static void *get_value(void *arg)
+{
+    waiter *w = static_cast<waiter*>(arg);
+    w->found = w->cache->get(w->key, w->value);
+    if (!w->found)
+        w->cache->put(w->key, string("built by a waiter"));
+
+    return 0;
+}
+
+// Ask for the key; if it is not found, build a value that cannot be cached.
+static void *get_uncacheable(void *arg)
+{
+    waiter *w = static_cast<waiter*>(arg);
+    w->found = w->cache->get(w->key, w->value);
+    if (!w->found)
+        w->cache->put_uncacheable(w->key);
+
+    return 0;
+}
+
+static string print_dds(DDS &dds)
+{
+    ostringstream oss;
+    for (DDS::Vars_iter i = dds.var_begin(), e = dds.var_end(); i != e; ++i)
+        (*i)->print_val(oss);
+    return oss.str();
+}
+
+static string print_dmr(D4Group *grp)
+{
+    ostringstream oss;
+    for (Constructor::Vars_iter i = grp->var_begin(), e = grp->var_end(); i != e; ++i)
+        (*i)->print_val(oss);
+    for (D4Group::groupsIter g = grp->grp_begin(), ge = grp->grp_end(); g != ge; ++g)
+        oss << print_dmr(*g);
+    return oss.str();
+}
+
+class FunctionResultCacheTest: public TestFixture {
+private:
+    BaseTypeFactory d_factory;
+    D4BaseTypeFactory d_d4_factory;
+
+    // A DDS like one made by functions: the variables hold their values
+    void m_load_dds(DDS &dds)
+    {
+        Int32 *i = new Int32("i");
+        i->set_value(17);
+        dds.add_var_nocopy(i);
+
+        Array *a = new Array("a", new Float64("a"));
+        a->append_dim(3, "x");
+        vector<dods_float64> values;
+        values.push_back(1.5);
+        values.push_back(-2.25);
+        values.push_back(1e10);
+        a->set_value(values, values.size());
+        dds.add_var_nocopy(a);
+
+        Structure *s = new Structure("s");
+        Str *str = new Str("name");
+        str->set_value("a \"quoted\" string");
+        s->add_var_nocopy(str);
+        Array *sa = new Array("sa", new Str("sa"));
+        sa->append_dim(2);
+        vector<string> strings;
+        strings.push_back("one");
+        strings.push_back("two");
+        sa->set_value(strings, strings.size());
+        s->add_var_nocopy(sa);
+        dds.add_var_nocopy(s);
+
+        for (DDS::Vars_iter v = dds.var_begin(), e = dds.var_end(); v != e; ++v)
+            (*v)->set_read_p(true);
+    }
+
+    void m_load_dmr(DMR &dmr)
+    {
+        D4Group *root = dmr.root();
+        D4Dimension *x = new D4Dimension("x", 4);
+        root->dims()->add_dim_nocopy(x);
+
+        Array *a = new Array("a", new Int64("a"));
+        a->append_dim(x);
+        vector<dods_int64> values;
+        for (int i = 0; i < 4; ++i)
+            values.push_back(-1000000000000LL * i);
+        a->set_value(values, values.size());
+        root->add_var_nocopy(a);
+
+        D4Group *child = new D4Group("child");
+        root->add_group_nocopy(child);
+        Float64 *f = new Float64("f");
+        f->set_value(3.25);
+        child->add_var_nocopy(f);
+
+        root->set_read_p(true);
+    }
+
+public:
+    FunctionResultCacheTest()
+    {
+    }
+
+    ~FunctionResultCacheTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_normalize()
+    {
+        CPPUNIT_ASSERT_EQUAL(string("scale(lat,10);scale(lon,10)"),
+            FunctionResultCache::normalize(" scale( lat, 10 ) ;\tscale(lon,10)\n"));
+        CPPUNIT_ASSERT_EQUAL(string("f(\"a b\",\"c \\\" d\")"),
+            FunctionResultCache::normalize("f( \"a b\", \"c \\\" d\" )"));
+    }
+
+    void test_make_key()
+    {
+        string key = FunctionResultCache::make_key("/data/f.nc", 100, "scale(lat, 10)");
+        CPPUNIT_ASSERT_EQUAL(key, FunctionResultCache::make_key("/data/f.nc", 100, "scale(lat,10)"));
+        CPPUNIT_ASSERT(key != FunctionResultCache::make_key("/data/f.nc", 101, "scale(lat,10)"));
+        CPPUNIT_ASSERT(key != FunctionResultCache::make_key("/data/g.nc", 100, "scale(lat,10)"));
+        // The dataset name can't run into the expression
+        CPPUNIT_ASSERT(FunctionResultCache::make_key("a:1", 2, "b")
+            != FunctionResultCache::make_key("a", 1, "2:b"));
+    }
+
+    void test_get_put()
+    {
+        FunctionResultCache cache(1000);
+        string value;
+
+        CPPUNIT_ASSERT(!cache.get("k", value));
+        cache.put("k", string("value"));
+        CPPUNIT_ASSERT(cache.get("k", value));
+        CPPUNIT_ASSERT_EQUAL(string("value"), value);
+
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.hits());
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.misses());
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+        CPPUNIT_ASSERT_EQUAL(6ULL, cache.size());
+
+        // An abandoned key can be reserved again
+        CPPUNIT_ASSERT(!cache.get("other", value));
+        cache.abandon("other");
+        CPPUNIT_ASSERT(!cache.get("other", value));
+        cache.abandon("other");
+
+        cache.clear();
+        CPPUNIT_ASSERT_EQUAL(0UL, cache.entries());
+        CPPUNIT_ASSERT_EQUAL(0ULL, cache.size());
+    }
+
+    // The values used least recently are removed first
+    void test_eviction()
+    {
+        FunctionResultCache cache(30);
+        string value;
+
+        cache.put("a", string(9, 'a'));
+        cache.put("b", string(9, 'b'));
+        cache.put("c", string(9, 'c'));
+        CPPUNIT_ASSERT(cache.get("a", value));
+
+        cache.put("d", string(9, 'd'));
+        CPPUNIT_ASSERT_EQUAL(3UL, cache.entries());
+        CPPUNIT_ASSERT(cache.get("a", value));
+        CPPUNIT_ASSERT(cache.get("c", value));
+        CPPUNIT_ASSERT(cache.get("d", value));
+        CPPUNIT_ASSERT(!cache.get("b", value));
+        cache.abandon("b");
+
+        // Too big to cache at all; the key is marked so get() does not
+        // reserve it again
+        CPPUNIT_ASSERT(!cache.get("e", value));
+        cache.put("e", string(40, 'e'));
+        CPPUNIT_ASSERT(cache.size() <= cache.max_size());
+        CPPUNIT_ASSERT(!cache.get("e", value));
+        CPPUNIT_ASSERT(!cache.get("e", value));
+    }
+
+    // Threads that ask for a key another thread is building wait for its
+    // value instead of building their own.
+    void test_single_flight()
+    {
+        FunctionResultCache cache(1000);
+        string value;
+        CPPUNIT_ASSERT(!cache.get("k", value));
+
+        vector<waiter> waiters(num_waiters);
+        vector<pthread_t> threads(num_waiters);
+        for (int i = 0; i < num_waiters; ++i) {
+            waiters[i].cache = &cache;
+            waiters[i].key = "k";
+            waiters[i].found = false;
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, get_value, &waiters[i]) == 0);
+        }
+
+        usleep(100000);
+        cache.put("k", string("built once"));
+
+        for (int i = 0; i < num_waiters; ++i) {
+            pthread_join(threads[i], 0);
+            CPPUNIT_ASSERT(waiters[i].found);
+            CPPUNIT_ASSERT_EQUAL(string("built once"), waiters[i].value);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.misses());
+        CPPUNIT_ASSERT_EQUAL((unsigned long) num_waiters, cache.hits());
+    }
+
+    // When the thread building a value fails, one of the waiting threads
+    // builds it instead.
+    void test_single_flight_abandon()
+    {
+        FunctionResultCache cache(1000);
+        string value;
+        CPPUNIT_ASSERT(!cache.get("k", value));
+
+        vector<waiter> waiters(num_waiters);
+        vector<pthread_t> threads(num_waiters);
+        for (int i = 0; i < num_waiters; ++i) {
+            waiters[i].cache = &cache;
+            waiters[i].key = "k";
+            waiters[i].found = false;
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, get_value, &waiters[i]) == 0);
+        }
+
+        usleep(100000);
+        cache.abandon("k");
+
+        int built = 0;
+        for (int i = 0; i < num_waiters; ++i) {
+            pthread_join(threads[i], 0);
+            if (waiters[i].found)
+                CPPUNIT_ASSERT_EQUAL(string("built by a waiter"), waiters[i].value);
+            else
+                ++built;
+        }
+
+        CPPUNIT_ASSERT_EQUAL(1, built);
+        CPPUNIT_ASSERT(cache.get("k", value));
+        CPPUNIT_ASSERT_EQUAL(string("built by a waiter"), value);
+    }
+
+    // When the value cannot be cached, all of the waiting threads wake up
+    // and build it at the same time.
+    void test_uncacheable_wakes_all()
+    {
+        FunctionResultCache cache(1000);
+        string value;
+        CPPUNIT_ASSERT(!cache.get("k", value));
+
+        vector<waiter> waiters(num_waiters);
+        vector<pthread_t> threads(num_waiters);
+        for (int i = 0; i < num_waiters; ++i) {
+            waiters[i].cache = &cache;
+            waiters[i].key = "k";
+            waiters[i].found = true;
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, get_uncacheable, &waiters[i]) == 0);
+        }
+
+        usleep(100000);
+        cache.put_uncacheable("k");
+
+        for (int i = 0; i < num_waiters; ++i) {
+            pthread_join(threads[i], 0);
+            CPPUNIT_ASSERT(!waiters[i].found);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(0UL, cache.hits());
+        CPPUNIT_ASSERT_EQUAL((unsigned long) num_waiters + 1, cache.misses());
+
+        // A value replaces the mark
+        cache.put("k", string("cached after all"));
+        CPPUNIT_ASSERT(cache.get("k", value));
+        CPPUNIT_ASSERT_EQUAL(string("cached after all"), value);
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+    }
+
+    // A handle shares the value and keeps it after it leaves the cache
+    void test_value_handle()
+    {
+        FunctionResultCache cache(1000);
+        FunctionResultCache::value_handle handle;
+        CPPUNIT_ASSERT(handle.empty());
+        CPPUNIT_ASSERT(handle.value().empty());
+
+        CPPUNIT_ASSERT(!cache.get("k", handle));
+        cache.put("k", string("first"));
+        CPPUNIT_ASSERT(cache.get("k", handle));
+
+        FunctionResultCache::value_handle other;
+        CPPUNIT_ASSERT(cache.get("k", other));
+        CPPUNIT_ASSERT(&handle.value() == &other.value());
+
+        cache.put("k", string("second"));
+        cache.clear();
+        CPPUNIT_ASSERT_EQUAL(string("first"), handle.value());
+        CPPUNIT_ASSERT_EQUAL(5UL, (unsigned long) other.size());
+
+        other = handle;
+        handle = FunctionResultCache::value_handle();
+        CPPUNIT_ASSERT(handle.empty());
+        CPPUNIT_ASSERT_EQUAL(string("first"), other.value());
+    }
+
+    // A thread waiting for another stops when its request is cancelled
+    void test_cancelled_wait()
+    {
+        FunctionResultCache cache(1000);
+        string value;
+        CPPUNIT_ASSERT(!cache.get("k", value));
+
+        CancelToken cancelled;
+        cancelled.cancel();
+        CPPUNIT_ASSERT_THROW(cache.get("k", value, &cancelled), Error);
+
+        CancelToken deadline;
+        deadline.set_timeout(250);
+        CPPUNIT_ASSERT_THROW(cache.get("k", value, &deadline), Error);
+        CPPUNIT_ASSERT(deadline.expired());
+
+        // The key is still reserved by the first get()
+        cache.put("k", string("value"));
+        CPPUNIT_ASSERT(cache.get("k", value, &deadline));
+        CPPUNIT_ASSERT_EQUAL(string("value"), value);
+    }
+
+    void test_dds_round_trip()
+    {
+        DDS dds(&d_factory, "function_result_test");
+        m_load_dds(dds);
+        CPPUNIT_ASSERT(FunctionResultCache::cacheable(dds));
+
+        FunctionResultCache cache(100000);
+        string key = FunctionResultCache::make_key("test", 0, "f(x)");
+        DDS empty(&d_factory);
+        CPPUNIT_ASSERT(!cache.get(key, empty));
+        cache.put(key, dds);
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+
+        DDS cached(&d_factory);
+        CPPUNIT_ASSERT(cache.get(key, cached));
+        DBG(cerr << print_dds(cached) << endl);
+        CPPUNIT_ASSERT_EQUAL(print_dds(dds), print_dds(cached));
+        CPPUNIT_ASSERT_EQUAL(dds.get_dataset_name(), cached.get_dataset_name());
+    }
+
+    void test_dmr_round_trip()
+    {
+        DMR dmr(&d_d4_factory, "function_results");
+        m_load_dmr(dmr);
+        CPPUNIT_ASSERT(FunctionResultCache::cacheable(dmr));
+
+        string value;
+        FunctionResultCache::write_value(dmr, value);
+
+        DMR cached(&d_d4_factory);
+        FunctionResultCache::read_value(value, cached);
+        DBG(cerr << print_dmr(cached.root()) << endl);
+        CPPUNIT_ASSERT_EQUAL(print_dmr(dmr.root()), print_dmr(cached.root()));
+        CPPUNIT_ASSERT(cached.root()->find_dim("/x"));
+        CPPUNIT_ASSERT_EQUAL(4, static_cast<Array*>(cached.root()->var("a"))->length());
+    }
+
+    void test_not_cacheable()
+    {
+        FunctionResultCache cache(100000);
+        string value;
+
+        DDS seq(&d_factory);
+        seq.add_var_nocopy(new Sequence("s"));
+        CPPUNIT_ASSERT(!FunctionResultCache::cacheable(seq));
+        CPPUNIT_ASSERT(!cache.get("seq", value));
+        cache.put("seq", seq);
+        // Only the mark, which get() does not reserve
+        CPPUNIT_ASSERT_EQUAL(1UL, cache.entries());
+        CPPUNIT_ASSERT_EQUAL(3ULL, cache.size());
+        CPPUNIT_ASSERT(!cache.get("seq", value));
+        CPPUNIT_ASSERT(!cache.get("seq", value));
+
+        DDS constrained(&d_factory);
+        m_load_dds(constrained);
+        Array *a = static_cast<Array*>(constrained.var("a"));
+        a->add_constraint(a->dim_begin(), 0, 1, 1);
+        CPPUNIT_ASSERT(!FunctionResultCache::cacheable(constrained));
+
+        DDS array_of_structures(&d_factory);
+        array_of_structures.add_var_nocopy(new Array("as", new Structure("as")));
+        CPPUNIT_ASSERT(!FunctionResultCache::cacheable(array_of_structures));
+    }
+
+    void test_malformed_value()
+    {
+        DMR dmr(&d_d4_factory);
+        CPPUNIT_ASSERT_THROW(FunctionResultCache::read_value(string("junk"), dmr), Error);
+        CPPUNIT_ASSERT_THROW(FunctionResultCache::read_value(string("100\nDAPB"), dmr), Error);
+    }
+
+    CPPUNIT_TEST_SUITE (FunctionResultCacheTest);
+
+    CPPUNIT_TEST (test_normalize);
+    CPPUNIT_TEST (test_make_key);
+    CPPUNIT_TEST (test_get_put);
+    CPPUNIT_TEST (test_eviction);
+    CPPUNIT_TEST (test_single_flight);
+    CPPUNIT_TEST (test_single_flight_abandon);
+    CPPUNIT_TEST (test_uncacheable_wakes_all);
+    CPPUNIT_TEST (test_value_handle);
+    CPPUNIT_TEST (test_cancelled_wait);
+    CPPUNIT_TEST (test_dds_round_trip);
+    CPPUNIT_TEST (test_dmr_round_trip);
+    CPPUNIT_TEST (test_not_cacheable);
+    CPPUNIT_TEST (test_malformed_value);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (FunctionResultCacheTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: FunctionResultCacheTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = FunctionResultCacheTest::suite()->getTests();
+            unsigned int prefix_len = FunctionResultCacheTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = FunctionResultCacheTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,380 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "Byte.h"
+#include "Int32.h"
+#include "Float64.h"
+#include "Array.h"
+#include "Grid.h"
+#include "Error.h"
+
+#include "GSEClause.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+using namespace functions;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static const relop ops[] = { dods_greater_op, dods_greater_equal_op, dods_less_op, dods_less_equal_op,
+    dods_equal_op, dods_not_equal_op };
+
+template<class T>
+static bool
+compare(T elem, relop op, double value)
+{
+    switch (op) {
+    case dods_greater_op:
+        return elem > value;
+    case dods_greater_equal_op:
+        return elem >= value;
+    case dods_less_op:
+        return elem < value;
+    case dods_less_equal_op:
+        return elem <= value;
+    case dods_equal_op:
+        return elem == value;
+    case dods_not_equal_op:
+        return elem != value;
+    default:
+        return false;
+    }
+}
+
+// The linear scans GSEClause used before it searched ordered maps. Every
+// clause is checked against these.
+template<class T>
+static void
+scan(const vector<T> &vals, relop op, double value, int &start, int &stop)
+{
+    int i = start;
+    int end = stop;
+    while (i <= end && !compare<T>(vals[i], op, value))
+        i++;
+    start = i;
+
+    i = end;
+    while (i >= 0 && !compare<T>(vals[i], op, value))
+        i--;
+    stop = i;
+}
+
+template<class T>
+static string
+format(T value)
+{
+    ostringstream oss;
+    oss << value;
+    return oss.str();
+}
+
+// A Grid with one map, 'x', that holds 'vals'
+template<class T, class V>
+static Grid *
+make_grid(vector<T> &vals)
+{
+    Grid *g = new Grid("g");
+    Array *a = new Array("a", new V("a"));
+    a->append_dim(vals.size(), "x");
+    g->add_var_nocopy(a, libdap::array);
+
+    Array *m = new Array("x", new V("x"));
+    m->append_dim(vals.size(), "x");
+    m->set_value(vals, vals.size());
+    g->add_var_nocopy(m, libdap::maps);
+
+    return g;
+}
+
+class GSEClauseTest: public TestFixture {
+private:
+    // The number of clauses checked by check_clauses()
+    int d_clauses;
+
+    // GSEClause deletes its map, which belongs to the Grid
+    template<class T, class V>
+    void check_clause(Grid *g, const vector<T> &vals, double v1, relop op1, double v2, relop op2)
+    {
+        int start = 0;
+        int stop = vals.size() - 1;
+        string min_value = format(vals[start]);
+        string max_value = format(vals[stop]);
+
+        scan<T>(vals, op1, v1, start, stop);
+        if (op2 != dods_nop_op)
+            scan<T>(vals, op2, v2, start, stop);
+
+        GSEClause *clause = (op2 == dods_nop_op) ? new GSEClause(g, "x", v1, op1) :
+            new GSEClause(g, "x", v1, op1, v2, op2);
+        int clause_start = clause->get_start();
+        int clause_stop = clause->get_stop();
+        string clause_min = clause->get_map_min_value();
+        string clause_max = clause->get_map_max_value();
+        clause->set_map(0);
+        delete clause;
+
+        if (clause_start != start || clause_stop != stop)
+            DBG(cerr << "x " << op1 << " " << v1 << " (" << op2 << " " << v2 << "): expected " << start << ", "
+                << stop << " got " << clause_start << ", " << clause_stop << endl);
+
+        CPPUNIT_ASSERT(clause_start == start);
+        CPPUNIT_ASSERT(clause_stop == stop);
+        CPPUNIT_ASSERT(clause_min == min_value);
+        CPPUNIT_ASSERT(clause_max == max_value);
+
+        ++d_clauses;
+    }
+
+    // Check 'trials' random single and dual clauses on a map
+    template<class T, class V>
+    void check_clauses(vector<T> &vals, int trials)
+    {
+        Grid *g = make_grid<T, V>(vals);
+        try {
+            for (int t = 0; t < trials; ++t) {
+                double v1 = (rand() % 140) - 20 + ((rand() % 2) ? 0.5 : 0);
+                double v2 = (rand() % 140) - 20;
+                relop op1 = ops[rand() % 6];
+                relop op2 = ops[rand() % 6];
+
+                check_clause<T, V>(g, vals, v1, op1, 0, dods_nop_op);
+                check_clause<T, V>(g, vals, v1, op1, v2, op2);
+            }
+        }
+        catch (...) {
+            delete g;
+            throw;
+        }
+
+        delete g;
+    }
+
+public:
+    GSEClauseTest() : d_clauses(0)
+    {
+    }
+
+    ~GSEClauseTest()
+    {
+    }
+
+    void setUp()
+    {
+        d_clauses = 0;
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_ascending()
+    {
+        vector<dods_float64> vals;
+        for (int i = 0; i < 10; ++i)
+            vals.push_back(i * 10.0);
+        Grid *g = make_grid<dods_float64, Float64>(vals);
+
+        GSEClause c1(g, "x", 25.0, dods_greater_op);
+        CPPUNIT_ASSERT(c1.get_start() == 3 && c1.get_stop() == 9);
+        c1.set_map(0);
+
+        GSEClause c2(g, "x", 20.0, dods_less_equal_op);
+        CPPUNIT_ASSERT(c2.get_start() == 0 && c2.get_stop() == 2);
+        c2.set_map(0);
+
+        GSEClause c3(g, "x", 15.0, dods_greater_op, 60.0, dods_less_op);
+        CPPUNIT_ASSERT(c3.get_start() == 2 && c3.get_stop() == 5);
+        CPPUNIT_ASSERT(c3.get_map_min_value() == "0" && c3.get_map_max_value() == "90");
+        c3.set_map(0);
+
+        delete g;
+    }
+
+    void test_descending()
+    {
+        vector<dods_int32> vals;
+        for (int i = 0; i < 10; ++i)
+            vals.push_back(90 - i * 10);
+        Grid *g = make_grid<dods_int32, Int32>(vals);
+
+        GSEClause c1(g, "x", 25.0, dods_greater_op);
+        CPPUNIT_ASSERT(c1.get_start() == 0 && c1.get_stop() == 6);
+        c1.set_map(0);
+
+        GSEClause c2(g, "x", 40.0, dods_equal_op);
+        CPPUNIT_ASSERT(c2.get_start() == 5 && c2.get_stop() == 5);
+        c2.set_map(0);
+
+        delete g;
+    }
+
+    // When nothing matches, start passes stop
+    void test_no_match()
+    {
+        vector<dods_float64> vals;
+        for (int i = 0; i < 10; ++i)
+            vals.push_back(i);
+        Grid *g = make_grid<dods_float64, Float64>(vals);
+
+        GSEClause c1(g, "x", 100.0, dods_greater_op);
+        CPPUNIT_ASSERT(c1.get_start() == 10 && c1.get_stop() == -1);
+        c1.set_map(0);
+
+        check_clause<dods_float64, Float64>(g, vals, -5.0, dods_less_op, 0, dods_nop_op);
+        check_clause<dods_float64, Float64>(g, vals, 4.5, dods_equal_op, 0, dods_nop_op);
+
+        delete g;
+    }
+
+    // Repeated values and NaNs
+    void test_repeated_and_nan()
+    {
+        vector<dods_float64> vals;
+        for (int i = 0; i < 20; ++i)
+            vals.push_back((i / 4) * 5);
+        Grid *g = make_grid<dods_float64, Float64>(vals);
+        for (int v = -5; v <= 25; ++v)
+            for (int i = 0; i < 6; ++i)
+                check_clause<dods_float64, Float64>(g, vals, v, ops[i], 0, dods_nop_op);
+        delete g;
+
+        vals[10] = NAN;
+        g = make_grid<dods_float64, Float64>(vals);
+        for (int v = -5; v <= 25; ++v)
+            for (int i = 0; i < 6; ++i)
+                check_clause<dods_float64, Float64>(g, vals, v, ops[i], 0, dods_nop_op);
+        delete g;
+    }
+
+    // Compare 42,000 random clauses on ascending, descending, random,
+    // repeating and NaN-holding maps with the linear scans
+    void test_random_clauses()
+    {
+        srand(1);
+        for (int k = 0; k < 300; ++k) {
+            int n = 1 + rand() % 50;
+            int kind = k % 5;
+
+            vector<dods_float64> d(n);
+            for (int i = 0; i < n; ++i) {
+                switch (kind) {
+                case 0: d[i] = i * 2; break;
+                case 1: d[i] = 100 - i * 3; break;
+                case 2: d[i] = rand() % 100; break;
+                case 3: d[i] = (i / 4) * 5; break;
+                case 4: d[i] = (i == n / 2) ? NAN : i; break;
+                }
+            }
+            check_clauses<dods_float64, Float64>(d, 40);
+
+            vector<dods_int32> iv(n);
+            for (int i = 0; i < n; ++i)
+                iv[i] = (kind == 1) ? 50 - i : (kind == 2 ? rand() % 100 : i);
+            check_clauses<dods_int32, Int32>(iv, 20);
+
+            vector<dods_byte> bv(n);
+            for (int i = 0; i < n; ++i)
+                bv[i] = (kind == 2) ? rand() % 100 : i;
+            check_clauses<dods_byte, Byte>(bv, 10);
+        }
+
+        DBG(cerr << "Checked " << d_clauses << " clauses" << endl);
+        CPPUNIT_ASSERT(d_clauses == 42000);
+    }
+
+    CPPUNIT_TEST_SUITE (GSEClauseTest);
+
+    CPPUNIT_TEST (test_ascending);
+    CPPUNIT_TEST (test_descending);
+    CPPUNIT_TEST (test_no_match);
+    CPPUNIT_TEST (test_repeated_and_nan);
+    CPPUNIT_TEST (test_random_clauses);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (GSEClauseTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: GSEClauseTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = GSEClauseTest::suite()->getTests();
+            unsigned int prefix_len = GSEClauseTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = GSEClauseTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,353 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/time.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <pthread.h>
+
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+//#define DODS_DEBUG
+
+#include "Float64.h"
+#include "Int32.h"
+#include "Structure.h"
+
+#include "D4BaseTypeFactory.h"
+#include "D4Group.h"
+#include "D4Attributes.h"
+#include "DMR.h"
+#include "InternedString.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// Count the bytes allocated with new so the heap used by a set of DMRs can
+// be measured. Each block records its size in front of the memory returned.
+static unsigned long heap_bytes = 0;
+
+static const size_t block_header = 16;
+
+void *operator new(size_t size) throw (std::bad_alloc)
+{
+    char *block = static_cast<char*>(malloc(size + block_header));
+    if (!block)
+        throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(block) = size;
+    __sync_add_and_fetch(&heap_bytes, size);
+    return block + block_header;
+}
+
+void operator delete(void *p) throw ()
+{
+    if (!p)
+        return;
+    char *block = static_cast<char*>(p) - block_header;
+    __sync_sub_and_fetch(&heap_bytes, *reinterpret_cast<size_t*>(block));
+    free(block);
+}
+
+void *operator new[](size_t size) throw (std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete[](void *p) throw ()
+{
+    operator delete(p);
+}
+
+// Copy, assign and release pooled strings from several threads at once
+static void *copy_strings(void *)
+{
+    static const char *names[] = { "latitude", "longitude", "time", "sea_surface_temperature" };
+    for (int i = 0; i < 20000; ++i) {
+        InternedString a(names[i % 4]);
+        InternedString b(a);
+        InternedString c;
+        c = b;
+        if (c != names[i % 4])
+            return (void*)1;
+        c = names[(i + 1) % 4];
+        b = c;
+    }
+    return 0;
+}
+
+// The number of DMRs held at once when measuring the heap
+static const int num_dmrs = 200;
+
+// The number of variables in each DMR
+static const int num_vars = 50;
+
+class InternedStringTest: public TestFixture {
+private:
+    D4BaseTypeFactory d_factory;
+
+    // Build a DMR the way a parser would, so that none of its strings are
+    // copies of another DMR's strings.
+    DMR *make_dmr()
+    {
+        DMR *dmr = new DMR(&d_factory, "sea_surface_temperature_dataset");
+        D4Group *root = dmr->root();
+        for (int i = 0; i < num_vars; ++i) {
+            ostringstream name;
+            name << "sea_surface_temperature_" << i;
+            Structure *s = new Structure(name.str() + "_group", "sea_surface_temperature_dataset");
+            s->add_var_nocopy(new Float64(name.str() + "_values", "sea_surface_temperature_dataset"));
+            s->add_var_nocopy(new Int32(name.str() + "_quality_flags", "sea_surface_temperature_dataset"));
+
+            D4Attribute *units = new D4Attribute("units_of_measurement", attr_str_c);
+            units->add_value("degrees_celsius");
+            s->attributes()->add_attribute_nocopy(units);
+            D4Attribute *fill = new D4Attribute("missing_value_indicator", attr_float64_c);
+            fill->add_value("-999.0");
+            s->attributes()->add_attribute_nocopy(fill);
+
+            root->add_var_nocopy(s);
+        }
+        return dmr;
+    }
+
+    // The heap bytes used by num_dmrs DMRs
+    unsigned long dmrs_heap()
+    {
+        unsigned long start = heap_bytes;
+        vector<DMR*> dmrs;
+        for (int i = 0; i < num_dmrs; ++i)
+            dmrs.push_back(make_dmr());
+        unsigned long used = heap_bytes - start;
+        for (vector<DMR*>::iterator i = dmrs.begin(); i != dmrs.end(); ++i)
+            delete *i;
+        return used;
+    }
+
+public:
+    InternedStringTest()
+    {
+    }
+
+    ~InternedStringTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+        InternedString::set_pooling(false);
+    }
+
+    void test_unpooled()
+    {
+        InternedString a("a_long_variable_name");
+        InternedString b(a);
+        CPPUNIT_ASSERT(!a.pooled() && !b.pooled());
+        CPPUNIT_ASSERT(a == b);
+        CPPUNIT_ASSERT(&a.str() != &b.str());
+
+        b = "another_name";
+        CPPUNIT_ASSERT(a == "a_long_variable_name");
+        CPPUNIT_ASSERT(b == "another_name");
+
+        InternedString empty;
+        CPPUNIT_ASSERT(empty.empty());
+        CPPUNIT_ASSERT(empty.str() == "");
+        CPPUNIT_ASSERT(InternedString("").empty());
+    }
+
+    // Without the pool, a short name costs what a std::string costs: nothing
+    // on the heap
+    void test_unpooled_short()
+    {
+        unsigned long start = heap_bytes;
+        {
+            InternedString a("lat");
+            InternedString b(a);
+            b = "lon";
+            InternedString c;
+            c = b;
+            CPPUNIT_ASSERT(a == "lat" && c == "lon");
+            CPPUNIT_ASSERT(heap_bytes == start);
+        }
+        CPPUNIT_ASSERT(heap_bytes == start);
+    }
+
+    void test_pooled()
+    {
+        InternedString::set_pooling(true);
+        unsigned long size = InternedString::pool_size();
+        {
+            InternedString a("a_long_variable_name");
+            InternedString b(string("a_long_variable_name"));
+            InternedString c;
+            c = a;
+            CPPUNIT_ASSERT(a.pooled() && b.pooled() && c.pooled());
+            CPPUNIT_ASSERT(&a.str() == &b.str());
+            CPPUNIT_ASSERT(&a.str() == &c.str());
+            CPPUNIT_ASSERT(InternedString::pool_size() == size + 1);
+
+            b = "another_name";
+            CPPUNIT_ASSERT(a == "a_long_variable_name");
+            CPPUNIT_ASSERT(b == "another_name");
+            CPPUNIT_ASSERT(InternedString::pool_size() == size + 2);
+        }
+        // The strings are freed when the last reference goes
+        CPPUNIT_ASSERT(InternedString::pool_size() == size);
+
+        // Strings made before the pool was turned on aren't in it
+        InternedString::set_pooling(false);
+        InternedString d("a_long_variable_name");
+        InternedString::set_pooling(true);
+        InternedString e("a_long_variable_name");
+        CPPUNIT_ASSERT(!d.pooled() && e.pooled());
+        CPPUNIT_ASSERT(d == e);
+    }
+
+    void test_names()
+    {
+        InternedString::set_pooling(true);
+        Float64 a("a_long_variable_name", "a_long_dataset_name");
+        Float64 b("a_long_variable_name", "a_long_dataset_name");
+        CPPUNIT_ASSERT(a.name() == "a_long_variable_name");
+        CPPUNIT_ASSERT(b.dataset() == "a_long_dataset_name");
+
+        b.set_name("new%20name");
+        CPPUNIT_ASSERT(b.name() == "new name");
+        CPPUNIT_ASSERT(a.name() == "a_long_variable_name");
+
+        D4Attribute attr("an_attribute_name", attr_str_c);
+        D4Attribute copy(attr);
+        CPPUNIT_ASSERT(copy.name() == "an_attribute_name");
+    }
+
+    void test_threads()
+    {
+        InternedString::set_pooling(true);
+        unsigned long size = InternedString::pool_size();
+
+        const int num_threads = 8;
+        pthread_t threads[num_threads];
+        for (int i = 0; i < num_threads; ++i)
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, copy_strings, 0) == 0);
+
+        bool ok = true;
+        for (int i = 0; i < num_threads; ++i) {
+            void *status;
+            pthread_join(threads[i], &status);
+            if (status != 0) ok = false;
+        }
+
+        CPPUNIT_ASSERT(ok);
+        CPPUNIT_ASSERT(InternedString::pool_size() == size);
+    }
+
+    // Compare the heap used by a set of DMRs with and without the pool
+    void test_heap_usage()
+    {
+        unsigned long unpooled = dmrs_heap();
+        InternedString::set_pooling(true);
+        unsigned long pooled = dmrs_heap();
+
+        DBG(cerr << num_dmrs << " DMRs use " << unpooled << " bytes without the pool and " << pooled
+            << " bytes with it" << endl);
+
+        CPPUNIT_ASSERT(pooled < unpooled);
+    }
+
+    CPPUNIT_TEST_SUITE (InternedStringTest);
+
+    CPPUNIT_TEST (test_unpooled);
+    CPPUNIT_TEST (test_unpooled_short);
+    CPPUNIT_TEST (test_pooled);
+    CPPUNIT_TEST (test_names);
+    CPPUNIT_TEST (test_threads);
+    CPPUNIT_TEST (test_heap_usage);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (InternedStringTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: InternedStringTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = InternedStringTest::suite()->getTests();
+            unsigned int prefix_len = InternedStringTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = InternedStringTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdexcept>
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "ParallelLoop.h"
+#include "Error.h"
+#include "InternalErr.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// Square each element of a vector
+class square: public ParallelLoop::Body {
+    vector<unsigned long> &d_values;
+
+public:
+    square(vector<unsigned long> &values) : d_values(values) { }
+
+    void run(unsigned long i)
+    {
+        d_values[i] = i * i;
+    }
+};
+
+// Throw from one of the iterations
+class thrower: public ParallelLoop::Body {
+    unsigned long d_bad;
+    int d_kind;
+
+public:
+    thrower(unsigned long bad, int kind) : d_bad(bad), d_kind(kind) { }
+
+    void run(unsigned long i)
+    {
+        if (i != d_bad)
+            return;
+
+        switch (d_kind) {
+        case 0:
+            throw Error(malformed_expr, "bad iteration");
+        case 1:
+            throw InternalErr(__FILE__, __LINE__, "bad iteration");
+        default:
+            throw std::runtime_error("bad iteration");
+        }
+    }
+};
+
+class ParallelLoopTest: public TestFixture {
+private:
+
+public:
+    ParallelLoopTest()
+    {
+    }
+
+    ~ParallelLoopTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_run()
+    {
+        const unsigned int threads[] = { 0, 1, 2, 8, 100 };
+        for (unsigned int t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+            DBG(cerr << "Threads: " << threads[t] << endl);
+            vector<unsigned long> values(1000, 0);
+            square body(values);
+            ParallelLoop(body, values.size()).run(threads[t]);
+
+            for (unsigned long i = 0; i < values.size(); ++i)
+                CPPUNIT_ASSERT(values[i] == i * i);
+        }
+    }
+
+    void test_empty()
+    {
+        vector<unsigned long> values;
+        square body(values);
+        ParallelLoop(body, 0).run(4);
+        CPPUNIT_ASSERT(values.empty());
+    }
+
+    void test_error()
+    {
+        thrower body(500, 0);
+        try {
+            ParallelLoop(body, 1000).run(4);
+            CPPUNIT_FAIL("Expected an Error");
+        }
+        catch (InternalErr &e) {
+            CPPUNIT_FAIL("Expected an Error, not an InternalErr");
+        }
+        catch (Error &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(e.get_error_code() == malformed_expr);
+            CPPUNIT_ASSERT(e.get_error_message() == "bad iteration");
+        }
+    }
+
+    void test_internal_err()
+    {
+        thrower body(0, 1);
+        CPPUNIT_ASSERT_THROW(ParallelLoop(body, 1000).run(4), InternalErr);
+    }
+
+    void test_std_exception()
+    {
+        thrower body(999, 2);
+        try {
+            ParallelLoop(body, 1000).run(4);
+            CPPUNIT_FAIL("Expected an InternalErr");
+        }
+        catch (InternalErr &e) {
+            DBG(cerr << e.get_error_message() << endl);
+            CPPUNIT_ASSERT(e.get_error_message().find("bad iteration") != string::npos);
+        }
+    }
+
+    CPPUNIT_TEST_SUITE (ParallelLoopTest);
+
+    CPPUNIT_TEST (test_run);
+    CPPUNIT_TEST (test_empty);
+    CPPUNIT_TEST (test_error);
+    CPPUNIT_TEST (test_internal_err);
+    CPPUNIT_TEST (test_std_exception);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (ParallelLoopTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: ParallelLoopTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = ParallelLoopTest::suite()->getTests();
+            unsigned int prefix_len = ParallelLoopTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = ParallelLoopTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
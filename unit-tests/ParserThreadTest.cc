@@ -0,0 +1,307 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+// Parse constraint expressions, DASs, DDSs and Error objects in many threads
+// at once.
+
+#include "config.h"
+
+#include <pthread.h>
+
+#include <cstdio>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "Array.h"
+#include "Int32.h"
+
+#include "BaseTypeFactory.h"
+#include "ConstraintEvaluator.h"
+#include "DAS.h"
+#include "DDS.h"
+#include "Error.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+#include "test_config.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static const int num_threads = 8;
+static const int num_parses = 200;
+
+// Each of the thread functions returns null if all of its parses worked.
+
+static void *parse_ces(void *)
+{
+    BaseTypeFactory factory;
+    for (int i = 0; i < num_parses; ++i) {
+        DDS dds(&factory, "test");
+        dds.add_var_nocopy(new Int32("x"));
+        Array *a = new Array("a", new Int32("a"));
+        a->append_dim(10, "d");
+        dds.add_var_nocopy(a);
+
+        try {
+            ConstraintEvaluator eval;
+            eval.parse_constraint("a[2:4]&x>3", dds);
+            if (static_cast<Array*>(dds.var("a"))->length() != 3 || dds.var("x")->send_p()
+                || eval.clause_end() - eval.clause_begin() != 1)
+                return dds.var("a");
+        }
+        catch (Error &e) {
+            DBG(cerr << "CE parse error: " << e.get_error_message() << endl);
+            return dds.var("a");
+        }
+
+        // A CE that does not parse must not confuse the parses of the
+        // other threads.
+        try {
+            ConstraintEvaluator eval;
+            eval.parse_constraint("a[2:4]&&", dds);
+            return dds.var("x");
+        }
+        catch (Error &) {
+        }
+    }
+
+    return 0;
+}
+
+static void *parse_dass(void *arg)
+{
+    for (int i = 0; i < num_parses; ++i) {
+        try {
+            DAS das;
+            das.parse(string(TEST_SRC_DIR) + "/dds-testsuite/fnoc1.nc.das");
+            AttrTable *u = das.get_table("u");
+            if (!u || u->get_attr("units") != "meter per second")
+                return arg;
+        }
+        catch (Error &e) {
+            DBG(cerr << "DAS parse error: " << e.get_error_message() << endl);
+            return arg;
+        }
+    }
+
+    return 0;
+}
+
+static void *parse_ddss(void *arg)
+{
+    BaseTypeFactory factory;
+    for (int i = 0; i < num_parses; ++i) {
+        try {
+            DDS dds(&factory);
+            dds.parse(string(TEST_SRC_DIR) + "/dds-testsuite/fnoc1.nc.dds");
+            if (dds.get_dataset_name() != "fnoc1.nc" || dds.num_var() != 5 || !dds.var("time"))
+                return arg;
+        }
+        catch (Error &e) {
+            DBG(cerr << "DDS parse error: " << e.get_error_message() << endl);
+            return arg;
+        }
+    }
+
+    return 0;
+}
+
+// Print an Error object and parse it back
+static void *parse_errors(void *arg)
+{
+    for (int i = 0; i < num_parses; ++i) {
+        FILE *in = tmpfile();
+        if (!in)
+            return arg;
+
+        try {
+            Error sent(no_such_variable, "The variable x is not in this dataset; see the DDS.");
+            sent.print(in);
+            rewind(in);
+
+            Error received;
+            received.parse(in);
+            fclose(in);
+            // The parser keeps the quotes around the message
+            if (received.get_error_code() != no_such_variable
+                || received.get_error_message() != "\"" + sent.get_error_message() + "\"")
+                return arg;
+        }
+        catch (Error &e) {
+            DBG(cerr << "Error parse error: " << e.get_error_message() << endl);
+            fclose(in);
+            return arg;
+        }
+    }
+
+    return 0;
+}
+
+class ParserThreadTest: public TestFixture {
+private:
+    // Run num_threads threads of each of the functions, all at once, and
+    // return the number that failed.
+    int m_run(const vector<void *(*)(void *)> &funcs)
+    {
+        vector<pthread_t> threads;
+        for (unsigned int f = 0; f < funcs.size(); ++f) {
+            for (int i = 0; i < num_threads; ++i) {
+                pthread_t thread;
+                CPPUNIT_ASSERT(pthread_create(&thread, 0, funcs[f], this) == 0);
+                threads.push_back(thread);
+            }
+        }
+
+        int failed = 0;
+        for (unsigned int i = 0; i < threads.size(); ++i) {
+            void *status = 0;
+            pthread_join(threads[i], &status);
+            if (status)
+                ++failed;
+        }
+
+        return failed;
+    }
+
+public:
+    ParserThreadTest()
+    {
+    }
+    ~ParserThreadTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_ce_threads()
+    {
+        vector<void *(*)(void *)> funcs(1, parse_ces);
+        CPPUNIT_ASSERT_EQUAL(0, m_run(funcs));
+    }
+
+    void test_das_threads()
+    {
+        vector<void *(*)(void *)> funcs(1, parse_dass);
+        CPPUNIT_ASSERT_EQUAL(0, m_run(funcs));
+    }
+
+    void test_dds_threads()
+    {
+        vector<void *(*)(void *)> funcs(1, parse_ddss);
+        CPPUNIT_ASSERT_EQUAL(0, m_run(funcs));
+    }
+
+    void test_error_threads()
+    {
+        vector<void *(*)(void *)> funcs(1, parse_errors);
+        CPPUNIT_ASSERT_EQUAL(0, m_run(funcs));
+    }
+
+    // All four parsers at the same time
+    void test_mixed_threads()
+    {
+        vector<void *(*)(void *)> funcs;
+        funcs.push_back(parse_ces);
+        funcs.push_back(parse_dass);
+        funcs.push_back(parse_ddss);
+        funcs.push_back(parse_errors);
+        CPPUNIT_ASSERT_EQUAL(0, m_run(funcs));
+    }
+
+    CPPUNIT_TEST_SUITE (ParserThreadTest);
+
+    CPPUNIT_TEST (test_ce_threads);
+    CPPUNIT_TEST (test_das_threads);
+    CPPUNIT_TEST (test_dds_threads);
+    CPPUNIT_TEST (test_error_threads);
+    CPPUNIT_TEST (test_mixed_threads);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (ParserThreadTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: ParserThreadTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = ParserThreadTest::suite()->getTests();
+            unsigned int prefix_len = ParserThreadTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = ParserThreadTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,394 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "Byte.h"
+#include "Int16.h"
+#include "UInt16.h"
+#include "Int32.h"
+#include "UInt32.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "Str.h"
+
+#include "BaseTypeFactory.h"
+#include "DDS.h"
+#include "Clause.h"
+#include "RValue.h"
+#include "ConstraintEvaluator.h"
+#include "SelectionProgram.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+#include "ce_expr.tab.hh"
+
+// ce_expr.tab.hh defines DDS(arg) for the parser
+#undef DDS
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+static const int relops[] = { SCAN_EQUAL, SCAN_NOT_EQUAL, SCAN_GREATER, SCAN_GREATER_EQL, SCAN_LESS, SCAN_LESS_EQL };
+static const int num_relops = sizeof(relops) / sizeof(int);
+
+// An Int32 whose relational operators are all true
+class AlwaysInt32: public Int32 {
+public:
+    AlwaysInt32(const string &n) : Int32(n) { }
+
+    virtual BaseType *ptr_duplicate() { return new AlwaysInt32(*this); }
+
+    virtual bool ops(BaseType *, int) { return true; }
+};
+
+class SelectionProgramTest: public TestFixture {
+private:
+    BaseTypeFactory d_factory;
+    DDS *d_dds;
+    vector<BaseType*> d_constants;
+    vector<Clause*> d_clauses;
+
+    BaseType *constant(BaseType *btp)
+    {
+        btp->set_read_p(true);
+        d_constants.push_back(btp);
+        return btp;
+    }
+
+    Clause *clause(int op, BaseType *lhs, BaseType *rhs)
+    {
+        Clause *c = new Clause(op, new rvalue(lhs), make_rvalue_list(new rvalue(rhs)));
+        d_clauses.push_back(c);
+        return c;
+    }
+
+    // Evaluate the clauses both ways; return the result if they agree
+    bool eval_both()
+    {
+        bool interpreted = true;
+        for (vector<Clause*>::iterator i = d_clauses.begin(); i != d_clauses.end() && interpreted; ++i)
+            interpreted = (*i)->value(*d_dds);
+
+        SelectionProgram program(d_clauses, d_constants);
+        bool compiled = program.eval(*d_dds);
+
+        CPPUNIT_ASSERT(interpreted == compiled);
+        return compiled;
+    }
+
+    void clear_clauses()
+    {
+        for (vector<Clause*>::iterator i = d_clauses.begin(); i != d_clauses.end(); ++i)
+            delete *i;
+        d_clauses.clear();
+    }
+
+public:
+    SelectionProgramTest() : d_dds(0)
+    {
+    }
+
+    ~SelectionProgramTest()
+    {
+    }
+
+    void setUp()
+    {
+        d_dds = new DDS(&d_factory, "selection");
+
+        Int32 *i32 = new Int32("i32");
+        i32->set_value(10);
+        d_dds->add_var_nocopy(i32);
+
+        UInt32 *ui32 = new UInt32("ui32");
+        ui32->set_value(10);
+        d_dds->add_var_nocopy(ui32);
+
+        Float64 *f64 = new Float64("f64");
+        f64->set_value(10.5);
+        d_dds->add_var_nocopy(f64);
+
+        Float32 *f32 = new Float32("f32");
+        f32->set_value(0.1f);
+        d_dds->add_var_nocopy(f32);
+
+        Str *s = new Str("s");
+        s->set_value("a string value");
+        d_dds->add_var_nocopy(s);
+
+        for (DDS::Vars_iter i = d_dds->var_begin(); i != d_dds->var_end(); ++i)
+            (*i)->set_read_p(true);
+    }
+
+    void tearDown()
+    {
+        clear_clauses();
+
+        for (vector<BaseType*>::iterator i = d_constants.begin(); i != d_constants.end(); ++i)
+            delete *i;
+        d_constants.clear();
+
+        delete d_dds;
+        d_dds = 0;
+    }
+
+    void test_int_constant()
+    {
+        BaseType *i32 = d_dds->var("i32");
+        Int32 *c = new Int32("");
+        c->set_value(10);
+        constant(c);
+
+        for (int i = 0; i < num_relops; ++i) {
+            clause(relops[i], i32, c);
+            SelectionProgram program(d_clauses, d_constants);
+            CPPUNIT_ASSERT(program.compiled_clauses() == 1);
+            eval_both();
+            clear_clauses();
+        }
+    }
+
+    void test_mixed_types()
+    {
+        BaseType *vars[] = { d_dds->var("i32"), d_dds->var("ui32"), d_dds->var("f64"), d_dds->var("f32") };
+
+        Int16 *neg = new Int16("");
+        neg->set_value(-3);
+        Byte *b = new Byte("");
+        b->set_value(200);
+        UInt16 *u = new UInt16("");
+        u->set_value(10);
+        Float64 *f = new Float64("");
+        f->set_value(0.1);
+        BaseType *consts[] = { constant(neg), constant(b), constant(u), constant(f) };
+
+        for (unsigned int v = 0; v < sizeof(vars) / sizeof(BaseType*); ++v)
+            for (unsigned int k = 0; k < sizeof(consts) / sizeof(BaseType*); ++k)
+                for (int i = 0; i < num_relops; ++i) {
+                    clause(relops[i], vars[v], consts[k]);
+                    eval_both();
+                    clear_clauses();
+                }
+    }
+
+    void test_variable_rhs()
+    {
+        clause(SCAN_EQUAL, d_dds->var("i32"), d_dds->var("ui32"));
+        CPPUNIT_ASSERT(eval_both());
+
+        static_cast<UInt32*>(d_dds->var("ui32"))->set_value(11);
+        CPPUNIT_ASSERT(!eval_both());
+    }
+
+    void test_or_of_rhs()
+    {
+        Int32 *one = new Int32("");
+        one->set_value(1);
+        Int32 *ten = new Int32("");
+        ten->set_value(10);
+        constant(one);
+        constant(ten);
+
+        rvalue_list *rhs = make_rvalue_list(new rvalue(one));
+        append_rvalue_list(rhs, new rvalue(ten));
+        d_clauses.push_back(new Clause(SCAN_EQUAL, new rvalue(d_dds->var("i32")), rhs));
+
+        CPPUNIT_ASSERT(eval_both());
+    }
+
+    void test_and_of_clauses()
+    {
+        Int32 *five = new Int32("");
+        five->set_value(5);
+        constant(five);
+
+        clause(SCAN_GREATER, d_dds->var("i32"), five);
+        clause(SCAN_LESS, d_dds->var("f64"), five);
+
+        CPPUNIT_ASSERT(!eval_both());
+    }
+
+    void test_strings()
+    {
+        Str *exact = new Str("");
+        exact->set_value("a string value");
+        Str *pattern = new Str("");
+        pattern->set_value("str.*val");
+        constant(exact);
+        constant(pattern);
+
+        clause(SCAN_EQUAL, d_dds->var("s"), exact);
+        CPPUNIT_ASSERT(eval_both());
+        clear_clauses();
+
+        clause(SCAN_REGEXP, d_dds->var("s"), pattern);
+        CPPUNIT_ASSERT(eval_both());
+        clear_clauses();
+
+        clause(SCAN_LESS, d_dds->var("s"), pattern);
+        CPPUNIT_ASSERT(eval_both());
+    }
+
+    void test_incompatible_types()
+    {
+        Str *s = new Str("");
+        s->set_value("10");
+        constant(s);
+
+        clause(SCAN_EQUAL, d_dds->var("i32"), s);
+
+        SelectionProgram program(d_clauses, d_constants);
+        CPPUNIT_ASSERT(program.compiled_clauses() == 0);
+        CPPUNIT_ASSERT_THROW(program.eval(*d_dds), Error);
+    }
+
+    void test_subclass_ops()
+    {
+        AlwaysInt32 *a = new AlwaysInt32("always");
+        a->set_value(10);
+        a->set_read_p(true);
+        d_dds->add_var_nocopy(a);
+
+        Int32 *c = new Int32("");
+        c->set_value(11);
+        constant(c);
+
+        clause(SCAN_EQUAL, d_dds->var("always"), c);
+
+        SelectionProgram program(d_clauses, d_constants);
+        CPPUNIT_ASSERT(program.compiled_clauses() == 0);
+        CPPUNIT_ASSERT(eval_both());
+    }
+
+    void test_bad_regex()
+    {
+        Str *pattern = new Str("");
+        pattern->set_value("[unclosed");
+        constant(pattern);
+
+        clause(SCAN_REGEXP, d_dds->var("s"), pattern);
+
+        SelectionProgram program(d_clauses, d_constants);
+        CPPUNIT_ASSERT(program.compiled_clauses() == 0);
+        CPPUNIT_ASSERT_THROW(program.eval(*d_dds), Error);
+    }
+
+    void test_constraint_evaluator()
+    {
+        ConstraintEvaluator ce;
+        Int32 *c = new Int32("");
+        c->set_value(10);
+        c->set_read_p(true);
+        ce.append_constant(c);
+
+        ce.append_clause(SCAN_EQUAL, new rvalue(d_dds->var("i32")), make_rvalue_list(new rvalue(c)));
+        CPPUNIT_ASSERT(ce.eval_selection(*d_dds, ""));
+
+        static_cast<Int32*>(d_dds->var("i32"))->set_value(11);
+        CPPUNIT_ASSERT(!ce.eval_selection(*d_dds, ""));
+
+        // Adding a clause must discard the compiled program
+        ce.append_clause(SCAN_GREATER, new rvalue(d_dds->var("f64")), make_rvalue_list(new rvalue(c)));
+        static_cast<Int32*>(d_dds->var("i32"))->set_value(10);
+        CPPUNIT_ASSERT(ce.eval_selection(*d_dds, ""));
+
+        static_cast<Float64*>(d_dds->var("f64"))->set_value(1.0);
+        CPPUNIT_ASSERT(!ce.eval_selection(*d_dds, ""));
+    }
+
+    CPPUNIT_TEST_SUITE (SelectionProgramTest);
+
+    CPPUNIT_TEST (test_int_constant);
+    CPPUNIT_TEST (test_mixed_types);
+    CPPUNIT_TEST (test_variable_rhs);
+    CPPUNIT_TEST (test_or_of_rhs);
+    CPPUNIT_TEST (test_and_of_clauses);
+    CPPUNIT_TEST (test_strings);
+    CPPUNIT_TEST (test_incompatible_types);
+    CPPUNIT_TEST (test_subclass_ops);
+    CPPUNIT_TEST (test_bad_regex);
+    CPPUNIT_TEST (test_constraint_evaluator);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (SelectionProgramTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: SelectionProgramTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = SelectionProgramTest::suite()->getTests();
+            unsigned int prefix_len = SelectionProgramTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = SelectionProgramTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -59,6 +59,16 @@ void sflut(int, libdap::BaseType *[], libdap::DDS &, libdap::BaseType **btpp)
 
 }
 
+void sflut_bool(int, libdap::BaseType *[], libdap::DDS &, bool *result)
+{
+    *result = true;
+}
+
+libdap::BaseType *sflut_d4(libdap::D4RValueList *, libdap::DMR &)
+{
+    return 0;
+}
+
 class SFLUT: public libdap::ServerFunction {
 public:
     SFLUT()
@@ -74,6 +84,22 @@ public:
     }
 };
 
+static const int num_threads = 4;
+static const int num_functions = 200;
+
+// Look up a function over and over while others are added
+static void *find_functions(void *arg)
+{
+    libdap::ServerFunctionsList *list = static_cast<libdap::ServerFunctionsList*>(arg);
+    for (int i = 0; i < num_functions * 10; ++i) {
+        libdap::btp_func f = 0;
+        if (!list->find_function("sflut", &f) || f != sflut)
+            return arg;     // Not null; the lookup failed
+    }
+
+    return 0;
+}
+
 namespace libdap {
 class ServerFunctionsListUnitTest: public CppUnit::TestFixture {
 
@@ -107,6 +133,11 @@ public:
     CPPUNIT_TEST_SUITE (libdap::ServerFunctionsListUnitTest);
 
     CPPUNIT_TEST (sflut_test);
+    CPPUNIT_TEST (find_function_kind_test);
+    CPPUNIT_TEST (find_function_first_test);
+    CPPUNIT_TEST (find_function_result_is_new_test);
+    CPPUNIT_TEST (find_function_changed_test);
+    CPPUNIT_TEST (find_function_threads_test);
     //CPPUNIT_TEST(always_pass);
 
     CPPUNIT_TEST_SUITE_END();
@@ -176,6 +207,145 @@ public:
 
     }
 
+    // A function is found only as the kinds it has
+    void find_function_kind_test()
+    {
+        ServerFunctionsList list;
+        list.add_function(new SFLUT());
+
+        btp_func btp = 0;
+        CPPUNIT_ASSERT(list.find_function("sflut", &btp));
+        CPPUNIT_ASSERT(btp == sflut);
+
+        bool_func bf = sflut_bool;
+        CPPUNIT_ASSERT(!list.find_function("sflut", &bf));
+        CPPUNIT_ASSERT(bf == 0);
+
+        D4Function d4f = sflut_d4;
+        CPPUNIT_ASSERT(!list.find_function("sflut", &d4f));
+        CPPUNIT_ASSERT(d4f == 0);
+
+        CPPUNIT_ASSERT(!list.find_function("no_such_function", &btp));
+        CPPUNIT_ASSERT(btp == 0);
+
+        // A second function with the same name but another kind
+        SFLUT *d4 = new SFLUT();
+        d4->setFunction(sflut_d4);
+        list.add_function(d4);
+
+        CPPUNIT_ASSERT(list.find_function("sflut", &d4f));
+        CPPUNIT_ASSERT(d4f == sflut_d4);
+        CPPUNIT_ASSERT(list.find_function("sflut", &btp));
+        CPPUNIT_ASSERT(btp == sflut);
+    }
+
+    // The DAP4 lookup says whether the function returns a new BaseType
+    void find_function_result_is_new_test()
+    {
+        ServerFunctionsList list;
+        SFLUT *copied = new SFLUT();
+        copied->setFunction(sflut_d4);
+        list.add_function(copied);
+
+        SFLUT *not_copied = new SFLUT();
+        not_copied->setName("sflut_new");
+        not_copied->setFunction(sflut_d4);
+        not_copied->setResultIsNew(true);
+        list.add_function(not_copied);
+
+        D4Function d4f = 0;
+        bool result_is_new = true;
+        CPPUNIT_ASSERT(list.find_function("sflut", &d4f, &result_is_new));
+        CPPUNIT_ASSERT(d4f == sflut_d4 && !result_is_new);
+
+        CPPUNIT_ASSERT(list.find_function("sflut_new", &d4f, &result_is_new));
+        CPPUNIT_ASSERT(d4f == sflut_d4 && result_is_new);
+
+        CPPUNIT_ASSERT(!list.find_function("no_such_function", &d4f, &result_is_new));
+        CPPUNIT_ASSERT(d4f == 0 && !result_is_new);
+    }
+
+    // When two functions of a kind have the same name, the first added is found
+    void find_function_first_test()
+    {
+        ServerFunctionsList list;
+
+        SFLUT *first = new SFLUT();
+        first->setFunction(sflut_bool);
+        list.add_function(first);
+
+        SFLUT *second = new SFLUT();
+        list.add_function(second);
+
+        bool_func bf = 0;
+        CPPUNIT_ASSERT(list.find_function("sflut", &bf));
+        CPPUNIT_ASSERT(bf == sflut_bool);
+
+        vector<string> names;
+        list.getFunctionNames(&names);
+        CPPUNIT_ASSERT_EQUAL((size_t)2, names.size());
+    }
+
+    // A function changed after it is added is found as it is now
+    void find_function_changed_test()
+    {
+        ServerFunctionsList list;
+        SFLUT *func = new SFLUT();
+        list.add_function(func);
+
+        bool_func bf = 0;
+        CPPUNIT_ASSERT(!list.find_function("sflut", &bf));
+
+        func->setFunction(sflut_bool);
+        CPPUNIT_ASSERT(list.find_function("sflut", &bf));
+        CPPUNIT_ASSERT(bf == sflut_bool);
+
+        func->setFunction((btp_func) 0);
+        btp_func btp = sflut;
+        CPPUNIT_ASSERT(!list.find_function("sflut", &btp));
+        CPPUNIT_ASSERT(btp == 0);
+
+        func->setFunction(sflut_d4);
+        func->setResultIsNew(true);
+        D4Function d4f = 0;
+        bool result_is_new = false;
+        CPPUNIT_ASSERT(list.find_function("sflut", &d4f, &result_is_new));
+        CPPUNIT_ASSERT(d4f == sflut_d4 && result_is_new);
+
+        // With no readers the replaced tables are deleted at once
+        CPPUNIT_ASSERT(list.d_old_tables.empty());
+    }
+
+    void find_function_threads_test()
+    {
+        ServerFunctionsList list;
+        list.add_function(new SFLUT());
+
+        vector<pthread_t> threads(num_threads);
+        for (int i = 0; i < num_threads; ++i)
+            CPPUNIT_ASSERT(pthread_create(&threads[i], 0, find_functions, &list) == 0);
+
+        for (int i = 0; i < num_functions; ++i) {
+            SFLUT *f = new SFLUT();
+            f->setName("sflut_" + long_to_string(i));
+            list.add_function(f);
+        }
+
+        for (int i = 0; i < num_threads; ++i) {
+            void *status = 0;
+            pthread_join(threads[i], &status);
+            CPPUNIT_ASSERT(status == 0);
+        }
+
+        btp_func btp = 0;
+        CPPUNIT_ASSERT(list.find_function("sflut_" + long_to_string(num_functions - 1), &btp));
+        CPPUNIT_ASSERT(btp == sflut);
+
+        // The last reader, or the last add_function(), deleted the old tables
+        CPPUNIT_ASSERT(list.d_old_tables.empty());
+        CPPUNIT_ASSERT_EQUAL(0, (int) list.d_readers);
+    }
+
 };
 } // libdap namespace
 
@@ -0,0 +1,472 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <sys/time.h>
+#include <pthread.h>
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+
+//#define DODS_DEBUG
+
+#include "Byte.h"
+#include "Int32.h"
+#include "Float64.h"
+#include "Array.h"
+#include "Structure.h"
+#include "Grid.h"
+
+#include "BaseTypeFactory.h"
+#include "D4BaseTypeFactory.h"
+#include "DDS.h"
+#include "DMR.h"
+#include "D4Group.h"
+#include "VarIndex.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+// The size of the synthetic datasets used to time lookups
+static const int num_vars = 10000;
+
+static double elapsed(const struct timeval &start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1.0e6;
+}
+
+static string var_name(int i)
+{
+    ostringstream oss;
+    oss << "var_" << i;
+    return oss.str();
+}
+
+// Look up every variable from several threads at once; each thread
+// starts at a different name.
+struct lookup_arg {
+    DDS *d_dds;
+    int d_first;
+    int d_errors;
+};
+
+static void *lookup_vars(void *arg)
+{
+    lookup_arg &la = *static_cast<lookup_arg*>(arg);
+    for (int n = 0; n < num_vars; ++n) {
+        int i = (la.d_first + n) % num_vars;
+        BaseType *btp = la.d_dds->var(var_name(i));
+        if (!btp || btp->name() != var_name(i) || (i % 10 == 5) != (btp->get_parent() != 0))
+            ++la.d_errors;
+    }
+
+    return 0;
+}
+
+class VarIndexTest: public TestFixture {
+private:
+    BaseTypeFactory d_factory;
+    D4BaseTypeFactory d_d4_factory;
+
+    // Top-level: a, s{b, t{c}}, u{c, b}; 'c' and 'b' are found first in 's'
+    void add_nested_vars(DDS &dds)
+    {
+        dds.add_var_nocopy(new Int32("a"));
+
+        Structure *t = new Structure("t");
+        t->add_var_nocopy(new Float64("c"));
+
+        Structure *s = new Structure("s");
+        s->add_var_nocopy(new Byte("b"));
+        s->add_var_nocopy(t);
+        dds.add_var_nocopy(s);
+
+        Structure *u = new Structure("u");
+        u->add_var_nocopy(new Int32("c"));
+        u->add_var_nocopy(new Int32("b"));
+        dds.add_var_nocopy(u);
+    }
+
+    // A DDS with num_vars Float64 arrays, every tenth one in a Structure
+    void add_many_vars(DDS &dds)
+    {
+        Structure *s = 0;
+        for (int i = 0; i < num_vars; ++i) {
+            Array *a = new Array(var_name(i), new Float64(var_name(i)));
+            a->append_dim(10, "dim");
+            if (i % 10 == 0) {
+                s = new Structure(var_name(i) + "_s");
+                dds.add_var_nocopy(s);
+            }
+            if (i % 10 == 5)
+                s->add_var_nocopy(a);
+            else
+                dds.add_var_nocopy(a);
+        }
+    }
+
+public:
+    VarIndexTest()
+    {
+    }
+
+    ~VarIndexTest()
+    {
+    }
+
+    void setUp()
+    {
+    }
+
+    void tearDown()
+    {
+    }
+
+    void test_constructor_lookup()
+    {
+        Structure s("s");
+        for (int i = 0; i < 100; ++i)
+            s.add_var_nocopy(new Int32(var_name(i)));
+
+        for (int i = 0; i < 100; ++i)
+            CPPUNIT_ASSERT(s.var(var_name(i)) == *(s.var_begin() + i));
+
+        CPPUNIT_ASSERT(s.var("no_such_var") == 0);
+        CPPUNIT_ASSERT(s.var("no_such_var", false) == 0);
+    }
+
+    void test_constructor_duplicate_names()
+    {
+        Structure s("s");
+        Int32 *first = new Int32("x");
+        s.add_var_nocopy(first);
+        s.add_var_nocopy(new Int32("x"));
+
+        CPPUNIT_ASSERT(s.var("x") == first);
+        CPPUNIT_ASSERT(s.var("x", false) == first);
+
+        s.del_var("x");
+        CPPUNIT_ASSERT(s.var("x") != 0 && s.var("x") != first);
+        s.del_var("x");
+        CPPUNIT_ASSERT(s.var("x") == 0);
+    }
+
+    void test_constructor_rename()
+    {
+        // Without and with an index
+        for (int padding = 0; padding <= 30; padding += 30) {
+            Structure s("s");
+            s.add_var_nocopy(new Int32("a"));
+            s.add_var_nocopy(new Int32("b"));
+            for (int i = 0; i < padding; ++i)
+                s.add_var_nocopy(new Int32(var_name(i)));
+            CPPUNIT_ASSERT(s.var("b"));
+
+            BaseType *b = s.var("b");
+            b->set_name("c");
+            CPPUNIT_ASSERT(s.var("b") == 0);
+            CPPUNIT_ASSERT(s.var("c") == b);
+
+            // A rename that makes a name match an earlier variable
+            s.var("a")->set_name("c");
+            CPPUNIT_ASSERT(s.var("c") != b);
+            CPPUNIT_ASSERT(s.var("c") == *s.var_begin());
+        }
+    }
+
+    // The index is built as the variables are added, once there are enough
+    // of them; lookups only read it
+    void test_index_eager()
+    {
+        VarIndex::Vars vars;
+        VarIndex index;
+        for (int i = 0; i < 40; ++i) {
+            if (i % 4 == 0)
+                vars.push_back(new Structure(var_name(i)));
+            else
+                vars.push_back(new Int32(var_name(i)));
+            index.added(vars);
+            CPPUNIT_ASSERT(index.indexed(vars) == (i >= 15));
+        }
+
+        CPPUNIT_ASSERT(index.constructors().size() == 10);
+        CPPUNIT_ASSERT(index.constructors()[1] == 4);
+
+        const VarIndex &lookup = index;
+        for (int i = 0; i < 40; ++i)
+            CPPUNIT_ASSERT(lookup.find(vars, var_name(i)) == VarIndex::Vars::size_type(i));
+        CPPUNIT_ASSERT(lookup.find(vars, "no_such_var") == vars.size());
+
+        // A variable renamed without telling the index is not returned
+        vars[3]->set_name("renamed");
+        CPPUNIT_ASSERT(lookup.find(vars, var_name(3)) == vars.size());
+        index.changed(vars);
+        CPPUNIT_ASSERT(lookup.find(vars, "renamed") == 3);
+
+        // Small vectors are searched
+        for (VarIndex::Vars::size_type i = 8; i < vars.size(); ++i)
+            delete vars[i];
+        vars.resize(8);
+        index.changed(vars);
+        CPPUNIT_ASSERT(!index.indexed(vars));
+        CPPUNIT_ASSERT(lookup.find(vars, var_name(5)) == 5);
+        CPPUNIT_ASSERT(lookup.find(vars, var_name(20)) == vars.size());
+
+        for (VarIndex::Vars::size_type i = 0; i < vars.size(); ++i)
+            delete vars[i];
+    }
+
+    void test_leaf_match_order()
+    {
+        DDS dds(&d_factory, "leaf");
+        add_nested_vars(dds);
+
+        for (int indexed = 0; indexed < 2; ++indexed) {
+            dds.set_name_index(indexed);
+
+            BaseType::btp_stack stack;
+            BaseType *c = dds.var("c", stack);
+            CPPUNIT_ASSERT(c && c->type() == dods_float64_c);
+            CPPUNIT_ASSERT(stack.size() == 2);
+            CPPUNIT_ASSERT(stack.top()->name() == "s");
+
+            BaseType *b = dds.var("b");
+            CPPUNIT_ASSERT(b && b->type() == dods_byte_c);
+
+            CPPUNIT_ASSERT(dds.var("a") && dds.var("a")->type() == dods_int32_c);
+            CPPUNIT_ASSERT(dds.var("s.t.c") == c);
+            CPPUNIT_ASSERT(dds.var("s.t.d") == 0);
+            CPPUNIT_ASSERT(dds.var("t") && dds.var("t")->name() == "t");
+            CPPUNIT_ASSERT(dds.var("u.b") && dds.var("u.b")->type() == dods_int32_c);
+            CPPUNIT_ASSERT(dds.var("d") == 0);
+        }
+    }
+
+    void test_dds_add_and_delete()
+    {
+        DDS dds(&d_factory, "edits");
+        dds.set_name_index(true);
+        add_nested_vars(dds);
+
+        CPPUNIT_ASSERT(dds.var("a"));
+        dds.del_var("a");
+        CPPUNIT_ASSERT(dds.var("a") == 0);
+
+        dds.insert_var_nocopy(dds.var_begin(), new Int32("a"));
+        CPPUNIT_ASSERT(dds.var("a") == *dds.var_begin());
+
+        // A nested rename is noticed by the Structure that holds the variable
+        dds.var("s.b")->set_name("e");
+        CPPUNIT_ASSERT(dds.var("e") && dds.var("e")->type() == dods_byte_c);
+        CPPUNIT_ASSERT(dds.var("b") && dds.var("b")->type() == dods_int32_c);
+
+        dds.del_var(dds.var_begin(), dds.var_end());
+        CPPUNIT_ASSERT(dds.var("a") == 0);
+        CPPUNIT_ASSERT(dds.num_var() == 0);
+    }
+
+    void test_dds_copy()
+    {
+        DDS dds(&d_factory, "copy");
+        dds.set_name_index(true);
+        add_nested_vars(dds);
+
+        DDS copy(dds);
+        CPPUNIT_ASSERT(copy.get_name_index());
+        CPPUNIT_ASSERT(copy.var("a") && copy.var("a") != dds.var("a"));
+        CPPUNIT_ASSERT(copy.var("c") && copy.var("c")->type() == dods_float64_c);
+    }
+
+    void test_grid_set_array()
+    {
+        Grid g("g");
+        Array *a = new Array("a", new Int32("a"));
+        a->append_dim(3, "x");
+        g.set_array(a);
+        g.add_map(new Array("x", new Int32("x")), false);
+        CPPUNIT_ASSERT(g.var("a") == a);
+
+        Array *b = new Array("b", new Int32("b"));
+        b->append_dim(3, "x");
+        g.set_array(b);
+        CPPUNIT_ASSERT(g.var("a") == 0);
+        CPPUNIT_ASSERT(g.var("b") == b);
+        CPPUNIT_ASSERT(g.var("x"));
+    }
+
+    void test_many_dds_vars()
+    {
+        DDS dds(&d_factory, "many");
+        add_many_vars(dds);
+
+        double times[2];
+        for (int indexed = 0; indexed < 2; ++indexed) {
+            dds.set_name_index(indexed);
+
+            struct timeval start;
+            gettimeofday(&start, 0);
+            for (int i = 0; i < num_vars; ++i) {
+                BaseType *btp = dds.var(var_name(i));
+                CPPUNIT_ASSERT(btp && btp->name() == var_name(i));
+                CPPUNIT_ASSERT((i % 10 == 5) == (btp->get_parent() != 0));
+            }
+            times[indexed] = elapsed(start);
+        }
+
+        DBG(cerr << endl << "DDS lookups of " << num_vars << " variables: linear " << times[0]
+            << "s, indexed " << times[1] << "s" << endl);
+    }
+
+    // Lookups only read the indexes of the DDS and of its Structures, so
+    // several threads can make them at once.
+    void test_threaded_lookup()
+    {
+        const int num_threads = 8;
+
+        for (int round = 0; round < 4; ++round) {
+            DDS dds(&d_factory, "threads");
+            add_many_vars(dds);
+            dds.set_name_index(true);
+
+            pthread_t threads[num_threads];
+            lookup_arg args[num_threads];
+            for (int t = 0; t < num_threads; ++t) {
+                args[t].d_dds = &dds;
+                args[t].d_first = t * (num_vars / num_threads);
+                args[t].d_errors = 0;
+                CPPUNIT_ASSERT(pthread_create(&threads[t], 0, lookup_vars, &args[t]) == 0);
+            }
+
+            int errors = 0;
+            for (int t = 0; t < num_threads; ++t) {
+                pthread_join(threads[t], 0);
+                errors += args[t].d_errors;
+            }
+
+            DBG(cerr << "test_threaded_lookup, round " << round << ", errors: " << errors << endl);
+            CPPUNIT_ASSERT(errors == 0);
+        }
+    }
+
+    void test_many_dmr_vars()
+    {
+        DMR dmr(&d_d4_factory, "many");
+        D4Group *root = dmr.root();
+        D4Group *child = new D4Group("child");
+        root->add_group_nocopy(child);
+
+        for (int i = 0; i < num_vars; ++i) {
+            root->add_var_nocopy(new Int32(var_name(i)));
+            child->add_var_nocopy(new Int32(var_name(i)));
+        }
+
+        struct timeval start;
+        gettimeofday(&start, 0);
+        for (int i = 0; i < num_vars; ++i) {
+            BaseType *btp = root->find_var("/child/" + var_name(i));
+            CPPUNIT_ASSERT(btp && btp->get_parent() == child && btp->name() == var_name(i));
+            CPPUNIT_ASSERT(root->find_var("/" + var_name(i))->get_parent() == root);
+        }
+
+        DBG(cerr << endl << "DMR lookups of " << 2 * num_vars << " variables: " << elapsed(start) << "s" << endl);
+
+        CPPUNIT_ASSERT(root->find_var("/child/no_such_var") == 0);
+    }
+
+    CPPUNIT_TEST_SUITE (VarIndexTest);
+
+    CPPUNIT_TEST (test_constructor_lookup);
+    CPPUNIT_TEST (test_constructor_duplicate_names);
+    CPPUNIT_TEST (test_constructor_rename);
+    CPPUNIT_TEST (test_index_eager);
+    CPPUNIT_TEST (test_leaf_match_order);
+    CPPUNIT_TEST (test_dds_add_and_delete);
+    CPPUNIT_TEST (test_dds_copy);
+    CPPUNIT_TEST (test_grid_set_array);
+    CPPUNIT_TEST (test_many_dds_vars);
+    CPPUNIT_TEST (test_many_dmr_vars);
+    CPPUNIT_TEST (test_threaded_lookup);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (VarIndexTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: VarIndexTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = VarIndexTest::suite()->getTests();
+            unsigned int prefix_len = VarIndexTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = VarIndexTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// -*- mode: c++; c-basic-offset:4 -*-
+
+// This file is part of libdap, A C++ implementation of the OPeNDAP Data
+// Access Protocol.
+
+// Copyright (c) 2026 OPeNDAP, Inc.
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+//
+// You can contact OPeNDAP, Inc. at PO Box 112, Saunderstown, RI. 02874-0112.
+
+#include "config.h"
+
+#include <cppunit/TextTestRunner.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+//#define DODS_DEBUG
+
+#include "Array.h"
+#include "Byte.h"
+#include "Int16.h"
+#include "Int32.h"
+#include "Float32.h"
+#include "Float64.h"
+#include "VectorView.h"
+#include "InternalErr.h"
+#include "util.h"
+
+#include "GetOpt.h"
+#include "debug.h"
+
+using namespace CppUnit;
+using namespace std;
+using namespace libdap;
+
+static bool debug = false;
+
+#undef DBG
+#define DBG(x) do { if (debug) (x); } while(false);
+
+class VectorViewTest: public TestFixture {
+private:
+    Array *d_int16;
+    Array *d_float64;
+
+public:
+    VectorViewTest() : d_int16(0), d_float64(0)
+    {
+    }
+
+    ~VectorViewTest()
+    {
+    }
+
+    void setUp()
+    {
+        d_int16 = new Array("a", new Int16("a"));
+        d_int16->append_dim(10);
+        vector<dods_int16> i16(10);
+        for (int i = 0; i < 10; ++i)
+            i16[i] = i - 5;
+        d_int16->set_value(i16, 10);
+
+        d_float64 = new Array("b", new Float64("b"));
+        d_float64->append_dim(6);
+        vector<dods_float64> f64(6);
+        for (int i = 0; i < 6; ++i)
+            f64[i] = i * 0.5;
+        d_float64->set_value(f64, 6);
+    }
+
+    void tearDown()
+    {
+        delete d_int16;
+        delete d_float64;
+    }
+
+    // A view of an Array uses the Array's own storage
+    void test_view_of_array()
+    {
+        VectorView<dods_int16> v(*d_int16);
+        CPPUNIT_ASSERT(v.size() == 10);
+        CPPUNIT_ASSERT(v.contiguous());
+        CPPUNIT_ASSERT(reinterpret_cast<char*>(v.data()) == d_int16->get_buf());
+        CPPUNIT_ASSERT(v[0] == -5 && v[9] == 4);
+
+        v[3] = 100;
+        vector<dods_int16> values(10);
+        d_int16->value(&values[0]);
+        CPPUNIT_ASSERT(values[3] == 100);
+
+        VectorView<const dods_int16> cv(*d_int16);
+        CPPUNIT_ASSERT(cv[3] == 100);
+    }
+
+    void test_wrong_type()
+    {
+        CPPUNIT_ASSERT_THROW(VectorView<dods_int32> v(*d_int16), InternalErr);
+        CPPUNIT_ASSERT_THROW(VectorView<dods_float32> v(*d_float64), InternalErr);
+    }
+
+    void test_no_values()
+    {
+        Array a("c", new Int32("c"));
+        a.append_dim(4);
+        CPPUNIT_ASSERT_THROW(VectorView<dods_int32> v(a), InternalErr);
+    }
+
+    void test_slice()
+    {
+        VectorView<dods_int16> v(*d_int16);
+
+        // Every third value, starting with the second: 1, 4, 7
+        VectorView<dods_int16> s = v.slice(1, 3, 3);
+        CPPUNIT_ASSERT(s.size() == 3);
+        CPPUNIT_ASSERT(s.stride() == 3);
+        CPPUNIT_ASSERT(!s.contiguous());
+        CPPUNIT_ASSERT(s[0] == -4 && s[1] == -1 && s[2] == 2);
+
+        // A slice of a slice: 1, 7
+        VectorView<dods_int16> ss = s.slice(0, 2, 2);
+        CPPUNIT_ASSERT(ss[0] == -4 && ss[1] == 2);
+
+        CPPUNIT_ASSERT(v.slice(9, 1)[0] == 4);
+        CPPUNIT_ASSERT(v.slice(10, 0).empty());
+        CPPUNIT_ASSERT_THROW(v.slice(1, 4, 3), InternalErr);
+        CPPUNIT_ASSERT_THROW(v.slice(10, 1), InternalErr);
+        CPPUNIT_ASSERT_THROW(v.slice(0, 1, 0), InternalErr);
+    }
+
+    void test_convert_values()
+    {
+        vector<double> d(10);
+        convert_values(VectorView<const dods_int16>(*d_int16), VectorView<double>(&d[0], d.size()));
+        CPPUNIT_ASSERT(d[0] == -5.0 && d[9] == 4.0);
+
+        // Strided source and destination
+        vector<dods_byte> b(4, 0);
+        convert_values(VectorView<const dods_int16>(*d_int16).slice(6, 2, 2), VectorView<dods_byte>(&b[0], 2, 2));
+        CPPUNIT_ASSERT(b[0] == 1 && b[1] == 0 && b[2] == 3 && b[3] == 0);
+
+        CPPUNIT_ASSERT_THROW(convert_values(VectorView<const dods_int16>(*d_int16), VectorView<double>(&d[0], 9)),
+            InternalErr);
+    }
+
+    void test_extract_double_array()
+    {
+        double *d = extract_double_array(d_int16);
+        CPPUNIT_ASSERT(d[0] == -5.0 && d[9] == 4.0);
+        delete[] d;
+
+        vector<double> dv;
+        extract_double_array(d_float64, dv);
+        CPPUNIT_ASSERT(dv.size() == 6);
+        CPPUNIT_ASSERT(dv[0] == 0.0 && dv[5] == 2.5);
+
+        Array f("f", new Float32("f"));
+        f.append_dim(3);
+        vector<dods_float32> f32(3, 1.5);
+        f.set_value(f32, 3);
+        extract_double_array(&f, dv);
+        CPPUNIT_ASSERT(dv.size() == 3 && dv[2] == 1.5);
+    }
+
+    void test_set_array_using_double()
+    {
+        vector<double> src(10);
+        for (int i = 0; i < 10; ++i)
+            src[i] = i * 2;
+
+        set_array_using_double(d_int16, &src[0], 10);
+        CPPUNIT_ASSERT(d_int16->read_p());
+        vector<dods_int16> values(10);
+        d_int16->value(&values[0]);
+        CPPUNIT_ASSERT(values[0] == 0 && values[9] == 18);
+
+        Array b("b", new Byte("b"));
+        b.append_dim(10);
+        set_array_using_double(&b, &src[0], 10);
+        VectorView<const dods_byte> v(b);
+        CPPUNIT_ASSERT(v.size() == 10 && v[5] == 10);
+
+        CPPUNIT_ASSERT_THROW(set_array_using_double(d_float64, &src[0], 10), InternalErr);
+    }
+
+    CPPUNIT_TEST_SUITE (VectorViewTest);
+
+    CPPUNIT_TEST (test_view_of_array);
+    CPPUNIT_TEST (test_wrong_type);
+    CPPUNIT_TEST (test_no_values);
+    CPPUNIT_TEST (test_slice);
+    CPPUNIT_TEST (test_convert_values);
+    CPPUNIT_TEST (test_extract_double_array);
+    CPPUNIT_TEST (test_set_array_using_double);
+
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION (VectorViewTest);
+
+int main(int argc, char*argv[])
+{
+    GetOpt getopt(argc, argv, "dh");
+    int option_char;
+    while ((option_char = getopt()) != -1)
+        switch (option_char) {
+        case 'd':
+            debug = 1;  // debug is a static global
+            break;
+        case 'h': {     // help - show test names
+            cerr << "Usage: VectorViewTest has the following tests:" << endl;
+            const std::vector<Test*> &tests = VectorViewTest::suite()->getTests();
+            unsigned int prefix_len = VectorViewTest::suite()->getName().append("::").length();
+            for (std::vector<Test*>::const_iterator i = tests.begin(), e = tests.end(); i != e; ++i) {
+                cerr << (*i)->getName().replace(0, prefix_len, "") << endl;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+
+    CppUnit::TextTestRunner runner;
+    runner.addTest(CppUnit::TestFactoryRegistry::getRegistry().makeTest());
+
+    bool wasSuccessful = true;
+    string test = "";
+    int i = getopt.optind;
+    if (i == argc) {
+        // run them all
+        wasSuccessful = runner.run("");
+    }
+    else {
+        for (; i < argc; ++i) {
+            if (debug) cerr << "Running " << argv[i] << endl;
+            test = VectorViewTest::suite()->getName().append("::").append(argv[i]);
+            wasSuccessful = wasSuccessful && runner.run(test);
+        }
+    }
+
+    return wasSuccessful ? 0 : 1;
+}
@@ -32,6 +32,8 @@
 
 #include "debug.h"
 #include "util.h"
+#include "Int32.h"
+#include "Structure.h"
 #include "escaping.h"
 
 #include <cstring>
@@ -41,6 +43,7 @@
 using std::cerr;
 using std::endl;
 using std::string;
+using std::vector;
 
 using namespace CppUnit;
 using namespace libdap;
@@ -81,6 +84,7 @@ public:
     CPPUNIT_TEST (munge_error_message_test);
     CPPUNIT_TEST (id2xml_test);
     CPPUNIT_TEST (xml2id_test);
+    CPPUNIT_TEST (independent_groups_test);
 
     CPPUNIT_TEST (glob_test_1);
     CPPUNIT_TEST (glob_test_2);
@@ -366,6 +370,35 @@ public:
         CPPUNIT_ASSERT(xml2id("&apos;abc&apos;def") == "'abc'def");
         CPPUNIT_ASSERT(xml2id("&quot;abc&quot;def&quot;") == "\"abc\"def\"");
     }
+
+    void independent_groups_test()
+    {
+        Structure s("s");
+        s.add_var_nocopy(new Int32("x"));
+        s.add_var_nocopy(new Int32("y"));
+        Int32 a("a");
+        Int32 b("b");
+
+        // Calls 0 and 2 use parts of 's'; 3 uses 'b' and 's'; 4 uses 'a' like 1
+        vector<vector<BaseType*> > uses(6);
+        uses[0].push_back(s.var("x"));
+        uses[1].push_back(&a);
+        uses[2].push_back(s.var("y"));
+        uses[3].push_back(&b);
+        uses[3].push_back(&s);
+        uses[4].push_back(&a);
+        // uses[5] is empty
+
+        vector<vector<unsigned long> > groups;
+        independent_groups(uses, groups);
+
+        CPPUNIT_ASSERT(groups.size() == 3);
+        CPPUNIT_ASSERT(groups[0].size() == 3);
+        CPPUNIT_ASSERT(groups[0][0] == 0 && groups[0][1] == 2 && groups[0][2] == 3);
+        CPPUNIT_ASSERT(groups[1].size() == 2);
+        CPPUNIT_ASSERT(groups[1][0] == 1 && groups[1][1] == 4);
+        CPPUNIT_ASSERT(groups[2].size() == 1 && groups[2][0] == 5);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION (generalUtilTest);
@@ -62,6 +62,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <stdexcept>
 
@@ -75,6 +76,7 @@
 #include "Float64.h"
 #include "Str.h"
 #include "Array.h"
+#include "VectorView.h"
 
 #include "Int64.h"
 #include "UInt64.h"
@@ -135,12 +137,9 @@ template<class T> static void set_array_using_double_helper(Array *a, double *sr
     assert(src);
     assert(src_len > 0);
 
-    vector<T> values(src_len);
-    for (int i = 0; i < src_len; ++i)
-        values[i] = (T) src[i];
-
-    // This copies the values
-    a->set_value(values, src_len);
+    // Convert the values straight into the Array's own storage
+    a->reserve_value_capacity(src_len);
+    convert_values(VectorView<const double>(src, src_len), VectorView<T>(*a));
 }
 
 /** Given an array that holds some sort of numeric data, load it with values
@@ -232,98 +231,90 @@ void set_array_using_double(Array *dest, double *src, int src_len)
     dest->set_read_p(true);
 }
 
-template<class T> static double *extract_double_array_helper(Array * a)
+template<class T> static void extract_double_array_helper(Array *a, double *dest)
 {
     assert(a);
+    assert(dest);
 
-    int length = a->length();
-
-    vector<T> b(length);
-    a->value(&b[0]);    // Extract the values of 'a' to 'b'
-
-    double *dest = new double[length];
-    for (int i = 0; i < length; ++i)
-        dest[i] = (double) b[i];
-
-    return dest;
+    // Read the values where the Array holds them; the only copy is the one
+    // that converts them to doubles.
+    VectorView<const T> src(*a);
+    convert_values(src, VectorView<double>(dest, src.size()));
 }
 
-/**
- * Given a pointer to an Array which holds a numeric type, extract the
- * values and return in an array of doubles. This function allocates the
- * array using 'new double[n]' so delete[] MUST be used when you are done
- * the data.
- *
- * @note Support added for DAP4.
- * @param a Extract value from this Array.
- * @return A C++/C array of doubles.
- */
-double *extract_double_array(Array * a)
+// Convert the values of 'a' and write them to 'dest', which must have room
+// for a->length() values.
+static void extract_double_values(Array *a, double *dest)
 {
-    assert(a);
-
-    // Simple types are Byte, ..., Float64, String and Url.
-    if ((a->type() == dods_array_c && !a->var()->is_simple_type()) || a->var()->type() == dods_str_c
-            || a->var()->type() == dods_url_c)
-        throw Error(malformed_expr, "The function requires a DAP numeric-type array argument.");
-
-    if (!a->read_p())
-        throw InternalErr(__FILE__, __LINE__, string("The Array '") + a->name() + "'does not contain values.");
-
     // The types of arguments that the CE Parser will build for numeric
     // constants are limited to Uint32, Int32 and Float64. See ce_expr.y.
     // Expanded to work for any numeric type so it can be used for more than
     // just arguments.
     switch (a->var()->type()) {
     case dods_byte_c:
-        return extract_double_array_helper<dods_byte>(a);
+        return extract_double_array_helper<dods_byte>(a, dest);
     case dods_uint16_c:
-        return extract_double_array_helper<dods_uint16>(a);
+        return extract_double_array_helper<dods_uint16>(a, dest);
     case dods_int16_c:
-        return extract_double_array_helper<dods_int16>(a);
+        return extract_double_array_helper<dods_int16>(a, dest);
     case dods_uint32_c:
-        return extract_double_array_helper<dods_uint32>(a);
+        return extract_double_array_helper<dods_uint32>(a, dest);
     case dods_int32_c:
-        return extract_double_array_helper<dods_int32>(a);
+        return extract_double_array_helper<dods_int32>(a, dest);
     case dods_float32_c:
-        return extract_double_array_helper<dods_float32>(a);
+        return extract_double_array_helper<dods_float32>(a, dest);
     case dods_float64_c:
-        // Should not be copying these values, just read them,
-        // but older code may depend on the return of this function
-        // being something that should be deleted, so leave this
-        // alone. jhrg 2/24/15
-        return extract_double_array_helper<dods_float64>(a);
+        return extract_double_array_helper<dods_float64>(a, dest);
 
         // Support for DAP4
     case dods_uint8_c:
-        return extract_double_array_helper<dods_byte>(a);
+        return extract_double_array_helper<dods_byte>(a, dest);
     case dods_int8_c:
-        return extract_double_array_helper<dods_int8>(a);
+        return extract_double_array_helper<dods_int8>(a, dest);
     case dods_uint64_c:
-        return extract_double_array_helper<dods_uint64>(a);
+        return extract_double_array_helper<dods_uint64>(a, dest);
     case dods_int64_c:
-        return extract_double_array_helper<dods_int64>(a);
+        return extract_double_array_helper<dods_int64>(a, dest);
     default:
         throw InternalErr(__FILE__, __LINE__,
                 "The argument list built by the CE parser contained an unsupported numeric type.");
     }
 }
 
-// This helper function assumes 'dest' is the correct size. This should not
-// be called when the Array 'a' is a Float64, since the values are already
-// in a double array!
-template<class T> static void extract_double_array_helper(Array * a, vector<double> &dest)
+/**
+ * Given a pointer to an Array which holds a numeric type, extract the
+ * values and return in an array of doubles. This function allocates the
+ * array using 'new double[n]' so delete[] MUST be used when you are done
+ * the data.
+ *
+ * @note Support added for DAP4.
+ * @param a Extract value from this Array.
+ * @return A C++/C array of doubles.
+ */
+double *extract_double_array(Array * a)
 {
     assert(a);
-    assert(dest.size() == (unsigned long )a->length());
 
-    int length = a->length();
+    // Simple types are Byte, ..., Float64, String and Url.
+    if ((a->type() == dods_array_c && !a->var()->is_simple_type()) || a->var()->type() == dods_str_c
+            || a->var()->type() == dods_url_c)
+        throw Error(malformed_expr, "The function requires a DAP numeric-type array argument.");
 
-    vector<T> b(length);
-    a->value(&b[0]);    // Extract the values of 'a' to 'b'
+    if (!a->read_p())
+        throw InternalErr(__FILE__, __LINE__, string("The Array '") + a->name() + "'does not contain values.");
 
-    for (int i = 0; i < length; ++i)
-        dest[i] = (double) b[i];
+    // Older code may depend on the return of this function being something
+    // that should be deleted, so Float64 values are copied too. jhrg 2/24/15
+    double *dest = new double[a->length()];
+    try {
+        extract_double_values(a, dest);
+    }
+    catch (...) {
+        delete[] dest;
+        throw;
+    }
+
+    return dest;
 }
 
 /**
@@ -353,41 +344,8 @@ void extract_double_array(Array *a, vector<double> &dest)
         throw InternalErr(__FILE__, __LINE__, string("The Array '") + a->name() + "' does not contain values.");
 
     dest.resize(a->length());
-
-    // The types of arguments that the CE Parser will build for numeric
-    // constants are limited to Uint32, Int32 and Float64. See ce_expr.y.
-    // Expanded to work for any numeric type so it can be used for more than
-    // just arguments.
-    switch (a->var()->type()) {
-    case dods_byte_c:
-        return extract_double_array_helper<dods_byte>(a, dest);
-    case dods_uint16_c:
-        return extract_double_array_helper<dods_uint16>(a, dest);
-    case dods_int16_c:
-        return extract_double_array_helper<dods_int16>(a, dest);
-    case dods_uint32_c:
-        return extract_double_array_helper<dods_uint32>(a, dest);
-    case dods_int32_c:
-        return extract_double_array_helper<dods_int32>(a, dest);
-    case dods_float32_c:
-        return extract_double_array_helper<dods_float32>(a, dest);
-    case dods_float64_c:
-        return a->value(&dest[0]);      // no need to copy the values
-        // return extract_double_array_helper<dods_float64>(a, dest);
-
-        // Support for DAP4
-    case dods_uint8_c:
-        return extract_double_array_helper<dods_byte>(a, dest);
-    case dods_int8_c:
-        return extract_double_array_helper<dods_int8>(a, dest);
-    case dods_uint64_c:
-        return extract_double_array_helper<dods_uint64>(a, dest);
-    case dods_int64_c:
-        return extract_double_array_helper<dods_int64>(a, dest);
-    default:
-        throw InternalErr(__FILE__, __LINE__,
-                "The argument list built by the CE parser contained an unsupported numeric type.");
-    }
+    if (!dest.empty())
+        extract_double_values(a, &dest[0]);
 }
 
 /** Given a BaseType pointer, extract the numeric value it contains and return
@@ -475,6 +433,66 @@ string prune_spaces(const string &name)
     }
 }
 
+// The variable at the top of the tree that holds btp. Variables in a DMR
+// stop below their Group, since all of them share the root group.
+static BaseType *top_level_variable(BaseType *btp)
+{
+    while (btp->get_parent() && btp->get_parent()->type() != dods_group_c)
+        btp = btp->get_parent();
+
+    return btp;
+}
+
+// The representative of element i in the forest 'parent'
+static unsigned long find_group(vector<unsigned long> &parent, unsigned long i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+/** @brief Sort function calls into groups that can run at the same time.
+
+    Element i of \e uses lists the variables that the i-th function call
+    reads. Two calls that read parts of the same top-level variable (or
+    of the same variable in a DMR's Group) depend on each other, as do
+    calls that both depend on a third call. Each group holds the indices
+    of calls that depend on one another, in increasing order, and the
+    groups are in the order of their first calls. A call in one group
+    shares no variables with a call in another, so the groups can be
+    evaluated by different threads.
+
+    @param uses The variables used by each call
+    @param groups Value-result parameter; the groups of calls */
+void independent_groups(const vector<vector<BaseType*> > &uses, vector<vector<unsigned long> > &groups)
+{
+    vector<unsigned long> parent(uses.size());
+    for (unsigned long i = 0; i < parent.size(); ++i)
+        parent[i] = i;
+
+    // Join each call with the first call that used the same variable
+    map<BaseType*, unsigned long> first_use;
+    for (unsigned long i = 0; i < uses.size(); ++i) {
+        for (vector<BaseType*>::const_iterator v = uses[i].begin(), e = uses[i].end(); v != e; ++v) {
+            pair<map<BaseType*, unsigned long>::iterator, bool> r = first_use.insert(make_pair(top_level_variable(*v), i));
+            if (!r.second)
+                parent[find_group(parent, i)] = find_group(parent, r.first->second);
+        }
+    }
+
+    groups.clear();
+    map<unsigned long, unsigned long> group_of;  // representative -> index in groups
+    for (unsigned long i = 0; i < uses.size(); ++i) {
+        pair<map<unsigned long, unsigned long>::iterator, bool> r = group_of.insert(make_pair(find_group(parent, i), groups.size()));
+        if (r.second)
+            groups.push_back(vector<unsigned long>());
+        groups[r.first->second].push_back(i);
+    }
+}
+
 // Compare elements in a list of (BaseType *)s and return true if there are
 // no duplicate elements, otherwise return false.
 
@@ -67,6 +67,7 @@ bool is_host_big_endian();
 
 string prune_spaces(const string &);
 bool unique_names(vector<BaseType *> l, const string &var, const string &type, string &msg);
+void independent_groups(const vector<vector<BaseType*> > &uses, vector<vector<unsigned long> > &groups);
 string systime();
 const char *libdap_root();
 extern "C" const char *libdap_version();